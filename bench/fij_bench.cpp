@@ -0,0 +1,488 @@
+#include <algorithm>
+#include <cstdio>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <linux/fij.h>
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+using json   = nlohmann::json;
+
+// -----------------------------------------------------------------------------
+// fij overhead microbenchmarks
+// -----------------------------------------------------------------------------
+//
+// Drives the module directly, without the campaign runner, against the tiny
+// programs in bench/programs. For every program and ioctl path it reports
+// runs/sec and the per-phase latencies stamped by the kernel; a scaling
+// sweep runs the busy loop on 1..N concurrent fds. Results are written as
+// JSON; --compare diffs two result files and fails on regressions.
+
+namespace {
+
+struct BenchProgram {
+    const char *name;
+    const char *binary;
+    const char *args;
+    bool only_mem;
+};
+
+const BenchProgram kPrograms[] = {
+    {"busy_loop", "busy_loop", "",    false},
+    {"fork_tree", "fork_tree", "3",   false},
+    {"spinner",   "spinner",   "4",   false},
+    {"big_rss",   "big_rss",   "128", true},
+};
+
+enum BenchPath {
+    PATH_EXEC_AND_FAULT,    // blocking IOCTL_EXEC_AND_FAULT
+    PATH_SEND_POLL,         // IOCTL_SEND_MSG + polled IOCTL_RECEIVE_MSG, as fij_runner
+};
+
+const char *kPathNames[] = {"exec_and_fault", "send_poll"};
+
+// kernel-stamped phases, see the ts_* fields of fij_result: stop_wait is the
+// wait for the victim to stop, monitor_completion runs from the target's exit
+// to the monitor's teardown being done, without any userspace polling
+const char *kMetrics[] = {"wall", "exec", "stop_wait", "flip_to_resume", "monitor_completion"};
+constexpr int kNrMetrics = 5;
+
+// an injected run is killed past this multiple of the golden run, as the runner does
+constexpr int kDeadlineFactor = 10;
+
+struct BenchOptions {
+    std::string device       = "/dev/fij";
+    fs::path programs_dir    = "programs";
+    int runs                 = 200;
+    int max_fds              = 64;
+    int poll_us              = 100;
+    std::string out          = "bench_results.json";
+    std::vector<std::string> only;  // program names, empty = all
+};
+
+struct Samples {
+    std::vector<std::uint64_t> ns[kNrMetrics];
+    long completed = 0;
+    long failed    = 0;
+    long injected  = 0;
+    long ebusy     = 0;
+    long killed    = 0;     // past the deadline: CPU budget or IOCTL_KILL_TARGET
+    std::uint64_t cpu_ns_max = 0;
+
+    void add(const struct fij_result &res, std::uint64_t wall_ns) {
+        completed++;
+        if (res.cpu_budget_exceeded) killed++;
+        cpu_ns_max = std::max<std::uint64_t>(cpu_ns_max, res.cpu_ns);
+        ns[0].push_back(wall_ns);
+        if (res.ts_exec_done > res.ts_exec_start)
+            ns[1].push_back(res.ts_exec_done - res.ts_exec_start);
+        if (res.fault_injected) {
+            injected++;
+            if (res.ts_flip_stopped >= res.ts_flip_start && res.ts_flip_start)
+                ns[2].push_back(res.ts_flip_stopped - res.ts_flip_start);
+            if (res.ts_flip_end >= res.ts_flip_stopped && res.ts_flip_stopped)
+                ns[3].push_back(res.ts_flip_end - res.ts_flip_stopped);
+        }
+        if (res.ts_monitor_done >= res.ts_exit && res.ts_exit)
+            ns[4].push_back(res.ts_monitor_done - res.ts_exit);
+    }
+
+    void merge(const Samples &o) {
+        for (int m = 0; m < kNrMetrics; ++m)
+            ns[m].insert(ns[m].end(), o.ns[m].begin(), o.ns[m].end());
+        completed += o.completed;
+        failed    += o.failed;
+        injected  += o.injected;
+        ebusy     += o.ebusy;
+        killed    += o.killed;
+    }
+};
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+template <std::size_t N>
+void set_cstring(char (&dst)[N], const std::string &src) {
+    std::snprintf(dst, N, "%s", src.c_str());
+}
+
+// -----------------------------------------------------------------------------
+// One run through the module
+// -----------------------------------------------------------------------------
+
+bool bench_run(const BenchOptions &opt, const struct fij_params &params, BenchPath path,
+               Samples &s) {
+    // the blocking path is bounded by params.cpu_budget_ns alone
+    std::uint64_t deadline_ns = params.no_injection ? 0
+        : static_cast<std::uint64_t>(kDeadlineFactor) * params.max_delay_ms * 1000000ULL;
+    std::uint64_t start = now_ns();
+    int fd = ::open(opt.device.c_str(), O_RDWR);
+    if (fd < 0) {
+        s.failed++;
+        return false;
+    }
+
+    struct fij_result res{};
+    bool ok = false, killed = false;
+
+    if (path == PATH_EXEC_AND_FAULT) {
+        struct fij_exec msg{};
+        msg.params = params;
+        ok = ::ioctl(fd, IOCTL_EXEC_AND_FAULT, &msg) == 0;
+        res = msg.result;
+    } else {
+        struct fij_params p = params;
+        int rc;
+        while ((rc = ::ioctl(fd, IOCTL_SEND_MSG, &p)) != 0 && errno == EBUSY) {
+            s.ebusy++;
+            std::this_thread::sleep_for(std::chrono::microseconds(opt.poll_us));
+        }
+        if (rc == 0) {
+            while ((rc = ::ioctl(fd, IOCTL_RECEIVE_MSG, &res)) != 0 &&
+                   (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (deadline_ns && !killed && now_ns() - start >= deadline_ns) {
+                    ::ioctl(fd, IOCTL_KILL_TARGET);
+                    killed = true;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(opt.poll_us));
+            }
+            ok = rc == 0;
+        }
+    }
+    ::close(fd);
+
+    if (!ok) {
+        s.failed++;
+        return false;
+    }
+    s.add(res, now_ns() - start);
+    if (killed && !res.cpu_budget_exceeded) s.killed++;
+    return true;
+}
+
+struct GoldenRun {
+    int delay_ms = 1;               // injection window: mean wall time
+    std::uint64_t cpu_ns_max = 0;   // CPU time of the tree, 0 if not reported
+};
+
+struct fij_params make_params(const BenchOptions &opt, const BenchProgram &prog, bool no_injection,
+                              const GoldenRun &golden = {}) {
+    struct fij_params p{};
+    fs::path bin = opt.programs_dir / prog.binary;
+
+    set_cstring(p.process_name, prog.binary);
+    set_cstring(p.process_path, fs::absolute(bin).string());
+    set_cstring(p.process_args, prog.args);
+    set_cstring(p.log_path, "/dev/null");
+    p.only_mem      = prog.only_mem ? 1 : 0;
+    p.no_injection  = no_injection ? 1 : 0;
+    p.max_delay_ms  = no_injection ? 0 : golden.delay_ms;
+    p.perf_counters = 1;     // as fij_runner does by default
+    // a flip can leave the target spinning; without a CPU time, all cores for the window
+    if (!no_injection) {
+        std::uint64_t cpu_ns = golden.cpu_ns_max ? golden.cpu_ns_max
+            : static_cast<std::uint64_t>(golden.delay_ms) * 1000000ULL *
+              std::max(1u, std::thread::hardware_concurrency());
+        p.cpu_budget_ns = kDeadlineFactor * cpu_ns;
+    }
+    return p;
+}
+
+// Injection window and deadline from a few golden runs, like the runner
+GoldenRun golden_run(const BenchOptions &opt, const BenchProgram &prog) {
+    GoldenRun g;
+    Samples s;
+    struct fij_params p = make_params(opt, prog, true);
+    for (int i = 0; i < 3; ++i) bench_run(opt, p, PATH_EXEC_AND_FAULT, s);
+    g.cpu_ns_max = s.cpu_ns_max;
+    if (s.ns[0].empty()) return g;
+
+    double sum = 0;
+    for (std::uint64_t v : s.ns[0]) sum += static_cast<double>(v);
+    g.delay_ms = std::max(1, static_cast<int>(std::lround(sum / s.ns[0].size() / 1e6)));
+    return g;
+}
+
+// -----------------------------------------------------------------------------
+// Statistics
+// -----------------------------------------------------------------------------
+
+json summarize(std::vector<std::uint64_t> v) {
+    json j;
+    j["count"] = v.size();
+    if (v.empty()) return j;
+
+    std::sort(v.begin(), v.end());
+    auto pct = [&](double q) {
+        std::size_t idx = static_cast<std::size_t>(std::ceil(q * v.size()));
+        return v[std::min(v.size() - 1, idx ? idx - 1 : 0)];
+    };
+    double sum = 0;
+    for (std::uint64_t x : v) sum += static_cast<double>(x);
+
+    j["mean"] = static_cast<std::uint64_t>(sum / v.size());
+    j["p50"]  = pct(0.50);
+    j["p90"]  = pct(0.90);
+    j["p99"]  = pct(0.99);
+    j["max"]  = v.back();
+    return j;
+}
+
+json report(const Samples &s, double elapsed_s) {
+    json j;
+    j["completed"]    = s.completed;
+    j["failed"]       = s.failed;
+    j["injected"]     = s.injected;
+    j["ebusy"]        = s.ebusy;
+    j["killed"]       = s.killed;
+    j["runs_per_sec"] = elapsed_s > 0 ? s.completed / elapsed_s : 0.0;
+    for (int m = 0; m < kNrMetrics; ++m)
+        j["latency_ns"][kMetrics[m]] = summarize(s.ns[m]);
+    return j;
+}
+
+// -----------------------------------------------------------------------------
+// Benchmarks
+// -----------------------------------------------------------------------------
+
+json bench_paths(const BenchOptions &opt) {
+    json out = json::array();
+
+    for (const auto &prog : kPrograms) {
+        if (!opt.only.empty() &&
+            std::find(opt.only.begin(), opt.only.end(), prog.name) == opt.only.end())
+            continue;
+
+        GoldenRun golden = golden_run(opt, prog);
+        struct fij_params p = make_params(opt, prog, false, golden);
+
+        for (BenchPath path : {PATH_EXEC_AND_FAULT, PATH_SEND_POLL}) {
+            Samples s;
+            std::uint64_t t0 = now_ns();
+            for (int i = 0; i < opt.runs; ++i) {
+                p.iteration_number = i;
+                bench_run(opt, p, path, s);
+            }
+            double elapsed = (now_ns() - t0) / 1e9;
+
+            json j = report(s, elapsed);
+            j["program"]      = prog.name;
+            j["path"]         = kPathNames[path];
+            j["max_delay_ms"]  = golden.delay_ms;
+            j["cpu_budget_ns"] = p.cpu_budget_ns;
+            out.push_back(j);
+
+            std::cout << std::left << std::setw(10) << prog.name << " " << std::setw(15)
+                      << kPathNames[path] << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(8) << j["runs_per_sec"].get<double>() << " runs/s"
+                      << "  exec p50 " << std::setw(8)
+                      << j["latency_ns"]["exec"].value("p50", 0ULL) / 1000.0 << " us"
+                      << "  stop p50 " << std::setw(8)
+                      << j["latency_ns"]["stop_wait"].value("p50", 0ULL) / 1000.0 << " us"
+                      << "  failed " << s.failed << "\n";
+        }
+    }
+    return out;
+}
+
+json bench_scaling(const BenchOptions &opt) {
+    json out = json::array();
+    const BenchProgram &prog = kPrograms[0];
+    struct fij_params p = make_params(opt, prog, false, golden_run(opt, prog));
+
+    for (int fds = 1; fds <= opt.max_fds; fds *= 2) {
+        int per_fd = std::max(4, opt.runs / fds);
+        std::vector<Samples> per_thread(fds);
+        std::vector<std::thread> threads;
+
+        std::uint64_t t0 = now_ns();
+        for (int t = 0; t < fds; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < per_fd; ++i) bench_run(opt, p, PATH_SEND_POLL, per_thread[t]);
+            });
+        }
+        for (auto &th : threads) th.join();
+        double elapsed = (now_ns() - t0) / 1e9;
+
+        Samples all;
+        for (const auto &s : per_thread) all.merge(s);
+
+        json j = report(all, elapsed);
+        j["fds"] = fds;
+        out.push_back(j);
+
+        std::cout << "scaling   " << std::setw(3) << fds << " fds " << std::fixed
+                  << std::setprecision(1) << std::setw(8) << j["runs_per_sec"].get<double>()
+                  << " runs/s  wall p99 " << std::setw(8)
+                  << j["latency_ns"]["wall"].value("p99", 0ULL) / 1e6 << " ms  ebusy " << all.ebusy
+                  << "\n";
+    }
+    return out;
+}
+
+// -----------------------------------------------------------------------------
+// Compare mode
+// -----------------------------------------------------------------------------
+
+// Worse by more than threshold percent: lower is better for latencies,
+// higher for throughput
+bool regressed(double base, double cur, bool higher_is_better, double threshold) {
+    if (base <= 0) return false;
+    double change = (cur - base) / base * 100.0;
+    return higher_is_better ? change < -threshold : change > threshold;
+}
+
+int compare_one(const std::string &what, const json &base, const json &cur, double threshold) {
+    int regressions = 0;
+
+    auto line = [&](const std::string &metric, double b, double c, bool higher_is_better) {
+        bool bad = regressed(b, c, higher_is_better, threshold);
+        double change = b > 0 ? (c - b) / b * 100.0 : 0.0;
+        std::cout << std::left << std::setw(34) << what << std::setw(28) << metric << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(14) << b << std::setw(14) << c
+                  << std::showpos << std::setw(9) << change << "%" << std::noshowpos
+                  << (bad ? "  REGRESSION" : "") << "\n";
+        regressions += bad;
+    };
+
+    line("runs_per_sec", base.value("runs_per_sec", 0.0), cur.value("runs_per_sec", 0.0), true);
+    for (const char *m : kMetrics) {
+        for (const char *q : {"p50", "p99"}) {
+            json b = base.value("latency_ns", json::object()).value(m, json::object());
+            json c = cur.value("latency_ns", json::object()).value(m, json::object());
+            if (!b.contains(q) || !c.contains(q)) continue;
+            line(std::string(m) + " " + q + " (us)", b[q].get<double>() / 1000.0,
+                 c[q].get<double>() / 1000.0, false);
+        }
+    }
+    return regressions;
+}
+
+int compare(const std::string &base_path, const std::string &cur_path, double threshold) {
+    json base, cur;
+    try {
+        std::ifstream(base_path) >> base;
+        std::ifstream(cur_path) >> cur;
+    } catch (const std::exception &e) {
+        std::cerr << "Cannot read results: " << e.what() << "\n";
+        return 2;
+    }
+
+    std::map<std::string, json> base_paths, base_scaling;
+    for (const auto &j : base.value("paths", json::array()))
+        base_paths[j["program"].get<std::string>() + "/" + j["path"].get<std::string>()] = j;
+    for (const auto &j : base.value("scaling", json::array()))
+        base_scaling[std::to_string(j["fds"].get<int>()) + " fds"] = j;
+
+    int regressions = 0;
+    for (const auto &j : cur.value("paths", json::array())) {
+        std::string key = j["program"].get<std::string>() + "/" + j["path"].get<std::string>();
+        auto it = base_paths.find(key);
+        if (it != base_paths.end()) regressions += compare_one(key, it->second, j, threshold);
+    }
+    for (const auto &j : cur.value("scaling", json::array())) {
+        std::string key = std::to_string(j["fds"].get<int>()) + " fds";
+        auto it = base_scaling.find(key);
+        if (it != base_scaling.end()) regressions += compare_one(key, it->second, j, threshold);
+    }
+
+    std::cout << "\n" << regressions << " regression(s) beyond " << threshold << "%\n";
+    return regressions ? 1 : 0;
+}
+
+void usage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " [--device DEV] [--programs DIR] [--runs N] [--max-fds N]\n"
+              << "           [--poll-us N] [--only NAME[,NAME...]] [--out FILE]\n"
+              << "       " << argv0 << " --compare BASE.json NEW.json [--threshold PCT]\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    BenchOptions opt;
+    std::string compare_base, compare_cur;
+    double threshold = 10.0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (a == "--device")          opt.device = next();
+        else if (a == "--programs")   opt.programs_dir = next();
+        else if (a == "--runs")       opt.runs = std::stoi(next());
+        else if (a == "--max-fds")    opt.max_fds = std::stoi(next());
+        else if (a == "--poll-us")    opt.poll_us = std::stoi(next());
+        else if (a == "--out")        opt.out = next();
+        else if (a == "--threshold")  threshold = std::stod(next());
+        else if (a == "--compare") {
+            compare_base = next();
+            compare_cur  = next();
+        } else if (a == "--only") {
+            std::string list = next();
+            std::size_t pos;
+            while ((pos = list.find(',')) != std::string::npos) {
+                opt.only.push_back(list.substr(0, pos));
+                list.erase(0, pos + 1);
+            }
+            if (!list.empty()) opt.only.push_back(list);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (!compare_base.empty()) return compare(compare_base, compare_cur, threshold);
+
+    if (!fs::exists(opt.device)) {
+        std::cerr << "Device " << opt.device << " does not exist (module loaded?)\n";
+        return 1;
+    }
+
+    json doc;
+    struct utsname uts{};
+    ::uname(&uts);
+    doc["meta"] = {
+        {"kernel",  uts.release},
+        {"machine", uts.machine},
+        {"cpus",    std::thread::hardware_concurrency()},
+        {"runs",    opt.runs},
+        {"poll_us", opt.poll_us},
+        {"time",    static_cast<long long>(std::time(nullptr))},
+    };
+    doc["paths"]   = bench_paths(opt);
+    doc["scaling"] = bench_scaling(opt);
+
+    std::ofstream out(opt.out);
+    if (!out) {
+        std::cerr << "Cannot write " << opt.out << "\n";
+        return 1;
+    }
+    out << doc.dump(2) << "\n";
+    std::cout << "\nResults written to " << opt.out << "\n";
+    return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * big_rss [megabytes] [passes]
+ *
+ * Touches a large heap buffer page by page, then sums it. Memory flips land
+ * in a big writable mapping and per-run RSS accounting has something to
+ * measure.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int main(int argc, char **argv)
+{
+    size_t mb = argc > 1 ? strtoul(argv[1], NULL, 0) : 128;
+    int passes = argc > 2 ? atoi(argv[2]) : 2;
+    size_t len = mb << 20;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    unsigned long sum = 0;
+    unsigned char *buf;
+    size_t i;
+    int p;
+
+    buf = malloc(len);
+    if (!buf)
+        return 2;
+
+    for (i = 0; i < len; i += page)
+        buf[i] = (unsigned char)(i / page);
+
+    for (p = 0; p < passes; p++) {
+        for (i = 0; i < len; i += page)
+            sum += buf[i];
+    }
+
+    printf("%lu\n", sum);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,21 @@
+/*
+ * busy_loop [iterations]
+ *
+ * Single-threaded integer loop, the cheapest possible target: what is left
+ * of a run's latency is fij overhead.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char **argv)
+{
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 0) : 20000000UL;
+    volatile unsigned long acc = 0;
+    unsigned long i;
+
+    for (i = 0; i < n; i++)
+        acc = acc * 6364136223846793005UL + i;
+
+    printf("%lu\n", (unsigned long)acc);
+    return 0;
+}
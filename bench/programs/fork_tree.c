@@ -0,0 +1,55 @@
+/*
+ * fork_tree [depth] [iterations]
+ *
+ * Every process forks two children until depth is reached, then spins;
+ * parents wait for their children. Exercises process selection and the
+ * accounting of reaped children.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void spin(unsigned long n)
+{
+    volatile unsigned long acc = 0;
+    unsigned long i;
+
+    for (i = 0; i < n; i++)
+        acc += i ^ (acc << 1);
+}
+
+int main(int argc, char **argv)
+{
+    int depth = argc > 1 ? atoi(argv[1]) : 3;
+    unsigned long n = argc > 2 ? strtoul(argv[2], NULL, 0) : 2000000UL;
+    int status, failed = 0;
+    int level, k;
+
+    for (level = 0; level < depth; level++) {
+        pid_t kids[2];
+        int child = 0;
+
+        for (k = 0; k < 2 && !child; k++) {
+            kids[k] = fork();
+            if (kids[k] < 0)
+                return 2;
+            child = kids[k] == 0;
+        }
+        /* children go one level deeper */
+        if (child)
+            continue;
+
+        spin(n);
+        for (k = 0; k < 2; k++) {
+            if (waitpid(kids[k], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+                failed = 1;
+        }
+        if (level == 0)
+            printf("%s\n", failed ? "child failed" : "ok");
+        return failed;
+    }
+
+    spin(n);
+    return 0;
+}
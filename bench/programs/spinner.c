@@ -0,0 +1,53 @@
+/*
+ * spinner [threads] [iterations]
+ *
+ * N threads spinning on private counters. Exercises thread selection and
+ * the stop/resume of one thread while the others keep running.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned long iterations = 5000000UL;
+
+static void *spin(void *arg)
+{
+    volatile unsigned long acc = (unsigned long)arg;
+    unsigned long i;
+
+    for (i = 0; i < iterations; i++)
+        acc = acc * 2862933555777941757UL + 3037000493UL;
+    return (void *)(unsigned long)acc;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    pthread_t *tids;
+    unsigned long sum = 0;
+    int t;
+
+    if (argc > 2)
+        iterations = strtoul(argv[2], NULL, 0);
+    if (threads < 1)
+        threads = 1;
+
+    tids = calloc(threads, sizeof(*tids));
+    if (!tids)
+        return 2;
+
+    for (t = 0; t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, spin, (void *)(unsigned long)t))
+            return 2;
+    }
+    for (t = 0; t < threads; t++) {
+        void *ret;
+
+        pthread_join(tids[t], &ret);
+        sum += (unsigned long)ret;
+    }
+
+    printf("%lu\n", sum);
+    free(tids);
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "fij_internal.h"
+#include "fij_trace.h"
 #include <linux/mm.h>
 #include <linux/mm_types.h>
 #include <linux/random.h>
@@ -16,7 +17,7 @@ int fij_group_stop(pid_t tgid)
     struct task_struct *task;
     int ret = -ESRCH;
 
-    pr_info("preparing to stop %d", tgid);
+    fij_info("preparing to stop %d", tgid);
     /* * RCU protects the task_struct from disappearing while we use it.
      * We don't need get_task_struct() if we stay inside the RCU block.
      */
@@ -27,7 +28,7 @@ int fij_group_stop(pid_t tgid)
     
     if (task) {
         ret = send_sig(SIGSTOP, task, 1);
-        pr_info("stopped PID %d", tgid);
+        fij_info("stopped PID %d", tgid);
     }
     
     rcu_read_unlock();
@@ -39,30 +40,42 @@ int fij_group_stop(pid_t tgid)
 int fij_flip_register_from_ptregs(struct fij_ctx *ctx, struct pt_regs *regs, pid_t tgid)
 {
     int target_reg = ctx->exec.params.target_reg;
-    pr_info("target reg is: %d", target_reg);
-    /* if reg is null pick random value */
-    if (!ctx->exec.params.target_reg)
-        target_reg = fij_pick_random_reg_any();
-    /* if bit is null pick a random value */
-    int bit = ctx->exec.params.reg_bit_present ? ctx->exec.params.reg_bit : fij_pick_random_bit64();
+    unsigned long mask;
+    int bit;
+
+    if (fij_fault_set(ctx)) {
+        /* described fault: register and bits as given, nothing drawn or prefiltered */
+        target_reg = ctx->exec.params.fault.reg;
+        mask = ctx->exec.params.fault.mask;
+        bit = mask ? __ffs(mask) : -1;
+    } else {
+        fij_info("target reg is: %d", target_reg);
+        /* if reg is null pick random value */
+        if (!ctx->exec.params.target_reg)
+            target_reg = fij_pick_live_reg(ctx, regs, tgid);
+        /* if bit is null pick a random value */
+        bit = ctx->exec.params.reg_bit_present ? ctx->exec.params.reg_bit : fij_pick_random_bit64(ctx);
+        mask = (bit >= 0 && bit <= 63) ? (1UL << bit) : 0;
+    }
     unsigned long *p = fij_reg_ptr_from_ptregs(regs, target_reg);
 
     if (!p) {
         pr_err("bad reg (reg=%d)\n", target_reg);
         return -EINVAL;
     }
-    if (bit < 0 || bit > 63) {
+    if (!mask) {
         pr_err("bad bit (bit=%d)\n", bit);
         return -EINVAL;
     }
 
     unsigned long before = READ_ONCE(*p);
-    unsigned long mask = (1UL << bit);
     unsigned long after = before ^ mask;
     WRITE_ONCE(*p, after);
 
-    pr_info("FIJ: flipped %s bit %d (LSB=0): 0x%lx -> 0x%lx (TGID %d)\n",
+    fij_info("FIJ: flipped %s bit %d (LSB=0): 0x%lx -> 0x%lx (TGID %d)\n",
             fij_reg_name(target_reg), bit, before, after, tgid);
+    trace_fij_flip(tgid, false, fij_reg_name(target_reg), bit, 0, before, after);
+    fij_stat_inc(FIJ_STAT_INJ_REG);
 
     strscpy(ctx->exec.result.register_name, fij_reg_name(target_reg), sizeof(ctx->exec.result.register_name));
     WRITE_ONCE(ctx->exec.result.memory_flip, 0);
@@ -72,6 +85,24 @@ int fij_flip_register_from_ptregs(struct fij_ctx *ctx, struct pt_regs *regs, pid
     return 0;
 }
 
+/* Class of a mapping for mem_region, checked in order of precedence */
+static int fij_vma_region(struct mm_struct *mm, struct vm_area_struct *vma)
+{
+    if (vma->vm_flags & VM_EXEC)
+        return FIJ_MEM_TEXT;
+    if ((vma->vm_flags & VM_GROWSDOWN) ||
+        (vma->vm_start <= mm->start_stack && mm->start_stack < vma->vm_end))
+        return FIJ_MEM_STACK;
+    if (mm->brk > mm->start_brk && vma->vm_start < mm->brk && vma->vm_end > mm->start_brk)
+        return FIJ_MEM_HEAP;
+    if (!(vma->vm_flags & VM_WRITE))
+        return FIJ_MEM_RODATA;
+    /* .bss past the file-backed .data is anonymous but below the heap */
+    if (vma->vm_file || (vma->vm_start >= mm->start_data && vma->vm_end <= mm->start_brk))
+        return FIJ_MEM_DATA;
+    return FIJ_MEM_ANON;
+}
+
 /* Flip a random memory bit in the target process */
 int fij_perform_mem_bitflip(struct fij_ctx *ctx, pid_t tgid)
 {
@@ -79,7 +110,7 @@ int fij_perform_mem_bitflip(struct fij_ctx *ctx, pid_t tgid)
     struct mm_struct *mm = NULL;
     struct vm_area_struct *vma = NULL;
     unsigned long vma_size, offset, target_addr;
-    unsigned char orig_byte, flipped_byte;
+    unsigned char orig_byte, flipped_byte, byte_mask;
     int count = 0, target_idx, bit_to_flip;
     int ret = 0;
     bool is_file_backed = false;
@@ -107,29 +138,73 @@ int fij_perform_mem_bitflip(struct fij_ctx *ctx, pid_t tgid)
         goto out_put_mm;
     }
     {
-        /* 1. Count valid VMAs */
+        int region = READ_ONCE(ctx->exec.params.mem_region);
+        u64 *bytes = ctx->exec.result.mem_region_bytes;
+        u32 *vmas = ctx->exec.result.mem_region_vmas;
+        u64 pick;
+        bool by_byte;
         VMA_ITERATOR(vmi, mm, 0);
+
+        if (region < FIJ_MEM_ANY || region >= FIJ_MEM_REGIONS)
+            region = FIJ_MEM_ANY;
+        /* a described fault indexes bytes, whatever the region */
+        by_byte = fij_fault_set(ctx);
+
+        /* 1. Count valid VMAs and the mappings and bytes of every class */
+        memset(bytes, 0, sizeof(ctx->exec.result.mem_region_bytes));
+        memset(vmas, 0, sizeof(ctx->exec.result.mem_region_vmas));
         vma_iter_init(&vmi, mm, 0);
         for_each_vma(vmi, vma) {
-            if (!(vma->vm_flags & VM_IO) && !(vma->vm_flags & VM_PFNMAP))
+            if (!(vma->vm_flags & VM_IO) && !(vma->vm_flags & VM_PFNMAP)) {
+                int r = fij_vma_region(mm, vma);
+
                 count++;
+                vmas[FIJ_MEM_ANY]++;
+                vmas[r]++;
+                bytes[FIJ_MEM_ANY] += vma->vm_end - vma->vm_start;
+                bytes[r] += vma->vm_end - vma->vm_start;
+            }
         }
 
-        if (count == 0) {
+        if (count == 0 || (region != FIJ_MEM_ANY && !bytes[region])) {
             mmap_read_unlock(mm);
             ret = -ENOENT;
             goto out_put_mm;
         }
-        /* 2. Select a VMA */
-        target_idx = get_random_u32() % count;
+        /*
+         * 2. Select a VMA: any of the class (all of them without one)
+         * with equal chance, as an unrestricted flip does, so a class is
+         * its share of the mappings. A described fault names its byte
+         * (or its address) instead.
+         */
+        target_idx = by_byte ? 0 : fij_rand_below(ctx, vmas[region]);
+        pick = 0;
+        if (by_byte && !(ctx->exec.params.fault.flags & FIJ_FAULT_ADDR))
+            pick = ctx->exec.params.fault.location % bytes[region];
         count = 0;
         vma = NULL;
         vma_iter_init(&vmi, mm, 0);
-        for_each_vma(vmi, vma) {
-            if (!(vma->vm_flags & VM_IO) && !(vma->vm_flags & VM_PFNMAP)) {
-                if (count == target_idx)
-                    break;
-                count++;
+        if (fij_fault_set(ctx) && (ctx->exec.params.fault.flags & FIJ_FAULT_ADDR)) {
+            vma = vma_lookup(mm, ctx->exec.params.fault.location);
+            if (vma && ((vma->vm_flags & VM_IO) || (vma->vm_flags & VM_PFNMAP)))
+                vma = NULL;
+            if (vma)
+                pick = ctx->exec.params.fault.location - vma->vm_start;
+        } else {
+            for_each_vma(vmi, vma) {
+                if ((vma->vm_flags & VM_IO) || (vma->vm_flags & VM_PFNMAP))
+                    continue;
+                if (!by_byte) {
+                    if (region != FIJ_MEM_ANY && fij_vma_region(mm, vma) != region)
+                        continue;
+                    if (count == target_idx)
+                        break;
+                    count++;
+                } else if (region == FIJ_MEM_ANY || fij_vma_region(mm, vma) == region) {
+                    if (pick < vma->vm_end - vma->vm_start)
+                        break;
+                    pick -= vma->vm_end - vma->vm_start;
+                }
             }
         }
         if (!vma) {
@@ -141,9 +216,10 @@ int fij_perform_mem_bitflip(struct fij_ctx *ctx, pid_t tgid)
         if (vma->vm_file) {
             is_file_backed = true;
         }
+        WRITE_ONCE(ctx->exec.result.mem_region, fij_vma_region(mm, vma));
 
         vma_size = vma->vm_end - vma->vm_start;
-        offset = get_random_u32() % vma_size;
+        offset = by_byte ? pick : fij_rand_u64(ctx) % vma_size;
         target_addr = vma->vm_start + offset;
     }
     mmap_read_unlock(mm);
@@ -159,8 +235,17 @@ int fij_perform_mem_bitflip(struct fij_ctx *ctx, pid_t tgid)
         goto out_put_mm;
     }
 
-    bit_to_flip = get_random_u32() % 8;
-    flipped_byte = orig_byte ^ (1 << bit_to_flip);
+    if (fij_fault_set(ctx)) {
+        byte_mask = (u8)ctx->exec.params.fault.mask;
+        if (!byte_mask) {
+            ret = -EINVAL;
+            goto out_put_mm;
+        }
+    } else {
+        byte_mask = 1 << fij_rand_below(ctx, 8);
+    }
+    bit_to_flip = __ffs(byte_mask);
+    flipped_byte = orig_byte ^ byte_mask;
     /* 5. Write Flipped Byte */
     if (access_process_vm(task, target_addr, &flipped_byte, 1, FOLL_WRITE | FOLL_FORCE) != 1) {
         ret = -EFAULT;
@@ -187,17 +272,19 @@ int fij_perform_mem_bitflip(struct fij_ctx *ctx, pid_t tgid)
                 ctx->restore.offset = target_addr & ~PAGE_MASK;
                 ctx->restore.orig_byte = orig_byte;
                 ctx->restore.active = true;
-                pr_info("FIJ: File-backed injection detected at 0x%lx. Scheduled for restore.\n", target_addr);
+                fij_info("FIJ: File-backed injection detected at 0x%lx. Scheduled for restore.\n", target_addr);
             } else {
-                pr_warn("FIJ: Failed to pin file-backed page for restore at 0x%lx\n", target_addr);
+                fij_warn("FIJ: Failed to pin file-backed page for restore at 0x%lx\n", target_addr);
             }
         } else {
-            pr_warn("FIJ: Could not acquire lock to pin page (busy). Restoration may fail.\n");
+            fij_warn("FIJ: Could not acquire lock to pin page (busy). Restoration may fail.\n");
         }
     }
 
-    pr_info("bit flipped at 0x%lx (TGID %d): 0x%02x -> 0x%02x\n",
+    fij_info("bit flipped at 0x%lx (TGID %d): 0x%02x -> 0x%02x\n",
             target_addr, tgid, orig_byte, flipped_byte);
+    trace_fij_flip(tgid, true, "none", bit_to_flip, target_addr, orig_byte, flipped_byte);
+    fij_stat_inc(FIJ_STAT_INJ_MEM);
     
     WRITE_ONCE(ctx->exec.result.memory_flip, 1);
     WRITE_ONCE(ctx->exec.result.target_address, target_addr);
@@ -205,6 +292,10 @@ int fij_perform_mem_bitflip(struct fij_ctx *ctx, pid_t tgid)
     WRITE_ONCE(ctx->exec.result.target_after, flipped_byte);
     strscpy(ctx->exec.result.register_name, "none", 5);
 
+    /* target is still group-stopped: the watchpoint is in place before it runs */
+    if (ctx->exec.params.watch_masked)
+        fij_watch_arm(ctx, task, target_addr);
+
 out_put_mm:
     if (mm) mmput(mm);
 out_put_task:
@@ -219,6 +310,8 @@ static int fij_stop_flip_resume_all_threads(struct fij_ctx *ctx, pid_t tgid)
     int ret = 0, first_err = 0;
     bool did_mem = false;
 
+    fij_stamp(ctx, ts_flip_start);
+
     /* Stop the whole group via helper */
     ret = fij_group_stop(tgid);
     if (ret)
@@ -246,14 +339,19 @@ static int fij_stop_flip_resume_all_threads(struct fij_ctx *ctx, pid_t tgid)
 
         /* Wait for this thread to reach stopped state */
         this_ret = fij_wait_task_stopped(t, msecs_to_jiffies(100));
+        trace_fij_stop(tgid, t->pid, this_ret,
+                       ktime_get_ns() - ctx->exec.result.ts_flip_start);
         if (this_ret) {
             if (!first_err) first_err = this_ret;
             put_task_struct(t);
             continue;
         }
 
+        if (!ctx->exec.result.ts_flip_stopped)
+            fij_stamp(ctx, ts_flip_stopped);
+
         /* Perform the flip */
-        if (choose_register_target(ctx->exec.params.weight_mem,
+        if (choose_register_target(ctx, ctx->exec.params.weight_mem,
                                    ctx->exec.params.only_mem) ||
             ctx->exec.params.target_reg != FIJ_REG_NONE) {
             struct pt_regs *regs = task_pt_regs(t);
@@ -278,8 +376,18 @@ static int fij_stop_flip_resume_all_threads(struct fij_ctx *ctx, pid_t tgid)
 
     /* Resume the whole group via helper */
     fij_send_cont(tgid);
+    fij_stamp(ctx, ts_flip_end);
     put_task_struct(g);
 
+    if (first_err)
+        fij_stat_inc(FIJ_STAT_INJ_FAILED);
+    if (ctx->exec.result.ts_flip_stopped) {
+        fij_stat_lat(FIJ_LAT_STOP_WAIT,
+                     ctx->exec.result.ts_flip_stopped - ctx->exec.result.ts_flip_start);
+        fij_stat_lat(FIJ_LAT_FLIP,
+                     ctx->exec.result.ts_flip_end - ctx->exec.result.ts_flip_stopped);
+    }
+
     /*
      * If at least one thread op succeeded, return 0.
      * Otherwise return the first error we saw.
@@ -293,43 +401,48 @@ int fij_stop_flip_resume_one_random(struct fij_ctx *ctx)
     int ret = 0;
     int idx;
 
-    pr_info("start fij_stop_flip_resume_one_random\n");
+    fij_info("start fij_stop_flip_resume_one_random\n");
     /* Collect processes at runtime */
     ret = fij_collect_descendants(ctx, ctx->target_tgid);
     if (ret) {
-        pr_warn("FIJ: collect_descendants failed: %d\n", ret);
+        fij_warn("FIJ: collect_descendants failed: %d\n", ret);
         return ret;
     }
 
     if (ctx->ntargets <= 0) {
-        pr_warn("FIJ: No targets found (process exited?)\n");
+        fij_warn("FIJ: No targets found (process exited?)\n");
         return -ESRCH;
     }
 
-    if (ctx->exec.params.process_present) {
+    if (fij_fault_set(ctx)) {
+        /* described fault: its process, modulo the processes there are */
+        idx = (int)(ctx->exec.params.fault.process_sel % (u32)ctx->ntargets);
+    } else if (ctx->exec.params.process_present) {
         /* the index of the process was chosen */
         idx = ctx->exec.params.nprocess;
-        if (idx > ctx->ntargets || idx < 0) {
-            idx = (int)get_random_u32_below(ctx->ntargets);
+        if (idx >= ctx->ntargets || idx < 0) {
+            idx = (int)fij_rand_below(ctx, ctx->ntargets);
         }
     } else {
         /* Choose TGID of process to stop */
-        idx = (int)get_random_u32_below(ctx->ntargets);
+        idx = (int)fij_rand_below(ctx, ctx->ntargets);
     }
     WRITE_ONCE(ctx->exec.result.pid_idx, idx);
     pid_t tgid = ctx->targets[idx];
     WRITE_ONCE(ctx->exec.result.target_tgid, tgid);
 
-    if (READ_ONCE(ctx->exec.params.all_threads))
+    if (READ_ONCE(ctx->exec.params.all_threads) && !fij_fault_set(ctx))
         return fij_stop_flip_resume_all_threads(ctx, tgid);
 
-    if (ctx->exec.params.thread_present)
+    if (ctx->exec.params.thread_present && !fij_fault_set(ctx))
         t = fij_pick_user_thread_by_index(tgid, ctx->exec.params.thread, ctx);
     else
         t = fij_pick_random_user_thread(tgid, ctx);
     if (!t)
         return -ESRCH;
 
+    fij_stamp(ctx, ts_flip_start);
+
     /* Group-stop the process (affects all threads) */
     ret = fij_group_stop(tgid);
     if (ret) {
@@ -339,21 +452,33 @@ int fij_stop_flip_resume_one_random(struct fij_ctx *ctx)
 
     /* Wait for the chosen thread to be stopped */
     ret = fij_wait_task_stopped(t, msecs_to_jiffies(100));
+    trace_fij_stop(tgid, t->pid, ret, ktime_get_ns() - ctx->exec.result.ts_flip_start);
     if (!ret) {
-        pr_info("starting fij_flip_for_task");
+        fij_stamp(ctx, ts_flip_stopped);
+        fij_info("starting fij_flip_for_task");
         /* Flip only this thread's saved user regs */
         ret = fij_flip_for_task(ctx, t, tgid);
     }
     else {
-        pr_info("task was not stopped correctly, exiting bitflip thread");
+        fij_info("task was not stopped correctly, exiting bitflip thread");
     }
 
     if (ret == 0) {
         WRITE_ONCE(ctx->exec.result.fault_injected, 1);
+    } else {
+        fij_stat_inc(FIJ_STAT_INJ_FAILED);
     }
 
     /* Resume the whole group */
     fij_send_cont(tgid);
+    fij_stamp(ctx, ts_flip_end);
+
+    if (!ret) {
+        fij_stat_lat(FIJ_LAT_STOP_WAIT,
+                     ctx->exec.result.ts_flip_stopped - ctx->exec.result.ts_flip_start);
+        fij_stat_lat(FIJ_LAT_FLIP,
+                     ctx->exec.result.ts_flip_end - ctx->exec.result.ts_flip_stopped);
+    }
 
     put_task_struct(t);
     return ret;
@@ -363,15 +488,22 @@ int fij_flip_for_task(struct fij_ctx *ctx, struct task_struct *t, pid_t tgid)
 {
     struct pt_regs *regs = task_pt_regs(t);
 
-    if (choose_register_target(ctx->exec.params.weight_mem,
-                               ctx->exec.params.only_mem) ||
-        ctx->exec.params.target_reg != FIJ_REG_NONE) {
+    bool reg_flip;
+
+    if (fij_fault_set(ctx))
+        reg_flip = !(ctx->exec.params.fault.flags & FIJ_FAULT_MEM);
+    else
+        reg_flip = choose_register_target(ctx, ctx->exec.params.weight_mem,
+                                          ctx->exec.params.only_mem) ||
+                   ctx->exec.params.target_reg != FIJ_REG_NONE;
+
+    if (reg_flip) {
         if (!regs)
             return -EINVAL;
-        pr_info("starting flip in register");
+        fij_info("starting flip in register");
         return fij_flip_register_from_ptregs(ctx, regs, tgid);
     } else {
-        pr_info("starting flip in memory");
+        fij_info("starting flip in memory");
         return fij_perform_mem_bitflip(ctx, tgid);
     }
 }
@@ -381,7 +513,7 @@ void fij_revert_file_backed_bitflip(struct fij_ctx *ctx)
     if (!ctx->restore.active || !ctx->restore.page)
         return;
 
-    pr_info("FIJ: Restoring file-backed page for TGID %d\n", ctx->target_tgid);
+    fij_info("FIJ: Restoring file-backed page for TGID %d\n", ctx->target_tgid);
 
     /* * Map the page into kernel address space. 
      * kmap_local_page is safe for interrupt contexts/kthreads.
@@ -7,6 +7,7 @@
 #include <linux/sched/signal.h>
 #include <linux/sched.h>
 #include <linux/hrtimer.h>
+#include <linux/math64.h>
 #include <linux/uaccess.h>
 #include <linux/delay.h>
 #include <linux/freezer.h>
@@ -28,15 +29,80 @@ static int fij_sleep_hrtimeout_interruptible_ns(u64 delay_ns)
     return schedule_hrtimeout(&kt, HRTIMER_MODE_REL);
 }
 
+/*
+ * delay_clock = FIJ_DELAY_CPU: sleep until the target tree has used delay_ns
+ * more CPU time. The tree cannot gain CPU time faster than one second per
+ * second and thread, so each sleep is what is left split over its threads
+ * and the wait ends at most FIJ_CPU_DELAY_SLACK_NS per thread late, however
+ * busy the host is.
+ */
+#define FIJ_CPU_DELAY_SLACK_NS  (50 * NSEC_PER_USEC)
+
+static int fij_sleep_target_cpu_ns(struct fij_ctx *ctx, u64 delay_ns)
+{
+    u64 start, now, left;
+    int nthreads, ret;
+
+    ret = fij_rusage_target_cpu(ctx, &start, NULL);
+    if (ret)
+        return ret;
+
+    while (delay_ns) {
+        ret = fij_rusage_target_cpu(ctx, &now, &nthreads);
+        if (ret)
+            return ret;
+        if (now - start >= delay_ns)
+            break;
+
+        left = div_u64(delay_ns - (now - start), max(nthreads, 1));
+        ret = fij_sleep_hrtimeout_interruptible_ns(max_t(u64, left, FIJ_CPU_DELAY_SLACK_NS));
+        if (ret || kthread_should_stop() || !READ_ONCE(ctx->target_alive))
+            return -EINTR;
+    }
+    return 0;
+}
+
+static bool fij_cpu_clock(struct fij_ctx *ctx)
+{
+    return READ_ONCE(ctx->exec.params.delay_clock) == FIJ_DELAY_CPU;
+}
+
+/* The injection itself, noting how far into its work the target is */
+static void fij_flip_now(struct fij_ctx *ctx)
+{
+    u64 cpu_ns;
+
+    if (!fij_rusage_target_cpu(ctx, &cpu_ns, NULL))
+        WRITE_ONCE(ctx->exec.result.injection_cpu_ns, cpu_ns);
+
+    if (fij_stop_flip_resume_one_random(ctx) == -ESRCH)
+        fij_info("FIJ: target TGID %d gone; aborting bitflip\n", ctx->target_tgid);
+}
+
 /* Helper: random ms in [min,max] (inclusive) */
-int fij_random_ms(int min_ms, int max_ms)
+int fij_random_ms(struct fij_ctx *ctx, int min_ms, int max_ms)
 {
     if (max_ms < min_ms) {
         int tmp = min_ms; min_ms = max_ms; max_ms = tmp;
     }
     int span = (max_ms - min_ms) + 1u;
 
-    return min_ms + (int)get_random_u32_below(span);
+    return min_ms + (int)fij_rand_below(ctx, span);
+}
+
+/*
+ * Helper: random delay in ns, uniform over [min_ms, max_ms] ms (inclusive)
+ * to the microsecond, so a window of whole milliseconds is covered without
+ * gaps and a draw never leaves it.
+ */
+u64 fij_random_delay_ns(struct fij_ctx *ctx, int min_ms, int max_ms)
+{
+    u64 span_us;
+
+    if (max_ms < min_ms)
+        swap(min_ms, max_ms);
+    span_us = min_t(u64, (u64)(max_ms - min_ms) * USEC_PER_MSEC, U32_MAX - 1) + 1;
+    return ((u64)min_ms * USEC_PER_MSEC + fij_rand_below(ctx, (u32)span_us)) * NSEC_PER_USEC;
 }
 
 int fij_sleep_hrtimeout_interruptible(unsigned int delay_us)
@@ -48,7 +114,7 @@ int fij_sleep_hrtimeout_interruptible(unsigned int delay_us)
 
     /* schedule_hrtimeout expects ktime in ns */
     kt = ktime_set(0, (u64)delay_us * NSEC_PER_USEC);
-    pr_info("FIJ: sleep %u us (%lld ns)\n",
+    fij_info("FIJ: sleep %u us (%lld ns)\n",
             delay_us, (long long)ktime_to_ns(kt));
 
     /* Put task into interruptible state so signals/kthread_stop can wake it */
@@ -63,7 +129,8 @@ int bitflip_thread_fn(void *data)
     int max = READ_ONCE(ctx->exec.params.max_delay_ms);
     int min_ms = (min > 0) ? min : DEFAULT_MIN_DELAY_MS;
     int max_ms = max ? max : DEFAULT_MAX_DELAY_MS;
-    int delay_ms, ret;
+    int delay_ms, ret = 0;
+    u32 rest_ns;
     u64 duration_ns = 0;
 
     init_completion(&ctx->bitflip_done);
@@ -71,7 +138,7 @@ int bitflip_thread_fn(void *data)
 
     if (READ_ONCE(ctx->exec.params.target_pc_present)) {
         /* Deterministic mode: sleep until uprobe triggers us */
-        pr_info("fij: bitflip_thread: waiting for uprobe trigger\n");
+        fij_info("fij: bitflip_thread: waiting for uprobe trigger\n");
 
         /* Wait until flip_triggered is set, or thread stop requested */
         wait_event_killable(ctx->flip_wq,
@@ -82,18 +149,52 @@ int bitflip_thread_fn(void *data)
 
         /* If target died, abort */
         if (!READ_ONCE(ctx->target_alive)) {
-            pr_info("fij: bitflip_thread: target not alive, abort\n");
+            fij_info("fij: bitflip_thread: target not alive, abort\n");
             goto out;
         }
 
         /* perform the single injection */
-        ret = fij_stop_flip_resume_one_random(ctx);
-        if (ret == -ESRCH)
-            pr_info("FIJ: target TGID %d gone; aborting bitflip\n", ctx->target_tgid);
+        fij_flip_now(ctx);
 
         /* Clear trigger (not strictly required since thread exits) */
         atomic_set(&ctx->flip_triggered, 0);
 
+    } else if (fij_roi_set(ctx)) {
+        /* Region of interest: the delay counts from its opening */
+        wait_event_killable(ctx->flip_wq,
+                            atomic_read(&ctx->flip_triggered) || kthread_should_stop());
+        if (kthread_should_stop() || !READ_ONCE(ctx->target_alive))
+            goto roi_missed;
+
+        if (fij_fault_set(ctx)) {
+            duration_ns = READ_ONCE(ctx->exec.params.fault.delay_us) * NSEC_PER_USEC;
+        } else {
+            if (max_ms < min_ms)
+                swap(min_ms, max_ms);
+            duration_ns = fij_random_delay_ns(ctx, min_ms, max_ms);
+        }
+
+        if (fij_cpu_clock(ctx))
+            ret = fij_sleep_target_cpu_ns(ctx, duration_ns);
+        else
+            ret = fij_sleep_hrtimeout_interruptible_ns(duration_ns);
+        if (ret || !READ_ONCE(ctx->target_alive) || kthread_should_stop() || fij_roi_closed(ctx))
+            goto roi_missed;
+
+        fij_flip_now(ctx);
+
+    } else if (fij_fault_set(ctx)) {
+        /* Described fault: its own delay, to the microsecond */
+        duration_ns = READ_ONCE(ctx->exec.params.fault.delay_us) * NSEC_PER_USEC;
+        if (fij_cpu_clock(ctx))
+            ret = fij_sleep_target_cpu_ns(ctx, duration_ns);
+        else
+            ret = fij_sleep_hrtimeout_interruptible_ns(duration_ns);
+        if (ret || !READ_ONCE(ctx->target_alive) || kthread_should_stop())
+            goto out;
+
+        fij_flip_now(ctx);
+
     } else {
         /* Nondeterministic mode: sleep a random interval then inject */
 
@@ -105,32 +206,38 @@ int bitflip_thread_fn(void *data)
         }
 
         if (max_ms <= 0) {
-            delay_ms = 0;
+            duration_ns = 0;
         } else if (max_ms < 500) {
             /*
              * For short windows (< 500 ms), use high-resolution sleep.
-             * min/max are in ms; we pick a random delay in [min_ms, max_ms] ms
-             * and convert it to ns for schedule_hrtimeout.
+             * min/max are in ms; the delay is uniform over [min_ms, max_ms]
+             * ms and slept with schedule_hrtimeout.
              *
-             * Example: max_ms = 350
-             *  -> delay_ms in [0, 350]
-             *  -> delay_ns in [0, 350 * 1_000_000] ns
+             * Example: min_ms = 100, max_ms = 350
+             *  -> duration_ns in [100 * 1_000_000, 350 * 1_000_000] ns
              */
-            delay_ms = fij_random_ms(min_ms, max_ms * NSEC_PER_MSEC);
-            if (delay_ms > 0) {
-                duration_ns = (u64)delay_ms;
-                ret = fij_sleep_hrtimeout_interruptible_ns(duration_ns);
+            duration_ns = fij_random_delay_ns(ctx, min_ms, max_ms);
+            if (duration_ns > 0) {
+                if (fij_cpu_clock(ctx))
+                    ret = fij_sleep_target_cpu_ns(ctx, duration_ns);
+                else
+                    ret = fij_sleep_hrtimeout_interruptible_ns(duration_ns);
                 if (ret) /* interrupted by signal / kthread_stop */
                     goto out;
             }
         } else {
             /*
-             * For longer windows (>= 500 ms), msleep is sufficient and cheaper.
+             * For longer windows (>= 500 ms), msleep is sufficient and cheaper;
+             * only the sub-millisecond rest goes through the hrtimer.
              */
-            delay_ms = fij_random_ms(min_ms, max_ms);
-            duration_ns = (u64)delay_ms * NSEC_PER_MSEC;
-            if (delay_ms > 0) {
-                if (msleep_interruptible(delay_ms))
+            duration_ns = fij_random_delay_ns(ctx, min_ms, max_ms);
+            delay_ms = div_u64_rem(duration_ns, NSEC_PER_MSEC, &rest_ns);
+            if (duration_ns > 0 && fij_cpu_clock(ctx)) {
+                if (fij_sleep_target_cpu_ns(ctx, duration_ns))
+                    goto out;
+            } else if (duration_ns > 0) {
+                if (msleep_interruptible(delay_ms) ||
+                    fij_sleep_hrtimeout_interruptible_ns(rest_ns))
                     goto out;  /* interrupted */
             }
         }
@@ -138,10 +245,14 @@ int bitflip_thread_fn(void *data)
         if (ret || !READ_ONCE(ctx->target_alive) || kthread_should_stop())
             goto out;
 
-        if (fij_stop_flip_resume_one_random(ctx) == -ESRCH)
-            pr_info("FIJ: target TGID %d gone; aborting bitflip\n", ctx->target_tgid);
+        fij_flip_now(ctx);
     }
 
+    goto out;
+
+roi_missed:
+    /* no flip outside the region */
+    WRITE_ONCE(ctx->exec.result.roi_missed, 1);
 out:
     WRITE_ONCE(ctx->exec.result.injection_time_ns, duration_ns);
     complete(&ctx->bitflip_done);
@@ -174,14 +285,14 @@ void fij_stop_bitflip_thread(struct fij_ctx *ctx)
     struct task_struct *t = READ_ONCE(ctx->bitflip_thread);
 
     if (t) {
-        pr_info("fij: stopping bitflip thread pid=%d\n", t->pid);
+        fij_info("fij: stopping bitflip thread pid=%d\n", t->pid);
         
         wake_up_process(t); 
         wake_up(&ctx->flip_wq);
 
         kthread_stop(t); 
         
-        pr_info("fij: bitflip thread stopped\n");
+        fij_info("fij: bitflip thread stopped\n");
         
         WRITE_ONCE(ctx->bitflip_thread, NULL);
         WRITE_ONCE(ctx->running, 0);
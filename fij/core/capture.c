@@ -0,0 +1,206 @@
+#include "fij_internal.h"
+
+#include <linux/anon_inodes.h>
+#include <linux/file.h>
+#include <linux/minmax.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+/*
+ * In-kernel capture of the target's stdout/stderr.
+ *
+ * With capture_output the helper installs an anonymous write-only file as
+ * fds 1 and 2 instead of opening log_path. Writes land in a per-run buffer
+ * that keeps the first and the last capture_bytes bytes, counts everything
+ * and hashes everything (xxh64), so chatty targets never touch the
+ * filesystem and the runner decides afterwards whether the text is worth
+ * writing. The buffer is refcounted: forked children inherit the fds and may
+ * outlive the run, so they keep writing into their own run's buffer.
+ */
+
+static void fij_capture_free(struct kref *ref)
+{
+    struct fij_capture *c = container_of(ref, struct fij_capture, ref);
+
+    kvfree(c->head);
+    kvfree(c->tail);
+    kfree(c);
+}
+
+static void fij_capture_append(struct fij_capture *c, const char *buf, size_t n)
+{
+    size_t take;
+
+    xxh64_update(&c->hash, buf, n);
+    c->total += n;
+
+    if (c->head_len < c->cap) {
+        take = min_t(size_t, n, c->cap - c->head_len);
+        memcpy(c->head + c->head_len, buf, take);
+        c->head_len += take;
+        buf += take;
+        n -= take;
+    }
+
+    /* everything past the head goes round the tail ring */
+    while (n) {
+        take = min_t(size_t, n, c->cap - c->tail_pos);
+        memcpy(c->tail + c->tail_pos, buf, take);
+        c->tail_pos = (c->tail_pos + take) % c->cap;
+        c->tail_len = min_t(u32, c->tail_len + take, c->cap);
+        buf += take;
+        n -= take;
+    }
+}
+
+static ssize_t fij_capture_write(struct file *file, const char __user *ubuf,
+                                 size_t len, loff_t *ppos)
+{
+    struct fij_capture *c = file->private_data;
+    char chunk[512];
+    size_t done = 0;
+
+    mutex_lock(&c->lock);
+    while (done < len) {
+        size_t n = min(len - done, sizeof(chunk));
+
+        if (copy_from_user(chunk, ubuf + done, n))
+            break;
+        fij_capture_append(c, chunk, n);
+        done += n;
+    }
+    mutex_unlock(&c->lock);
+
+    if (!done && len)
+        return -EFAULT;
+    return done;
+}
+
+static int fij_capture_file_release(struct inode *inode, struct file *file)
+{
+    struct fij_capture *c = file->private_data;
+
+    kref_put(&c->ref, fij_capture_free);
+    return 0;
+}
+
+static const struct file_operations fij_capture_fops = {
+    .owner   = THIS_MODULE,
+    .write   = fij_capture_write,
+    .release = fij_capture_file_release,
+    .llseek  = noop_llseek,
+};
+
+/* New buffer for the run about to start; the previous one is dropped */
+int fij_capture_start(struct fij_ctx *ctx)
+{
+    struct fij_capture *c;
+    int cap = ctx->exec.params.capture_bytes;
+
+    fij_capture_release(ctx);
+    if (!ctx->exec.params.capture_output)
+        return 0;
+
+    if (cap <= 0)
+        cap = FIJ_CAPTURE_DEFAULT;
+    cap = min(cap, FIJ_CAPTURE_MAX);
+
+    c = kzalloc(sizeof(*c), GFP_KERNEL);
+    if (!c)
+        return -ENOMEM;
+
+    c->head = kvmalloc(cap, GFP_KERNEL);
+    c->tail = kvmalloc(cap, GFP_KERNEL);
+    if (!c->head || !c->tail) {
+        kvfree(c->head);
+        kvfree(c->tail);
+        kfree(c);
+        return -ENOMEM;
+    }
+
+    kref_init(&c->ref);
+    mutex_init(&c->lock);
+    xxh64_reset(&c->hash, 0);
+    c->cap = cap;
+
+    ctx->capture = c;
+    return 0;
+}
+
+/* Called from helper_child_init: the file the target's stdout/stderr go to */
+struct file *fij_capture_file(struct fij_ctx *ctx)
+{
+    struct fij_capture *c = ctx->capture;
+    struct file *f;
+
+    kref_get(&c->ref);
+    f = anon_inode_getfile("[fij_capture]", &fij_capture_fops, c, O_WRONLY);
+    if (IS_ERR(f))
+        kref_put(&c->ref, fij_capture_free);
+    return f;
+}
+
+/* Counters into the result handed to userspace */
+void fij_capture_result(struct fij_ctx *ctx)
+{
+    struct fij_result *res = &ctx->exec.result;
+    struct fij_capture *c = ctx->capture;
+
+    if (!c) {
+        res->capture_total = 0;
+        res->capture_hash  = 0;
+        res->capture_head  = 0;
+        res->capture_tail  = 0;
+        return;
+    }
+
+    mutex_lock(&c->lock);
+    res->capture_total = c->total;
+    res->capture_hash  = xxh64_digest(&c->hash);
+    res->capture_head  = c->head_len;
+    res->capture_tail  = c->tail_len;
+    mutex_unlock(&c->lock);
+}
+
+int fij_capture_copy_out(struct fij_ctx *ctx, struct fij_output *out)
+{
+    struct fij_capture *c = ctx->capture;
+    char *buf;
+    u32 n, first, start;
+
+    if (!c)
+        return -ENODATA;
+
+    /* snapshot under the lock, copy to userspace without it */
+    buf = kvmalloc(2 * (size_t)c->cap, GFP_KERNEL);
+    if (!buf)
+        return -ENOMEM;
+
+    mutex_lock(&c->lock);
+    memcpy(buf, c->head, c->head_len);
+    n = c->head_len;
+    start = c->tail_len < c->cap ? 0 : c->tail_pos;    /* oldest tail byte */
+    first = min(c->tail_len, c->cap - start);
+    memcpy(buf + n, c->tail + start, first);
+    memcpy(buf + n + first, c->tail, c->tail_len - first);
+    n += c->tail_len;
+    mutex_unlock(&c->lock);
+
+    out->len = min(n, out->size);
+    if (copy_to_user(u64_to_user_ptr(out->buf), buf, out->len)) {
+        kvfree(buf);
+        return -EFAULT;
+    }
+
+    kvfree(buf);
+    return 0;
+}
+
+void fij_capture_release(struct fij_ctx *ctx)
+{
+    if (!ctx->capture)
+        return;
+    kref_put(&ctx->capture->ref, fij_capture_free);
+    ctx->capture = NULL;
+}
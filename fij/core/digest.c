@@ -0,0 +1,314 @@
+#include "fij_internal.h"
+
+#include <linux/auxvec.h>
+#include <linux/mm.h>
+#include <linux/personality.h>
+#include <linux/ptrace.h>
+#include <linux/sched/mm.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/xxhash.h>
+
+/*
+ * Memory-state digests.
+ *
+ * Every time the target reaches digest_pc we hash its private writable
+ * memory and its registers. A golden run records the digests (RECORD); an
+ * injected run compares its own against the golden set once the fault is in
+ * (COMPARE). Program state identical to a golden state means the rest of the
+ * run is identical too, so the target is killed and reported as converged.
+ *
+ * To make two runs comparable at all, digest runs start with ASLR off and a
+ * fixed AT_RANDOM (so stack canary and pointer guard match), and the
+ * target's own PID, which glibc keeps in memory, is hashed as zero.
+ * Seeded and described-fault runs start the same way, so a replayed fault
+ * meets the same addresses.
+ */
+
+#define FIJ_DIGEST_MAX_VMAS   256
+#define FIJ_DIGEST_MAX_BYTES  (256UL << 20)
+
+struct fij_digest_range {
+    unsigned long start;
+    unsigned long end;
+};
+
+/* Called in the child before exec: honoured by the new mm layout */
+void fij_digest_child_init(struct fij_ctx *ctx)
+{
+    if (!fij_reproducible(ctx))
+        return;
+
+    current->personality |= ADDR_NO_RANDOMIZE;
+}
+
+/* Called after exec, before the target runs its first instruction */
+int fij_digest_prepare(struct fij_ctx *ctx)
+{
+    static const u8 fixed_random[16] = {
+        0x66, 0x69, 0x6a, 0x2d, 0x64, 0x69, 0x67, 0x65,
+        0x73, 0x74, 0x2d, 0x73, 0x65, 0x65, 0x64, 0x00,
+    };
+    struct task_struct *task;
+    struct mm_struct *mm;
+    unsigned long at_random = 0;
+    int i, ret = 0;
+
+    if (!fij_reproducible(ctx))
+        return 0;
+
+    task = fij_rcu_find_get_task_by_tgid(ctx->target_tgid);
+    if (!task)
+        return -ESRCH;
+
+    mm = get_task_mm(task);
+    if (!mm) {
+        put_task_struct(task);
+        return -ESRCH;
+    }
+
+    for (i = 0; i + 1 < AT_VECTOR_SIZE && mm->saved_auxv[i] != AT_NULL; i += 2) {
+        if (mm->saved_auxv[i] == AT_RANDOM) {
+            at_random = mm->saved_auxv[i + 1];
+            break;
+        }
+    }
+
+    ctx->digest.start_code = mm->start_code;
+    mmput(mm);
+
+    if (at_random &&
+        access_process_vm(task, at_random, (void *)fixed_random,
+                          sizeof(fixed_random), FOLL_WRITE | FOLL_FORCE) != sizeof(fixed_random)) {
+        fij_warn("digest: could not fix AT_RANDOM, digests will not match\n");
+        ret = -EFAULT;
+    }
+
+    put_task_struct(task);
+    return ret;
+}
+
+static void fij_digest_update(struct xxh64_state *st, void *buf, size_t len, u32 pid)
+{
+    u32 *w = buf;
+    size_t i;
+
+    for (i = 0; i < len / sizeof(u32); i++)
+        if (w[i] == pid)
+            w[i] = 0;
+    xxh64_update(st, buf, len);
+}
+
+/* Runs in the target thread at the checkpoint */
+static int fij_digest_compute(struct pt_regs *regs, u64 *out)
+{
+    struct mm_struct *mm = current->mm;
+    struct fij_digest_range *ranges;
+    struct vm_area_struct *vma;
+    struct xxh64_state st;
+    unsigned long total = 0, addr;
+    u32 pid = task_pid_vnr(current);
+    int n = 0, i, ret = 0;
+    void *page;
+
+    ranges = kmalloc_array(FIJ_DIGEST_MAX_VMAS, sizeof(*ranges), GFP_KERNEL);
+    page = kmalloc(PAGE_SIZE, GFP_KERNEL);
+    if (!ranges || !page) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    /* snapshot the layout; the copies below fault pages in and need the lock */
+    mmap_read_lock(mm);
+    {
+        VMA_ITERATOR(vmi, mm, 0);
+        for_each_vma(vmi, vma) {
+            if (!(vma->vm_flags & VM_WRITE) ||
+                (vma->vm_flags & (VM_SHARED | VM_IO | VM_PFNMAP)))
+                continue;
+            if (n == FIJ_DIGEST_MAX_VMAS) {
+                ret = -E2BIG;
+                break;
+            }
+            ranges[n].start = vma->vm_start;
+            ranges[n].end = vma->vm_end;
+            total += vma->vm_end - vma->vm_start;
+            n++;
+        }
+    }
+    mmap_read_unlock(mm);
+
+    if (!ret && total > FIJ_DIGEST_MAX_BYTES)
+        ret = -E2BIG;
+    if (ret)
+        goto out;
+
+    xxh64_reset(&st, 0);
+    xxh64_update(&st, ranges, n * sizeof(*ranges));
+
+    for (i = 0; i < n; i++) {
+        for (addr = ranges[i].start; addr < ranges[i].end; addr += PAGE_SIZE) {
+            if (copy_from_user(page, (void __user *)addr, PAGE_SIZE)) {
+                ret = -EFAULT;
+                goto out;
+            }
+            fij_digest_update(&st, page, PAGE_SIZE, pid);
+        }
+    }
+
+    for (i = FIJ_REG_NONE + 1; i < FIJ_REG_MAX; i++) {
+        unsigned long *p = fij_reg_ptr_from_ptregs(regs, i);
+        unsigned long v;
+
+        if (!p)
+            continue;
+        v = *p;
+        fij_digest_update(&st, &v, sizeof(v), pid);
+    }
+
+    *out = xxh64_digest(&st);
+out:
+    kfree(page);
+    kfree(ranges);
+    return ret;
+}
+
+/*
+ * A memory flip outside the hashed ranges (code, rodata, shared mappings)
+ * cannot be seen by the digest: such runs must never be called converged.
+ */
+static bool fij_digest_blind(struct fij_ctx *ctx)
+{
+    struct vm_area_struct *vma;
+    unsigned long addr;
+    bool blind = true;
+
+    if (!READ_ONCE(ctx->exec.result.memory_flip))
+        return false;
+
+    addr = READ_ONCE(ctx->exec.result.target_address);
+    mmap_read_lock(current->mm);
+    vma = vma_lookup(current->mm, addr);
+    if (vma && (vma->vm_flags & VM_WRITE) &&
+        !(vma->vm_flags & (VM_SHARED | VM_IO | VM_PFNMAP)))
+        blind = false;
+    mmap_read_unlock(current->mm);
+
+    return blind;
+}
+
+static bool fij_digest_filter(struct uprobe_consumer *uc, struct mm_struct *mm)
+{
+    struct fij_ctx *ctx = container_of(uc, struct fij_ctx, digest.uc);
+
+    return fij_uprobe_mm_is_target(ctx, mm);
+}
+
+static int fij_digest_hit(struct uprobe_consumer *uc, struct pt_regs *regs, u64 *bp_addr)
+{
+    struct fij_ctx *ctx = container_of(uc, struct fij_ctx, digest.uc);
+    struct fij_result *res = &ctx->exec.result;
+    int mode = ctx->exec.params.digest_mode;
+    int count, i;
+    u64 d;
+
+    if (task_tgid_vnr(current) != READ_ONCE(ctx->target_tgid))
+        return 0;
+
+    /* other threads or children could change state behind our back */
+    if (get_nr_threads(current) != 1 || !list_empty(&current->children))
+        return 0;
+
+    if (mode == FIJ_DIGEST_RECORD) {
+        count = READ_ONCE(res->digest_count);
+        if (count >= FIJ_MAX_DIGESTS)
+            return 0;
+        if (fij_digest_compute(regs, &d))
+            return 0;
+        res->digests[count] = d;
+        WRITE_ONCE(res->digest_count, count + 1);
+        return 0;
+    }
+
+    /* COMPARE: before the flip the run is trivially golden */
+    if (!READ_ONCE(res->fault_injected) || READ_ONCE(res->converged))
+        return 0;
+    if (fij_digest_blind(ctx))
+        return 0;
+    if (fij_digest_compute(regs, &d))
+        return 0;
+
+    count = min_t(int, ctx->exec.params.digest_golden_count, FIJ_MAX_DIGESTS);
+    for (i = 0; i < count; i++) {
+        if (ctx->exec.params.digest_golden[i] != d)
+            continue;
+
+        fij_info("digest: TGID %d reconverged with golden checkpoint %d, killing\n",
+                ctx->target_tgid, i);
+        WRITE_ONCE(res->converged_idx, i);
+        WRITE_ONCE(res->converged, 1);
+        fij_send_sigkill(ctx, "converged");
+        break;
+    }
+    return 0;
+}
+
+int fij_digest_arm(struct fij_ctx *ctx)
+{
+    struct task_struct *t;
+    unsigned long va;
+    int err;
+
+    if (ctx->exec.params.digest_mode == FIJ_DIGEST_OFF || ctx->digest.active)
+        return 0;
+    if (ctx->exec.params.digest_mode == FIJ_DIGEST_COMPARE &&
+        ctx->exec.params.digest_golden_count <= 0)
+        return 0;
+
+    t = fij_rcu_find_get_task_by_tgid(ctx->target_tgid);
+    if (!t)
+        return -ESRCH;
+
+    va = ctx->digest.start_code + ctx->exec.params.digest_pc;
+    err = fij_va_to_file_off(t, va, &ctx->digest.inode, &ctx->digest.off);
+    put_task_struct(t);
+    if (err) {
+        pr_err("digest: could not map VA 0x%lx to file offset (%d)\n", va, err);
+        ctx->digest.inode = NULL;
+        return err;
+    }
+
+    ctx->digest.uc.handler = fij_digest_hit;
+    ctx->digest.uc.ret_handler = NULL;
+    ctx->digest.uc.filter = fij_digest_filter;
+
+    ctx->digest.uprobe = uprobe_register(ctx->digest.inode, ctx->digest.off, 0, &ctx->digest.uc);
+    if (IS_ERR(ctx->digest.uprobe)) {
+        err = PTR_ERR(ctx->digest.uprobe);
+        pr_err("digest: uprobe_register failed (%d)\n", err);
+        iput(ctx->digest.inode);
+        ctx->digest.inode = NULL;
+        ctx->digest.uprobe = NULL;
+        return err;
+    }
+
+    ctx->digest.active = true;
+    fij_stat_inc(FIJ_STAT_UPROBE_ARM);
+    return 0;
+}
+
+void fij_digest_disarm(struct fij_ctx *ctx)
+{
+    if (ctx->digest.active && ctx->digest.uprobe) {
+        uprobe_unregister_nosync(ctx->digest.uprobe, &ctx->digest.uc);
+        uprobe_unregister_sync();
+        ctx->digest.uprobe = NULL;
+        ctx->digest.active = false;
+        fij_stat_inc(FIJ_STAT_UPROBE_DISARM);
+    }
+    if (ctx->digest.inode) {
+        iput(ctx->digest.inode);
+        ctx->digest.inode = NULL;
+    }
+}
@@ -16,20 +16,28 @@ static int helper_child_init(struct subprocess_info *info, struct cred *new)
     struct fij_ctx *ctx = (struct fij_ctx *)info->data;
     ctx->target_tgid = task_tgid_vnr(current);
     
-    struct file *log_file;
+    struct file *log_file = NULL;
     struct file *null_file;
     int fd_stdin, fd_stdout, fd_stderr;
     char *path = ctx->exec.params.log_path;
 
-    /* If the log file's path is specified by the userspace the STOUT AND STDERR are associated to it */
-    if(path && path[0]!= "\0") {
-        /* 2. Open the Log File */
+    if (ctx->capture) {
+        /* STDOUT and STDERR go to the in-kernel capture buffer of this run */
+        log_file = fij_capture_file(ctx);
+        if (IS_ERR(log_file)) {
+            pr_err("fij: Failed to create capture file\n");
+            return PTR_ERR(log_file);
+        }
+    } else if (path[0] != '\0') {
+        /* If the log file's path is specified by the userspace the STOUT AND STDERR are associated to it */
         log_file = filp_open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
         if (IS_ERR(log_file)) {
             pr_err("fij: Failed to open log file: %s\n", path);
             return PTR_ERR(log_file);
         }
-    
+    }
+
+    if (log_file) {
         /* 3. Open /dev/null for Stdin */
         null_file = filp_open("/dev/null", O_RDWR, 0);
         if (IS_ERR(null_file)) {
@@ -48,29 +56,62 @@ static int helper_child_init(struct subprocess_info *info, struct cred *new)
             fput(null_file);
         }
     
+        /* each installed fd owns one reference */
+        if (fd_stderr >= 0) {
+            fd_install(fd_stderr, get_file(log_file));
+        }
+
         if (fd_stdout >= 0) {
             fd_install(fd_stdout, log_file);
-        }
-    
-        if (fd_stderr >= 0) {
-            fd_install(fd_stderr, log_file);
+        } else {
+            fput(log_file);
         }
     }
 
+    fij_digest_child_init(ctx);
+
     send_sig(SIGSTOP, current, 0);
     return 0;
 }
 
 int fij_exec_and_stop(const char *path, char *const argv[], struct fij_ctx *ctx)
 {
-    static char *envp[] = {
+    static char *envp_base[] = {
         "HOME=/",
         "PATH=/sbin:/usr/sbin:/bin:/usr/bin",
-        NULL,
     };
     struct subprocess_info *sub_info;
+    char **envp;
+    char *env_buf = NULL, *cursor;
+    int envc = 0;
     int ret;
 
+    envp = kcalloc(ARRAY_SIZE(envp_base) + FIJ_MAX_ENV + 1, sizeof(char *), GFP_KERNEL);
+    if (!envp)
+        return -ENOMEM;
+
+    for (envc = 0; envc < ARRAY_SIZE(envp_base); envc++)
+        envp[envc] = envp_base[envc];
+
+    /* e.g. LD_PRELOAD for the output fingerprinting library */
+    if (ctx->exec.params.env_extra[0]) {
+        env_buf = kstrndup(ctx->exec.params.env_extra,
+                           sizeof(ctx->exec.params.env_extra), GFP_KERNEL);
+        if (!env_buf) {
+            kfree(envp);
+            return -ENOMEM;
+        }
+
+        cursor = env_buf;
+        while (envc < ARRAY_SIZE(envp_base) + FIJ_MAX_ENV) {
+            char *tok = strsep(&cursor, " ");
+            if (!tok) break;
+            if (*tok && strchr(tok, '='))
+                envp[envc++] = tok;
+        }
+    }
+    envp[envc] = NULL;
+
     /* * Setup the helper.
      * The last argument is the 'void *data' that gets passed to helper_child_init.
      * We pass 'ctx' here so we can access log_path inside the helper.
@@ -81,13 +122,18 @@ int fij_exec_and_stop(const char *path, char *const argv[], struct fij_ctx *ctx)
                                          ctx);
 
     if (!sub_info) {
+        kfree(env_buf);
+        kfree(envp);
         return -ENOMEM;
     }
 
+    /* UMH_WAIT_EXEC returns once execve is done with envp */
     ret = call_usermodehelper_exec(sub_info, UMH_WAIT_EXEC);
 
     if (ret)
         pr_err("fij: exec failed (%d)\n", ret);
-    
+
+    kfree(env_buf);
+    kfree(envp);
     return ret;
-}
\ No newline at end of file
+}
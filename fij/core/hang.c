@@ -0,0 +1,143 @@
+#include "fij_internal.h"
+
+#include <linux/jiffies.h>
+#include <linux/ptrace.h>
+#include <linux/rcupdate.h>
+#include <linux/sched/signal.h>
+
+/*
+ * Livelock detector.
+ *
+ * The monitor calls fij_hang_sample() from its wait loop. Every
+ * FIJ_HANG_SAMPLE_MS we read the saved user PC of the running threads of the
+ * target and of all its descendant processes (pt_regs is refreshed on every
+ * tick, so this is cheap and good enough for sampling) together with
+ * counters that move when the program makes progress: voluntary context
+ * switches (blocking syscalls), page faults and system time, which grows
+ * with any syscall, plus read/write syscall counts where CONFIG_TASK_XACCT
+ * keeps them. A process forking or exiting changes the sums too. If the PCs stay inside hang_pc_span bytes,
+ * CPU time keeps growing and none of the progress counters move for
+ * hang_window_ms, the target is spinning and gets killed as a HANG.
+ */
+
+#define FIJ_HANG_SAMPLE_MS      10
+#define FIJ_HANG_DEF_WINDOW_MS  500
+#define FIJ_HANG_DEF_PC_SPAN    4096
+
+struct fij_hang_snapshot {
+    unsigned long pc_lo;
+    unsigned long pc_hi;
+    u64           progress;
+    u64           cpu_ns;
+    int           nrunning;
+};
+
+/* Under rcu_read_lock(), for every process of the tree */
+static void fij_hang_collect_process(struct task_struct *p, void *arg)
+{
+    struct fij_hang_snapshot *s = arg;
+    struct task_struct *t;
+
+    for_each_thread(p, t) {
+        unsigned long pc;
+
+        if (t->flags & PF_KTHREAD)
+            continue;
+        if (READ_ONCE(t->exit_state))
+            continue;
+
+        s->progress += READ_ONCE(t->nvcsw);
+        s->progress += READ_ONCE(t->min_flt) + READ_ONCE(t->maj_flt);
+        s->progress += READ_ONCE(t->stime);
+#ifdef CONFIG_TASK_XACCT
+        s->progress += READ_ONCE(t->ioac.syscr) + READ_ONCE(t->ioac.syscw);
+#endif
+        s->cpu_ns += READ_ONCE(t->se.sum_exec_runtime);
+
+        /* blocked or stopped threads are not spinning */
+        if (!task_is_running(t))
+            continue;
+
+        pc = instruction_pointer(task_pt_regs(t));
+        if (pc < s->pc_lo)
+            s->pc_lo = pc;
+        if (pc > s->pc_hi)
+            s->pc_hi = pc;
+        s->nrunning++;
+    }
+}
+
+static void fij_hang_collect(struct task_struct *leader, struct fij_hang_snapshot *s)
+{
+    s->pc_lo = ULONG_MAX;
+    s->pc_hi = 0;
+    s->progress = 0;
+    s->cpu_ns = 0;
+    s->nrunning = 0;
+
+    rcu_read_lock();
+    fij_for_each_process_rcu(leader, fij_hang_collect_process, s);
+    rcu_read_unlock();
+}
+
+static void fij_hang_open_window(struct fij_hang_state *hs,
+                                 const struct fij_hang_snapshot *s,
+                                 unsigned long now)
+{
+    hs->pc_lo = s->pc_lo;
+    hs->pc_hi = s->pc_hi;
+    hs->progress = s->progress;
+    hs->cpu_ns = s->cpu_ns;
+    hs->window_start = now;
+    hs->armed = s->nrunning > 0;
+}
+
+void fij_hang_reset(struct fij_ctx *ctx)
+{
+    memset(&ctx->hang, 0, sizeof(ctx->hang));
+    ctx->hang.next_sample = jiffies;
+}
+
+/* Returns true once the target is considered livelocked */
+bool fij_hang_sample(struct fij_ctx *ctx, struct task_struct *leader)
+{
+    struct fij_hang_state *hs = &ctx->hang;
+    struct fij_hang_snapshot s;
+    unsigned long now = jiffies;
+    int window_ms = ctx->exec.params.hang_window_ms;
+    int span = ctx->exec.params.hang_pc_span;
+    unsigned long lo, hi;
+
+    if (!ctx->exec.params.hang_detect)
+        return false;
+    if (time_before(now, hs->next_sample))
+        return false;
+    hs->next_sample = now + msecs_to_jiffies(FIJ_HANG_SAMPLE_MS);
+
+    if (window_ms <= 0)
+        window_ms = FIJ_HANG_DEF_WINDOW_MS;
+    if (span <= 0)
+        span = FIJ_HANG_DEF_PC_SPAN;
+
+    fij_hang_collect(leader, &s);
+
+    /* any sign of progress (or no CPU use at all) restarts the window */
+    if (!hs->armed || !s.nrunning ||
+        s.progress != hs->progress || s.cpu_ns == hs->cpu_ns) {
+        fij_hang_open_window(hs, &s, now);
+        return false;
+    }
+
+    lo = min(hs->pc_lo, s.pc_lo);
+    hi = max(hs->pc_hi, s.pc_hi);
+    if (hi - lo > (unsigned long)span) {
+        fij_hang_open_window(hs, &s, now);
+        return false;
+    }
+
+    hs->pc_lo = lo;
+    hs->pc_hi = hi;
+    hs->cpu_ns = s.cpu_ns;
+
+    return time_after_eq(now, hs->window_start + msecs_to_jiffies(window_ms));
+}
@@ -0,0 +1,717 @@
+#include <linux/errno.h>
+#include <linux/kernel.h>
+
+#include "fij_insn.h"
+
+/* Per-opcode attributes */
+#define F_MODRM  0x001
+#define F_IMM8   0x002
+#define F_IMMZ   0x004   /* imm16 with 0x66, imm32 otherwise */
+#define F_IMM16  0x008
+#define F_IMMV   0x010   /* imm64 with REX.W (mov r64, imm64) */
+#define F_MOFFS  0x020   /* 64-bit absolute address, 32-bit with 0x67 */
+#define F_GRP3   0x040   /* F6/F7: immediate only for /0 and /1 */
+#define F_IMM32  0x080   /* rel32, not affected by 0x66 in 64-bit mode */
+#define F_BAD    0x100
+
+static u16 fij_attr_1b(u8 op)
+{
+    if (op < 0x40) {
+        switch (op & 7) {
+        case 0: case 1: case 2: case 3:
+            return F_MODRM;
+        case 4:
+            return F_IMM8;
+        case 5:
+            return F_IMMZ;
+        default:
+            /* push/pop seg, daa, aaa...: invalid in 64-bit mode */
+            return F_BAD;
+        }
+    }
+    if (op >= 0x50 && op <= 0x5F)
+        return 0;
+    if (op >= 0x70 && op <= 0x7F)
+        return F_IMM8;
+    if (op >= 0x84 && op <= 0x8E)
+        return F_MODRM;
+    if (op >= 0x90 && op <= 0x99)
+        return 0;
+    if (op >= 0x9B && op <= 0x9F)
+        return 0;
+    if (op >= 0xA0 && op <= 0xA3)
+        return F_MOFFS;
+    if ((op >= 0xA4 && op <= 0xA7) || (op >= 0xAA && op <= 0xAF))
+        return 0;
+    if (op >= 0xB0 && op <= 0xB7)
+        return F_IMM8;
+    if (op >= 0xB8 && op <= 0xBF)
+        return F_IMMV;
+    if (op >= 0xD0 && op <= 0xD3)
+        return F_MODRM;
+    if (op >= 0xD8 && op <= 0xDF)
+        return F_MODRM;
+    if (op >= 0xE0 && op <= 0xE7)
+        return F_IMM8;
+    if (op >= 0xEC && op <= 0xEF)
+        return 0;
+    if (op >= 0xF8 && op <= 0xFD)
+        return 0;
+
+    switch (op) {
+    case 0x63:
+    case 0x8F:
+    case 0xFE:
+    case 0xFF:
+        return F_MODRM;
+    case 0x68:
+        return F_IMMZ;
+    case 0x69:
+    case 0x81:
+    case 0xC7:
+        return F_MODRM | F_IMMZ;
+    case 0x6A:
+    case 0xA8:
+    case 0xCD:
+    case 0xEB:
+        return F_IMM8;
+    case 0x6B:
+    case 0x80:
+    case 0x83:
+    case 0xC0:
+    case 0xC1:
+    case 0xC6:
+        return F_MODRM | F_IMM8;
+    case 0x6C: case 0x6D: case 0x6E: case 0x6F:
+    case 0xC3: case 0xC9: case 0xCB: case 0xCC: case 0xCF:
+    case 0xD7: case 0xF1: case 0xF4: case 0xF5:
+        return 0;
+    case 0xA9:
+        return F_IMMZ;
+    case 0xC2:
+    case 0xCA:
+        return F_IMM16;
+    case 0xC8:
+        return F_IMM16 | F_IMM8;    /* enter iw, ib */
+    case 0xE8:
+    case 0xE9:
+        return F_IMM32;
+    case 0xF6:
+    case 0xF7:
+        return F_MODRM | F_GRP3;
+    }
+    return F_BAD;
+}
+
+static u16 fij_attr_0f(u8 op)
+{
+    if (op >= 0x80 && op <= 0x8F)
+        return F_IMM32;             /* jcc rel32 */
+    if (op >= 0xC8 && op <= 0xCF)
+        return 0;                   /* bswap */
+
+    switch (op) {
+    case 0x05: case 0x06: case 0x07: case 0x08: case 0x09: case 0x0B:
+    case 0x0E: case 0x30: case 0x31: case 0x32: case 0x33: case 0x34:
+    case 0x35: case 0x37: case 0x77: case 0xA0: case 0xA1: case 0xA2:
+    case 0xA8: case 0xA9: case 0xAA:
+        return 0;
+    case 0x04: case 0x0A: case 0x0C: case 0x24: case 0x25: case 0x26:
+    case 0x27: case 0x36: case 0x39: case 0x3B: case 0x3C: case 0x3D:
+    case 0x3E: case 0x3F: case 0x7A: case 0x7B: case 0xA6: case 0xA7:
+    case 0xFF:
+        return F_BAD;
+    case 0x0F:                      /* 3DNow!, suffix opcode as imm8 */
+    case 0x70: case 0x71: case 0x72: case 0x73:
+    case 0xA4: case 0xAC: case 0xBA:
+    case 0xC2: case 0xC4: case 0xC5: case 0xC6:
+        return F_MODRM | F_IMM8;
+    }
+    return F_MODRM;
+}
+
+/* VEX/EVEX: every opcode has a ModRM byte except vzeroupper/vzeroall */
+static u16 fij_attr_vex(u8 map, u8 op)
+{
+    switch (map) {
+    case FIJ_INSN_MAP_0F:
+        if (op == 0x77)
+            return 0;
+        if ((op >= 0x70 && op <= 0x73) || op == 0xC2 || op == 0xC4 ||
+            op == 0xC5 || op == 0xC6)
+            return F_MODRM | F_IMM8;
+        return F_MODRM;
+    case FIJ_INSN_MAP_0F3A:
+        return F_MODRM | F_IMM8;
+    default:
+        return F_MODRM;
+    }
+}
+
+static int fij_insn_modrm(struct fij_insn *insn, const u8 *buf, int len, int *pos)
+{
+    u8 mod, rm;
+
+    if (*pos >= len)
+        return -EINVAL;
+    insn->modrm = buf[(*pos)++];
+    insn->has_modrm = true;
+
+    mod = insn->modrm >> 6;
+    rm = insn->modrm & 7;
+    if (mod == 3)
+        return 0;
+
+    if (rm == 4) {
+        if (*pos >= len)
+            return -EINVAL;
+        insn->sib = buf[(*pos)++];
+        insn->has_sib = true;
+        if (mod == 0 && (insn->sib & 7) == 5)
+            insn->disp_len = 4;
+    } else if (mod == 0 && rm == 5) {
+        insn->disp_len = 4;         /* RIP-relative */
+    }
+
+    if (mod == 1)
+        insn->disp_len = 1;
+    else if (mod == 2)
+        insn->disp_len = 4;
+
+    return 0;
+}
+
+/* Record the implied prefix carried in VEX/EVEX pp bits */
+static void fij_insn_vex_pp(struct fij_insn *insn, u8 pp)
+{
+    if (pp == 1)
+        insn->opsize = true;
+    else if (pp == 2)
+        insn->rep = 0xF3;
+    else if (pp == 3)
+        insn->rep = 0xF2;
+}
+
+int fij_insn_decode(struct fij_insn *insn, const u8 *buf, int len)
+{
+    int pos = 0;
+    u16 attr;
+    u8 op;
+
+    memset(insn, 0, sizeof(*insn));
+    if (len > FIJ_INSN_MAX_LEN)
+        len = FIJ_INSN_MAX_LEN;
+
+    /* legacy prefixes */
+    for (; pos < len; pos++) {
+        u8 b = buf[pos];
+
+        if (b == 0x66)
+            insn->opsize = true;
+        else if (b == 0x67)
+            insn->adsize = true;
+        else if (b == 0xF0)
+            insn->lock = true;
+        else if (b == 0xF2 || b == 0xF3)
+            insn->rep = b;
+        else if (b != 0x2E && b != 0x36 && b != 0x3E && b != 0x26 &&
+                 b != 0x64 && b != 0x65)
+            break;
+    }
+    if (pos >= len)
+        return -EINVAL;
+
+    if ((buf[pos] & 0xF0) == 0x40) {
+        insn->rex = buf[pos++];
+        if (pos >= len)
+            return -EINVAL;
+    }
+
+    op = buf[pos++];
+
+    if (op == 0xC4 || op == 0xC5 || op == 0x62) {
+        /* VEX/EVEX cannot follow REX, 0x66, 0xF2, 0xF3 or lock */
+        if (insn->rex || insn->opsize || insn->rep || insn->lock)
+            return -EINVAL;
+        insn->vex = true;
+
+        if (op == 0xC5) {
+            if (pos + 1 >= len)
+                return -EINVAL;
+            fij_insn_vex_pp(insn, buf[pos] & 3);
+            insn->map = FIJ_INSN_MAP_0F;
+            pos += 1;
+        } else if (op == 0xC4) {
+            u8 mmmmm;
+
+            if (pos + 2 >= len)
+                return -EINVAL;
+            mmmmm = buf[pos] & 0x1F;
+            if (mmmmm < 1 || mmmmm > 3)
+                return -EINVAL;
+            insn->map = mmmmm;      /* 1=0F, 2=0F38, 3=0F3A */
+            fij_insn_vex_pp(insn, buf[pos + 1] & 3);
+            pos += 2;
+        } else {
+            u8 mmm;
+
+            if (pos + 3 >= len)
+                return -EINVAL;
+            mmm = buf[pos] & 7;
+            if (mmm >= 1 && mmm <= 3)
+                insn->map = mmm;
+            else if (mmm == 5 || mmm == 6)
+                insn->map = FIJ_INSN_MAP_OTHER;
+            else
+                return -EINVAL;
+            fij_insn_vex_pp(insn, buf[pos + 1] & 3);
+            pos += 3;
+        }
+
+        insn->opcode = buf[pos++];
+        attr = fij_attr_vex(insn->map, insn->opcode);
+    } else if (op == 0x0F) {
+        if (pos >= len)
+            return -EINVAL;
+        op = buf[pos++];
+        if (op == 0x38 || op == 0x3A) {
+            if (pos >= len)
+                return -EINVAL;
+            insn->map = (op == 0x38) ? FIJ_INSN_MAP_0F38 : FIJ_INSN_MAP_0F3A;
+            insn->opcode = buf[pos++];
+            attr = (op == 0x38) ? F_MODRM : (F_MODRM | F_IMM8);
+        } else {
+            insn->map = FIJ_INSN_MAP_0F;
+            insn->opcode = op;
+            attr = fij_attr_0f(op);
+        }
+    } else {
+        insn->map = FIJ_INSN_MAP_1B;
+        insn->opcode = op;
+        attr = fij_attr_1b(op);
+    }
+
+    if (attr & F_BAD)
+        return -EINVAL;
+
+    if (attr & F_MODRM) {
+        if (fij_insn_modrm(insn, buf, len, &pos))
+            return -EINVAL;
+        /* 8F /1-7 is XOP on AMD, not pop */
+        if (insn->map == FIJ_INSN_MAP_1B && op == 0x8F && fij_insn_reg(insn))
+            return -EINVAL;
+    }
+
+    if (attr & F_GRP3) {
+        if (fij_insn_reg(insn) <= 1)
+            attr |= (op == 0xF6) ? F_IMM8 : F_IMMZ;
+    }
+
+    if (attr & F_IMM8)
+        insn->imm_len += 1;
+    if (attr & F_IMM16)
+        insn->imm_len += 2;
+    if (attr & F_IMM32)
+        insn->imm_len += 4;
+    if (attr & F_IMMZ)
+        insn->imm_len += insn->opsize ? 2 : 4;
+    if (attr & F_IMMV)
+        insn->imm_len += (insn->rex & 0x08) ? 8 : (insn->opsize ? 2 : 4);
+    if (attr & F_MOFFS)
+        insn->imm_len += insn->adsize ? 4 : 8;
+
+    pos += insn->disp_len + insn->imm_len;
+    if (pos > len)
+        return -EINVAL;
+
+    insn->len = pos;
+    return pos;
+}
+
+bool fij_insn_is_pure_store(const struct fij_insn *insn)
+{
+    bool mem = insn->has_modrm && fij_insn_mod(insn) != 3;
+    u8 op = insn->opcode;
+
+    if (insn->lock)
+        return false;
+
+    if (insn->map == FIJ_INSN_MAP_1B) {
+        if (op >= 0x50 && op <= 0x57)       /* push r */
+            return true;
+
+        switch (op) {
+        case 0x88:                          /* mov r/m, r */
+        case 0x89:
+            return mem;
+        case 0xC6:                          /* mov r/m, imm */
+        case 0xC7:
+            return mem && fij_insn_reg(insn) == 0;
+        case 0xAA:                          /* stos */
+        case 0xAB:
+        case 0x68:                          /* push imm */
+        case 0x6A:
+        case 0xE8:                          /* call rel32 */
+            return true;
+        case 0xFF:                          /* call/push r, not r/m */
+            return !mem && (fij_insn_reg(insn) == 2 || fij_insn_reg(insn) == 6);
+        }
+        return false;
+    }
+
+    if (insn->map == FIJ_INSN_MAP_0F) {
+        switch (op) {
+        case 0x11:                          /* movups/movss/movsd store */
+        case 0x13:                          /* movlps */
+        case 0x17:                          /* movhps */
+        case 0x29:                          /* movaps */
+        case 0x2B:                          /* movntps */
+        case 0x7F:                          /* movq/movdqa/movdqu */
+        case 0xC3:                          /* movnti */
+        case 0xD6:                          /* movq xmm/m64 */
+        case 0xE7:                          /* movntq/movntdq */
+            return mem;
+        case 0x7E:                          /* movd/movq r/m, xmm (F3 is a load) */
+            return mem && insn->rep != 0xF3;
+        }
+    }
+
+    return false;
+}
+
+/* ---- register use/def ---- */
+
+#define R(n)        ((u16)1 << (n))
+#define X86_RAX     0
+#define X86_RCX     1
+#define X86_RDX     2
+#define X86_RBX     3
+#define X86_RSP     4
+#define X86_RBP     5
+#define X86_RSI     6
+#define X86_RDI     7
+
+static u8 fij_insn_reg_full(const struct fij_insn *insn)
+{
+    return fij_insn_reg(insn) | ((insn->rex & 0x04) ? 8 : 0);
+}
+
+static u8 fij_insn_rm_full(const struct fij_insn *insn)
+{
+    return (insn->modrm & 7) | ((insn->rex & 0x01) ? 8 : 0);
+}
+
+/* Registers read to form the memory address, 0 for register operands */
+static u16 fij_insn_addr_regs(const struct fij_insn *insn)
+{
+    u8 mod = fij_insn_mod(insn);
+    u8 rm = insn->modrm & 7;
+    u16 use = 0;
+
+    if (!insn->has_modrm || mod == 3)
+        return 0;
+
+    if (insn->has_sib) {
+        u8 base = insn->sib & 7;
+        u8 index = ((insn->sib >> 3) & 7) | ((insn->rex & 0x02) ? 8 : 0);
+
+        if (!(base == 5 && mod == 0))
+            use |= R(base | ((insn->rex & 0x01) ? 8 : 0));
+        if (index != 4)
+            use |= R(index);
+        return use;
+    }
+
+    if (mod == 0 && rm == 5)        /* RIP-relative */
+        return 0;
+    return R(fij_insn_rm_full(insn));
+}
+
+/*
+ * Registers an instruction reads and fully overwrites, as hardware numbers
+ * (RAX=0 ... R15=15). Only writes that replace the whole 64-bit register
+ * count as definitions: 32-bit writes zero-extend, 8/16-bit ones do not.
+ * Returns -EOPNOTSUPP for control flow and for anything not modelled here;
+ * callers must then assume every register is live.
+ */
+int fij_insn_regs(const struct fij_insn *insn, u16 *use, u16 *def)
+{
+    u8 op = insn->opcode;
+    u8 ext = fij_insn_reg(insn);
+    bool wide = !insn->opsize || (insn->rex & 0x08);
+    bool regop = insn->has_modrm && fij_insn_mod(insn) == 3;
+    u16 addr = fij_insn_addr_regs(insn);
+    u16 reg = insn->has_modrm ? R(fij_insn_reg_full(insn)) : 0;
+    u16 rm = regop ? R(fij_insn_rm_full(insn)) : 0;
+    u16 oreg = R((op & 7) | ((insn->rex & 0x01) ? 8 : 0));  /* reg in opcode */
+
+    *use = 0;
+    *def = 0;
+
+    /* VEX/EVEX can name a GPR in vvvv, which we do not decode */
+    if (insn->vex)
+        return -EOPNOTSUPP;
+
+    if (insn->map == FIJ_INSN_MAP_1B) {
+        if (op < 0x40) {
+            bool cmp = (op & 0xF8) == 0x38;
+
+            switch (op & 7) {
+            case 0:                             /* op r/m8, r8 */
+            case 2:                             /* op r8, r/m8 */
+                *use = addr | reg | rm;
+                return 0;
+            case 1:                             /* op r/m, r */
+                /* xor/sub r, r only produce a constant */
+                if (regop && reg == rm && ((op & 0xF8) == 0x30 || (op & 0xF8) == 0x28)) {
+                    *def = wide ? rm : 0;
+                    *use = wide ? 0 : rm;
+                    return 0;
+                }
+                *use = addr | reg | rm;
+                *def = (!cmp && wide) ? rm : 0;
+                return 0;
+            case 3:                             /* op r, r/m */
+                if (regop && reg == rm && ((op & 0xF8) == 0x30 || (op & 0xF8) == 0x28)) {
+                    *def = wide ? reg : 0;
+                    *use = wide ? 0 : reg;
+                    return 0;
+                }
+                *use = addr | reg | rm;
+                *def = (!cmp && wide) ? reg : 0;
+                return 0;
+            case 4:                             /* op al, imm8 */
+                *use = R(X86_RAX);
+                return 0;
+            case 5:                             /* op eax, imm */
+                *use = R(X86_RAX);
+                *def = (!cmp && wide) ? R(X86_RAX) : 0;
+                return 0;
+            }
+            return -EOPNOTSUPP;
+        }
+
+        if (op >= 0x50 && op <= 0x57) {        /* push r */
+            *use = oreg | R(X86_RSP);
+            *def = R(X86_RSP);
+            return 0;
+        }
+        if (op >= 0x58 && op <= 0x5F) {        /* pop r */
+            *use = R(X86_RSP);
+            *def = R(X86_RSP) | (insn->opsize ? 0 : oreg);
+            return 0;
+        }
+        if (op >= 0x91 && op <= 0x97) {        /* xchg r, rax */
+            *use = oreg | R(X86_RAX);
+            *def = wide ? (oreg | R(X86_RAX)) : 0;
+            return 0;
+        }
+        if (op >= 0xB0 && op <= 0xB7) {        /* mov r8, imm8 */
+            return 0;
+        }
+        if (op >= 0xB8 && op <= 0xBF) {        /* mov r, imm */
+            *def = wide ? oreg : 0;
+            return 0;
+        }
+        if (op >= 0xD8 && op <= 0xDF) {        /* x87: memory operands only */
+            *use = addr;
+            return 0;
+        }
+
+        switch (op) {
+        case 0x63:                              /* movsxd r, r/m32 */
+        case 0x8B:                              /* mov r, r/m */
+        case 0x8D:                              /* lea r, m */
+            *use = addr | rm;
+            *def = wide ? reg : 0;
+            return 0;
+        case 0x69:                              /* imul r, r/m, imm */
+        case 0x6B:
+            *use = addr | rm;
+            *def = wide ? reg : 0;
+            return 0;
+        case 0x68:                              /* push imm */
+        case 0x6A:
+            *use = R(X86_RSP);
+            *def = R(X86_RSP);
+            return 0;
+        case 0x80:                              /* grp1 r/m, imm */
+        case 0x81:
+        case 0x83:
+            *use = addr | rm;
+            *def = (op != 0x80 && ext != 7 && wide) ? rm : 0;
+            return 0;
+        case 0x84:                              /* test */
+        case 0x85:
+        case 0x86:                              /* xchg r/m8, r8 */
+            *use = addr | reg | rm;
+            return 0;
+        case 0x87:                              /* xchg r/m, r */
+            *use = addr | reg | rm;
+            *def = wide ? (reg | rm) : 0;
+            return 0;
+        case 0x88:                              /* mov r/m8, r8 */
+            *use = addr | reg;
+            return 0;
+        case 0x89:                              /* mov r/m, r */
+            *use = addr | reg;
+            *def = wide ? rm : 0;
+            return 0;
+        case 0x8A:                              /* mov r8, r/m8 */
+            *use = addr | rm;
+            return 0;
+        case 0x8F:                              /* pop r/m */
+            *use = addr | R(X86_RSP);
+            *def = R(X86_RSP) | (insn->opsize ? 0 : rm);
+            return 0;
+        case 0x90:                              /* nop, or xchg r8, rax */
+            if (insn->rex & 0x01) {
+                *use = oreg | R(X86_RAX);
+                *def = wide ? (oreg | R(X86_RAX)) : 0;
+            }
+            return 0;
+        case 0x98:                              /* cwde/cdqe */
+            *use = R(X86_RAX);
+            *def = wide ? R(X86_RAX) : 0;
+            return 0;
+        case 0x99:                              /* cdq/cqo */
+            *use = R(X86_RAX) | (wide ? 0 : R(X86_RDX));
+            *def = wide ? R(X86_RDX) : 0;
+            return 0;
+        case 0xA8:                              /* test al/eax, imm */
+        case 0xA9:
+            *use = R(X86_RAX);
+            return 0;
+        case 0xC0:                              /* shift group */
+        case 0xC1:
+        case 0xD0:
+        case 0xD1:
+        case 0xD2:
+        case 0xD3:
+            *use = addr | rm | ((op == 0xD2 || op == 0xD3) ? R(X86_RCX) : 0);
+            return 0;
+        case 0xC6:                              /* mov r/m, imm */
+        case 0xC7:
+            if (ext)
+                return -EOPNOTSUPP;
+            *use = addr;
+            *def = (op == 0xC7 && wide) ? rm : 0;
+            return 0;
+        case 0xC9:                              /* leave */
+            *use = R(X86_RBP);
+            *def = R(X86_RSP) | (insn->opsize ? 0 : R(X86_RBP));
+            return 0;
+        case 0xF6:                              /* grp3 r/m8 */
+            *use = addr | rm | (ext >= 4 ? R(X86_RAX) : 0);
+            return 0;
+        case 0xF7:                              /* grp3 r/m */
+            *use = addr | rm;
+            if (ext == 2 || ext == 3)           /* not/neg */
+                *def = wide ? rm : 0;
+            if (ext >= 4) {                     /* mul/imul/div/idiv */
+                *use |= R(X86_RAX) | (ext >= 6 ? R(X86_RDX) : 0);
+                *def = wide ? (R(X86_RAX) | R(X86_RDX)) : 0;
+            }
+            return 0;
+        case 0xFE:                              /* inc/dec r/m8 */
+            if (ext > 1)
+                return -EOPNOTSUPP;
+            *use = addr | rm;
+            return 0;
+        case 0xFF:
+            if (ext <= 1) {                     /* inc/dec */
+                *use = addr | rm;
+                *def = wide ? rm : 0;
+                return 0;
+            }
+            if (ext == 6) {                     /* push r/m */
+                *use = addr | rm | R(X86_RSP);
+                *def = R(X86_RSP);
+                return 0;
+            }
+            return -EOPNOTSUPP;                 /* call/jmp */
+        case 0x9B:                              /* fwait */
+            return 0;
+        }
+        return -EOPNOTSUPP;
+    }
+
+    if (insn->map == FIJ_INSN_MAP_0F) {
+        if (op >= 0x40 && op <= 0x4F) {        /* cmovcc: dest kept if false */
+            *use = addr | reg | rm;
+            return 0;
+        }
+        if (op >= 0x90 && op <= 0x9F) {        /* setcc r/m8 */
+            *use = addr;
+            return 0;
+        }
+        if (op >= 0xC8 && op <= 0xCF) {        /* bswap */
+            *use = oreg;
+            *def = wide ? oreg : 0;
+            return 0;
+        }
+
+        if (op >= 0x18 && op <= 0x1F)          /* prefetch, hint nops, endbr */
+            return 0;
+
+        switch (op) {
+        case 0x31:                              /* rdtsc */
+            *def = R(X86_RAX) | R(X86_RDX);
+            return 0;
+        case 0xA2:                              /* cpuid */
+            *use = R(X86_RAX) | R(X86_RCX);
+            *def = R(X86_RAX) | R(X86_RBX) | R(X86_RCX) | R(X86_RDX);
+            return 0;
+        case 0xAF:                              /* imul r, r/m */
+            *use = addr | reg | rm;
+            *def = wide ? reg : 0;
+            return 0;
+        case 0xB6: case 0xB7:                   /* movzx */
+        case 0xBE: case 0xBF:                   /* movsx */
+            *use = addr | rm;
+            *def = wide ? reg : 0;
+            return 0;
+        case 0xBC: case 0xBD:                   /* bsf/bsr keep dest on zero, tzcnt/lzcnt do not */
+            *use = addr | rm | (insn->rep == 0xF3 ? 0 : reg);
+            *def = (insn->rep == 0xF3 && wide) ? reg : 0;
+            return 0;
+        case 0xA3: case 0xAB: case 0xB3: case 0xBB: case 0xBA:  /* bt* */
+        case 0xA4: case 0xAC:                   /* shld/shrd imm */
+        case 0xB0: case 0xB1:                   /* cmpxchg (also reads rax, below) */
+        case 0xC0: case 0xC1:                   /* xadd */
+            *use = addr | reg | rm;
+            if (op == 0xB0 || op == 0xB1)
+                *use |= R(X86_RAX);
+            return 0;
+        case 0xA5: case 0xAD:                   /* shld/shrd cl */
+            *use = addr | reg | rm | R(X86_RCX);
+            return 0;
+        case 0xF7:                              /* maskmovq writes [rdi] */
+            *use = addr | reg | rm | R(X86_RDI);
+            return 0;
+        }
+
+        /*
+         * SSE/MMX: no implicit GPR operands. A GPR is only read through
+         * ModRM.rm (movd, cvtsi2sd, pinsrw); ModRM.reg names a GPR only as
+         * a destination (cvttsd2si, pextrw, movmskps), which we can ignore.
+         */
+        if ((op >= 0x10 && op <= 0x17) || (op >= 0x28 && op <= 0x2F) ||
+            (op >= 0x50 && op <= 0x7F && op != 0x77) ||
+            op == 0xC2 || (op >= 0xC4 && op <= 0xC6) || op >= 0xD0) {
+            *use = addr | rm;
+            return 0;
+        }
+        return -EOPNOTSUPP;
+    }
+
+    if (insn->map == FIJ_INSN_MAP_0F38 || insn->map == FIJ_INSN_MAP_0F3A) {
+        *use = addr | reg | rm;
+        /* pcmpestr* read rax/rdx, pcmp*stri write rcx */
+        if (insn->map == FIJ_INSN_MAP_0F3A && op >= 0x60 && op <= 0x63)
+            *use |= R(X86_RAX) | R(X86_RDX);
+        return 0;
+    }
+
+    return -EOPNOTSUPP;
+}
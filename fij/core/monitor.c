@@ -1,4 +1,5 @@
 #include "fij_internal.h"
+#include "fij_trace.h"
 
 #include <linux/kthread.h>
 #include <linux/pid.h>
@@ -14,6 +15,22 @@ struct monitor_args {
     struct fij_ctx     *ctx;
 };
 
+/*
+ * Last user fault address recorded by the arch fault handler. Only the
+ * leader is still around once the group is dead, so a fault taken by
+ * another thread is not seen here (the field is then 0 or stale).
+ */
+static u64 fij_fault_addr(struct task_struct *t)
+{
+#if defined(CONFIG_X86)
+    return t->thread.cr2;
+#elif defined(CONFIG_ARM64)
+    return t->thread.fault_address;
+#else
+    return 0;
+#endif
+}
+
 static int monitor_thread_fn(void *data)
 {
     struct monitor_args *ma = data;
@@ -21,21 +38,43 @@ static int monitor_thread_fn(void *data)
     struct fij_ctx *ctx = ma->ctx;
     int exit_code = 0;
     bool exited = false;
+    bool hang_killed = false;
 
     set_freezable();
 
     for (;;) {
         bool target_exited = READ_ONCE(leader->exit_state) != 0;
         if (target_exited) {
+            fij_stamp(ctx, ts_exit);
             exited = true;
             exit_code = READ_ONCE(leader->exit_code);
             break;
         }
         if (kthread_should_stop()) {
+            fij_stamp(ctx, ts_exit);
             exit_code = SIGKILL;
             WRITE_ONCE(ctx->exec.result.process_hanged, 1);
             break;
         }
+        if (!hang_killed && fij_hang_sample(ctx, leader)) {
+            fij_info("TGID %d livelocked in [0x%lx, 0x%lx], killing\n",
+                    ctx->target_tgid, ctx->hang.pc_lo, ctx->hang.pc_hi);
+            WRITE_ONCE(ctx->exec.result.hang_detected, 1);
+            WRITE_ONCE(ctx->exec.result.hang_pc_lo, ctx->hang.pc_lo);
+            WRITE_ONCE(ctx->exec.result.hang_pc_hi, ctx->hang.pc_hi);
+            WRITE_ONCE(ctx->exec.result.process_hanged, 1);
+            fij_send_sigkill(ctx, "livelock");
+            hang_killed = true;
+        }
+        if (!hang_killed)
+            fij_profile_tick(ctx, leader);
+        if (!hang_killed && fij_rusage_over_budget(ctx, leader)) {
+            fij_info("TGID %d exceeded its CPU budget of %llu ns, killing\n",
+                    ctx->target_tgid, ctx->exec.params.cpu_budget_ns);
+            WRITE_ONCE(ctx->exec.result.process_hanged, 1);
+            fij_send_sigkill(ctx, "cpu_budget");
+            hang_killed = true;
+        }
 
         wait_event_killable_timeout(fij_mon_wq,
             kthread_should_stop() || READ_ONCE(leader->exit_state),
@@ -43,6 +82,8 @@ static int monitor_thread_fn(void *data)
         try_to_freeze();
     }
 
+    fij_rusage_collect(ctx, leader, exited);
+
     if (ctx->restore.active) {
         fij_revert_file_backed_bitflip(ctx);
     }
@@ -50,36 +91,52 @@ static int monitor_thread_fn(void *data)
     WRITE_ONCE(ctx->target_alive, 0);
 
     if (ctx->bitflip_thread) {
-        pr_info("monitor: target finished, stopping bitflip thread\n");
+        fij_info("monitor: target finished, stopping bitflip thread\n");
         if (waitqueue_active(&ctx->flip_wq)) {
             wake_up_all(&ctx->flip_wq);
         }
         fij_stop_bitflip_thread(ctx); 
     }
 
+    /* no more flips can happen: drop the watchpoint and report its outcome */
+    fij_watch_disarm(ctx);
+
     if (exited) {
         int sig = exit_code & 0x7f;
         bool coredump = !!(exit_code & 0x80);
         int status = (exit_code >> 8) & 0xff;
 
+        WRITE_ONCE(ctx->exec.result.sigal, sig);
+        if (sig == SIGSEGV || sig == SIGBUS)
+            WRITE_ONCE(ctx->exec.result.fault_addr, fij_fault_addr(leader));
+
         if (sig)
-            pr_info("TGID %d terminated by signal %d%s\n",
+            fij_info("TGID %d terminated by signal %d%s\n",
                     ctx->target_tgid, sig, coredump ? " (core)" : "");
         else
-            pr_info("TGID %d exited with status %d\n",
+            fij_info("TGID %d exited with status %d\n",
                     ctx->target_tgid, status);
     } else {
-        pr_info("monitor thread stopped before target exited\n");
+        fij_info("monitor thread stopped before target exited\n");
     }
 
     if (ctx->exec.params.target_pc_present) {
-        pr_info("fij: monitor_thread: target exited ... disarming probe\n");
+        fij_info("fij: monitor_thread: target exited ... disarming probe\n");
         fij_uprobe_disarm_sync(ctx);
     }
+    fij_digest_disarm(ctx);
+    fij_roi_disarm(ctx);
+    fij_trigger_disarm(ctx);
 
     WRITE_ONCE(ctx->exec.result.exit_code, exit_code);
+    trace_fij_exit(ctx->target_tgid, exit_code,
+                   READ_ONCE(ctx->exec.result.fault_injected),
+                   READ_ONCE(ctx->exec.result.process_hanged));
     
     WRITE_ONCE(ctx->running, 0);
+    fij_stamp(ctx, ts_monitor_done);
+    fij_stat_lat(FIJ_LAT_MONITOR, ctx->exec.result.ts_monitor_done - ctx->exec.result.ts_exit);
+    fij_stat_inc(FIJ_STAT_RUNS_FINISHED);
     complete(&ctx->monitor_done);
     WRITE_ONCE(ctx->pc_monitor_thread, NULL);
     
@@ -117,6 +174,10 @@ int fij_monitor_start(struct fij_ctx *ctx)
     ma->leader = leader;
     ma->ctx = ctx;
 
+    fij_hang_reset(ctx);
+    ctx->watch.status = FIJ_WATCH_OFF;
+    ctx->watch.pc = 0;
+
     ctx->pc_monitor_thread = kthread_run(monitor_thread_fn, ma, "fij_monitor");
     int err = 0;
     if (IS_ERR(ctx->pc_monitor_thread)) {
@@ -127,6 +188,10 @@ int fij_monitor_start(struct fij_ctx *ctx)
         return err;
     }
 
+    /* digests are recorded in golden runs too */
+    if (fij_digest_arm(ctx))
+        fij_warn("digest: checkpoint not armed, running without it\n");
+
     /* if no_injection == 1, we only monitor; never arm injection */
     if (ctx->exec.params.no_injection)
         return 0;
@@ -136,6 +201,10 @@ int fij_monitor_start(struct fij_ctx *ctx)
     init_waitqueue_head(&ctx->flip_wq);
     atomic_set(&ctx->flip_triggered, 0);
 
+    /* the trigger uprobe flips by itself, there is no delay to wait for */
+    if (fij_trigger_set(ctx))
+        return 0;
+
     /* bitflip thread is started */
     err = fij_start_bitflip_thread(ctx);
 
@@ -156,15 +225,15 @@ void fij_monitor_stop(struct fij_ctx *ctx)
     struct task_struct *t = READ_ONCE(ctx->pc_monitor_thread);
 
     if (t) {
-        pr_info("fij: monitor_stop: waiting for monitor to finish\n");
+        fij_info("fij: monitor_stop: waiting for monitor to finish\n");
         WRITE_ONCE(ctx->target_alive, 0);
         complete(&ctx->monitor_done);
-        pr_info("fij: monitor_stop: monitor finished\n");
+        fij_info("fij: monitor_stop: monitor finished\n");
         WRITE_ONCE(ctx->pc_monitor_thread, NULL);
-        pr_info("fij: thread stop");
+        fij_info("fij: thread stop");
     }
      else {
-        pr_info("fij: monitor_stop: no thread\n");
+        fij_info("fij: monitor_stop: no thread\n");
     }
 }
 
@@ -198,8 +267,10 @@ int fij_wait_task_stopped(struct task_struct *t, long timeout_jiffies)
             return -EINTR;
 
         /* Check timeout before sleeping */
-        if (time_after(jiffies, end))
+        if (time_after(jiffies, end)) {
+            fij_stat_inc(FIJ_STAT_STOP_TIMEOUT);
             return -ETIMEDOUT;
+        }
 
         /* Sleep briefly (interruptible so kthread_stop wakes us) */
         /* msecs_to_jiffies(1) is usually 1 tick */
@@ -1,6 +1,7 @@
 #include <linux/rcupdate.h>
 #include <linux/pid.h>
 #include <linux/sched.h>
+#include <linux/sched/signal.h>
 #include <linux/slab.h>
 
 #include "fij_internal.h"
@@ -51,6 +52,30 @@ static int fij_collect_descendants_preorder_rcu(struct task_struct *parent,
     return n;
 }
 
+/*
+ * Must be called under rcu_read_lock(): fn on root, then on every live
+ * descendant process in pre-order. Children hang off the thread that forked
+ * them, so the children of every thread are walked.
+ */
+void fij_for_each_process_rcu(struct task_struct *root,
+                              void (*fn)(struct task_struct *p, void *arg), void *arg)
+{
+    struct task_struct *t, *child;
+
+    fn(root, arg);
+    for_each_thread(root, t) {
+        list_for_each_entry_rcu(child, &t->children, sibling) {
+            if (child->flags & PF_KTHREAD)
+                continue;
+            if (READ_ONCE(child->exit_state))
+                continue;
+            if (!thread_group_leader(child))
+                continue;
+            fij_for_each_process_rcu(child, fn, arg);
+        }
+    }
+}
+
 /* collect root + descendants into ctx->targets at runtime. */
 int fij_collect_descendants(struct fij_ctx *ctx, pid_t root_tgid)
 {
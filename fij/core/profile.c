@@ -0,0 +1,328 @@
+#include "fij_internal.h"
+
+#include <linux/dcache.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/namei.h>
+#include <linux/ptrace.h>
+#include <linux/rcupdate.h>
+#include <linux/sched/mm.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+/*
+ * Profile-guided injection sites.
+ *
+ * A golden run with profile_period_us has the monitor sample the user PC
+ * of the target's threads that are on a CPU, like the livelock detector
+ * does, and store each as an offset into the file mapped there. The
+ * runner turns the samples into a histogram of sites weighted by execution
+ * time. An injected run then names one site as trigger, with the
+ * execution of it to stop at: the uprobe counts the hits of the target
+ * process and flips in the thread that executes the site for the
+ * trigger_hit-th time, before the instruction runs. A golden run with a
+ * trigger and trigger_hit = 0 only counts, which is how the runner learns
+ * how often each site runs.
+ *
+ * With a region of interest, only its inside is sampled and counted.
+ */
+
+#define FIJ_PROFILE_MAX_THREADS 64
+
+static bool fij_profile_in_roi(struct fij_ctx *ctx)
+{
+    return !fij_roi_set(ctx) || atomic_read(&ctx->roi.state) == FIJ_ROI_OPEN;
+}
+
+/* New buffer for the run about to start; the previous one is dropped */
+int fij_profile_start(struct fij_ctx *ctx)
+{
+    struct fij_profile_buf *p;
+
+    fij_profile_release(ctx);
+    if (ctx->exec.params.profile_period_us <= 0)
+        return 0;
+
+    p = kzalloc(sizeof(*p), GFP_KERNEL);
+    if (!p)
+        return -ENOMEM;
+
+    p->samples = kvmalloc_array(FIJ_PROFILE_MAX_SAMPLES, sizeof(*p->samples), GFP_KERNEL);
+    p->files = kvcalloc(FIJ_PROFILE_MAX_FILES, sizeof(*p->files), GFP_KERNEL);
+    if (!p->samples || !p->files) {
+        kvfree(p->samples);
+        kvfree(p->files);
+        kfree(p);
+        return -ENOMEM;
+    }
+
+    ctx->profile = p;
+    return 0;
+}
+
+static int fij_profile_file_index(struct fij_profile_buf *p, struct file *file)
+{
+    struct inode *inode = file_inode(file);
+    struct fij_profile_file *f;
+    char *path;
+    u32 i;
+
+    for (i = 0; i < p->nfiles; i++)
+        if (p->files[i].inode == inode)
+            return i;
+
+    if (p->nfiles == FIJ_PROFILE_MAX_FILES)
+        return -ENOSPC;
+
+    f = &p->files[p->nfiles];
+    path = d_path(&file->f_path, f->path, sizeof(f->path));
+    if (IS_ERR(path))
+        return PTR_ERR(path);
+    memmove(f->path, path, strlen(path) + 1);
+
+    f->inode = igrab(inode);
+    if (!f->inode)
+        return -ENOENT;
+
+    return p->nfiles++;
+}
+
+/* From the monitor loop: one sample per running thread every profile_period_us */
+void fij_profile_tick(struct fij_ctx *ctx, struct task_struct *leader)
+{
+    struct fij_profile_buf *p = ctx->profile;
+    struct fij_result *res = &ctx->exec.result;
+    unsigned long pcs[FIJ_PROFILE_MAX_THREADS];
+    struct task_struct *t;
+    struct mm_struct *mm;
+    u64 now = ktime_get_ns();
+    int i, n = 0;
+
+    if (!p || now < p->next_ns)
+        return;
+    p->next_ns = now + (u64)ctx->exec.params.profile_period_us * NSEC_PER_USEC;
+
+    if (!fij_profile_in_roi(ctx))
+        return;
+
+    rcu_read_lock();
+    for_each_thread(leader, t) {
+        if (t->flags & PF_KTHREAD)
+            continue;
+        if (READ_ONCE(t->exit_state))
+            continue;
+        /* weighted by execution time: blocked threads are not sampled */
+        if (!task_is_running(t))
+            continue;
+        if (n == FIJ_PROFILE_MAX_THREADS)
+            break;
+        pcs[n++] = instruction_pointer(task_pt_regs(t));
+    }
+    rcu_read_unlock();
+
+    if (!n)
+        return;
+
+    mm = get_task_mm(leader);
+    if (!mm)
+        return;
+
+    mmap_read_lock(mm);
+    for (i = 0; i < n; i++) {
+        struct vm_area_struct *vma = vma_lookup(mm, pcs[i]);
+        struct fij_profile_sample *s;
+        int file;
+
+        /* anonymous code (JIT, vdso) has no file to put a uprobe on */
+        if (p->nsamples == FIJ_PROFILE_MAX_SAMPLES || !vma || !vma->vm_file) {
+            p->dropped++;
+            continue;
+        }
+        file = fij_profile_file_index(p, vma->vm_file);
+        if (file < 0) {
+            p->dropped++;
+            continue;
+        }
+
+        s = &p->samples[p->nsamples++];
+        s->offset = pcs[i] - vma->vm_start + ((u64)vma->vm_pgoff << PAGE_SHIFT);
+        s->file = file;
+        s->reserved = 0;
+    }
+    mmap_read_unlock(mm);
+    mmput(mm);
+
+    WRITE_ONCE(res->profile_samples, p->nsamples);
+    WRITE_ONCE(res->profile_dropped, p->dropped);
+}
+
+int fij_profile_copy_out(struct fij_ctx *ctx, struct fij_profile *out)
+{
+    struct fij_profile_buf *p = ctx->profile;
+    char __user *files = u64_to_user_ptr(out->files);
+    u32 i;
+
+    if (!p)
+        return -ENODATA;
+    /* the monitor still samples */
+    if (READ_ONCE(ctx->running))
+        return -EBUSY;
+
+    out->nsamples = min(p->nsamples, out->max_samples);
+    out->nfiles = min(p->nfiles, out->max_files);
+
+    if (copy_to_user(u64_to_user_ptr(out->samples), p->samples,
+                     (size_t)out->nsamples * sizeof(*p->samples)))
+        return -EFAULT;
+
+    for (i = 0; i < out->nfiles; i++) {
+        if (copy_to_user(files + (size_t)i * FIJ_PROBE_PATH, p->files[i].path, FIJ_PROBE_PATH))
+            return -EFAULT;
+    }
+    return 0;
+}
+
+void fij_profile_release(struct fij_ctx *ctx)
+{
+    struct fij_profile_buf *p = ctx->profile;
+    u32 i;
+
+    if (!p)
+        return;
+
+    for (i = 0; i < p->nfiles; i++)
+        iput(p->files[i].inode);
+    kvfree(p->samples);
+    kvfree(p->files);
+    kfree(p);
+    ctx->profile = NULL;
+}
+
+/* Index of t among the user threads of its process, as thread_idx counts them */
+static int fij_thread_index(struct task_struct *task)
+{
+    struct task_struct *t;
+    int idx = 0;
+
+    rcu_read_lock();
+    for_each_thread(task->group_leader, t) {
+        if (t == task)
+            break;
+        if (t->mm && !(t->flags & PF_KTHREAD))
+            idx++;
+    }
+    rcu_read_unlock();
+    return idx;
+}
+
+static bool fij_trigger_filter(struct uprobe_consumer *uc, struct mm_struct *mm)
+{
+    struct fij_ctx *ctx = container_of(uc, struct fij_ctx, trigger.uc);
+
+    return fij_uprobe_mm_is_target(ctx, mm);
+}
+
+static int fij_trigger_hit(struct uprobe_consumer *uc, struct pt_regs *regs, u64 *bp_addr)
+{
+    struct fij_ctx *ctx = container_of(uc, struct fij_ctx, trigger.uc);
+    struct fij_result *res = &ctx->exec.result;
+    pid_t tgid = task_tgid_vnr(current);
+    u64 resumed, cpu_ns;
+    int ret;
+
+    if (tgid != READ_ONCE(ctx->target_tgid) || !fij_profile_in_roi(ctx))
+        return 0;
+
+    if (atomic64_inc_return(&ctx->trigger.hits) != READ_ONCE(ctx->exec.params.trigger_hit) ||
+        ctx->exec.params.no_injection)
+        return 0;
+
+    /* the thread at the site takes the fault, nothing has to be stopped */
+    if (!fij_rusage_target_cpu(ctx, &cpu_ns, NULL))
+        WRITE_ONCE(res->injection_cpu_ns, cpu_ns);
+    fij_stamp(ctx, ts_flip_start);
+    WRITE_ONCE(res->ts_flip_stopped, res->ts_flip_start);
+    WRITE_ONCE(res->target_tgid, tgid);
+    WRITE_ONCE(res->pid_idx, 0);
+    WRITE_ONCE(res->thread_idx, fij_thread_index(current));
+
+    ret = fij_flip_for_task(ctx, current, tgid);
+    fij_stamp(ctx, ts_flip_end);
+    if (ret) {
+        fij_stat_inc(FIJ_STAT_INJ_FAILED);
+        return 0;
+    }
+
+    resumed = READ_ONCE(res->ts_resume);
+    WRITE_ONCE(res->injection_time_ns,
+               resumed && res->ts_flip_start > resumed ? res->ts_flip_start - resumed : 0);
+    WRITE_ONCE(res->fault_injected, 1);
+    fij_stat_lat(FIJ_LAT_FLIP, res->ts_flip_end - res->ts_flip_start);
+    return 0;
+}
+
+int fij_trigger_arm(struct fij_ctx *ctx)
+{
+    const struct fij_probe *want = &ctx->exec.params.trigger;
+    struct fij_trigger *tr = &ctx->trigger;
+    struct path path;
+    char *name;
+    int err;
+
+    if (!fij_trigger_set(ctx))
+        return 0;
+
+    atomic64_set(&tr->hits, 0);
+
+    name = kstrndup(want->path, sizeof(want->path), GFP_KERNEL);
+    if (!name)
+        return -ENOMEM;
+    err = kern_path(name, LOOKUP_FOLLOW, &path);
+    kfree(name);
+    if (err)
+        goto fail;
+    tr->inode = igrab(d_inode(path.dentry));
+    path_put(&path);
+    if (!tr->inode) {
+        err = -ENOENT;
+        goto fail;
+    }
+
+    tr->uc.handler = fij_trigger_hit;
+    tr->uc.ret_handler = NULL;
+    tr->uc.filter = fij_trigger_filter;
+
+    tr->uprobe = uprobe_register(tr->inode, want->offset, 0, &tr->uc);
+    if (IS_ERR(tr->uprobe)) {
+        err = PTR_ERR(tr->uprobe);
+        tr->uprobe = NULL;
+        iput(tr->inode);
+        tr->inode = NULL;
+        goto fail;
+    }
+    fij_stat_inc(FIJ_STAT_UPROBE_ARM);
+    return 0;
+
+fail:
+    pr_err("trigger: probe at %s+0x%llx not armed (%d)\n", want->path, want->offset, err);
+    return err;
+}
+
+/* After the target exited: no hit can come any more */
+void fij_trigger_disarm(struct fij_ctx *ctx)
+{
+    struct fij_trigger *tr = &ctx->trigger;
+
+    if (tr->uprobe) {
+        uprobe_unregister_nosync(tr->uprobe, &tr->uc);
+        uprobe_unregister_sync();
+        tr->uprobe = NULL;
+        fij_stat_inc(FIJ_STAT_UPROBE_DISARM);
+        WRITE_ONCE(ctx->exec.result.trigger_hits, atomic64_read(&tr->hits));
+    }
+    if (tr->inode) {
+        iput(tr->inode);
+        tr->inode = NULL;
+    }
+}
@@ -0,0 +1,367 @@
+#include "fij_internal.h"
+
+#include <linux/bitops.h>
+#include <linux/mm.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <asm/syscall.h>
+
+/*
+ * Dead-register prefilter.
+ *
+ * Before a random register flip we decode a short window of straight-line
+ * instructions at the victim's saved PC. A register whose first access in
+ * that window is a full overwrite holds a value nobody will read, so a flip
+ * there is benign by construction and the pick is redrawn. The scan stops at
+ * the first branch or instruction we do not model: everything not decided by
+ * then is considered live, so the filter can only skip truly dead registers.
+ */
+
+#define FIJ_LIVE_DEF_WINDOW  8
+#define FIJ_LIVE_MAX_WINDOW  32
+
+/* ---------- x86-64 ---------- */
+#ifdef CONFIG_X86
+#include "fij_insn.h"
+
+#define FIJ_LIVE_MAX_BYTES  (FIJ_LIVE_MAX_WINDOW * FIJ_INSN_MAX_LEN)
+
+/* hardware register number -> enum fij_reg_id */
+static const u8 fij_x86_regs[16] = {
+    FIJ_REG_RAX, FIJ_REG_RCX, FIJ_REG_RDX, FIJ_REG_RBX,
+    FIJ_REG_RSP, FIJ_REG_RBP, FIJ_REG_RSI, FIJ_REG_RDI,
+    FIJ_REG_R8,  FIJ_REG_R9,  FIJ_REG_R10, FIJ_REG_R11,
+    FIJ_REG_R12, FIJ_REG_R13, FIJ_REG_R14, FIJ_REG_R15,
+};
+
+static bool fij_live_user_mode(struct pt_regs *regs)
+{
+    return user_64bit_mode(regs);
+}
+
+static u64 fij_live_scan(const u8 *code, int len, int window)
+{
+    u16 decided = 0, dead = 0;
+    u64 mask = 0;
+    int pos = 0, i, n;
+
+    for (i = 0; i < window && pos < len; i++) {
+        struct fij_insn insn;
+        u16 use, def;
+
+        n = fij_insn_decode(&insn, code + pos, len - pos);
+        if (n < 0)
+            break;
+        if (fij_insn_regs(&insn, &use, &def))
+            break;
+
+        /* sources are read before the destination is written */
+        dead |= def & ~use & ~decided;
+        decided |= use | def;
+        pos += n;
+    }
+
+    for (i = 0; i < 16; i++)
+        if (dead & (1U << i))
+            mask |= BIT_ULL(fij_x86_regs[i]);
+    return mask;
+}
+#endif /* CONFIG_X86 */
+
+
+/* ---------- arm64 (AArch64) ---------- */
+#ifdef CONFIG_ARM64
+
+#define FIJ_LIVE_MAX_BYTES  (FIJ_LIVE_MAX_WINDOW * 4)
+
+/* bit n = Xn, bit 31 = SP; register 31 reads/writes as XZR unless SP-form */
+#define A64_ZR(n)   ((n) == 31 ? 0U : (1U << (n)))
+#define A64_SP(n)   (1U << (n))
+
+static bool fij_live_user_mode(struct pt_regs *regs)
+{
+    return !compat_user_mode(regs);
+}
+
+/*
+ * Same contract as fij_insn_regs(): registers read and written by one
+ * straight-line A64 instruction, -EOPNOTSUPP for anything else.
+ * Every A64 GPR write replaces the full X register (W writes zero-extend).
+ */
+static int fij_a64_regs(u32 insn, u32 *use, u32 *def)
+{
+    u32 rd = insn & 31;
+    u32 rn = (insn >> 5) & 31;
+    u32 rm = (insn >> 16) & 31;
+    u32 ra = (insn >> 10) & 31;
+    bool s = insn & (1U << 29);
+
+    *use = 0;
+    *def = 0;
+
+    /* NOP and BTI; the PAC hints read and write LR */
+    if ((insn & 0xFFFFF01F) == 0xD503201F) {
+        u32 hint = (insn >> 5) & 0x7F;
+
+        return (hint == 0 || (hint & 0x79) == 0x20) ? 0 : -EOPNOTSUPP;
+    }
+
+    /* data processing, immediate */
+    if ((insn & 0x1C000000) == 0x10000000) {
+        switch ((insn >> 23) & 7) {
+        case 0: case 1:                 /* adr/adrp */
+            *def = A64_ZR(rd);
+            return 0;
+        case 2:                         /* add/sub imm */
+            *use = A64_SP(rn);
+            *def = s ? A64_ZR(rd) : A64_SP(rd);
+            return 0;
+        case 4:                         /* logical imm, ands writes xzr */
+            *use = A64_ZR(rn);
+            *def = ((insn >> 29) & 3) == 3 ? A64_ZR(rd) : A64_SP(rd);
+            return 0;
+        case 5:                         /* movn/movz/movk */
+            if (((insn >> 29) & 3) == 1)
+                return -EOPNOTSUPP;
+            if (((insn >> 29) & 3) == 3)
+                *use = A64_ZR(rd);
+            *def = A64_ZR(rd);
+            return 0;
+        case 6:                         /* sbfm/bfm/ubfm, bfm keeps bits of rd */
+            *use = A64_ZR(rn) | (((insn >> 29) & 3) == 1 ? A64_ZR(rd) : 0);
+            *def = A64_ZR(rd);
+            return 0;
+        case 7:                         /* extr */
+            *use = A64_ZR(rn) | A64_ZR(rm);
+            *def = A64_ZR(rd);
+            return 0;
+        }
+        return -EOPNOTSUPP;
+    }
+
+    /* loads and stores */
+    if ((insn & 0x0A000000) == 0x08000000) {
+        bool simd = insn & (1U << 26);
+        u32 rt = rd;
+        u32 size = insn >> 30;
+        u32 opc = (insn >> 22) & 3;
+
+        /* ldr literal */
+        if ((insn & 0x3B000000) == 0x18000000) {
+            if (!simd && size != 3)
+                *def = A64_ZR(rt);
+            return 0;
+        }
+
+        /* ldp/stp, any addressing mode */
+        if ((insn & 0x3A000000) == 0x28000000) {
+            u32 pair = A64_ZR(rt) | A64_ZR(ra);
+
+            *use = A64_SP(rn);
+            if (!simd) {
+                if (insn & (1U << 22))
+                    *def = pair;
+                else
+                    *use |= pair;
+            }
+            return 0;
+        }
+
+        /* ldr/str: unsigned offset, unscaled/pre/post-index, register offset */
+        if ((insn & 0x3B000000) == 0x39000000 ||
+            (insn & 0x3B200000) == 0x38000000 ||
+            (insn & 0x3B200C00) == 0x38200800) {
+            *use = A64_SP(rn);
+            if ((insn & 0x3B200C00) == 0x38200800)
+                *use |= A64_ZR(rm);
+            if (simd)
+                return 0;
+            switch (opc) {
+            case 0:                     /* store */
+                *use |= A64_ZR(rt);
+                return 0;
+            case 1:                     /* load, zero-extended */
+                *def = A64_ZR(rt);
+                return 0;
+            case 2:                     /* load signed to X, or prfm */
+                if (size != 3)
+                    *def = A64_ZR(rt);
+                return 0;
+            case 3:                     /* load signed to W */
+                if (size >= 2)
+                    return -EOPNOTSUPP;
+                *def = A64_ZR(rt);
+                return 0;
+            }
+        }
+
+        /* exclusives, atomics, pointer-auth loads, SIMD structures */
+        return -EOPNOTSUPP;
+    }
+
+    /* data processing, register */
+    if ((insn & 0x0E000000) == 0x0A000000) {
+        u32 op = (insn >> 10) & 0x3F;
+
+        if ((insn & 0x1F000000) == 0x0A000000 ||      /* logical shifted */
+            (insn & 0x1F200000) == 0x0B000000 ||      /* add/sub shifted */
+            (insn & 0x1FE00000) == 0x1A000000 ||      /* adc/sbc */
+            (insn & 0x1FE00000) == 0x1A800000) {      /* csel/csinc/... */
+            *use = A64_ZR(rn) | A64_ZR(rm);
+            *def = A64_ZR(rd);
+            return 0;
+        }
+        if ((insn & 0x1F200000) == 0x0B200000) {      /* add/sub extended */
+            *use = A64_SP(rn) | A64_ZR(rm);
+            *def = s ? A64_ZR(rd) : A64_SP(rd);
+            return 0;
+        }
+        if ((insn & 0x1FE00000) == 0x1A400000) {      /* ccmp/ccmn */
+            *use = A64_ZR(rn) | ((insn & (1U << 11)) ? 0 : A64_ZR(rm));
+            return 0;
+        }
+        if ((insn & 0x5FE00000) == 0x1AC00000) {      /* 2-source */
+            /* udiv/sdiv, shifts by register, crc32; not the MTE/PAC ones */
+            if (op == 2 || op == 3 || (op >= 8 && op <= 11) || (op >= 16 && op <= 23)) {
+                *use = A64_ZR(rn) | A64_ZR(rm);
+                *def = A64_ZR(rd);
+                return 0;
+            }
+            return -EOPNOTSUPP;
+        }
+        if ((insn & 0x5FFF0000) == 0x5AC00000 && op <= 5) { /* rbit/rev/clz/cls */
+            *use = A64_ZR(rn);
+            *def = A64_ZR(rd);
+            return 0;
+        }
+        if ((insn & 0x1F000000) == 0x1B000000) {      /* madd/msub/smull/umulh... */
+            *use = A64_ZR(rn) | A64_ZR(rm) | A64_ZR(ra);
+            *def = A64_ZR(rd);
+            return 0;
+        }
+        return -EOPNOTSUPP;
+    }
+
+    /*
+     * SIMD/FP data processing: the GPR forms (fmov, scvtf, dup, ins) take
+     * their GPR source in Rn; GPR destinations are simply not counted.
+     */
+    if ((insn & 0x0E000000) == 0x0E000000) {
+        *use = A64_ZR(rn);
+        return 0;
+    }
+
+    /* branches, exceptions, system */
+    return -EOPNOTSUPP;
+}
+
+static u64 fij_live_scan(const u8 *code, int len, int window)
+{
+    u32 decided = 0, dead = 0;
+    u64 mask = 0;
+    int pos, i;
+
+    for (i = 0, pos = 0; i < window && pos + 4 <= len; i++, pos += 4) {
+        __le32 word;
+        u32 use, def;
+
+        memcpy(&word, code + pos, sizeof(word));
+        if (fij_a64_regs(le32_to_cpu(word), &use, &def))
+            break;
+        dead |= def & ~use & ~decided;
+        decided |= use | def;
+    }
+
+    for (i = 0; i < 31; i++)
+        if (dead & (1U << i))
+            mask |= BIT_ULL(FIJ_REG_X0 + i);
+    if (dead & (1U << 31))
+        mask |= BIT_ULL(FIJ_REG_SP);
+    return mask;
+}
+#endif /* CONFIG_ARM64 */
+
+
+#if defined(CONFIG_X86) || defined(CONFIG_ARM64)
+
+/* Registers (bit = enum fij_reg_id) overwritten before use after regs' PC */
+static u64 fij_regs_dead_mask(pid_t tgid, struct pt_regs *regs, int window)
+{
+    struct task_struct *task;
+    u8 *code;
+    int len;
+    u64 dead = 0;
+
+    if (!user_mode(regs) || !fij_live_user_mode(regs))
+        return 0;
+
+    rcu_read_lock();
+    task = pid_task(find_vpid(tgid), PIDTYPE_TGID);
+    if (task)
+        get_task_struct(task);
+    rcu_read_unlock();
+    if (!task)
+        return 0;
+
+    /*
+     * A thread stopped on its way out of a syscall may still have it
+     * restarted, with kernel-written registers and a rewound PC.
+     */
+    if (syscall_get_nr(task, regs) >= 0)
+        goto out_put;
+
+    code = kmalloc(FIJ_LIVE_MAX_BYTES, GFP_KERNEL);
+    if (!code)
+        goto out_put;
+
+    len = access_process_vm(task, instruction_pointer(regs), code,
+                            FIJ_LIVE_MAX_BYTES, FOLL_FORCE);
+    if (len > 0)
+        dead = fij_live_scan(code, len, window);
+    kfree(code);
+
+out_put:
+    put_task_struct(task);
+    return dead;
+}
+
+#else
+
+static u64 fij_regs_dead_mask(pid_t tgid, struct pt_regs *regs, int window)
+{
+    return 0;
+}
+
+#endif
+
+/* Random register for the flip, redrawn while it is dead at regs' PC */
+enum fij_reg_id fij_pick_live_reg(struct fij_ctx *ctx, struct pt_regs *regs, pid_t tgid)
+{
+    int window = ctx->exec.params.reg_prefilter_window;
+    enum fij_reg_id reg = fij_pick_random_reg_any(ctx);
+    u64 dead;
+    int skipped = 0;
+
+    if (!ctx->exec.params.reg_prefilter)
+        return reg;
+
+    if (window <= 0)
+        window = FIJ_LIVE_DEF_WINDOW;
+    if (window > FIJ_LIVE_MAX_WINDOW)
+        window = FIJ_LIVE_MAX_WINDOW;
+
+    /* the PC is never dead, so this terminates */
+    dead = fij_regs_dead_mask(tgid, regs, window);
+    while (dead & BIT_ULL(reg)) {
+        skipped++;
+        reg = fij_pick_random_reg_any(ctx);
+    }
+
+    fij_info("prefilter: %d dead registers at pc 0x%lx, %d picks skipped\n",
+            hweight64(dead), instruction_pointer(regs), skipped);
+
+    /* all_threads mode flips once per thread: accumulate */
+    ctx->exec.result.regs_dead += hweight64(dead);
+    ctx->exec.result.regs_skipped += skipped;
+    return reg;
+}
@@ -0,0 +1,154 @@
+#include "fij_internal.h"
+
+#include <linux/fs.h>
+#include <linux/namei.h>
+#include <linux/slab.h>
+#include <linux/timekeeping.h>
+
+/*
+ * Region of interest.
+ *
+ * roi_start and roi_end name an instruction by file and file offset, so
+ * they can sit in a shared library as well as in the executable. The
+ * uprobes are registered on the file's inode while the target is still
+ * stopped before its first instruction, and uprobes follow the inode into
+ * every later mapping, libraries loaded with dlopen() included. The first
+ * roi_start hit in the target opens the region and the first roi_end hit
+ * after it closes it. An injected run's delay counts from the opening and
+ * a flip due after the closing is dropped, so every fault lands inside the
+ * region. Golden runs record both ends too: the runner sizes the injection
+ * window from them.
+ */
+
+static bool fij_roi_filter(struct uprobe_consumer *uc, struct mm_struct *mm)
+{
+    struct fij_roi_probe *probe = container_of(uc, struct fij_roi_probe, uc);
+
+    return fij_uprobe_mm_is_target(probe->ctx, mm);
+}
+
+static int fij_roi_hit(struct uprobe_consumer *uc, struct pt_regs *regs, u64 *bp_addr)
+{
+    struct fij_roi_probe *probe = container_of(uc, struct fij_roi_probe, uc);
+    struct fij_ctx *ctx = probe->ctx;
+    struct fij_roi *roi = &ctx->roi;
+    struct fij_result *res = &ctx->exec.result;
+    u64 now = ktime_get_ns();
+    u64 cpu_ns = 0;
+
+    if (task_tgid_vnr(current) != READ_ONCE(ctx->target_tgid))
+        return 0;
+
+    if (probe == &roi->probe[0]) {
+        if (atomic_cmpxchg(&roi->state, FIJ_ROI_BEFORE, FIJ_ROI_OPENING) != FIJ_ROI_BEFORE)
+            return 0;
+
+        fij_rusage_target_cpu(ctx, &cpu_ns, NULL);
+        roi->start_cpu_ns = cpu_ns;
+        WRITE_ONCE(res->ts_roi_start, now);
+        atomic_set_release(&roi->state, FIJ_ROI_OPEN);
+
+        /* the bitflip thread starts counting the delay */
+        if (!ctx->exec.params.no_injection && atomic_xchg(&ctx->flip_triggered, 1) == 0)
+            wake_up(&ctx->flip_wq);
+        return 0;
+    }
+
+    if (atomic_cmpxchg(&roi->state, FIJ_ROI_OPEN, FIJ_ROI_CLOSED) != FIJ_ROI_OPEN)
+        return 0;
+
+    fij_rusage_target_cpu(ctx, &cpu_ns, NULL);
+    WRITE_ONCE(res->ts_roi_end, now);
+    WRITE_ONCE(res->roi_cpu_ns, cpu_ns - roi->start_cpu_ns);
+    return 0;
+}
+
+int fij_roi_arm(struct fij_ctx *ctx)
+{
+    const struct fij_probe *want[2] = {
+        &ctx->exec.params.roi_start, &ctx->exec.params.roi_end,
+    };
+    struct fij_roi *roi = &ctx->roi;
+    struct path path;
+    char *name;
+    int i, err = 0;
+
+    if (!fij_roi_set(ctx))
+        return 0;
+
+    for (i = 0; i < 2; i++) {
+        struct fij_roi_probe *probe = &roi->probe[i];
+
+        if (!want[i]->present)
+            continue;
+
+        name = kstrndup(want[i]->path, sizeof(want[i]->path), GFP_KERNEL);
+        if (!name) {
+            err = -ENOMEM;
+            goto fail;
+        }
+        err = kern_path(name, LOOKUP_FOLLOW, &path);
+        kfree(name);
+        if (err)
+            goto fail;
+        probe->inode = igrab(d_inode(path.dentry));
+        path_put(&path);
+        if (!probe->inode) {
+            err = -ENOENT;
+            goto fail;
+        }
+
+        probe->ctx = ctx;
+        probe->uc.handler = fij_roi_hit;
+        probe->uc.ret_handler = NULL;
+        probe->uc.filter = fij_roi_filter;
+
+        probe->uprobe = uprobe_register(probe->inode, want[i]->offset, 0, &probe->uc);
+        if (IS_ERR(probe->uprobe)) {
+            err = PTR_ERR(probe->uprobe);
+            probe->uprobe = NULL;
+            goto fail;
+        }
+        fij_stat_inc(FIJ_STAT_UPROBE_ARM);
+    }
+    return 0;
+
+fail:
+    pr_err("roi: %s probe at %s+0x%llx not armed (%d)\n", i ? "end" : "start",
+           want[i]->path, want[i]->offset, err);
+    fij_roi_disarm(ctx);
+    return err;
+}
+
+/* After the target exited and its CPU time was collected */
+void fij_roi_disarm(struct fij_ctx *ctx)
+{
+    struct fij_roi *roi = &ctx->roi;
+    struct fij_result *res = &ctx->exec.result;
+    bool registered = false;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        struct fij_roi_probe *probe = &roi->probe[i];
+
+        if (probe->uprobe) {
+            uprobe_unregister_nosync(probe->uprobe, &probe->uc);
+            probe->uprobe = NULL;
+            registered = true;
+            fij_stat_inc(FIJ_STAT_UPROBE_DISARM);
+        }
+    }
+    if (registered)
+        uprobe_unregister_sync();
+
+    for (i = 0; i < 2; i++) {
+        if (roi->probe[i].inode) {
+            iput(roi->probe[i].inode);
+            roi->probe[i].inode = NULL;
+        }
+    }
+
+    /* a region still open ends with the target */
+    if (atomic_cmpxchg(&roi->state, FIJ_ROI_OPEN, FIJ_ROI_CLOSED) == FIJ_ROI_OPEN)
+        WRITE_ONCE(res->roi_cpu_ns, READ_ONCE(res->cpu_ns) - roi->start_cpu_ns);
+}
@@ -0,0 +1,234 @@
+#include "fij_internal.h"
+
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/perf_event.h>
+#include <linux/rcupdate.h>
+#include <linux/sched/cputime.h>
+#include <linux/sched/mm.h>
+#include <linux/sched/signal.h>
+
+/*
+ * Per-run resource accounting.
+ *
+ * Counters come from signal_struct, which accumulates exited threads and
+ * the children the target reaped, plus the threads still linked to the
+ * group. Perf counters are attached to the stopped leader right after exec
+ * with inherit set, so threads and forked children are counted too. Without
+ * a PMU (most VMs) the software task-clock is used instead.
+ */
+
+static struct perf_event *fij_rusage_counter(struct task_struct *task, u32 type, u64 config)
+{
+    struct perf_event_attr attr = {
+        .type           = type,
+        .size           = sizeof(attr),
+        .config         = config,
+        .inherit        = 1,
+        .exclude_hv     = 1,
+    };
+
+    return perf_event_create_kernel_counter(&attr, -1, task, NULL, NULL);
+}
+
+void fij_rusage_attach(struct fij_ctx *ctx)
+{
+    struct fij_rusage *ru = &ctx->rusage;
+    struct task_struct *task;
+    struct perf_event *ev;
+
+    ru->source = FIJ_PERF_NONE;
+    if (!ctx->exec.params.perf_counters)
+        return;
+
+    task = fij_rcu_find_get_task_by_tgid(ctx->target_tgid);
+    if (!task)
+        return;
+
+    ev = fij_rusage_counter(task, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    if (!IS_ERR(ev)) {
+        ru->events[0] = ev;
+        ev = fij_rusage_counter(task, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        if (!IS_ERR(ev)) {
+            ru->events[1] = ev;
+            ru->source = FIJ_PERF_HW;
+            goto out;
+        }
+        perf_event_release_kernel(ru->events[0]);
+        ru->events[0] = NULL;
+    }
+
+    ev = fij_rusage_counter(task, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+    if (!IS_ERR(ev)) {
+        ru->events[0] = ev;
+        ru->source = FIJ_PERF_SW;
+    } else {
+        fij_info("rusage: no perf counter available (%ld)\n", PTR_ERR(ev));
+    }
+out:
+    put_task_struct(task);
+}
+
+void fij_rusage_release(struct fij_ctx *ctx)
+{
+    int i;
+
+    for (i = 0; i < FIJ_RUSAGE_MAX_EVENTS; i++) {
+        if (ctx->rusage.events[i]) {
+            perf_event_release_kernel(ctx->rusage.events[i]);
+            ctx->rusage.events[i] = NULL;
+        }
+    }
+}
+
+/* scaled for multiplexing when the PMU was shared */
+static u64 fij_rusage_read(struct perf_event *ev)
+{
+    u64 enabled, running, count;
+
+    count = perf_event_read_value(ev, &enabled, &running);
+    if (running && running < enabled)
+        count = mul_u64_u64_div_u64(count, enabled, running);
+    return count;
+}
+
+/* CPU time of the group: exited threads, live threads, reaped children */
+static u64 fij_rusage_cpu_ns(struct task_struct *leader, bool exited)
+{
+    struct signal_struct *sig = leader->signal;
+    struct task_struct *t;
+    u64 ns;
+
+    ns = READ_ONCE(sig->sum_sched_runtime) + READ_ONCE(sig->cutime) + READ_ONCE(sig->cstime);
+
+    /* a dead group has folded everything but the leader into sig */
+    if (exited)
+        return ns + READ_ONCE(leader->se.sum_exec_runtime);
+
+    rcu_read_lock();
+    for_each_thread(leader, t)
+        ns += READ_ONCE(t->se.sum_exec_runtime);
+    rcu_read_unlock();
+    return ns;
+}
+
+bool fij_rusage_over_budget(struct fij_ctx *ctx, struct task_struct *leader)
+{
+    u64 budget = ctx->exec.params.cpu_budget_ns;
+
+    if (!budget || READ_ONCE(ctx->exec.result.cpu_budget_exceeded))
+        return false;
+    if (fij_rusage_cpu_ns(leader, false) <= budget)
+        return false;
+
+    WRITE_ONCE(ctx->exec.result.cpu_budget_exceeded, 1);
+    return true;
+}
+
+/*
+ * CPU time of a process and of its children not yet reaped, recursively,
+ * and how many of their threads can still run. Reaped children are in the
+ * parent's cutime/cstime already. Must be called under rcu_read_lock().
+ */
+static u64 fij_rusage_tree_cpu_ns_rcu(struct task_struct *p, int *nthreads)
+{
+    struct task_struct *t, *child;
+    bool exited = READ_ONCE(p->exit_state);
+    u64 ns = fij_rusage_cpu_ns(p, exited);
+
+    if (exited)
+        return ns;
+
+    *nthreads += get_nr_threads(p);
+    for_each_thread(p, t) {
+        list_for_each_entry_rcu(child, &t->children, sibling) {
+            if (child->flags & PF_KTHREAD)
+                continue;
+            ns += fij_rusage_tree_cpu_ns_rcu(child, nthreads);
+        }
+    }
+    return ns;
+}
+
+/* The clock of delay_clock = FIJ_DELAY_CPU */
+int fij_rusage_target_cpu(struct fij_ctx *ctx, u64 *ns, int *nthreads)
+{
+    struct task_struct *leader;
+    int n = 0;
+
+    leader = fij_rcu_find_get_task_by_tgid(READ_ONCE(ctx->target_tgid));
+    if (!leader)
+        return -ESRCH;
+
+    rcu_read_lock();
+    *ns = fij_rusage_tree_cpu_ns_rcu(leader, &n);
+    rcu_read_unlock();
+    put_task_struct(leader);
+
+    if (nthreads)
+        *nthreads = n;
+    return 0;
+}
+
+void fij_rusage_collect(struct fij_ctx *ctx, struct task_struct *leader, bool exited)
+{
+    struct fij_result *res = &ctx->exec.result;
+    struct signal_struct *sig = leader->signal;
+    struct task_struct *t;
+    struct mm_struct *mm;
+    u64 utime, stime, min_flt, maj_flt, nvcsw, nivcsw;
+    unsigned long maxrss;
+
+    utime   = sig->utime + sig->cutime;
+    stime   = sig->stime + sig->cstime;
+    min_flt = sig->min_flt + sig->cmin_flt;
+    maj_flt = sig->maj_flt + sig->cmaj_flt;
+    nvcsw   = sig->nvcsw + sig->cnvcsw;
+    nivcsw  = sig->nivcsw + sig->cnivcsw;
+    maxrss  = max(sig->maxrss, sig->cmaxrss);
+
+    if (exited) {
+        utime   += leader->utime;
+        stime   += leader->stime;
+        min_flt += leader->min_flt;
+        maj_flt += leader->maj_flt;
+        nvcsw   += leader->nvcsw;
+        nivcsw  += leader->nivcsw;
+    } else {
+        rcu_read_lock();
+        for_each_thread(leader, t) {
+            utime   += t->utime;
+            stime   += t->stime;
+            min_flt += t->min_flt;
+            maj_flt += t->maj_flt;
+            nvcsw   += t->nvcsw;
+            nivcsw  += t->nivcsw;
+        }
+        rcu_read_unlock();
+
+        mm = get_task_mm(leader);
+        if (mm) {
+            maxrss = max(maxrss, get_mm_hiwater_rss(mm));
+            mmput(mm);
+        }
+    }
+
+    res->utime_ns  = utime;
+    res->stime_ns  = stime;
+    res->cpu_ns    = fij_rusage_cpu_ns(leader, exited);
+    res->maxrss_kb = (u64)maxrss * (PAGE_SIZE / 1024);
+    res->min_flt   = min_flt;
+    res->maj_flt   = maj_flt;
+    res->nvcsw     = nvcsw;
+    res->nivcsw    = nivcsw;
+
+    res->perf_source = ctx->rusage.source;
+    if (ctx->rusage.source == FIJ_PERF_HW) {
+        res->perf_instructions = fij_rusage_read(ctx->rusage.events[0]);
+        res->perf_cycles       = fij_rusage_read(ctx->rusage.events[1]);
+    } else if (ctx->rusage.source == FIJ_PERF_SW) {
+        res->perf_task_clock_ns = fij_rusage_read(ctx->rusage.events[0]);
+    }
+
+    fij_rusage_release(ctx);
+}
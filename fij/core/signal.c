@@ -1,16 +1,17 @@
 #include <linux/sched/signal.h>
 #include "fij_internal.h"
+#include "fij_trace.h"
 
-int fij_send_sigkill(struct fij_ctx *ctx)
+int fij_send_sigkill_tgid(pid_t tgid, const char *reason)
 {
     struct pid *pid;
     int ret;
     /* If we don't have a valid target, bail out */
-    if (ctx->target_tgid <= 0)
+    if (tgid <= 0)
         return -ESRCH;
 
     rcu_read_lock();
-    pid = find_get_pid(ctx->target_tgid);
+    pid = find_get_pid(tgid);
     if (!pid) {
         rcu_read_unlock();
         return -ESRCH;
@@ -21,5 +22,13 @@ int fij_send_sigkill(struct fij_ctx *ctx)
     put_pid(pid);
     rcu_read_unlock();
 
+    trace_fij_kill(tgid, reason, ret);
+    fij_stat_inc(FIJ_STAT_KILLS);
+
     return ret;
+}
+
+int fij_send_sigkill(struct fij_ctx *ctx, const char *reason)
+{
+    return fij_send_sigkill_tgid(ctx->target_tgid, reason);
 }
\ No newline at end of file
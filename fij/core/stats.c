@@ -0,0 +1,135 @@
+#include "fij_internal.h"
+
+#include <linux/debugfs.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+
+/*
+ * Module-wide statistics in /sys/kernel/debug/fij/.
+ *
+ * Counters and latency histograms are per-CPU so the hot paths only do a
+ * this_cpu_inc. At about 2 KB per CPU they are allocated with alloc_percpu()
+ * rather than taken from the small per-CPU reserve modules share. Histogram bucket k > 0 counts latencies in [2^(k-1), 2^k) ns,
+ * bucket 0 counts zero. Writing anything to "reset" zeroes everything;
+ * increments racing with the reset may survive it.
+ */
+
+#define FIJ_HIST_BUCKETS 64
+
+struct fij_stats {
+    u64 counters[FIJ_STAT_NR];
+    u64 hist[FIJ_LAT_NR][FIJ_HIST_BUCKETS];
+};
+
+static struct fij_stats __percpu *fij_stats;
+static struct dentry *fij_debugfs_dir;
+
+static const char *const fij_stat_names[FIJ_STAT_NR] = {
+    [FIJ_STAT_RUNS_STARTED]   = "runs_started",
+    [FIJ_STAT_RUNS_FINISHED]  = "runs_finished",
+    [FIJ_STAT_INJ_REG]        = "injections_reg",
+    [FIJ_STAT_INJ_MEM]        = "injections_mem",
+    [FIJ_STAT_INJ_FAILED]     = "injections_failed",
+    [FIJ_STAT_EBUSY]          = "ebusy_rejections",
+    [FIJ_STAT_STOP_TIMEOUT]   = "stop_wait_timeouts",
+    [FIJ_STAT_KILLS]          = "kills",
+    [FIJ_STAT_UPROBE_ARM]     = "uprobe_arms",
+    [FIJ_STAT_UPROBE_DISARM]  = "uprobe_disarms",
+};
+
+static const char *const fij_lat_names[FIJ_LAT_NR] = {
+    [FIJ_LAT_EXEC]      = "exec_to_stop",
+    [FIJ_LAT_STOP_WAIT] = "stop_wait",
+    [FIJ_LAT_FLIP]      = "flip",
+    [FIJ_LAT_MONITOR]   = "monitor_completion",
+};
+
+void fij_stat_inc(enum fij_stat id)
+{
+    this_cpu_inc(fij_stats->counters[id]);
+}
+
+void fij_stat_lat(enum fij_lat id, u64 ns)
+{
+    int b = ns ? min_t(int, ilog2(ns) + 1, FIJ_HIST_BUCKETS - 1) : 0;
+
+    this_cpu_inc(fij_stats->hist[id][b]);
+}
+
+static int fij_counters_show(struct seq_file *m, void *v)
+{
+    int i, cpu;
+
+    for (i = 0; i < FIJ_STAT_NR; i++) {
+        u64 sum = 0;
+
+        for_each_possible_cpu(cpu)
+            sum += per_cpu_ptr(fij_stats, cpu)->counters[i];
+        seq_printf(m, "%-20s %llu\n", fij_stat_names[i], sum);
+    }
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(fij_counters);
+
+static int fij_histograms_show(struct seq_file *m, void *v)
+{
+    int i, b, cpu;
+
+    for (i = 0; i < FIJ_LAT_NR; i++) {
+        u64 total = 0;
+
+        seq_printf(m, "%s (ns)\n", fij_lat_names[i]);
+        for (b = 0; b < FIJ_HIST_BUCKETS; b++) {
+            u64 sum = 0;
+
+            for_each_possible_cpu(cpu)
+                sum += per_cpu_ptr(fij_stats, cpu)->hist[i][b];
+            if (!sum)
+                continue;
+            total += sum;
+            seq_printf(m, "  [%llu, %llu) %llu\n",
+                       b ? 1ULL << (b - 1) : 0, 1ULL << b, sum);
+        }
+        seq_printf(m, "  total %llu\n\n", total);
+    }
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(fij_histograms);
+
+static ssize_t fij_reset_write(struct file *file, const char __user *buf,
+                               size_t count, loff_t *ppos)
+{
+    int cpu;
+
+    for_each_possible_cpu(cpu)
+        memset(per_cpu_ptr(fij_stats, cpu), 0, sizeof(struct fij_stats));
+    return count;
+}
+
+static const struct file_operations fij_reset_fops = {
+    .owner = THIS_MODULE,
+    .write = fij_reset_write,
+};
+
+int fij_stats_init(void)
+{
+    fij_stats = alloc_percpu(struct fij_stats);
+    if (!fij_stats)
+        return -ENOMEM;
+
+    /* statistics are optional: the module works without debugfs */
+    fij_debugfs_dir = debugfs_create_dir("fij", NULL);
+    debugfs_create_file("counters", 0444, fij_debugfs_dir, NULL, &fij_counters_fops);
+    debugfs_create_file("histograms", 0444, fij_debugfs_dir, NULL, &fij_histograms_fops);
+    debugfs_create_file("reset", 0200, fij_debugfs_dir, NULL, &fij_reset_fops);
+    return 0;
+}
+
+void fij_stats_exit(void)
+{
+    debugfs_remove_recursive(fij_debugfs_dir);
+    fij_debugfs_dir = NULL;
+    free_percpu(fij_stats);
+    fij_stats = NULL;
+}
@@ -0,0 +1,3 @@
+/* Instantiates the tracepoints declared in fij_trace.h */
+#define CREATE_TRACE_POINTS
+#include "fij_trace.h"
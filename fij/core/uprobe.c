@@ -12,6 +12,7 @@ static void uprobe_disarm_workfn(struct work_struct *work)
         uprobe_unregister_sync();
         ctx->inj_uprobe = NULL;
         WRITE_ONCE(ctx->uprobe_active, false);
+        fij_stat_inc(FIJ_STAT_UPROBE_DISARM);
     }
     if (ctx->inj_inode) {
         iput(ctx->inj_inode);
@@ -42,9 +43,9 @@ static void inject_workfn(struct work_struct *work)
     atomic_set(&ctx->inject_work_queued, 0);
 }
 
-static bool uprobe_filter(struct uprobe_consumer *uc, struct mm_struct *mm)
+/* Uprobe filter shared by every fij probe: only the target's own mm */
+bool fij_uprobe_mm_is_target(struct fij_ctx *ctx, struct mm_struct *mm)
 {
-    struct fij_ctx *ctx = container_of(uc, struct fij_ctx, uc);
     pid_t want = READ_ONCE(ctx->target_tgid);
 
     rcu_read_lock();
@@ -56,6 +57,13 @@ static bool uprobe_filter(struct uprobe_consumer *uc, struct mm_struct *mm)
     return have == want;
 }
 
+static bool uprobe_filter(struct uprobe_consumer *uc, struct mm_struct *mm)
+{
+    struct fij_ctx *ctx = container_of(uc, struct fij_ctx, uc);
+
+    return fij_uprobe_mm_is_target(ctx, mm);
+}
+
 // static int uprobe_hit(struct uprobe_consumer *uc, struct pt_regs *regs, u64 *bp_addr)
 // {
 //     int ret = 0;
@@ -98,7 +106,7 @@ static int uprobe_hit(struct uprobe_consumer *uc, struct pt_regs *regs, u64 *bp_
     struct fij_ctx *ctx = container_of(uc, struct fij_ctx, uc);
 
     /* Extremely small and fast in probe context */
-    pr_info("fij: uprobe_hit: pid=%d\n", current->pid);
+    fij_info("fij: uprobe_hit: pid=%d\n", current->pid);
 
     /* set trigger and wake the bitflip thread (if not already triggered) */
     if (atomic_xchg(&ctx->flip_triggered, 1) == 0)
@@ -158,6 +166,7 @@ int fij_uprobe_arm(struct fij_ctx *ctx, unsigned long target_va)
     }
 
     WRITE_ONCE(ctx->uprobe_active, true);
+    fij_stat_inc(FIJ_STAT_UPROBE_ARM);
     return 0;
 }
 
@@ -171,18 +180,19 @@ void fij_uprobe_schedule_disarm(struct fij_ctx *ctx)
 
 void fij_uprobe_disarm_sync(struct fij_ctx *ctx)
 {
-    pr_info("fij: uprobe_disarm_sync: begin\n");
+    fij_info("fij: uprobe_disarm_sync: begin\n");
     /* Flush any in-progress handler and then fully disarm */
     flush_work(&ctx->uprobe_disarm_work);
 
     if (READ_ONCE(ctx->uprobe_active) && ctx->inj_uprobe) {
-        pr_info("fij: uprobe_unregister_nosync()\n");
+        fij_info("fij: uprobe_unregister_nosync()\n");
         uprobe_unregister_nosync(ctx->inj_uprobe, &ctx->uc);
-        pr_info("fij: uprobe_unregister_sync()\n");
+        fij_info("fij: uprobe_unregister_sync()\n");
         uprobe_unregister_sync();
-        pr_info("fij: uprobe_unregister_sync() done\n");
+        fij_info("fij: uprobe_unregister_sync() done\n");
         ctx->inj_uprobe = NULL;
         WRITE_ONCE(ctx->uprobe_active, false);
+        fij_stat_inc(FIJ_STAT_UPROBE_DISARM);
     }
     if (ctx->inj_inode) {
         iput(ctx->inj_inode);
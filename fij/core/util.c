@@ -1,6 +1,8 @@
 #include "fij_internal.h"
+#include "fij_trace.h"
 #include <linux/mm.h>
 #include <linux/fs.h>
+#include <linux/random.h>
 #include <linux/sched/signal.h>
 
 struct task_struct *fij_rcu_find_get_task_by_tgid(pid_t tgid)
@@ -54,14 +56,16 @@ int fij_send_cont(pid_t tgid)
 {
     struct pid *p = find_get_pid(tgid);
     if (!p) {
-        pr_info("PID %d is already dead", tgid);
+        fij_info("PID %d is already dead", tgid);
+        trace_fij_resume(tgid, -ESRCH);
         return -ESRCH;
     }
 
     /* SIGCONT resumes whole thread group even if sent to one thread */
     send_sig(SIGCONT, pid_task(p, PIDTYPE_TGID), 0);
     put_pid(p);
-    pr_info("SIGCONT → TGID %d\n", tgid);
+    fij_info("SIGCONT → TGID %d\n", tgid);
+    trace_fij_resume(tgid, 0);
     return 0;
 }
 
@@ -82,7 +86,8 @@ struct task_struct *fij_pick_random_user_thread(int tgid, struct fij_ctx *ctx)
     }
     if (!n) { rcu_read_unlock(); put_task_struct(g); return NULL; }
 
-    pick = get_random_u32() % n;
+    /* a described fault names its thread, modulo the threads there are */
+    pick = fij_fault_set(ctx) ? ctx->exec.params.fault.thread_sel % n : fij_rand_below(ctx, n);
 
     /* Walk again to grab the pick-th eligible thread */
     for_each_thread(g, t) {
@@ -91,7 +96,7 @@ struct task_struct *fij_pick_random_user_thread(int tgid, struct fij_ctx *ctx)
                 get_task_struct(t);
                 chosen = t;
                 WRITE_ONCE(ctx->exec.result.thread_idx, pick);
-                pr_info("thread %d chosen\n", pick);
+                fij_info("thread %d chosen\n", pick);
                 break;
             }
         }
@@ -138,31 +143,31 @@ struct task_struct *fij_pick_user_thread_by_index(int tgid, int n1, struct fij_c
         }
     }
     WRITE_ONCE(ctx->exec.result.thread_idx, target);
-    pr_info("thread %d chosen\n", target+1);
+    fij_info("thread %d chosen\n", target+1);
     rcu_read_unlock();
     put_task_struct(g);
     return chosen; /* ref held if non-NULL */
 }
 
 /* Pick a random register id in [FIJ_REG_RAX .. FIJ_REG_MAX-1] */
-enum fij_reg_id fij_pick_random_reg_any(void)
+enum fij_reg_id fij_pick_random_reg_any(struct fij_ctx *ctx)
 {
     int range = (FIJ_REG_MAX - 1);   /* number of selectable regs */
-    return (enum fij_reg_id)(1 + (get_random_u32() % range));
+    return (enum fij_reg_id)(1 + (fij_rand_u32(ctx) % range));
 }
 
 /* Pick a random bit for a 64-bit register */
-int fij_pick_random_bit64(void)
+int fij_pick_random_bit64(struct fij_ctx *ctx)
 {
-    return get_random_u32() & 63;    /* 0..63 */
+    return fij_rand_u32(ctx) & 63;    /* 0..63 */
 }
 
-bool choose_register_target(int weight_mem, int only_mem)
+bool choose_register_target(struct fij_ctx *ctx, int weight_mem, int only_mem)
 {
     if(only_mem) {
         return 0;
     }
-    pr_info("only mem %d, weight mem %d\n", only_mem, weight_mem);
+    fij_info("only mem %d, weight mem %d\n", only_mem, weight_mem);
     const u32 weight_regs = 1;
 
     /* sanitize signed input: negatives behave like 0 */
@@ -179,8 +184,47 @@ bool choose_register_target(int weight_mem, int only_mem)
         u32 r;
         u32 limit = U32_MAX - (U32_MAX % total);
         do {
-            r = get_random_u32();
+            r = fij_rand_u32(ctx);
         } while (r >= limit);
         return (r % total) < weight_regs;   // i.e., r % total == 0
     }
 }
+
+/*
+ * Run randomness. Without a seed every draw is get_random_u32(). With
+ * fij_params.seed the draws of the run come from a splitmix64 stream
+ * started at the seed, so the same seed makes the same picks. Only the
+ * bitflip thread draws, no locking needed.
+ */
+void fij_rand_seed(struct fij_ctx *ctx)
+{
+    ctx->rng_state = ctx->exec.params.seed;
+}
+
+u64 fij_rand_u64(struct fij_ctx *ctx)
+{
+    u64 z;
+
+    if (!ctx->exec.params.seed)
+        return get_random_u64();
+
+    z = (ctx->rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+u32 fij_rand_u32(struct fij_ctx *ctx)
+{
+    if (!ctx->exec.params.seed)
+        return get_random_u32();
+    return (u32)(fij_rand_u64(ctx) >> 32);
+}
+
+/* in [0, ceil), ceil > 0 */
+u32 fij_rand_below(struct fij_ctx *ctx, u32 ceil)
+{
+    if (!ctx->exec.params.seed)
+        return get_random_u32_below(ceil);
+    return (u32)(((u64)fij_rand_u32(ctx) * ceil) >> 32);
+}
@@ -0,0 +1,229 @@
+#include "fij_internal.h"
+#include "fij_insn.h"
+
+#include <linux/hw_breakpoint.h>
+#include <linux/perf_event.h>
+#include <linux/ptrace.h>
+#include <linux/rcupdate.h>
+#include <linux/sched/signal.h>
+#include <linux/uaccess.h>
+
+/*
+ * Early termination of masked memory faults.
+ *
+ * After a memory flip we put a read/write user hardware breakpoint on the
+ * flipped byte in every thread of the victim process. x86 data breakpoints
+ * trap after the access and do not tell reads from writes, so the handler
+ * decodes the instruction that ended at the trapping PC. If it is a plain
+ * store the flipped byte was overwritten before anybody consumed it: the
+ * fault is masked and the run is killed right away. Anything else (or any
+ * ambiguity) means the fault may have been activated and the run goes on
+ * normally with the watchpoint removed.
+ */
+
+#if defined(CONFIG_HAVE_HW_BREAKPOINT) && defined(CONFIG_X86)
+
+static bool fij_watch_is_overwrite(struct pt_regs *regs)
+{
+    u8 buf[FIJ_INSN_MAX_LEN];
+    unsigned long ip = instruction_pointer(regs);
+    int k, candidates = 0;
+
+    /* kernel accesses (e.g. read() into the buffer) are not decoded */
+    if (!user_mode(regs) || !user_64bit_mode(regs))
+        return false;
+    if (ip < FIJ_INSN_MAX_LEN)
+        return false;
+    if (copy_from_user_nofault(buf, (void __user *)(ip - FIJ_INSN_MAX_LEN),
+                               FIJ_INSN_MAX_LEN))
+        return false;
+
+    /*
+     * We only know where the instruction ended. Every start offset that
+     * decodes to an instruction ending exactly at ip is a candidate, and
+     * all of them must be plain stores.
+     */
+    for (k = 1; k <= FIJ_INSN_MAX_LEN; k++) {
+        struct fij_insn insn;
+
+        if (fij_insn_decode(&insn, buf + FIJ_INSN_MAX_LEN - k, k) != k)
+            continue;
+        if (!fij_insn_is_pure_store(&insn))
+            return false;
+        candidates++;
+    }
+
+    return candidates > 0;
+}
+
+static void fij_watch_triggered(struct perf_event *bp,
+                                struct perf_sample_data *data,
+                                struct pt_regs *regs)
+{
+    struct fij_ctx *ctx = bp->overflow_handler_context;
+    bool overwrite;
+
+    /* only the first access matters */
+    if (atomic_xchg(&ctx->watch.hit, 1))
+        return;
+
+    overwrite = fij_watch_is_overwrite(regs);
+
+    /* a thread we are not watching may have read the byte already */
+    if (get_nr_threads(current) != ctx->watch.nthreads)
+        overwrite = false;
+
+    ctx->watch.pc = instruction_pointer(regs);
+    WRITE_ONCE(ctx->watch.status, overwrite ? FIJ_WATCH_MASKED : FIJ_WATCH_READ);
+
+    /* cannot sleep here: unregister and kill from process context */
+    schedule_work(&ctx->watch.work);
+}
+
+static void fij_watch_release(struct fij_ctx *ctx)
+{
+    int i;
+
+    for (i = 0; i < ctx->watch.nbps; i++) {
+        struct perf_event *bp = xchg(&ctx->watch.bps[i], NULL);
+
+        if (bp)
+            unregister_hw_breakpoint(bp);
+    }
+}
+
+static void fij_watch_workfn(struct work_struct *work)
+{
+    struct fij_ctx *ctx = container_of(work, struct fij_ctx, watch.work);
+    int status = READ_ONCE(ctx->watch.status);
+
+    fij_watch_release(ctx);
+
+    WRITE_ONCE(ctx->exec.result.watch_status, status);
+    WRITE_ONCE(ctx->exec.result.watch_pc, ctx->watch.pc);
+
+    if (status != FIJ_WATCH_MASKED || !READ_ONCE(ctx->target_alive))
+        return;
+
+    fij_info("flipped byte 0x%lx overwritten at pc 0x%lx, fault masked, killing TGID %d\n",
+            ctx->watch.addr, ctx->watch.pc, ctx->watch.tgid);
+
+    if (ctx->watch.tgid != ctx->target_tgid)
+        fij_send_sigkill_tgid(ctx->watch.tgid, "masked");
+    fij_send_sigkill(ctx, "masked");
+}
+
+int fij_watch_arm(struct fij_ctx *ctx, struct task_struct *task, unsigned long addr)
+{
+    struct task_struct *threads[FIJ_WATCH_MAX_THREADS];
+    struct perf_event_attr attr;
+    struct task_struct *t;
+    int n = 0, i, err = 0;
+    bool too_many = false;
+
+    /* all_threads mode flips several bytes: one watchpoint cannot vouch for all */
+    if (ctx->watch.nbps) {
+        fij_watch_release(ctx);
+        ctx->watch.nbps = 0;
+        WRITE_ONCE(ctx->watch.status, FIJ_WATCH_UNAVAILABLE);
+        WRITE_ONCE(ctx->exec.result.watch_status, FIJ_WATCH_UNAVAILABLE);
+        return -EBUSY;
+    }
+
+    ctx->watch.addr = addr;
+    ctx->watch.tgid = task->tgid;
+    ctx->watch.nbps = 0;
+    atomic_set(&ctx->watch.hit, 0);
+
+    rcu_read_lock();
+    for_each_thread(task, t) {
+        if (t->flags & PF_KTHREAD)
+            continue;
+        if (n == FIJ_WATCH_MAX_THREADS) {
+            too_many = true;
+            break;
+        }
+        get_task_struct(t);
+        threads[n++] = t;
+    }
+    rcu_read_unlock();
+
+    if (too_many) {
+        err = -E2BIG;
+        goto out_put;
+    }
+
+    ctx->watch.nthreads = n;
+
+    hw_breakpoint_init(&attr);
+    attr.bp_addr = addr;
+    attr.bp_len = HW_BREAKPOINT_LEN_1;
+    attr.bp_type = HW_BREAKPOINT_RW;
+    attr.disabled = 0;
+
+    for (i = 0; i < n; i++) {
+        struct perf_event *bp;
+
+        bp = register_user_hw_breakpoint(&attr, fij_watch_triggered, ctx, threads[i]);
+        if (IS_ERR(bp)) {
+            err = PTR_ERR(bp);
+            break;
+        }
+        ctx->watch.bps[ctx->watch.nbps++] = bp;
+    }
+
+out_put:
+    for (i = 0; i < n; i++)
+        put_task_struct(threads[i]);
+
+    if (err) {
+        /* no free debug register (or too many threads): run normally */
+        fij_watch_release(ctx);
+        ctx->watch.nbps = 0;
+        WRITE_ONCE(ctx->watch.status, FIJ_WATCH_UNAVAILABLE);
+        WRITE_ONCE(ctx->exec.result.watch_status, FIJ_WATCH_UNAVAILABLE);
+        fij_info("watchpoint unavailable for 0x%lx (%d), running to completion\n",
+                addr, err);
+        return err;
+    }
+
+    WRITE_ONCE(ctx->watch.status, FIJ_WATCH_ARMED);
+    WRITE_ONCE(ctx->exec.result.watch_status, FIJ_WATCH_ARMED);
+    return 0;
+}
+
+void fij_watch_disarm(struct fij_ctx *ctx)
+{
+    cancel_work_sync(&ctx->watch.work);
+    fij_watch_release(ctx);
+    ctx->watch.nbps = 0;
+
+    /* the work may have been cancelled before reporting the hit */
+    WRITE_ONCE(ctx->exec.result.watch_status, READ_ONCE(ctx->watch.status));
+    WRITE_ONCE(ctx->exec.result.watch_pc, ctx->watch.pc);
+}
+
+void fij_watch_init(struct fij_ctx *ctx)
+{
+    INIT_WORK(&ctx->watch.work, fij_watch_workfn);
+    atomic_set(&ctx->watch.hit, 0);
+}
+
+#else /* !CONFIG_HAVE_HW_BREAKPOINT || !CONFIG_X86 */
+
+int fij_watch_arm(struct fij_ctx *ctx, struct task_struct *task, unsigned long addr)
+{
+    WRITE_ONCE(ctx->watch.status, FIJ_WATCH_UNAVAILABLE);
+    WRITE_ONCE(ctx->exec.result.watch_status, FIJ_WATCH_UNAVAILABLE);
+    return -EOPNOTSUPP;
+}
+
+void fij_watch_disarm(struct fij_ctx *ctx)
+{
+}
+
+void fij_watch_init(struct fij_ctx *ctx)
+{
+}
+
+#endif
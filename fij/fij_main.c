@@ -1,5 +1,6 @@
 #include "fij_internal.h"
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/version.h>
 
 MODULE_LICENSE("GPL");
@@ -9,6 +10,11 @@ MODULE_VERSION("0.2");
 
 DECLARE_WAIT_QUEUE_HEAD(fij_mon_wq);
 
+/* per-run messages cost a console lock each: campaigns can run with 0 */
+int fij_loglevel = FIJ_LOG_INFO;
+module_param_named(loglevel, fij_loglevel, int, 0644);
+MODULE_PARM_DESC(loglevel, "dmesg verbosity: 0 errors only, 1 warnings, 2 info (default)");
+
 void fij_ctx_init(struct fij_ctx *ctx)
 {
     memset(ctx, 0, sizeof(*ctx));
@@ -18,6 +24,7 @@ void fij_ctx_init(struct fij_ctx *ctx)
 
     extern void fij_uprobe_init_work(struct fij_ctx *ctx);
     fij_uprobe_init_work(ctx);
+    fij_watch_init(ctx);
 
     atomic_set(&ctx->uprobe_disarm_queued, 0);
 }
@@ -26,9 +33,16 @@ static int __init fij_init(void)
 {
     int err;
 
+    err = fij_stats_init();
+    if (err) {
+        pr_err("failed to allocate statistics: %d\n", err);
+        return err;
+    }
+
     err = fij_chardev_register();
     if (err) {
         pr_err("failed to register misc device: %d\n", err);
+        fij_stats_exit();
         return err;
     }
 
@@ -44,6 +58,8 @@ static void __exit fij_exit(void)
     fij_chardev_unregister();
     pr_info("fij: chardev_unregister() done\n");
 
+    fij_stats_exit();
+
     pr_info("fij: EXIT end\n");
 }
 
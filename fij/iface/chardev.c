@@ -32,9 +32,16 @@ static int fij_release(struct inode *inode, struct file *file)
        after kfree(ctx), corrupting memory. */
     cancel_work_sync(&ctx->uprobe_disarm_work);
     cancel_work_sync(&ctx->inject_work);
+    fij_watch_disarm(ctx);
 
     /* 3. Cleanup Resources */
     fij_uprobe_disarm_sync(ctx);
+    fij_digest_disarm(ctx);
+    fij_roi_disarm(ctx);
+    fij_trigger_disarm(ctx);
+    fij_rusage_release(ctx);
+    fij_capture_release(ctx);
+    fij_profile_release(ctx);
     kfree(ctx->targets);
     kfree(ctx); // Free the context
     
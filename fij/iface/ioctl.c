@@ -1,4 +1,5 @@
 #include "fij_internal.h"
+#include "fij_trace.h"
 #include <linux/uaccess.h>
 #include <linux/slab.h>
 
@@ -41,8 +42,13 @@ static int fij_start_exec(struct fij_ctx *ctx)
     char *args_buf = NULL;
     int err = 0;
 
-    if (READ_ONCE(ctx->running))
+    if (READ_ONCE(ctx->running)) {
+        fij_stat_inc(FIJ_STAT_EBUSY);
         return -EBUSY;
+    }
+
+    fij_stamp(ctx, ts_exec_start);
+    fij_rand_seed(ctx);
 
     /* Build argv[] and copies from ctx->exec.params */
     err = fij_build_argv_from_params(&ctx->exec.params,
@@ -50,11 +56,24 @@ static int fij_start_exec(struct fij_ctx *ctx)
     if (err)
         goto out;
 
+    /* fresh stdout/stderr buffer, installed by the exec helper */
+    err = fij_capture_start(ctx);
+    if (err)
+        goto out;
+
+    /* fresh PC sample buffer for a profiled golden run */
+    err = fij_profile_start(ctx);
+    if (err)
+        goto out;
+
     /* Exec target and stop it under our control */
     err = fij_exec_and_stop(path_copy, argv, ctx);
     if (err)
         goto out;
 
+    fij_stamp(ctx, ts_exec_done);
+    fij_stat_lat(FIJ_LAT_EXEC, ctx->exec.result.ts_exec_done - ctx->exec.result.ts_exec_start);
+
     WRITE_ONCE(ctx->running, 1);
 
     if (ctx->target_tgid < 0) {
@@ -63,11 +82,21 @@ static int fij_start_exec(struct fij_ctx *ctx)
         goto out;
     }
 
-    pr_info("launched '%s' (TGID %d)\n",
+    fij_info("launched '%s' (TGID %d)\n",
             ctx->exec.params.process_name, ctx->target_tgid);
+    trace_fij_exec(ctx->target_tgid, ctx->exec.result.iteration_number,
+                   ctx->exec.params.no_injection,
+                   ctx->exec.result.ts_exec_done - ctx->exec.result.ts_exec_start);
 
     WRITE_ONCE(ctx->target_alive, true);
 
+    /* still stopped before its first instruction: make the run reproducible */
+    if (fij_digest_prepare(ctx))
+        fij_warn("digest: preparation failed, checkpoints may never match\n");
+
+    /* counters start before the target's first instruction */
+    fij_rusage_attach(ctx);
+
     /* If PC delay is specified initialize parameter */
     if (ctx->exec.params.target_pc_present) {
         struct pid *p_tmp;
@@ -96,6 +125,16 @@ static int fij_start_exec(struct fij_ctx *ctx)
         put_pid(p_tmp);
     }
 
+    /* region-of-interest probes are in place before the target's first instruction */
+    err = fij_roi_arm(ctx);
+    if (err)
+        goto out;
+
+    /* the injection site counts its hits from the first instruction on */
+    err = fij_trigger_arm(ctx);
+    if (err)
+        goto out;
+
     /* Start monitor thread to clean up when target exits */
     err = fij_monitor_start(ctx);
     if (err)
@@ -106,6 +145,9 @@ static int fij_start_exec(struct fij_ctx *ctx)
     if (err)
         goto out;
 
+    fij_stamp(ctx, ts_resume);
+    fij_stat_inc(FIJ_STAT_RUNS_STARTED);
+
     /* Success: we return without waiting for monitor_done */
     goto out;
 
@@ -136,7 +178,7 @@ long fij_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
         /* store params in ctx */
         ctx->exec.params = u;
         ctx->exec.result.iteration_number = u.iteration_number;
-        pr_info("send iteration number %d", ctx->exec.result.iteration_number);
+        fij_info("send iteration number %d", ctx->exec.result.iteration_number);
 
         /* we are starting a fresh run */
         reinit_completion(&ctx->monitor_done);
@@ -154,9 +196,11 @@ long fij_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
         if (!completion_done(&ctx->monitor_done))
             return -EAGAIN;
 
+        fij_stamp(ctx, ts_collect);
+        fij_capture_result(ctx);
         res = ctx->exec.result;
-        pr_info("receive iteration number %d", res.iteration_number);
-        pr_info("receive targetid PID %d", res.target_tgid);
+        fij_info("receive iteration number %d", res.iteration_number);
+        fij_info("receive targetid PID %d", res.target_tgid);
 
         if (copy_to_user((void __user *)arg, &res, sizeof(res)))
             return -EFAULT;
@@ -165,7 +209,7 @@ long fij_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
     }
 
     case IOCTL_EXEC_AND_FAULT: {
-        pr_info("started IOCTL EXEC");
+        fij_info("started IOCTL EXEC");
         struct fij_exec u;
         int err;
 
@@ -186,6 +230,8 @@ long fij_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
         if (wait_for_completion_interruptible(&ctx->monitor_done))
             return -ERESTARTSYS;
 
+        fij_stamp(ctx, ts_collect);
+        fij_capture_result(ctx);
         if (copy_to_user(&((struct fij_exec __user *)arg)->result,
                          &ctx->exec.result,
                          sizeof(ctx->exec.result)))
@@ -204,10 +250,10 @@ long fij_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
         if (!READ_ONCE(ctx->running) || ctx->target_tgid <= 0)
             return -ESRCH;
 
-        pr_info("IOCTL_KILL_TARGET: sending SIGKILL to TGID %d\n",
+        fij_info("IOCTL_KILL_TARGET: sending SIGKILL to TGID %d\n",
                 ctx->target_tgid);
 
-        ret = fij_send_sigkill(ctx);
+        ret = fij_send_sigkill(ctx, "ioctl");
 
         /*
          * We *don't* complete monitor_done or clear running here.
@@ -219,7 +265,7 @@ long fij_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 
         struct task_struct *mon_thread = READ_ONCE(ctx->pc_monitor_thread);
         if (mon_thread) {
-            pr_info("IOCTL_KILL_TARGET: stopping monitor thread manually\n");
+            fij_info("IOCTL_KILL_TARGET: stopping monitor thread manually\n");
             
             /* 1. Explicitly wake the waitqueue to ensure the loop breaks immediately */
             wake_up(&fij_mon_wq); 
@@ -227,12 +273,48 @@ long fij_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
             /* 2. Now call stop, which waits for the thread to return */
             kthread_stop(mon_thread);
             
-            pr_info("IOCTL_KILL_TARGET: monitor thread stopped\n");
+            fij_info("IOCTL_KILL_TARGET: monitor thread stopped\n");
         }
 
         return ret;
     }
 
+    case IOCTL_GET_OUTPUT: {
+        struct fij_output out;
+        int err;
+
+        /* captured stdout/stderr of the last run, head then tail */
+        if (copy_from_user(&out, (void __user *)arg, sizeof(out)))
+            return -EFAULT;
+
+        err = fij_capture_copy_out(ctx, &out);
+        if (err)
+            return err;
+
+        if (copy_to_user((void __user *)arg, &out, sizeof(out)))
+            return -EFAULT;
+
+        return 0;
+    }
+
+    case IOCTL_GET_PROFILE: {
+        struct fij_profile prof;
+        int err;
+
+        /* PC samples of the last run with profile_period_us */
+        if (copy_from_user(&prof, (void __user *)arg, sizeof(prof)))
+            return -EFAULT;
+
+        err = fij_profile_copy_out(ctx, &prof);
+        if (err)
+            return err;
+
+        if (copy_to_user((void __user *)arg, &prof, sizeof(prof)))
+            return -EFAULT;
+
+        return 0;
+    }
+
     default:
         return -EINVAL;
     }
@@ -0,0 +1,69 @@
+#ifndef _LINUX_FIJ_INSN_H
+#define _LINUX_FIJ_INSN_H
+
+#include <linux/types.h>
+
+/*
+ * Minimal x86-64 instruction decoder.
+ *
+ * The kernel's own decoder (arch/x86/lib/insn.c) is not exported to
+ * modules, so we carry the small subset we need: instruction length and
+ * the prefix/opcode/ModRM fields used to classify an instruction.
+ */
+
+#define FIJ_INSN_MAX_LEN 15
+
+enum fij_insn_map {
+    FIJ_INSN_MAP_1B = 0,    /* one-byte opcodes */
+    FIJ_INSN_MAP_0F,        /* 0F xx */
+    FIJ_INSN_MAP_0F38,      /* 0F 38 xx */
+    FIJ_INSN_MAP_0F3A,      /* 0F 3A xx */
+    FIJ_INSN_MAP_OTHER,     /* EVEX maps 5/6 */
+};
+
+struct fij_insn {
+    u8   len;
+    u8   map;               /* enum fij_insn_map */
+    u8   opcode;
+    u8   rex;               /* REX byte, 0 if none */
+    u8   modrm;
+    u8   sib;
+    u8   rep;               /* 0xF2, 0xF3 or 0 */
+    u8   disp_len;
+    u8   imm_len;
+    bool has_modrm;
+    bool has_sib;
+    bool opsize;            /* 0x66 */
+    bool adsize;            /* 0x67 */
+    bool lock;
+    bool vex;               /* VEX or EVEX encoded */
+};
+
+static inline u8 fij_insn_mod(const struct fij_insn *insn)
+{
+    return insn->modrm >> 6;
+}
+
+static inline u8 fij_insn_reg(const struct fij_insn *insn)
+{
+    return (insn->modrm >> 3) & 7;
+}
+
+/*
+ * Decode one 64-bit mode instruction from buf.
+ * Returns its length, or -EINVAL if buf does not start with a complete
+ * instruction we know how to decode.
+ */
+int fij_insn_decode(struct fij_insn *insn, const u8 *buf, int len);
+
+/* True if insn only writes memory (plain stores, push, stos, call) */
+bool fij_insn_is_pure_store(const struct fij_insn *insn);
+
+/*
+ * GPRs read (*use) and fully overwritten (*def) by a straight-line
+ * instruction, one bit per hardware register number (RAX=0 ... R15=15).
+ * Returns -EOPNOTSUPP for branches and instructions not modelled.
+ */
+int fij_insn_regs(const struct fij_insn *insn, u16 *use, u16 *def);
+
+#endif /* _LINUX_FIJ_INSN_H */
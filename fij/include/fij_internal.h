@@ -11,6 +11,10 @@
 #include <linux/pid.h>
 #include <linux/sched.h>
 #include <linux/kthread.h>
+#include <linux/timekeeping.h>
+#include <linux/kref.h>
+#include <linux/mutex.h>
+#include <linux/xxhash.h>
 
 #include <uapi/linux/fij.h>
 
@@ -29,6 +33,108 @@ struct fij_restore_info {
     bool active;            /* Is there something to restore? */
 };
 
+/* Livelock detector state, sampled from the monitor thread */
+struct fij_hang_state {
+    unsigned long pc_lo;        /* PC range seen since window_start */
+    unsigned long pc_hi;
+    u64           progress;     /* voluntary switches + faults + system time + syscalls */
+    u64           cpu_ns;       /* CPU time of the sampled threads */
+    unsigned long window_start; /* jiffies */
+    unsigned long next_sample;  /* jiffies */
+    bool          armed;        /* a valid window is open */
+};
+
+/* Hardware watchpoint on a flipped memory byte */
+#define FIJ_WATCH_MAX_THREADS 16
+
+struct fij_watch {
+    struct perf_event  *bps[FIJ_WATCH_MAX_THREADS]; /* one per thread */
+    int                 nbps;
+    int                 nthreads;   /* threads of the victim when armed */
+    pid_t               tgid;       /* victim process */
+    unsigned long       addr;       /* flipped byte */
+    atomic_t            hit;        /* first access already handled */
+    int                 status;     /* enum fij_watch_status */
+    unsigned long       pc;
+    struct work_struct  work;       /* unregister + kill, process context */
+};
+
+/* Memory-state digest checkpoint (uprobe at digest_pc) */
+struct fij_digest {
+    struct uprobe_consumer uc;
+    struct uprobe      *uprobe;
+    struct inode       *inode;
+    loff_t              off;
+    unsigned long       start_code;
+    bool                active;
+};
+
+/* Region of interest: uprobes at roi_start and roi_end */
+enum fij_roi_state {
+    FIJ_ROI_BEFORE = 0,
+    FIJ_ROI_OPENING,            /* first roi_start hit, start still being recorded */
+    FIJ_ROI_OPEN,
+    FIJ_ROI_CLOSED,
+};
+
+struct fij_roi_probe {
+    struct uprobe_consumer uc;
+    struct uprobe      *uprobe;
+    struct inode       *inode;
+    struct fij_ctx     *ctx;
+};
+
+struct fij_roi {
+    struct fij_roi_probe probe[2];  /* start, end */
+    atomic_t            state;      /* enum fij_roi_state */
+    u64                 start_cpu_ns;
+};
+
+/* PC profile of a golden run (profile_period_us), kept until the next run */
+struct fij_profile_file {
+    struct inode       *inode;      /* held, tells mappings of the same file apart */
+    char                path[FIJ_PROBE_PATH];
+};
+
+struct fij_profile_buf {
+    struct fij_profile_sample *samples;
+    struct fij_profile_file   *files;
+    u32                 nsamples;
+    u32                 nfiles;
+    u32                 dropped;
+    u64                 next_ns;    /* monotonic time of the next sample */
+};
+
+/* uprobe at fij_params.trigger: the flip happens at its trigger_hit-th hit */
+struct fij_trigger {
+    struct uprobe_consumer uc;
+    struct uprobe      *uprobe;
+    struct inode       *inode;
+    atomic64_t          hits;
+};
+
+/* perf counters attached to the target at exec */
+#define FIJ_RUSAGE_MAX_EVENTS 2
+
+struct fij_rusage {
+    struct perf_event  *events[FIJ_RUSAGE_MAX_EVENTS];
+    int                 source;             /* enum fij_perf_source */
+};
+
+/* captured stdout/stderr of one run; the target's fds hold references too */
+struct fij_capture {
+    struct kref         ref;
+    struct mutex        lock;
+    u32                 cap;        /* bytes kept at each end */
+    u32                 head_len;
+    u32                 tail_len;
+    u32                 tail_pos;   /* next write position in the tail ring */
+    u64                 total;
+    struct xxh64_state  hash;
+    char               *head;
+    char               *tail;
+};
+
 struct fij_ctx {
     /* targeting */
     pid_t              target_tgid;
@@ -68,8 +174,30 @@ struct fij_ctx {
 
     struct fij_exec exec;
     struct fij_restore_info restore;
+    struct fij_hang_state hang;
+    struct fij_watch watch;
+    struct fij_digest digest;
+    struct fij_roi roi;
+    struct fij_trigger trigger;
+    struct fij_rusage rusage;
+    struct fij_capture *capture;    /* last run with capture_output, or NULL */
+    struct fij_profile_buf *profile; /* last run with profile_period_us, or NULL */
+    u64 rng_state;                  /* splitmix64 state of a seeded run */
 };
 
+/* a run flipping the fault userspace described instead of drawing one */
+static inline bool fij_fault_set(const struct fij_ctx *ctx)
+{
+    return ctx->exec.params.fault.flags & FIJ_FAULT_SET;
+}
+
+/* runs that must lay out and behave the same every time: ASLR off, fixed AT_RANDOM */
+static inline bool fij_reproducible(const struct fij_ctx *ctx)
+{
+    return ctx->exec.params.digest_mode != FIJ_DIGEST_OFF ||
+           ctx->exec.params.seed || fij_fault_set(ctx);
+}
+
 static const char *fij_reg_name(int id)
 {
     switch (id) {
@@ -176,6 +304,26 @@ fij_reg_ptr_from_ptregs(struct pt_regs *regs, int id)
 }
 
 
+/* ---- logging ---- */
+
+/* fij_loglevel module parameter: pr_err is always printed */
+enum fij_log_level {
+    FIJ_LOG_ERR = 0,
+    FIJ_LOG_WARN,
+    FIJ_LOG_INFO,
+};
+
+extern int fij_loglevel;
+
+#define fij_warn(fmt, ...) \
+    do { if (READ_ONCE(fij_loglevel) >= FIJ_LOG_WARN) pr_warn(fmt, ##__VA_ARGS__); } while (0)
+#define fij_info(fmt, ...) \
+    do { if (READ_ONCE(fij_loglevel) >= FIJ_LOG_INFO) pr_info(fmt, ##__VA_ARGS__); } while (0)
+
+/* record the current monotonic time in a fij_result ts_* field */
+#define fij_stamp(ctx, field) \
+    WRITE_ONCE((ctx)->exec.result.field, ktime_get_ns())
+
 /* ---- char device ---- */
 int  fij_chardev_register(void);
 void fij_chardev_unregister(void);
@@ -186,7 +334,8 @@ void fij_ctx_init(struct fij_ctx *ctx);
 long fij_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
 
 /* bitflip_thread.c */
-int  fij_random_ms(int min_ms, int max_ms);
+int  fij_random_ms(struct fij_ctx *ctx, int min_ms, int max_ms);
+u64  fij_random_delay_ns(struct fij_ctx *ctx, int min_ms, int max_ms);
 int  fij_sleep_hrtimeout_interruptible(unsigned int delay_us);
 int  bitflip_thread_fn(void *data);
 int  fij_start_bitflip_thread(struct fij_ctx *ctx);
@@ -205,14 +354,104 @@ void fij_revert_file_backed_bitflip(struct fij_ctx *ctx);
 int  fij_uprobe_arm(struct fij_ctx *ctx, unsigned long target_va);
 void fij_uprobe_schedule_disarm(struct fij_ctx *ctx);
 void fij_uprobe_disarm_sync(struct fij_ctx *ctx);
+bool fij_uprobe_mm_is_target(struct fij_ctx *ctx, struct mm_struct *mm);
 
 /* ---- monitor ---- */
 int  fij_monitor_start(struct fij_ctx *ctx);
 void fij_monitor_stop(struct fij_ctx *ctx);
 int fij_wait_task_stopped(struct task_struct *t, long timeout_jiffies);
 
+/* ---- livelock detection ---- */
+void fij_hang_reset(struct fij_ctx *ctx);
+bool fij_hang_sample(struct fij_ctx *ctx, struct task_struct *leader);
+
+/* ---- watchpoints ---- */
+void fij_watch_init(struct fij_ctx *ctx);
+int  fij_watch_arm(struct fij_ctx *ctx, struct task_struct *task, unsigned long addr);
+void fij_watch_disarm(struct fij_ctx *ctx);
+
+/* ---- dead-register prefilter ---- */
+enum fij_reg_id fij_pick_live_reg(struct fij_ctx *ctx, struct pt_regs *regs, pid_t tgid);
+
+/* ---- memory-state digests ---- */
+void fij_digest_child_init(struct fij_ctx *ctx);
+int  fij_digest_prepare(struct fij_ctx *ctx);
+int  fij_digest_arm(struct fij_ctx *ctx);
+void fij_digest_disarm(struct fij_ctx *ctx);
+
+/* ---- region of interest ---- */
+static inline bool fij_roi_set(struct fij_ctx *ctx)
+{
+    return ctx->exec.params.roi_start.present;
+}
+
+static inline bool fij_roi_closed(struct fij_ctx *ctx)
+{
+    return atomic_read(&ctx->roi.state) == FIJ_ROI_CLOSED;
+}
+
+int  fij_roi_arm(struct fij_ctx *ctx);
+void fij_roi_disarm(struct fij_ctx *ctx);
+
+/* ---- profile-guided injection sites ---- */
+static inline bool fij_trigger_set(struct fij_ctx *ctx)
+{
+    return ctx->exec.params.trigger.present;
+}
+
+int  fij_profile_start(struct fij_ctx *ctx);
+void fij_profile_tick(struct fij_ctx *ctx, struct task_struct *leader);
+int  fij_profile_copy_out(struct fij_ctx *ctx, struct fij_profile *out);
+void fij_profile_release(struct fij_ctx *ctx);
+int  fij_trigger_arm(struct fij_ctx *ctx);
+void fij_trigger_disarm(struct fij_ctx *ctx);
+
+/* ---- resource accounting ---- */
+void fij_rusage_attach(struct fij_ctx *ctx);
+bool fij_rusage_over_budget(struct fij_ctx *ctx, struct task_struct *leader);
+int  fij_rusage_target_cpu(struct fij_ctx *ctx, u64 *ns, int *nthreads);
+void fij_rusage_collect(struct fij_ctx *ctx, struct task_struct *leader, bool exited);
+void fij_rusage_release(struct fij_ctx *ctx);
+
+/* ---- output capture ---- */
+int  fij_capture_start(struct fij_ctx *ctx);
+struct file *fij_capture_file(struct fij_ctx *ctx);
+void fij_capture_result(struct fij_ctx *ctx);
+int  fij_capture_copy_out(struct fij_ctx *ctx, struct fij_output *out);
+void fij_capture_release(struct fij_ctx *ctx);
+
+/* ---- statistics (debugfs) ---- */
+enum fij_stat {
+    FIJ_STAT_RUNS_STARTED = 0,
+    FIJ_STAT_RUNS_FINISHED,
+    FIJ_STAT_INJ_REG,
+    FIJ_STAT_INJ_MEM,
+    FIJ_STAT_INJ_FAILED,
+    FIJ_STAT_EBUSY,
+    FIJ_STAT_STOP_TIMEOUT,
+    FIJ_STAT_KILLS,
+    FIJ_STAT_UPROBE_ARM,
+    FIJ_STAT_UPROBE_DISARM,
+    FIJ_STAT_NR,
+};
+
+enum fij_lat {
+    FIJ_LAT_EXEC = 0,       /* exec request to target stopped before its first instruction */
+    FIJ_LAT_STOP_WAIT,      /* group stop requested to victim thread stopped */
+    FIJ_LAT_FLIP,           /* victim stopped to target continued */
+    FIJ_LAT_MONITOR,        /* target exit to result available */
+    FIJ_LAT_NR,
+};
+
+int  fij_stats_init(void);
+void fij_stats_exit(void);
+void fij_stat_inc(enum fij_stat id);
+void fij_stat_lat(enum fij_lat id, u64 ns);
+
 /* ---- processes ---- */
 int fij_collect_descendants(struct fij_ctx *ctx, pid_t root_tgid);
+void fij_for_each_process_rcu(struct task_struct *root,
+                              void (*fn)(struct task_struct *p, void *arg), void *arg);
 
 
 /* ---- exec helper ---- */
@@ -225,11 +464,19 @@ int   fij_send_cont(pid_t tgid);
 struct task_struct *fij_pick_random_user_thread(int tgid, struct fij_ctx *ctx);
 struct task_struct *fij_pick_user_thread_by_index(int tgid, int n1, struct fij_ctx *ctx);
 struct task_struct *fij_rcu_find_get_task_by_tgid(pid_t tgid);
-int fij_pick_random_bit64(void);
-enum fij_reg_id fij_pick_random_reg_any(void);
-bool choose_register_target(int weight_mem, int only_mem);
+int fij_pick_random_bit64(struct fij_ctx *ctx);
+enum fij_reg_id fij_pick_random_reg_any(struct fij_ctx *ctx);
+bool choose_register_target(struct fij_ctx *ctx, int weight_mem, int only_mem);
+
+/* random draws of a run: kernel randomness, or a stream of fij_params.seed */
+void fij_rand_seed(struct fij_ctx *ctx);
+u32  fij_rand_u32(struct fij_ctx *ctx);
+u64  fij_rand_u64(struct fij_ctx *ctx);
+u32  fij_rand_below(struct fij_ctx *ctx, u32 ceil);
 
 /* ---- signal ---- */
-int fij_send_sigkill(struct fij_ctx *ctx);
+/* reason is only reported by the fij_kill tracepoint */
+int fij_send_sigkill(struct fij_ctx *ctx, const char *reason);
+int fij_send_sigkill_tgid(pid_t tgid, const char *reason);
 
 #endif /* _LINUX_FIJ_INTERNAL_H */
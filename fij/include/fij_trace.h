@@ -0,0 +1,171 @@
+/*
+ * Tracepoints of the fij module (events/fij in tracefs).
+ *
+ * One event per step of a run, with the fields needed to rebuild its
+ * timeline: they cost nothing while disabled, unlike pr_info on the
+ * injection path.
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM fij
+
+#if !defined(_FIJ_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _FIJ_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(fij_exec,
+
+    TP_PROTO(pid_t tgid, int iteration, int no_injection, u64 exec_ns),
+
+    TP_ARGS(tgid, iteration, no_injection, exec_ns),
+
+    TP_STRUCT__entry(
+        __field(pid_t, tgid)
+        __field(int,   iteration)
+        __field(int,   no_injection)
+        __field(u64,   exec_ns)
+    ),
+
+    TP_fast_assign(
+        __entry->tgid         = tgid;
+        __entry->iteration    = iteration;
+        __entry->no_injection = no_injection;
+        __entry->exec_ns      = exec_ns;
+    ),
+
+    TP_printk("tgid=%d iteration=%d no_injection=%d exec_ns=%llu",
+              __entry->tgid, __entry->iteration, __entry->no_injection,
+              __entry->exec_ns)
+);
+
+TRACE_EVENT(fij_stop,
+
+    TP_PROTO(pid_t tgid, pid_t pid, int ret, u64 wait_ns),
+
+    TP_ARGS(tgid, pid, ret, wait_ns),
+
+    TP_STRUCT__entry(
+        __field(pid_t, tgid)
+        __field(pid_t, pid)
+        __field(int,   ret)
+        __field(u64,   wait_ns)
+    ),
+
+    TP_fast_assign(
+        __entry->tgid    = tgid;
+        __entry->pid     = pid;
+        __entry->ret     = ret;
+        __entry->wait_ns = wait_ns;
+    ),
+
+    TP_printk("tgid=%d pid=%d ret=%d wait_ns=%llu",
+              __entry->tgid, __entry->pid, __entry->ret, __entry->wait_ns)
+);
+
+TRACE_EVENT(fij_flip,
+
+    TP_PROTO(pid_t tgid, bool mem, const char *reg, int bit,
+             unsigned long addr, unsigned long before, unsigned long after),
+
+    TP_ARGS(tgid, mem, reg, bit, addr, before, after),
+
+    TP_STRUCT__entry(
+        __field(pid_t,         tgid)
+        __field(bool,          mem)
+        __array(char,          reg, 8)
+        __field(int,           bit)
+        __field(unsigned long, addr)
+        __field(unsigned long, before)
+        __field(unsigned long, after)
+    ),
+
+    TP_fast_assign(
+        __entry->tgid   = tgid;
+        __entry->mem    = mem;
+        strscpy(__entry->reg, reg, sizeof(__entry->reg));
+        __entry->bit    = bit;
+        __entry->addr   = addr;
+        __entry->before = before;
+        __entry->after  = after;
+    ),
+
+    TP_printk("tgid=%d mem=%d reg=%s bit=%d addr=0x%lx before=0x%lx after=0x%lx",
+              __entry->tgid, __entry->mem, __entry->reg, __entry->bit,
+              __entry->addr, __entry->before, __entry->after)
+);
+
+TRACE_EVENT(fij_resume,
+
+    TP_PROTO(pid_t tgid, int ret),
+
+    TP_ARGS(tgid, ret),
+
+    TP_STRUCT__entry(
+        __field(pid_t, tgid)
+        __field(int,   ret)
+    ),
+
+    TP_fast_assign(
+        __entry->tgid = tgid;
+        __entry->ret  = ret;
+    ),
+
+    TP_printk("tgid=%d ret=%d", __entry->tgid, __entry->ret)
+);
+
+TRACE_EVENT(fij_exit,
+
+    TP_PROTO(pid_t tgid, int exit_code, int fault_injected, int hanged),
+
+    TP_ARGS(tgid, exit_code, fault_injected, hanged),
+
+    TP_STRUCT__entry(
+        __field(pid_t, tgid)
+        __field(int,   exit_code)
+        __field(int,   fault_injected)
+        __field(int,   hanged)
+    ),
+
+    TP_fast_assign(
+        __entry->tgid           = tgid;
+        __entry->exit_code      = exit_code;
+        __entry->fault_injected = fault_injected;
+        __entry->hanged         = hanged;
+    ),
+
+    TP_printk("tgid=%d exit_code=%d signal=%d fault_injected=%d hanged=%d",
+              __entry->tgid, __entry->exit_code, __entry->exit_code & 0x7f,
+              __entry->fault_injected, __entry->hanged)
+);
+
+TRACE_EVENT(fij_kill,
+
+    TP_PROTO(pid_t tgid, const char *reason, int ret),
+
+    TP_ARGS(tgid, reason, ret),
+
+    TP_STRUCT__entry(
+        __field(pid_t,  tgid)
+        __string(reason, reason)
+        __field(int,    ret)
+    ),
+
+    TP_fast_assign(
+        __entry->tgid = tgid;
+        __assign_str(reason);
+        __entry->ret  = ret;
+    ),
+
+    TP_printk("tgid=%d reason=%s ret=%d",
+              __entry->tgid, __get_str(reason), __entry->ret)
+);
+
+#endif /* _FIJ_TRACE_H */
+
+/* the header lives in include/, which is on the module's include path */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE fij_trace
+
+#include <trace/define_trace.h>
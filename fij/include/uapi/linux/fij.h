@@ -7,6 +7,13 @@
 
 #define FIJ_DEVICE_NAME "fij"
 #define FIJ_MAX_ARGC    128
+#define FIJ_MAX_ENV     16
+#define FIJ_MAX_DIGESTS 32
+#define FIJ_CAPTURE_DEFAULT (64 * 1024)   /* capture_bytes when 0 */
+#define FIJ_CAPTURE_MAX     (1024 * 1024)
+#define FIJ_PROBE_PATH      512
+#define FIJ_PROFILE_MAX_SAMPLES (1 << 16)
+#define FIJ_PROFILE_MAX_FILES   64
 
 enum fij_reg_id {
     FIJ_REG_NONE = 0,
@@ -103,6 +110,70 @@ enum fij_reg_id {
 
 };
 
+/* outcome of the post-flip watchpoint (fij_result.watch_status) */
+enum fij_watch_status {
+    FIJ_WATCH_OFF = 0,      /* not requested, or register flip */
+    FIJ_WATCH_UNAVAILABLE,  /* no debug register free / unsupported arch */
+    FIJ_WATCH_ARMED,        /* armed, flipped byte never accessed */
+    FIJ_WATCH_READ,         /* first access may have consumed the byte */
+    FIJ_WATCH_MASKED,       /* first access overwrote the byte, run killed */
+};
+
+/* class of the mapping a memory flip lands in (fij_params.mem_region) */
+enum fij_mem_region {
+    FIJ_MEM_ANY = 0,        /* any mapping, each equally likely (the default) */
+    FIJ_MEM_TEXT,           /* executable */
+    FIJ_MEM_RODATA,         /* read-only, not executable */
+    FIJ_MEM_DATA,           /* writable file-backed and the .data/.bss span */
+    FIJ_MEM_HEAP,           /* brk heap */
+    FIJ_MEM_STACK,          /* main thread stack and grows-down mappings */
+    FIJ_MEM_ANON,           /* other writable anonymous mappings (mmap, thread stacks) */
+    FIJ_MEM_REGIONS
+};
+
+/* memory-state digests at digest_pc (fij_params.digest_mode) */
+enum fij_digest_mode {
+    FIJ_DIGEST_OFF = 0,
+    FIJ_DIGEST_RECORD,      /* golden run: fill fij_result.digests */
+    FIJ_DIGEST_COMPARE,     /* injected run: kill when a golden digest matches */
+};
+
+/* an instruction of a file the target maps (fij_params.roi_start, roi_end, trigger) */
+struct fij_probe {
+    char path[FIJ_PROBE_PATH];  /* absolute path of the executable or library */
+    __u64 offset;               /* file offset of the instruction */
+    __u32 present;
+    __u32 reserved;
+};
+
+/* what the injection delay counts (fij_params.delay_clock) */
+enum fij_delay_clock {
+    FIJ_DELAY_WALL = 0,     /* time since the target was resumed (the default) */
+    FIJ_DELAY_CPU,          /* CPU time of the target tree, whatever else runs on the host */
+};
+
+/* what fij_result.perf_* counted (fij_params.perf_counters) */
+enum fij_perf_source {
+    FIJ_PERF_NONE = 0,
+    FIJ_PERF_HW,            /* perf_instructions and perf_cycles */
+    FIJ_PERF_SW,            /* no PMU: perf_task_clock_ns only */
+};
+
+/* fij_fault.flags */
+#define FIJ_FAULT_SET   (1u << 0)   /* flip exactly this fault, nothing is drawn */
+#define FIJ_FAULT_MEM   (1u << 1)   /* memory flip, otherwise a register flip */
+#define FIJ_FAULT_ADDR  (1u << 2)   /* memory: location is a virtual address, not a selector */
+
+/* a fully specified fault (fij_params.fault) */
+struct fij_fault {
+    __u32 flags;
+    __u32 reg;                  /* enum fij_reg_id of a register flip */
+    __u64 delay_us;             /* on the delay_clock, unused with target_pc */
+    __u32 process_sel;          /* victim process: index modulo the processes at the flip */
+    __u32 thread_sel;           /* victim thread: index modulo its user threads */
+    __u64 location;             /* memory: byte index modulo the mapped bytes of mem_region */
+    __u64 mask;                 /* bits flipped: 64 for a register, the low 8 for memory */
+};
 
 struct fij_params {
     char process_name[256];
@@ -130,6 +201,43 @@ struct fij_params {
     int nprocess; // order in array is root-lchild-lchildchild1-...-rchild-rchildchild1-...
     int process_present;
     int no_injection; // no injection is performed
+    /* livelock detection: kill early when the target spins in a small PC range */
+    int hang_detect;
+    int hang_window_ms; /* no-progress window before the kill, DEFAULTS to 500ms */
+    int hang_pc_span;   /* widest PC range (bytes) still considered a loop, DEFAULTS to 4096 */
+    /* watch the flipped byte and kill the run if it is overwritten before being read */
+    int watch_masked;
+    /* random register picks skip registers overwritten before use at the stop PC */
+    int reg_prefilter;
+    int reg_prefilter_window; /* instructions decoded at the PC, DEFAULTS to 8, max 32 */
+    /* memory-state digests: checkpoint offset from start_code, like target_pc */
+    int digest_mode;            /* enum fij_digest_mode */
+    int digest_pc;
+    int digest_golden_count;
+    __u64 digest_golden[FIJ_MAX_DIGESTS];
+    /* resource accounting */
+    int perf_counters;          /* attach instructions/cycles counters at exec */
+    __u64 cpu_budget_ns;        /* kill the target past this CPU time, 0 = no limit */
+    /* stdout/stderr into an in-kernel buffer instead of log_path */
+    int capture_output;
+    int capture_bytes;          /* kept from the start and from the end, DEFAULTS to 64 KiB */
+    /* NAME=VALUE entries added to the target's environment, space separated */
+    char env_extra[1024];
+    /* memory flips only in this class of mapping, byte-uniform within it */
+    int mem_region;             /* enum fij_mem_region */
+    /* replayable runs: the fault itself, and the seed of whatever is still drawn */
+    struct fij_fault fault;
+    __u64 seed;                 /* 0 = fresh kernel randomness */
+    /* what min_delay_ms, max_delay_ms and fault.delay_us count */
+    int delay_clock;            /* enum fij_delay_clock */
+    /* region of interest: delays count from the first roi_start hit, none lands after roi_end */
+    struct fij_probe roi_start;
+    struct fij_probe roi_end;   /* not present: the region lasts until the target exits */
+    /* golden run: sample the user PCs of the target this often, 0 = off */
+    int profile_period_us;
+    /* flip in the thread executing trigger for the trigger_hit-th time, instead of after a delay */
+    struct fij_probe trigger;
+    __u64 trigger_hit;          /* 0: only count the hits */
 
     int iteration_number;
 };
@@ -149,6 +257,84 @@ struct fij_result {
     __u64 target_before;
     __u64 target_after;
     char register_name[8];
+    __s32 hang_detected; // 1 if the livelock detector killed the target
+    __u64 hang_pc_lo;    // loop address range seen by the detector
+    __u64 hang_pc_hi;
+    __s32 watch_status;  // enum fij_watch_status
+    __u64 watch_pc;      // PC right after the first access to the flipped byte
+    __s32 regs_dead;     // registers found dead by the prefilter
+    __s32 regs_skipped;  // random picks redrawn because they were dead
+    __s32 digest_count;  // RECORD: checkpoints hashed
+    __u64 digests[FIJ_MAX_DIGESTS];
+    __s32 converged;     // COMPARE: state matched golden after the flip, run killed
+    __s32 converged_idx; // index of the matching golden digest
+    __u64 fault_addr;    // faulting address when killed by SIGSEGV/SIGBUS
+    /* CLOCK_MONOTONIC timestamps (ns) of the run's phases, 0 if not reached */
+    __u64 ts_exec_start;   // exec request received
+    __u64 ts_exec_done;    // target launched and stopped before its first instruction
+    __u64 ts_resume;       // monitor armed, target continued
+    __u64 ts_flip_start;   // injection started, stop requested
+    __u64 ts_flip_stopped; // victim thread seen stopped
+    __u64 ts_flip_end;     // flip done, target continued
+    __u64 ts_exit;         // monitor saw the target exit
+    __u64 ts_monitor_done; // monitor finished its teardown, result complete
+    __u64 ts_collect;      // result handed to userspace
+    /* resources used by the target and its reaped children */
+    __u64 utime_ns;
+    __u64 stime_ns;
+    __u64 cpu_ns;          // scheduler runtime, exact unlike utime/stime
+    __u64 maxrss_kb;
+    __u64 min_flt;
+    __u64 maj_flt;
+    __u64 nvcsw;
+    __u64 nivcsw;
+    __s32 perf_source;     // enum fij_perf_source
+    __u64 perf_instructions;
+    __u64 perf_cycles;
+    __u64 perf_task_clock_ns;
+    __s32 cpu_budget_exceeded; // killed by the monitor at cpu_budget_ns
+    /* captured stdout/stderr (capture_output), read with IOCTL_GET_OUTPUT */
+    __u64 capture_total;   // bytes the target wrote
+    __u64 capture_hash;    // xxh64 of all of them
+    __u32 capture_head;    // bytes kept from the start
+    __u32 capture_tail;    // bytes kept from the end, total - head - tail were dropped
+    /* memory flips: where the byte was and how the address space looked */
+    __s32 mem_region;      // enum fij_mem_region of the flipped mapping
+    __u64 mem_region_bytes[FIJ_MEM_REGIONS]; // mapped bytes per class, [0] = all
+    __u32 mem_region_vmas[FIJ_MEM_REGIONS];  // mappings per class, [0] = all
+    __u64 injection_cpu_ns; // CPU time of the target tree when the flip started
+    /* region of interest (roi_start), CLOCK_MONOTONIC, 0 if not reached */
+    __u64 ts_roi_start;    // first roi_start hit
+    __u64 ts_roi_end;      // first roi_end hit after it, 0 with ts_roi_start set: ran until exit
+    __u64 roi_cpu_ns;      // CPU time of the target tree inside the region
+    __s32 roi_missed;      // not injected: the region closed before the fault was due, or never opened
+    /* profile-guided injection sites */
+    __u64 trigger_hits;    // executions of trigger by the target process
+    __u32 profile_samples; // PC samples kept (profile_period_us), read with IOCTL_GET_PROFILE
+    __u32 profile_dropped; // samples outside a file mapping or past the buffer
+};
+
+/* IOCTL_GET_OUTPUT: head then tail of the last run's captured output */
+struct fij_output {
+    __u64 buf;             // [in]  user buffer
+    __u32 size;            // [in]  its size
+    __u32 len;             // [out] bytes copied
+};
+
+/* IOCTL_GET_PROFILE: one sampled user PC of the last run with profile_period_us */
+struct fij_profile_sample {
+    __u64 offset;          // file offset of the PC in files[file]
+    __u32 file;
+    __u32 reserved;
+};
+
+struct fij_profile {
+    __u64 samples;         // [in]  user array of struct fij_profile_sample
+    __u64 files;           // [in]  user array of char[FIJ_PROBE_PATH], the mapped files sampled
+    __u32 max_samples;     // [in]
+    __u32 max_files;       // [in]
+    __u32 nsamples;        // [out] samples copied
+    __u32 nfiles;          // [out] paths copied
 };
 
 struct fij_exec {
@@ -163,5 +349,7 @@ struct fij_exec {
 #define IOCTL_SEND_MSG        _IOW('f', 3, struct fij_params)
 #define IOCTL_RECEIVE_MSG     _IOR('f', 4, struct fij_result)
 #define IOCTL_KILL_TARGET     _IO('f', 5)
+#define IOCTL_GET_OUTPUT      _IOWR('f', 6, struct fij_output)
+#define IOCTL_GET_PROFILE     _IOWR('f', 7, struct fij_profile)
 
 #endif /* _UAPI_LINUX_FIJ_H */
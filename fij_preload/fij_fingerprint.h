@@ -0,0 +1,64 @@
+#ifndef FIJ_FINGERPRINT_H
+#define FIJ_FINGERPRINT_H
+
+/*
+ * Shared memory slot filled by libfij_preload.so inside the target and read
+ * by the runner once the run is collected.
+ *
+ * For every output file matching FIJ_FP_PATHS the library records the bytes
+ * written and an FNV-1a 64 hash of them, as long as the writes are
+ * sequential from offset 0. That is then the length and hash of the file
+ * itself, so the runner can tell a golden output from a corrupted one
+ * without reading it back.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* environment the runner passes to the target */
+#define FIJ_FP_ENV_SHM    "FIJ_FP_SHM"      /* shm_open name of the slot */
+#define FIJ_FP_ENV_PATHS  "FIJ_FP_PATHS"    /* ':' separated fnmatch patterns */
+#define FIJ_FP_ENV_SINK   "FIJ_FP_SINK"     /* 1: matching outputs go to /dev/null */
+
+#define FIJ_FP_MAGIC      0x70666a66u       /* "fjfp" */
+#define FIJ_FP_MAX_FILES  32
+#define FIJ_FP_NAME_LEN   256
+
+#define FIJ_FP_FNV_OFFSET 0xcbf29ce484222325ULL
+#define FIJ_FP_FNV_PRIME  0x100000001b3ULL
+
+enum fij_fp_flags {
+    FIJ_FP_CLOSED    = 1u << 0,     /* a descriptor on it was closed */
+    FIJ_FP_UNORDERED = 1u << 1,     /* written out of order, hash is not the file's */
+    FIJ_FP_SUNK      = 1u << 2,     /* contents went to /dev/null, nothing on disk */
+    FIJ_FP_STDIO     = 1u << 3,     /* fopen stream: writes libc makes internally are not seen */
+};
+
+struct fij_fp_file {
+    char     name[FIJ_FP_NAME_LEN];  /* path as opened by the target */
+    uint64_t bytes;                  /* bytes written */
+    uint64_t hash;                   /* FNV-1a 64 of them, in order */
+    uint32_t writes;
+    uint32_t flags;                  /* enum fij_fp_flags */
+};
+
+struct fij_fp_slot {
+    uint32_t magic;
+    uint32_t lock;                   /* spinlock, the target may be multi-process */
+    uint32_t nfiles;
+    uint32_t overflow;               /* outputs that found no free entry */
+    struct fij_fp_file files[FIJ_FP_MAX_FILES];
+};
+
+static inline uint64_t fij_fp_fnv1a(uint64_t h, const void *buf, size_t n)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+
+    while (n--) {
+        h ^= *p++;
+        h *= FIJ_FP_FNV_PRIME;
+    }
+    return h;
+}
+
+#endif /* FIJ_FINGERPRINT_H */
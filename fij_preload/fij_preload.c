@@ -0,0 +1,472 @@
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "fij_fingerprint.h"
+
+/*
+ * LD_PRELOAD interposer fingerprinting the target's output files.
+ *
+ * The runner sets FIJ_FP_SHM and FIJ_FP_PATHS in the environment the module
+ * builds for the target. Every descriptor opened for writing on a matching
+ * path is tracked: write, pwrite and writev on it feed the bytes into the
+ * file's entry of the shared slot, close marks it. fopen on a matching path
+ * registers the real stream's descriptor: libstdc++ streams write through
+ * write() and are followed, C stdio buffers are flushed inside libc and are
+ * not. With FIJ_FP_SINK=1 the contents go to /dev/null instead of the file.
+ *
+ * Descriptors duplicated with dup/dup2/dup3 (a shell redirect) stay tracked.
+ * Not seen: mmap'ed output, sendfile/copy_file_range and fcntl(F_DUPFD)
+ * copies. The runner checks every output against the golden run
+ * and falls back to reading the files for the ones fingerprinting missed.
+ */
+
+#define FP_MAX_FDS 4096
+
+static struct fij_fp_slot *slot;
+static char patterns[4096];
+static int sink;
+
+/* per-process fd -> files[] index + 1, inherited across fork with the rest */
+static unsigned char fd_file[FP_MAX_FDS];
+
+static int     (*real_open)(const char *, int, ...);
+static int     (*real_open64)(const char *, int, ...);
+static int     (*real_openat)(int, const char *, int, ...);
+static int     (*real_openat64)(int, const char *, int, ...);
+static FILE   *(*real_fopen)(const char *, const char *);
+static FILE   *(*real_fopen64)(const char *, const char *);
+static int     (*real_fclose)(FILE *);
+static ssize_t (*real_write)(int, const void *, size_t);
+static ssize_t (*real_pwrite)(int, const void *, size_t, off_t);
+static ssize_t (*real_pwrite64)(int, const void *, size_t, off64_t);
+static ssize_t (*real_writev)(int, const struct iovec *, int);
+static int     (*real_close)(int);
+static int     (*real_dup)(int);
+static int     (*real_dup2)(int, int);
+static int     (*real_dup3)(int, int, int);
+
+#define RESOLVE(fn) (real_##fn = (__typeof__(real_##fn))dlsym(RTLD_NEXT, #fn))
+
+static void fp_resolve(void)
+{
+    RESOLVE(open);
+    RESOLVE(open64);
+    RESOLVE(openat);
+    RESOLVE(openat64);
+    RESOLVE(fopen);
+    RESOLVE(fopen64);
+    RESOLVE(fclose);
+    RESOLVE(write);
+    RESOLVE(pwrite);
+    RESOLVE(pwrite64);
+    RESOLVE(writev);
+    RESOLVE(close);
+    RESOLVE(dup);
+    RESOLVE(dup2);
+    RESOLVE(dup3);
+}
+
+/* resolved on first use: other constructors may write before ours runs */
+#define REAL(fn) ((real_##fn ? (void)0 : fp_resolve()), real_##fn)
+
+__attribute__((constructor))
+static void fp_init(void)
+{
+    const char *shm = getenv(FIJ_FP_ENV_SHM);
+    const char *paths = getenv(FIJ_FP_ENV_PATHS);
+    const char *s = getenv(FIJ_FP_ENV_SINK);
+    void *map;
+    int fd;
+
+    if (!shm || !paths || !*paths)
+        return;
+
+    fd = shm_open(shm, O_RDWR, 0);
+    if (fd < 0)
+        return;
+    map = mmap(NULL, sizeof(*slot), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    REAL(close)(fd);
+    if (map == MAP_FAILED)
+        return;
+
+    slot = map;
+    if (slot->magic != FIJ_FP_MAGIC) {
+        munmap(map, sizeof(*slot));
+        slot = NULL;
+        return;
+    }
+
+    strncpy(patterns, paths, sizeof(patterns) - 1);
+    sink = s && s[0] == '1';
+}
+
+static void fp_lock(void)
+{
+    while (__atomic_exchange_n(&slot->lock, 1, __ATOMIC_ACQUIRE))
+        sched_yield();
+}
+
+static void fp_unlock(void)
+{
+    __atomic_store_n(&slot->lock, 0, __ATOMIC_RELEASE);
+}
+
+static int fp_match(const char *path)
+{
+    const char *base = strrchr(path, '/');
+    char buf[sizeof(patterns)];
+    char *save = NULL, *pat;
+
+    base = base ? base + 1 : path;
+    memcpy(buf, patterns, sizeof(buf));
+    for (pat = strtok_r(buf, ":", &save); pat; pat = strtok_r(NULL, ":", &save)) {
+        if (!fnmatch(pat, path, 0) || !fnmatch(pat, base, 0))
+            return 1;
+    }
+    return 0;
+}
+
+static int fp_wants(const char *path, int flags)
+{
+    return slot && path && (flags & (O_WRONLY | O_RDWR)) && fp_match(path);
+}
+
+static int fp_tracked(int fd)
+{
+    return slot && fd >= 0 && fd < FP_MAX_FDS && fd_file[fd];
+}
+
+/* Entry for path, reset when the target starts the file over */
+static void fp_register(int fd, const char *path, int flags, int stdio)
+{
+    struct fij_fp_file *f = NULL;
+    struct stat st;
+    uint32_t k, n;
+    int fresh = 0;
+
+    if (fd < 0 || fd >= FP_MAX_FDS)
+        return;
+
+    fp_lock();
+    n = slot->nfiles;
+    for (k = 0; k < n; k++) {
+        if (!strncmp(slot->files[k].name, path, FIJ_FP_NAME_LEN - 1)) {
+            f = &slot->files[k];
+            break;
+        }
+    }
+    if (!f) {
+        if (n == FIJ_FP_MAX_FILES) {
+            slot->overflow++;
+            fp_unlock();
+            return;
+        }
+        f = &slot->files[n];
+        strncpy(f->name, path, FIJ_FP_NAME_LEN - 1);
+        slot->nfiles = n + 1;
+        k = n;
+        fresh = 1;
+    }
+    if (fresh || (flags & O_TRUNC)) {
+        f->bytes  = 0;
+        f->hash   = FIJ_FP_FNV_OFFSET;
+        f->writes = 0;
+        f->flags  = sink ? FIJ_FP_SUNK : 0;
+    }
+    f->flags &= ~FIJ_FP_CLOSED;
+    if (stdio)
+        f->flags |= FIJ_FP_STDIO;
+    /* pre-existing contents the hash never saw; fstat leaves the target's offset alone */
+    if (!sink && !(flags & O_TRUNC) && !fstat(fd, &st) && st.st_size > 0 && !f->bytes)
+        f->flags |= FIJ_FP_UNORDERED;
+    /* /dev/null has no offset to check: a rewrite in place cannot be followed */
+    if (sink && !fresh && !(flags & (O_TRUNC | O_APPEND)))
+        f->flags |= FIJ_FP_UNORDERED;
+    fp_unlock();
+
+    fd_file[fd] = (unsigned char)(k + 1);
+}
+
+/* off < 0: at the current position of fd */
+static void fp_account(int fd, const void *buf, size_t n, off64_t off)
+{
+    struct fij_fp_file *f = &slot->files[fd_file[fd] - 1];
+
+    fp_lock();
+    if (off < 0)
+        off = (off64_t)f->bytes;
+    if ((uint64_t)off != f->bytes)
+        f->flags |= FIJ_FP_UNORDERED;
+    if (!(f->flags & FIJ_FP_UNORDERED))
+        f->hash = fij_fp_fnv1a(f->hash, buf, n);
+    f->bytes += n;
+    f->writes++;
+    fp_unlock();
+}
+
+/* where the next write() on fd lands, -1 when it is not seekable */
+static off64_t fp_position(int fd)
+{
+    if (sink)
+        return -1;
+    return lseek64(fd, 0, SEEK_CUR);
+}
+
+static int fp_open_common(int dirfd, const char *path, int flags, mode_t mode,
+                          int (*open_fn)(const char *, int, ...),
+                          int (*openat_fn)(int, const char *, int, ...))
+{
+    int fd;
+
+    if (!fp_wants(path, flags))
+        return openat_fn ? openat_fn(dirfd, path, flags, mode) : open_fn(path, flags, mode);
+
+    if (sink)
+        fd = REAL(open)("/dev/null", O_WRONLY | (flags & O_CLOEXEC));
+    else
+        fd = openat_fn ? openat_fn(dirfd, path, flags, mode) : open_fn(path, flags, mode);
+
+    if (fd >= 0)
+        fp_register(fd, path, flags, 0);
+    return fd;
+}
+
+static mode_t fp_mode(int flags, va_list ap)
+{
+    return (flags & (O_CREAT | O_TMPFILE)) ? (mode_t)va_arg(ap, int) : 0;
+}
+
+int open(const char *path, int flags, ...)
+{
+    va_list ap;
+    mode_t mode;
+
+    va_start(ap, flags);
+    mode = fp_mode(flags, ap);
+    va_end(ap);
+    return fp_open_common(AT_FDCWD, path, flags, mode, REAL(open), NULL);
+}
+
+int open64(const char *path, int flags, ...)
+{
+    va_list ap;
+    mode_t mode;
+
+    va_start(ap, flags);
+    mode = fp_mode(flags, ap);
+    va_end(ap);
+    return fp_open_common(AT_FDCWD, path, flags, mode, REAL(open64), NULL);
+}
+
+int openat(int dirfd, const char *path, int flags, ...)
+{
+    va_list ap;
+    mode_t mode;
+
+    va_start(ap, flags);
+    mode = fp_mode(flags, ap);
+    va_end(ap);
+    return fp_open_common(dirfd, path, flags, mode, NULL, REAL(openat));
+}
+
+int openat64(int dirfd, const char *path, int flags, ...)
+{
+    va_list ap;
+    mode_t mode;
+
+    va_start(ap, flags);
+    mode = fp_mode(flags, ap);
+    va_end(ap);
+    return fp_open_common(dirfd, path, flags, mode, NULL, REAL(openat64));
+}
+
+int creat(const char *path, mode_t mode)
+{
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+}
+
+int creat64(const char *path, mode_t mode)
+{
+    return open64(path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+}
+
+ssize_t write(int fd, const void *buf, size_t n)
+{
+    off64_t off;
+    ssize_t ret;
+
+    if (!fp_tracked(fd))
+        return REAL(write)(fd, buf, n);
+
+    off = fp_position(fd);
+    ret = REAL(write)(fd, buf, n);
+    if (ret > 0)
+        fp_account(fd, buf, (size_t)ret, off);
+    return ret;
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t n, off_t off)
+{
+    ssize_t ret = REAL(pwrite)(fd, buf, n, off);
+
+    if (ret > 0 && fp_tracked(fd))
+        fp_account(fd, buf, (size_t)ret, off);
+    return ret;
+}
+
+ssize_t pwrite64(int fd, const void *buf, size_t n, off64_t off)
+{
+    ssize_t ret = REAL(pwrite64)(fd, buf, n, off);
+
+    if (ret > 0 && fp_tracked(fd))
+        fp_account(fd, buf, (size_t)ret, off);
+    return ret;
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    off64_t off;
+    ssize_t ret;
+    size_t left;
+    int k;
+
+    if (!fp_tracked(fd))
+        return REAL(writev)(fd, iov, iovcnt);
+
+    off = fp_position(fd);
+    ret = REAL(writev)(fd, iov, iovcnt);
+    left = ret > 0 ? (size_t)ret : 0;
+    for (k = 0; k < iovcnt && left; k++) {
+        size_t n = iov[k].iov_len < left ? iov[k].iov_len : left;
+
+        fp_account(fd, iov[k].iov_base, n, off);
+        if (off >= 0)
+            off += (off64_t)n;
+        left -= n;
+    }
+    return ret;
+}
+
+int close(int fd)
+{
+    if (fp_tracked(fd)) {
+        fp_lock();
+        slot->files[fd_file[fd] - 1].flags |= FIJ_FP_CLOSED;
+        fp_unlock();
+        fd_file[fd] = 0;
+    }
+    return REAL(close)(fd);
+}
+
+/* newfd now refers to whatever oldfd did */
+static void fp_dup(int oldfd, int newfd)
+{
+    if (!slot || newfd < 0 || newfd >= FP_MAX_FDS)
+        return;
+    fd_file[newfd] = fp_tracked(oldfd) ? fd_file[oldfd] : 0;
+}
+
+int dup(int oldfd)
+{
+    int fd = REAL(dup)(oldfd);
+
+    if (fd >= 0)
+        fp_dup(oldfd, fd);
+    return fd;
+}
+
+int dup2(int oldfd, int newfd)
+{
+    int fd = REAL(dup2)(oldfd, newfd);
+
+    if (fd >= 0 && oldfd != newfd)
+        fp_dup(oldfd, fd);
+    return fd;
+}
+
+int dup3(int oldfd, int newfd, int flags)
+{
+    int fd = REAL(dup3)(oldfd, newfd, flags);
+
+    if (fd >= 0)
+        fp_dup(oldfd, fd);
+    return fd;
+}
+
+static int fp_stdio_flags(const char *mode)
+{
+    int flags;
+
+    switch (mode[0]) {
+    case 'w': flags = O_WRONLY | O_CREAT | O_TRUNC;  break;
+    case 'a': flags = O_WRONLY | O_CREAT | O_APPEND; break;
+    default:  flags = O_RDONLY;                      break;
+    }
+    if (strchr(mode, '+'))
+        flags = (flags & ~O_WRONLY) | O_RDWR;
+    if (strchr(mode, 'x'))
+        flags |= O_EXCL;
+    if (strchr(mode, 'e'))
+        flags |= O_CLOEXEC;
+    return flags;
+}
+
+/*
+ * fopen returns the real stream, so its descriptor and everything built on
+ * it (std::ofstream) keep working. Streams that write through write(), as
+ * libstdc++ does, are followed like any descriptor; C stdio writes from
+ * inside libc are not, which leaves the entry short of the file and sends
+ * it to the read-back comparison.
+ */
+static FILE *fp_fopen_common(const char *path, const char *mode,
+                             FILE *(*fopen_fn)(const char *, const char *))
+{
+    int flags = fp_stdio_flags(mode);
+    FILE *f;
+
+    if (!fp_wants(path, flags))
+        return fopen_fn(path, mode);
+
+    f = fopen_fn(sink ? "/dev/null" : path, mode);
+    if (f)
+        fp_register(fileno(f), path, flags, 1);
+    return f;
+}
+
+FILE *fopen(const char *path, const char *mode)
+{
+    return fp_fopen_common(path, mode, REAL(fopen));
+}
+
+FILE *fopen64(const char *path, const char *mode)
+{
+    return fp_fopen_common(path, mode, REAL(fopen64));
+}
+
+/* libc closes the descriptor internally, past the close() above */
+int fclose(FILE *f)
+{
+    int fd = f ? fileno(f) : -1;
+
+    if (fp_tracked(fd)) {
+        fp_lock();
+        slot->files[fd_file[fd] - 1].flags |= FIJ_FP_CLOSED;
+        fp_unlock();
+        fd_file[fd] = 0;
+    }
+    return REAL(fclose)(f);
+}
@@ -2,6 +2,7 @@
 
 #include <chrono>
 #include <csignal>
+#include <deque>
 #include <cerrno>
 #include <cstring>
 #include <filesystem>
@@ -10,6 +11,9 @@
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <regex>
 #include <stdexcept>
 #include <string>
@@ -80,6 +84,65 @@ void apply_field_if_present(
 // High-level types
 // -----------------------------------------------------------------------------
 
+struct JobTelemetry;    // fij_telemetry.hpp
+
+// Where run outputs are written first and which of them are kept
+struct RetentionPolicy {
+    std::string stage_dir;        // tmpfs area for run outputs, "" = write in place
+    double keep_benign = 0.01;    // share of benign runs whose outputs are kept (staged only)
+    int keep_baseline  = 1;       // baseline runs kept, injection_0 is golden (staged only)
+    int shard_size     = 0;       // injection_<i> under shard_<i / shard_size>/, 0 = flat
+};
+
+// Output fingerprinting through the LD_PRELOAD interposer (fij_preload/)
+struct FingerprintOptions {
+    std::vector<std::string> outputs;   // fnmatch patterns of output paths, empty = off
+    bool sink = false;                  // injected runs write matching outputs to /dev/null
+    std::string lib = "../fij_preload/libfij_preload.so";
+};
+
+// When a campaign has enough runs (statistical early stopping)
+struct StoppingRule {
+    double margin     = 0.0;        // half-width every tracked rate must reach, 0 = off
+    double confidence = 0.95;
+    std::string method = "wilson";  // or "clopper-pearson"
+    int min_runs      = 100;        // never stop before this many classified runs
+    bool per_location = true;       // also register and memory runs on their own
+};
+
+// Stratified allocation of runs over the fault space (stratify)
+struct StrataOptions {
+    bool enabled      = false;
+    int bit_bins      = 4;      // register bits split into this many ranges
+    int time_bins     = 10;     // injection delay window split into this many bins
+    bool per_register = false;  // one stratum per register instead of one for all
+    bool mem_regions  = true;   // memory split by region class (text, heap, stack, ...)
+    int pilot         = 2;      // runs every stratum gets before Neyman allocation
+    int batch         = 32;     // runs allocated at a time
+};
+
+// Precomputed, replayable faults (fault_plan)
+struct PlanOptions {
+    bool enabled = false;
+    std::uint64_t seed = 0;     // draws of the plan, 0 = from the configuration hash
+    int window_ms = 0;          // delays drawn up to this, 0 = the measured baseline mean
+};
+
+// Outcomes of planned faults kept across campaigns (outcome_cache)
+struct OutcomeCacheOptions {
+    std::string path;                   // JSONL file shared by campaigns, "" = off
+    double verify = 0.0;                // share of cache hits run anyway to check the entry
+    std::vector<std::string> inputs;    // files or folders read besides those named in args
+};
+
+// Injection sites drawn from a PC profile of golden runs (profile_guided)
+struct ProfileOptions {
+    bool enabled  = false;
+    int period_us = 1000;       // PC sampling period of the profile runs
+    int runs      = 3;          // golden runs sampled
+    int sites     = 32;         // most sampled sites kept as injection sites
+};
+
 struct FijJob {
     std::string path;      // executable path
     std::string args;      // argument string
@@ -87,6 +150,51 @@ struct FijJob {
     int baseline_runs;
     struct fij_params params;
     int workers;
+    double cpu_deadline_factor;   // kill past this multiple of the golden CPU time, 0 = off
+    double slowdown_factor;       // flag runs past this multiple of the mean golden CPU time
+    bool kernel_trace;            // record the module's tracepoints during the campaign
+    std::string telemetry_file;   // Prometheus text file rewritten while running, "" = off
+    std::string telemetry_socket; // Unix socket serving the same text, "" = off
+    int telemetry_interval_ms;
+    bool timeline_trace;          // write diff/timeline.json (Chrome trace format)
+    RetentionPolicy retention;
+    FingerprintOptions fingerprint;
+    StoppingRule stopping;
+    StrataOptions strata;
+    PlanOptions plan;
+    OutcomeCacheOptions cache;
+    ProfileOptions profile;
+};
+
+// One run as seen by a worker, for the timeline trace. Times are
+// steady_clock ns, i.e. CLOCK_MONOTONIC like the kernel ts_* stamps.
+struct TimelineRun {
+    int worker;
+    int run;
+    std::string kind;             // baseline, injection, retry (no fault), error
+    std::uint64_t start_ns;
+    std::uint64_t end_ns;
+    int exit_code;
+    std::uint64_t maxrss_kb;
+    std::string kill_reason;      // empty unless the target was SIGKILLed
+    std::uint64_t ts[8];          // fij_result ts_exec_start .. ts_collect, 0 if unknown
+};
+
+// Runner-side work outside the workers (baseline statistics, analysis, ...)
+struct TimelineSpan {
+    std::string name;
+    std::uint64_t start_ns;
+    std::uint64_t end_ns;
+};
+
+// Outcome mix as classified by the analyzer
+struct CampaignOutcomes {
+    int total   = 0;
+    int crashed = 0;
+    int hanged  = 0;
+    int sdc     = 0;
+    int benign  = 0;
+    int masked  = 0;
 };
 
 struct CampaignResult {
@@ -99,6 +207,14 @@ struct CampaignResult {
     double avg_ms;
     double std_ms;
     std::vector<double> inj_times_ms;
+    fs::path campaign_path;
+    int workers;
+    double baseline_s;      // golden runs and their statistics
+    double injection_s;
+    double analysis_s;
+    CampaignOutcomes outcomes;
+    std::vector<TimelineRun>  timeline_runs;
+    std::vector<TimelineSpan> timeline_spans;
 };
 
 // -----------------------------------------------------------------------------
@@ -107,13 +223,436 @@ struct CampaignResult {
 
 fs::path create_dir_in_path(const fs::path &base_path, const std::string &final_folder);
 
+// Writes <run_dir>/injection_<i>.json; outputs_retained = false records that
+// the outputs were found equal to golden while staged and then dropped.
+// The keys of extra are added to the top level of the JSON.
 void log_injection_iteration(
-    const fs::path &base_path,
+    const fs::path &run_dir,
     int i,
     double dt_seconds,
-    const struct fij_result &res
+    const struct fij_result &res,
+    bool outputs_retained = true,
+    const json &extra = json::object()
 );
 
+// <target>_+_<args> folder of a campaign under fij_logs, before any (k) suffix
+std::string campaign_folder_name(const struct fij_params &p);
+
+// Replaces {campaign} and {run} in a target argument or output pattern
+std::string expand_run_placeholders(std::string s, const std::string &campaign, int run);
+
+// -----------------------------------------------------------------------------
+// Output fingerprints (fingerprint_outputs)
+// -----------------------------------------------------------------------------
+
+struct OutputFingerprint {
+    std::uint64_t bytes = 0;
+    std::uint64_t hash  = 0;    // FNV-1a 64 of the contents
+    bool ordered = true;        // written sequentially: bytes and hash are the file's
+    bool sunk    = false;       // contents went to /dev/null, nothing on disk
+    bool stdio   = false;       // fopen stream: writes made inside libc are not counted
+};
+
+// by file name, the way outputs are matched against no_inj/injection_0
+using FingerprintMap = std::map<std::string, OutputFingerprint>;
+
+// One run's shared memory slot, filled by libfij_preload.so and unlinked on destruction
+struct FingerprintSlot {
+    explicit FingerprintSlot(const std::string &name);
+    ~FingerprintSlot();
+    FingerprintSlot(const FingerprintSlot &) = delete;
+    FingerprintSlot &operator=(const FingerprintSlot &) = delete;
+
+    FingerprintMap read() const;
+    std::uint32_t overflow() const;     // outputs the slot had no room for
+
+    std::string name;
+    void *map = nullptr;
+};
+
+// env_extra of a run: LD_PRELOAD and the FIJ_FP_* variables
+std::string fingerprint_env(const FingerprintOptions &opt, const std::string &slot_name,
+                            bool sink, const std::string &campaign, int run);
+
+// Hashes the outputs (non-JSON files) of a run folder the way the library does
+FingerprintMap fingerprint_files(const fs::path &dir);
+
+json fingerprint_to_json(const FingerprintMap &fp);
+FingerprintMap fingerprint_from_json(const json &j);
+
+// Golden fingerprints the runner validated, from <campaign>/no_inj/fingerprint.json
+void write_golden_fingerprint(const fs::path &campaign, const FingerprintMap &fp,
+                              const std::vector<std::string> &fallback);
+FingerprintMap load_golden_fingerprint(const fs::path &campaign);
+
+enum class OutputCheck { Same, Missing, Differs };
+
+// Compares one golden output with the run's, by fingerprint when both sides
+// have one and by reading the files otherwise
+OutputCheck check_run_output(const fs::path &golden_file, const fs::path &run_dir,
+                             const FingerprintMap &golden_fp, const FingerprintMap &run_fp,
+                             std::uint64_t *bytes = nullptr);
+
+// Every golden output of golden_dir is Same in run_dir; false without golden outputs
+bool run_outputs_match_golden(const fs::path &run_dir, const fs::path &golden_dir,
+                              const FingerprintMap &golden_fp, const FingerprintMap &run_fp);
+
+// -----------------------------------------------------------------------------
+// Campaign journal (--resume, --top-up)
+// -----------------------------------------------------------------------------
+
+// How an existing campaign is picked up again
+struct ResumeOptions {
+    bool resume = false;    // continue the latest campaign with the same configuration
+    int top_up  = 0;        // runs added to that campaign (implies resume)
+    int replay  = -1;       // rerun this planned run of that campaign instead, -1 = no
+};
+
+// One injected run of the journal
+struct JournaledRun {
+    double dt = 0.0;
+    struct fij_result result;
+    std::string run_class;      // CRASH, HANG, SDC or BENIGN when it was classified, else ""
+    int stratum = -1;           // StrataPlanner stratum, -1 if not stratified
+};
+
+// What <campaign>/journal.jsonl says was already done
+struct JournalState {
+    bool found = false;
+    std::string config_hash;
+    int runs = 0;                                       // runs the campaign aims at
+    bool baseline_done = false;
+    std::vector<double> baseline_times;                 // in completion order
+    std::vector<struct fij_result> baseline_results;
+    json golden_run_fingerprint = json::object();       // the library's view of baseline run 0
+    std::uint32_t golden_overflow = 0;
+    std::map<int, JournaledRun> completed;
+};
+
+// Append-only, one JSON record per line, each on disk before append() returns
+struct CampaignJournal {
+    explicit CampaignJournal(const fs::path &campaign);
+    ~CampaignJournal();
+    CampaignJournal(const CampaignJournal &) = delete;
+    CampaignJournal &operator=(const CampaignJournal &) = delete;
+
+    void append(const json &record);
+
+    int fd = -1;
+    std::mutex lock;
+};
+
+// Everything that makes two campaigns comparable run by run, not the run count
+std::string campaign_config_hash(const struct fij_params &p, int baseline_runs,
+                                 const RetentionPolicy &retention,
+                                 const FingerprintOptions &fingerprint,
+                                 const StrataOptions &strata = StrataOptions{},
+                                 const PlanOptions &plan = PlanOptions{},
+                                 const ProfileOptions &profile = ProfileOptions{});
+
+JournalState load_campaign_journal(const fs::path &campaign);
+
+// The latest <base>/<folder> or <folder>(k) journaled with config_hash, empty if none
+fs::path find_campaign_to_resume(const fs::path &base, const std::string &folder,
+                                 const std::string &config_hash);
+
+// fij_result as hex, exact across a resume by the same build
+std::string journal_encode_result(const struct fij_result &res);
+bool journal_decode_result(const std::string &hex, struct fij_result &res);
+
+// -----------------------------------------------------------------------------
+// Statistical early stopping (stop_margin)
+// -----------------------------------------------------------------------------
+
+// Outcome of an injected run as the analyzer counts it, masked runs as benign
+enum class RunClass { Benign, Sdc, Crash, Hang };
+constexpr int kRunClasses = 4;
+
+const char *run_class_name(RunClass c);
+bool run_class_from_name(const std::string &name, RunClass &c);
+
+// outputs_same: the run's outputs compared equal to golden (run_outputs_match_golden)
+RunClass classify_run(const struct fij_result &res, bool outputs_same);
+
+struct RateInterval {
+    double p;
+    double lo;
+    double hi;
+};
+
+// z with P(|Z| <= z) = confidence
+double normal_critical_value(double confidence);
+
+RateInterval wilson_interval(int k, int n, double confidence);
+RateInterval clopper_pearson_interval(int k, int n, double confidence);
+
+// Outcome counts of the classified runs, shared by the workers
+struct StoppingTracker {
+    explicit StoppingTracker(const StoppingRule &rule);
+
+    void add(RunClass c, bool memory);
+    int runs() const;
+    bool satisfied() const;     // every tracked rate within rule.margin
+    json report() const;        // counts and intervals, for diff/stopping.json
+
+    StoppingRule rule;
+    mutable std::mutex lock;
+    int counts[3][kRunClasses] = {};    // all, register, memory
+
+private:
+    int group_runs(int g) const;
+    RateInterval interval(int k, int n) const;
+};
+
+
+// -----------------------------------------------------------------------------
+// Stratified allocation of runs (stratify)
+// -----------------------------------------------------------------------------
+
+// One cell of the fault space; a run pinned to it flips a register bit in
+// [bit_lo, bit_hi] or a byte of a region class, within the delay bin
+struct Stratum {
+    std::string name;
+    bool memory = false;
+    int reg = FIJ_REG_NONE;         // FIJ_REG_NONE: the module picks
+    int bit_lo = 0;
+    int bit_hi = 63;
+    int region = FIJ_MEM_ANY;
+    int time_bin = 0;
+    int delay_lo = 0;               // ms, inclusive
+    int delay_hi = 0;
+    double base_weight = 0.0;       // share of the fault space, before the region share
+    int assigned = 0;               // runs handed out
+    int done = 0;                   // classified runs
+    int outside = 0;                // runs whose delay fell outside the bin, not counted
+    int counts[kRunClasses] = {};
+};
+
+// Hands out strata to runs, shared by the workers
+struct StrataPlanner {
+    StrataPlanner(const StrataOptions &opt, const struct fij_params &base, int max_delay_ms,
+                  std::uint64_t seed);
+
+    int next();                     // stratum of the next run, -1 if none can be sampled
+    bool usable(int h) const;       // false once its region turned out to be empty
+    // pins a run to stratum h; window_max_ms is the top of its delay bin
+    void apply(int h, struct fij_params &p, int &window_max_ms);
+    void observe_layout(int h, const struct fij_result &res);   // mem_region_vmas of a run
+    bool in_bin(int h, const struct fij_result &res) const;     // injection delay within the bin
+    void out_of_bin(int h);
+    void add(int h, RunClass c);
+    void restore(int h, const struct fij_result &res, const std::string &run_class);  // journaled run
+    const std::string &name(int h) const;
+
+    bool within_margin(const StoppingRule &rule) const;   // the weighted estimates
+    json report(double confidence) const;                 // for diff/strata.json
+
+    StrataOptions opt;
+    std::vector<Stratum> strata;
+    int time_bins = 1;
+
+private:
+    struct Estimate {
+        double rate = 0.0;
+        double var = 0.0;
+        int runs = 0;
+        double unsampled = 0.0;     // weight of the strata without a run yet
+    };
+
+    double weight(int h) const;
+    void plan_batch();
+    Estimate estimate(int group, int c) const;
+
+    mutable std::mutex lock;
+    std::mt19937_64 rng;
+    std::deque<int> queue;
+    std::vector<std::vector<double>> layout_sum;     // per time bin (+ all) and region
+    std::vector<int> layout_runs;
+};
+
+// -----------------------------------------------------------------------------
+// Precomputed fault lists (fault_plan)
+// -----------------------------------------------------------------------------
+
+// <campaign>/plan.bin: this header, then count records, run i uses record i
+struct FaultPlanHeader {
+    char magic[8];              // "FIJPLAN1"
+    std::uint32_t record_size;  // sizeof(FaultPlanRecord) of the build that wrote it
+    std::uint32_t count;
+    std::uint64_t seed;
+    std::int32_t min_delay_ms;  // delays drawn in [min_delay_ms, max_delay_ms]
+    std::int32_t max_delay_ms;  // the campaign's injection window
+};
+
+struct FaultPlanRecord {
+    struct fij_fault fault;
+    std::uint64_t seed;         // fij_params.seed of the run
+};
+
+// Keeps a plan.bin made from the same seed and window with at least count
+// records, otherwise draws count distinct faults and replaces it. The draws
+// are sequential, so a longer plan starts with the records of a shorter one.
+void prepare_fault_plan(const fs::path &path, const struct fij_params &base, int max_delay_ms,
+                        int count, std::uint64_t seed);
+
+// A plan file mapped read-only, shared by the workers
+struct FaultPlan {
+    explicit FaultPlan(const fs::path &path);
+    ~FaultPlan();
+    FaultPlan(const FaultPlan &) = delete;
+    FaultPlan &operator=(const FaultPlan &) = delete;
+
+    const FaultPlanHeader &header() const;
+    std::size_t size() const;
+    const FaultPlanRecord &operator[](std::size_t i) const;
+
+    void *map = nullptr;
+    std::size_t bytes = 0;
+};
+
+// Pins a run to a planned fault
+void apply_planned_fault(struct fij_params &p, const FaultPlanRecord &r);
+json planned_fault_to_json(const FaultPlanRecord &r, int index);
+
+// Reruns planned run `run` of the campaign journaled for job into
+// <campaign>/replay/injection_<run> and compares it with the campaign's run
+void replay_planned_run(const std::string &device, const FijJob &job, int run,
+                        int pre_delay_ms, int max_retries, int retry_delay_ms, bool verbose);
+
+// -----------------------------------------------------------------------------
+// Fault outcome cache (outcome_cache)
+// -----------------------------------------------------------------------------
+
+// What a planned fault did the last time it ran against the same target
+struct CachedOutcome {
+    RunClass run_class = RunClass::Benign;
+    struct fij_result result;
+    double dt = 0.0;
+    int seen = 0;                   // runs that agreed with it
+    bool nondeterministic = false;  // a verify run disagreed: never used again
+    std::string campaign;           // where it was observed first
+    int run = -1;
+};
+
+// The cache file, loaded once per campaign and appended to by the workers.
+// The key of a fault hashes the target binary, its argument template, the
+// files named in the arguments and opt.inputs, the parameters that change
+// an outcome, and the fault descriptor.
+struct OutcomeCache {
+    OutcomeCache(const OutcomeCacheOptions &opt, const struct fij_params &base,
+                 double cpu_deadline_factor, const std::string &campaign);
+    ~OutcomeCache();
+    OutcomeCache(const OutcomeCache &) = delete;
+    OutcomeCache &operator=(const OutcomeCache &) = delete;
+
+    std::string key(const FaultPlanRecord &r) const;
+    bool lookup(const std::string &key, CachedOutcome &out);    // deterministic entries only
+    bool sampled_for_verify(const std::string &key) const;
+
+    void store(const std::string &key, RunClass c, const struct fij_result &res, double dt, int run);
+    // Compares a verify run with the entry; a mismatch marks it nondeterministic
+    bool verify(const std::string &key, const CachedOutcome &cached, RunClass c,
+                const struct fij_result &res, int run);
+
+    json report() const;
+
+    void append(const json &record);    // under lock
+
+    OutcomeCacheOptions opt;
+    std::string campaign_name;
+    std::uint64_t target_hash = 0;
+    std::uint64_t verify_salt = 0;
+    std::unordered_map<std::string, CachedOutcome> entries;
+    int hits = 0, misses = 0, verified = 0, stored = 0;
+    json mismatches = json::array();
+    int fd = -1;
+    mutable std::mutex lock;
+};
+
+// -----------------------------------------------------------------------------
+// Region of interest (roi_start, roi_end)
+// -----------------------------------------------------------------------------
+
+// [FILE:]SYMBOL[+OFFSET] or [FILE:]ADDRESS as the module's file and file
+// offset; FILE defaults to exe_path, which may be a shared library
+struct fij_probe resolve_roi_probe(const std::string &spec, const std::string &exe_path);
+
+// The function holding a file offset in an executable segment of an ELF
+// file and the offset into it, the other way round; false when no symbol
+// covers it
+bool symbolize_file_offset(const std::string &path, std::uint64_t offset,
+                           std::string &function, std::uint64_t &function_offset);
+
+// -----------------------------------------------------------------------------
+// Profile-guided injection sites (profile_guided)
+// -----------------------------------------------------------------------------
+
+// PC samples of one golden run, as IOCTL_GET_PROFILE hands them out
+struct RunProfile {
+    std::vector<std::string> files;
+    std::vector<struct fij_profile_sample> samples;
+    std::uint64_t dropped = 0;
+};
+
+// An instruction the golden runs spent time at
+struct ProfileSite {
+    std::string path;
+    std::uint64_t offset = 0;
+    std::string function;       // symbolize_file_offset, "" if unknown
+    std::uint64_t function_offset = 0;  // of the site into function
+    std::uint64_t samples = 0;
+    std::uint64_t hits = 0;     // executions in a golden run, 0 = could not be counted
+};
+
+// <campaign>/no_inj/profile.json
+struct SiteProfile {
+    std::vector<ProfileSite> sites;     // injection sites, most sampled first
+    std::vector<ProfileSite> unusable;  // sampled often enough but never hit by a uprobe
+    std::uint64_t samples = 0;          // all samples of the profile runs
+    std::uint64_t dropped = 0;          // outside any file mapping
+    int period_us = 0;
+    int runs = 0;
+
+    // Site and execution of it for attempt `attempt` of run `run`: sites
+    // by their share of the samples, executions uniform in [1, hits]
+    std::pair<int, std::uint64_t> draw(std::uint64_t seed, int run, int attempt) const;
+
+    json to_json() const;
+    static SiteProfile from_json(const json &j);
+};
+
+// Samples opt.runs golden runs, keeps the opt.sites most sampled sites and
+// counts their executions in one more golden run each. golden is the
+// baseline's per-run params; outputs go to scratch, removed afterwards.
+SiteProfile profile_injection_sites(const std::string &device, const struct fij_params &golden,
+                                    const fs::path &scratch, const ProfileOptions &opt,
+                                    int num_threads, int pre_delay_ms, int max_retries,
+                                    int retry_delay_ms, bool verbose);
+
+// Pins a run to execution `hit` of a site
+void apply_profile_site(struct fij_params &p, const ProfileSite &site, std::uint64_t hit);
+
+// -----------------------------------------------------------------------------
+
+// injection_<i> of a campaign, inside its shard when shard_size > 0
+fs::path run_dir_path(const fs::path &campaign, int i, int shard_size);
+
+// Records the layout in <campaign>/layout.json, read back by the analyzer
+void write_campaign_layout(const fs::path &campaign, const RetentionPolicy &policy);
+int campaign_shard_size(const fs::path &campaign);
+
+// Whether a staged injected run is worth persisting: anything but a clean
+// exit with golden outputs, plus the keep_benign sample of the rest.
+// outputs_same is run_outputs_match_golden of the staged folder.
+bool retain_run_outputs(const struct fij_result &res, bool outputs_same, int i,
+                        const RetentionPolicy &policy, std::uint64_t slowdown_cpu_ns);
+
+// Moves a run folder, copying when source and destination are on different filesystems
+void move_run_dir(const fs::path &from, const fs::path &to);
+
+// log.txt from the head and tail the module captured (capture_output)
+void write_captured_log(const fs::path &path, const std::string &output, const struct fij_result &res);
+
 std::string label_from_params(const struct fij_params &p);
 
 // -----------------------------------------------------------------------------
@@ -122,22 +661,26 @@ std::string label_from_params(const struct fij_params &p);
 
 std::vector<FijJob> build_fij_jobs_from_config(const json &config);
 
+// Parses a config file, dropping // comments
+json load_config_file(const std::string &config_path);
+
 std::vector<FijJob> load_fij_jobs_from_file(const std::string &config_path);
 
 // -----------------------------------------------------------------------------
 // Campaign runner
 // -----------------------------------------------------------------------------
 
+// One campaign of job: its parameters, run counts and per-campaign options
+// all come from the job, the rest is how the runner drives the module
 CampaignResult run_injection_campaign(
     const std::string &device,
-    struct fij_params base_params,
-    int runs,
-    int baseline_runs,
+    const FijJob &job,
     int pre_delay_ms,
     int max_retries,
     int retry_delay_ms,
-    bool verbose      = true,
-    int max_workers   = 1
+    bool verbose               = true,
+    const ResumeOptions &resume = ResumeOptions{},
+    JobTelemetry *telemetry    = nullptr
 );
 
 void run_campaigns_from_config(
@@ -146,12 +689,118 @@ void run_campaigns_from_config(
     int pre_delay_ms               = 0,
     int max_retries                = 5,
     int retry_delay_ms             = 50,
-    bool verbose                   = true
+    bool verbose                   = true,
+    const ResumeOptions &resume    = ResumeOptions{}
 );
 
+struct CampaignBenchOptions {
+    std::string device    = "/dev/fij";
+    std::vector<int> workers{1, 2, 4};
+    int runs              = 0;      // injections per campaign, 0 = as in the config
+    std::string base_path;          // overrides the config's base_path when set
+    std::string out       = "campaign_bench.json";
+    bool keep             = false;  // keep the campaign folders
+};
+
+// Every job once per worker count; results in opt.out (JSON)
+void run_campaign_benchmark(const std::string &config_path, const CampaignBenchOptions &opt);
+
+// --------------------------------------------------------------------------
+// Synthetic campaigns / analyzer benchmark
+// --------------------------------------------------------------------------
+
+struct SynthCampaignOptions {
+    int runs                 = 1000;
+    double sdc               = 0.10;   // fractions of the runs, the rest is benign
+    double crash             = 0.05;
+    double hang              = 0.02;
+    int image_px             = 64;     // side of the PNG output
+    std::size_t binary_bytes = 4096;   // size of the binary output
+    std::uint64_t seed       = 1;
+};
+
+// Campaign folder in the runner's on-disk layout, without running anything
+void generate_synthetic_campaign(const fs::path &dir, const SynthCampaignOptions &opt);
+
+struct AnalyzerBenchOptions {
+    std::vector<int> runs{1000, 100000, 1000000};
+    SynthCampaignOptions synth;
+    std::string dir = "/tmp/fij_synth";     // where the campaigns are generated
+    std::string out = "analyzer_bench.json";
+    bool keep       = false;                // keep the generated campaigns
+};
+
+// Generates and analyzes one campaign per run count; results in opt.out (JSON)
+void run_analyzer_benchmark(const AnalyzerBenchOptions &opt);
+
 // --------------------------------------------------------------------------
 // Campaign Analyzer
 // --------------------------------------------------------------------------
 
-void analyze_injection_campaign(fs::path base_path_str, int expected_runs);
+// Where the analyzer spends its time. Stage times are summed over the
+// OpenMP threads; total_ns is wall time and includes writing summary.csv.
+struct AnalyzerProfile {
+    std::uint64_t files = 0;          // run JSONs parsed and outputs compared
+    std::uint64_t bytes = 0;          // bytes read by those
+    std::uint64_t json_parse_ns = 0;
+    std::uint64_t compare_ns = 0;
+    std::uint64_t image_diff_ns = 0;
+    std::uint64_t copy_ns = 0;        // diff_<i>/ folders and copies into them
+    std::uint64_t total_ns = 0;
+};
+
+bool are_files_identical_binary(const fs::path &p1, const fs::path &p2, std::uint64_t *bytes = nullptr);
+
+CampaignOutcomes analyze_injection_campaign(fs::path base_path_str, int expected_runs,
+                                            AnalyzerProfile *profile = nullptr);
+
+// --------------------------------------------------------------------------
+// Kernel tracepoint stream
+// --------------------------------------------------------------------------
+
+struct KernelTraceEvent {
+    std::uint64_t ts_ns;    // CLOCK_MONOTONIC, comparable with fij_result ts_*
+    int cpu;
+    int pid;
+    std::string task;
+    std::string event;      // fij_exec, fij_stop, fij_flip, ...
+    std::string fields;     // "key=value ..." as printed by the tracepoint
+};
+
+struct KernelTraceSession;
+
+// nullptr if tracefs or the tracepoints are not available
+std::shared_ptr<KernelTraceSession> kernel_trace_start();
+std::vector<KernelTraceEvent> kernel_trace_stop(const std::shared_ptr<KernelTraceSession> &session);
+void write_kernel_timeline(const fs::path &path, const std::vector<KernelTraceEvent> &events);
+
+// --------------------------------------------------------------------------
+// Timeline trace
+// --------------------------------------------------------------------------
+
+std::uint64_t timeline_now_ns();
+
+TimelineRun timeline_run(int worker, int run, const std::string &kind,
+                         std::uint64_t start_ns, std::uint64_t end_ns,
+                         const struct fij_result *res);
+
+// Chrome trace JSON, loadable in Perfetto UI or chrome://tracing
+void write_timeline_trace(
+    const fs::path &path,
+    const CampaignResult &cr,
+    const std::vector<KernelTraceEvent> &kernel_events
+);
+
+// --------------------------------------------------------------------------
+// Latency report
+// --------------------------------------------------------------------------
+
+void write_latency_report(
+    const fs::path &out_dir,
+    const std::vector<struct fij_result> &baseline_results,
+    const std::vector<double> &baseline_times_s,
+    const std::vector<struct fij_result> &inj_results,
+    const std::vector<double> &inj_times_s,
+    bool verbose = true
+);
 
@@ -8,6 +8,9 @@
 #include <opencv2/opencv.hpp>
 #include <nlohmann/json.hpp>
 #include <omp.h>
+#include <linux/fij.h>
+
+#include "fij.hpp"
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
@@ -15,12 +18,13 @@ namespace fs = std::filesystem;
 // ==========================================
 // UTILITY: Binary File Comparison
 // ==========================================
-bool are_files_identical_binary(const fs::path& p1, const fs::path& p2) {
+bool are_files_identical_binary(const fs::path& p1, const fs::path& p2, std::uint64_t* bytes) {
     std::ifstream f1(p1, std::ifstream::binary | std::ifstream::ate);
     std::ifstream f2(p2, std::ifstream::binary | std::ifstream::ate);
 
     if (f1.fail() || f2.fail()) return false;
     if (f1.tellg() != f2.tellg()) return false; // Size mismatch
+    if (bytes) *bytes += 2 * static_cast<std::uint64_t>(f1.tellg());
 
     f1.seekg(0, std::ifstream::beg);
     f2.seekg(0, std::ifstream::beg);
@@ -97,6 +101,8 @@ struct AnalyzeStats {
     int hanged = 0;
     int sdc = 0;
     int benign = 0;
+    int masked = 0;     // flipped byte overwritten before use, run killed early
+    int converged = 0;  // BENIGN runs cut short at a golden checkpoint
     int errors = 0;
 
     // Split counters (Reg / Mem)
@@ -104,6 +110,13 @@ struct AnalyzeStats {
     int hanged_reg = 0;  int hanged_mem = 0;
     int sdc_reg = 0;     int sdc_mem = 0;
     int benign_reg = 0;  int benign_mem = 0;
+    int masked_mem = 0;  // memory-only outcome
+
+    // Dead-register prefilter (reg_prefilter)
+    long long regs_skipped = 0;
+
+    // Completed runs that used much more CPU than golden (slowdown_factor)
+    int slowdown = 0;
 };
 
 struct CsvRecord {
@@ -114,7 +127,7 @@ struct CsvRecord {
     std::string json_file;
 };
 
-void analyze_injection_campaign(fs::path base_path, int expected_runs) {
+CampaignOutcomes analyze_injection_campaign(fs::path base_path, int expected_runs, AnalyzerProfile* profile) {
     fs::path golden_dir = base_path / "no_inj/injection_0";
     fs::path diff_root = base_path / "diff";
 
@@ -125,6 +138,44 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
 
     std::vector<CsvRecord> csv_records;
     AnalyzeStats stats;
+    // profile_guided runs: outcome counts of the function holding the site
+    std::map<std::string, std::map<std::string, int>> by_function;
+    std::uint64_t t_start = timeline_now_ns();
+
+    // Per-run stage times and I/O, folded into *profile when asked for
+    auto merge_profile = [&](const AnalyzerProfile& p) {
+        if (!profile) return;
+        #pragma omp critical(profile_update)
+        {
+            profile->files         += p.files;
+            profile->bytes         += p.bytes;
+            profile->json_parse_ns += p.json_parse_ns;
+            profile->compare_ns    += p.compare_ns;
+            profile->image_diff_ns += p.image_diff_ns;
+            profile->copy_ns       += p.copy_ns;
+        }
+    };
+
+    // Slowdown threshold written by the runner from the golden CPU times
+    std::uint64_t slowdown_cpu_ns = 0;
+    double golden_cpu_ns = 0.0;
+    {
+        std::ifstream ru_file(base_path / "no_inj/rusage.json");
+        if (ru_file.good()) {
+            try {
+                json ru;
+                ru_file >> ru;
+                slowdown_cpu_ns = ru.value("slowdown_cpu_ns", std::uint64_t{0});
+                golden_cpu_ns   = ru.value("cpu_ns_mean", 0.0);
+            } catch (const std::exception&) {}
+        }
+    }
+
+    // sharded campaigns keep injection_<i> under shard_<n>/
+    int shard_size = campaign_shard_size(base_path);
+
+    // outputs hashed inside the target (fingerprint_outputs) are compared by hash
+    const FingerprintMap golden_fp = load_golden_fingerprint(base_path);
 
     std::cout << "Reference: " << golden_dir << "\nStarting analysis (" << expected_runs << " expected runs)...\n";
 
@@ -136,19 +187,21 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
         // --- LOCAL VARS ---
         CsvRecord local_rec; 
         bool rec_valid = false;
+        AnalyzerProfile prof;
         
         // --- LOCAL STATS Delta ---
         // (We calculate delta for this run and merge at the end)
         // Simplification: we just use a critical section at the end of iteration
         // to update the global stats struct.
 
-        fs::path inj_dir = base_path / ("injection_" + std::to_string(i));
+        fs::path inj_dir = run_dir_path(base_path, i, shard_size);
         if (!fs::exists(inj_dir)) continue;
 
         std::string current_json_filename = "injection_" + std::to_string(i) + ".json";
         fs::path json_path = inj_dir / current_json_filename;
 
         // 1. Load JSON
+        std::uint64_t t0 = timeline_now_ns();
         std::ifstream json_file(json_path);
         if (!json_file.good()) {
             #pragma omp critical(stats_update)
@@ -170,10 +223,14 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
             }
             continue;
         }
+        prof.files++;
+        prof.bytes += static_cast<std::uint64_t>(json_file.tellg());
+        prof.json_parse_ns += timeline_now_ns() - t0;
 
         // 2. Filter Logic
         auto& res_block = meta_data["result"];
         if (res_block.value("fault_injected", 0) != 1) {
+            merge_profile(prof);
             continue;
         }
 
@@ -193,17 +250,41 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
         bool sdc_detected = false;
 
         // 4. Classification
-        if (exit_code != 0) {
+        // The module killed these on purpose, so exit_code is SIGKILL: check first
+        bool converged = res_block.value("converged", 0) == 1;
+        if (res_block.value("watch_status", 0) == FIJ_WATCH_MASKED) {
+            status_type = "MASKED";
+            status_details = "Overwritten at " + res_block.value("watch_pc", std::string("?"));
+        } else if (converged) {
+            // state matched golden, outputs were never written: nothing to compare
+            status_type = "BENIGN";
+        } else if (exit_code != 0) {
             if (process_hanged == 1) {
                 status_type = "HANG";
                 status_details = "Exit: " + std::to_string(exit_code) + ", Hanged: 1";
+                if (res_block.value("cpu_budget_exceeded", 0) == 1)
+                    status_details += ", CPU budget exceeded";
+                if (res_block.value("hang_detected", 0) == 1) {
+                    status_details += ", Livelock: " + res_block.value("hang_pc_lo", std::string("?")) +
+                                      "-" + res_block.value("hang_pc_hi", std::string("?"));
+                }
             } else {
                 status_type = "CRASH";
                 status_details = "Exit: " + std::to_string(exit_code);
             }
+        } else if (meta_data.contains("cached")) {
+            // not run: the outcome cache had this fault, outputs were compared back then
+            const json &cached = meta_data["cached"];
+            status_type = cached.value("class", std::string("BENIGN"));
+            status_details = "Cached from " + cached.value("campaign", std::string("?")) +
+                             " run " + std::to_string(cached.value("run", -1));
+        } else if (!meta_data.value("outputs_retained", true)) {
+            // compared with golden while staged and found equal, outputs dropped
+            status_type = "BENIGN";
         } else {
             // SDC Check Logic
             std::vector<std::string> details_list;
+            FingerprintMap run_fp = fingerprint_from_json(meta_data.value("fingerprint", json::object()));
             
             for (const auto& entry : fs::directory_iterator(golden_dir)) {
                 if (entry.path().extension() == ".json") continue;
@@ -214,12 +295,24 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
                 bool file_mismatch = false;
                 std::string file_note = "";
 
-                if (!fs::exists(i_file)) {
+                std::uint64_t tc = timeline_now_ns();
+                OutputCheck check = check_run_output(g_file, inj_dir, golden_fp, run_fp, &prof.bytes);
+                bool missing = check == OutputCheck::Missing;
+                bool identical = check == OutputCheck::Same;
+                if (!missing) prof.files++;
+                prof.compare_ns += timeline_now_ns() - tc;
+
+                if (missing) {
                     file_mismatch = true;
                     file_note = "MISSING: " + g_file.filename().string();
-                } else if (!are_files_identical_binary(g_file, i_file)) {
+                } else if (!identical && !fs::exists(i_file)) {
+                    // output went to the fingerprint sink, only its hash is left
+                    file_mismatch = true;
+                    file_note = "SDC " + g_file.filename().string() + " (Fingerprint Mismatch)";
+                } else if (!identical) {
                     file_mismatch = true;
                     
+                    std::uint64_t tcopy = timeline_now_ns();
                     if (!fs::exists(experiment_diff_dir)) {
                         fs::create_directories(experiment_diff_dir);
                     }
@@ -229,9 +322,12 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
                         std::string i_name = i_file.stem().string() + "_INJ" + i_file.extension().string();
                         fs::copy_file(g_file, experiment_diff_dir / g_name, fs::copy_options::overwrite_existing);
                         fs::copy_file(i_file, experiment_diff_dir / i_name, fs::copy_options::overwrite_existing);
+                        prof.copy_ns += timeline_now_ns() - tcopy;
 
+                        std::uint64_t timg = timeline_now_ns();
                         fs::path mask_path = experiment_diff_dir / ("diff_mask_" + g_file.filename().string());
                         DiffResult img_res = try_visual_diff(g_file, i_file, mask_path);
+                        prof.image_diff_ns += timeline_now_ns() - timg;
 
                         if (img_res.is_image) {
                             file_note = "SDC " + g_file.filename().string() + " [" + img_res.desc + "]";
@@ -259,12 +355,29 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
             }
         }
 
+        // A run that finished but burnt far more CPU than golden is worth a look
+        bool slow = false;
+        if (slowdown_cpu_ns > 0 && (status_type == "BENIGN" || status_type == "SDC") && !converged) {
+            std::uint64_t cpu_ns = res_block.value("rusage", json::object()).value("cpu_ns", std::uint64_t{0});
+            if (cpu_ns > slowdown_cpu_ns) {
+                slow = true;
+                std::ostringstream oss;
+                oss << "Slowdown: " << std::fixed << std::setprecision(2)
+                    << (cpu_ns / golden_cpu_ns) << "x golden CPU";
+                if (!status_details.empty()) status_details += " | ";
+                status_details += oss.str();
+            }
+        }
+
         // 5. Update shared stats
         #pragma omp critical(stats_update)
         {
             stats.total_injected++;
+            stats.regs_skipped += res_block.value("regs_skipped", 0);
+            if (slow) stats.slowdown++;
             if (status_type == "BENIGN") {
                 stats.benign++;
+                if (converged) stats.converged++;
                 if (is_memory) stats.benign_mem++; else stats.benign_reg++;
             } else if (status_type == "HANG") {
                 stats.hanged++;
@@ -275,17 +388,35 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
             } else if (status_type == "SDC") {
                 stats.sdc++;
                 if (is_memory) stats.sdc_mem++; else stats.sdc_reg++;
+            } else if (status_type == "MASKED") {
+                stats.masked++;
+                stats.masked_mem++;
+            }
+            if (meta_data.contains("site")) {
+                const json &site = meta_data["site"];
+                std::string fn = site.value("function", std::string());
+                if (fn.empty())
+                    fn = fs::path(site.value("path", std::string())).filename().string() + "+" +
+                         site.value("offset", std::string("?"));
+                by_function[fn][status_type]++;
+                by_function[fn]["TOTAL"]++;
             }
 
-            if (status_type != "BENIGN") {
+            // masked runs have no output worth keeping, only their CSV row
+            if (status_type == "MASKED") {
+                csv_records.push_back({std::to_string(i), status_type, loc_str, status_details, current_json_filename});
+            } else if (status_type != "BENIGN" || slow) {
+                std::uint64_t tcopy = timeline_now_ns();
                 if (!fs::exists(experiment_diff_dir)) {
                     fs::create_directories(experiment_diff_dir);
                 }
                 fs::copy_file(json_path, experiment_diff_dir / current_json_filename, fs::copy_options::overwrite_existing);
+                prof.copy_ns += timeline_now_ns() - tcopy;
 
                 csv_records.push_back({std::to_string(i), status_type, loc_str, status_details, current_json_filename});
             }
         }
+        merge_profile(prof);
     }
 
     // 6. Final Report (CSV)
@@ -311,6 +442,13 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
     csv << "STATS,HANGED," << stats.hanged << " (" << std::fixed << std::setprecision(2) << get_pct(stats.hanged) << "%),,\n";
     csv << "STATS,SDC," << stats.sdc << " (" << std::fixed << std::setprecision(2) << get_pct(stats.sdc) << "%),,\n";
     csv << "STATS,BENIGN," << stats.benign << " (" << std::fixed << std::setprecision(2) << get_pct(stats.benign) << "%),,\n";
+    csv << "STATS,MASKED," << stats.masked << " (" << std::fixed << std::setprecision(2) << get_pct(stats.masked) << "%),,\n";
+    if (stats.converged > 0)
+        csv << "STATS,CONVERGED (BENIGN)," << stats.converged << ",,\n";
+    if (stats.regs_skipped > 0)
+        csv << "STATS,DEAD REGISTER PICKS SKIPPED," << stats.regs_skipped << ",,\n";
+    if (stats.slowdown > 0)
+        csv << "STATS,SLOWDOWN (BENIGN/SDC)," << stats.slowdown << " (" << std::fixed << std::setprecision(2) << get_pct(stats.slowdown) << "%),,\n";
     
     // --- FAILURE BREAKDOWN TABLE ---
     csv << ",,,,\n"; // Spacer
@@ -320,6 +458,17 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
     csv << "HANG," << stats.hanged << "," << stats.hanged_reg << "," << stats.hanged_mem << ",\n";
     csv << "SDC," << stats.sdc << "," << stats.sdc_reg << "," << stats.sdc_mem << ",\n";
     csv << "BENIGN," << stats.benign << "," << stats.benign_reg << "," << stats.benign_mem << ",\n";
+    csv << "MASKED," << stats.masked << ",0," << stats.masked_mem << ",\n";
+
+    if (!by_function.empty()) {
+        csv << ",,,,\n"; // Spacer
+        csv << "BREAKDOWN BY FUNCTION,,,,\n";
+        csv << "FUNCTION,TOTAL,CRASH,HANG,SDC,BENIGN,MASKED\n";
+        for (auto &[fn, n] : by_function) {
+            csv << "\"" << fn << "\"," << n["TOTAL"] << "," << n["CRASH"] << "," << n["HANG"] << ","
+                << n["SDC"] << "," << n["BENIGN"] << "," << n["MASKED"] << "\n";
+        }
+    }
 
     csv.close();
 
@@ -328,5 +477,19 @@ void analyze_injection_campaign(fs::path base_path, int expected_runs) {
     std::cout << "Crashed: " << stats.crashed << " (Reg: " << stats.crashed_reg << ", Mem: " << stats.crashed_mem << ")\n";
     std::cout << "Hanged:  " << stats.hanged  << " (Reg: " << stats.hanged_reg  << ", Mem: " << stats.hanged_mem  << ")\n";
     std::cout << "SDC:     " << stats.sdc     << " (Reg: " << stats.sdc_reg     << ", Mem: " << stats.sdc_mem     << ")\n";
+    std::cout << "Masked:  " << stats.masked  << " (Mem: " << stats.masked_mem << ")\n";
+    if (stats.slowdown > 0)
+        std::cout << "Slow:    " << stats.slowdown << " (finished above the golden CPU threshold)\n";
     std::cout << "Summary saved to: " << summary_path << std::endl;
+
+    if (profile) profile->total_ns += timeline_now_ns() - t_start;
+
+    CampaignOutcomes out;
+    out.total   = stats.total_injected;
+    out.crashed = stats.crashed;
+    out.hanged  = stats.hanged;
+    out.sdc     = stats.sdc;
+    out.benign  = stats.benign;
+    out.masked  = stats.masked;
+    return out;
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "fij.hpp"
+#include "fij_telemetry.hpp"
 
 #include <iostream>
 
@@ -8,7 +9,8 @@ void run_campaigns_from_config(
     int pre_delay_ms,
     int max_retries,
     int retry_delay_ms,
-    bool verbose
+    bool verbose,
+    const ResumeOptions &resume
 ) {
     auto jobs = load_fij_jobs_from_file(config_path);
 
@@ -16,6 +18,28 @@ void run_campaigns_from_config(
         std::cout << "[+] Loaded " << jobs.size() << " jobs from " << config_path << "\n";
     }
 
+    // telemetry settings are top-level, so any job carries them
+    std::unique_ptr<CampaignTelemetry> telemetry;
+    std::vector<JobTelemetry *> job_telemetry(jobs.size(), nullptr);
+    if (!jobs.empty() && (!jobs[0].telemetry_file.empty() || !jobs[0].telemetry_socket.empty())) {
+        telemetry = std::make_unique<CampaignTelemetry>(
+            jobs[0].telemetry_file, jobs[0].telemetry_socket, jobs[0].telemetry_interval_ms);
+        for (std::size_t idx = 0; idx < jobs.size(); ++idx) {
+            const auto &job = jobs[idx];
+            std::string label = job.path + (job.args.empty() ? "" : " " + job.args);
+            job_telemetry[idx] = telemetry->add_job(label, job.baseline_runs, job.runs, job.workers);
+        }
+        if (!telemetry->start()) telemetry.reset();
+    }
+
+    // --replay reruns one planned run of each job's campaign, nothing else
+    if (resume.replay >= 0) {
+        for (const auto &job : jobs)
+            replay_planned_run(device, job, resume.replay, pre_delay_ms, max_retries,
+                               retry_delay_ms, verbose);
+        return;
+    }
+
     for (std::size_t idx = 0; idx < jobs.size(); ++idx) {
         const auto &job = jobs[idx];
         if (verbose) {
@@ -26,16 +50,37 @@ void run_campaigns_from_config(
                       << "    runs   = " << job.runs << "\n";
         }
 
-        run_injection_campaign(
+        std::shared_ptr<KernelTraceSession> trace;
+        if (job.kernel_trace) trace = kernel_trace_start();
+
+        CampaignResult cr = run_injection_campaign(
             device,
-            job.params,
-            job.runs,
-            job.baseline_runs,
+            job,
             pre_delay_ms,
             max_retries,
             retry_delay_ms,
             verbose,
-            job.workers
+            resume,
+            telemetry ? job_telemetry[idx] : nullptr
         );
+
+        std::vector<KernelTraceEvent> events;
+        if (trace) {
+            events = kernel_trace_stop(trace);
+            write_kernel_timeline(cr.campaign_path / "diff" / "kernel_trace.csv", events);
+            if (verbose) {
+                std::cout << "  Kernel trace: " << events.size() << " events in "
+                          << (cr.campaign_path / "diff" / "kernel_trace.csv") << "\n";
+            }
+        }
+
+        if (job.timeline_trace) {
+            write_timeline_trace(cr.campaign_path / "diff" / "timeline.json", cr, events);
+            if (verbose) {
+                std::cout << "  Timeline: " << (cr.campaign_path / "diff" / "timeline.json") << "\n";
+            }
+        }
     }
+
+    if (telemetry) telemetry->stop();
 }
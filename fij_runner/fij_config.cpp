@@ -6,6 +6,9 @@ std::vector<FijJob> build_fij_jobs_from_config(const json &config) {
     std::string base_path = config.value("base_path", std::string());
     int baseline_runs    = config.value("baseline_runs", 100);
     int workers = config.value("workers", 1);
+    std::string telemetry_file   = config.value("telemetry_file", std::string());
+    std::string telemetry_socket = config.value("telemetry_socket", std::string());
+    int telemetry_interval_ms    = config.value("telemetry_interval_ms", 1000);
 
     std::vector<FijJob> jobs;
 
@@ -52,6 +55,7 @@ std::vector<FijJob> build_fij_jobs_from_config(const json &config) {
             if (runs <= 0) continue;
 
             struct fij_params p{};
+            p.perf_counters = 1;
             set_cstring(p.process_path, path);
             set_process_name_from_path(p);
 
@@ -77,10 +81,19 @@ std::vector<FijJob> build_fij_jobs_from_config(const json &config) {
             apply_field_if_present(p, merged, "weight_mem",   &fij_params::weight_mem);
             apply_field_if_present(p, merged, "min_delay_ms", &fij_params::min_delay_ms);
             apply_field_if_present(p, merged, "max_delay_ms", &fij_params::max_delay_ms);
+            apply_field_if_present(p, merged, "hang_window_ms", &fij_params::hang_window_ms);
+            apply_field_if_present(p, merged, "hang_pc_span",   &fij_params::hang_pc_span);
+            apply_field_if_present(p, merged, "reg_prefilter_window", &fij_params::reg_prefilter_window);
 
             apply_field_if_present(p, merged, "only_mem",     &fij_params::only_mem,     true);
             apply_field_if_present(p, merged, "no_injection", &fij_params::no_injection, true);
             apply_field_if_present(p, merged, "all_threads",  &fij_params::all_threads,  true);
+            apply_field_if_present(p, merged, "hang_detect",  &fij_params::hang_detect,  true);
+            apply_field_if_present(p, merged, "watch_masked", &fij_params::watch_masked, true);
+            apply_field_if_present(p, merged, "reg_prefilter", &fij_params::reg_prefilter, true);
+            apply_field_if_present(p, merged, "perf_counters", &fij_params::perf_counters, true);
+            apply_field_if_present(p, merged, "capture_output", &fij_params::capture_output, true);
+            apply_field_if_present(p, merged, "capture_bytes", &fij_params::capture_bytes);
 
             if (merged.contains("thread")) {
                 p.thread_present = 1;
@@ -102,6 +115,37 @@ std::vector<FijJob> build_fij_jobs_from_config(const json &config) {
                 }
             }
 
+            if (merged.contains("digest_pc")) {
+                p.digest_mode = FIJ_DIGEST_RECORD;  // turned into COMPARE after the baseline
+                if (merged["digest_pc"].is_string()) {
+                    std::string v = merged["digest_pc"].get<std::string>();
+                    p.digest_pc = std::stoi(v, nullptr, 0);
+                } else {
+                    p.digest_pc = static_cast<int>(merged["digest_pc"].get<long long>());
+                }
+            }
+
+            if (merged.contains("delay_clock")) {
+                std::string clock = merged["delay_clock"].get<std::string>();
+                if (clock == "cpu")
+                    p.delay_clock = FIJ_DELAY_CPU;
+                else if (clock == "wall")
+                    p.delay_clock = FIJ_DELAY_WALL;
+                else
+                    throw std::runtime_error("delay_clock must be \"wall\" or \"cpu\"");
+            }
+
+            if (merged.contains("roi_start")) {
+                if (p.target_pc_present)
+                    throw std::runtime_error("roi_start and pc both pick when to inject, set one");
+                std::string exe = cstr_from_array(p.process_path);
+                p.roi_start = resolve_roi_probe(merged["roi_start"].get<std::string>(), exe);
+                if (merged.contains("roi_end"))
+                    p.roi_end = resolve_roi_probe(merged["roi_end"].get<std::string>(), exe);
+            } else if (merged.contains("roi_end")) {
+                throw std::runtime_error("roi_end needs roi_start");
+            }
+
             if (merged.contains("reg")) {
                 std::string regname = merged["reg"].get<std::string>();
                 std::cout << "regname=" << regname;
@@ -123,6 +167,79 @@ std::vector<FijJob> build_fij_jobs_from_config(const json &config) {
             job.baseline_runs = baseline_runs;
             job.params  = p;
             job.workers = workers;
+            job.cpu_deadline_factor = merged.value("cpu_deadline_factor", 0.0);
+            job.slowdown_factor     = merged.value("slowdown_factor", 1.5);
+            job.kernel_trace        = merged.value("kernel_trace", false);
+            job.timeline_trace      = merged.value("timeline_trace", false);
+            job.retention.stage_dir     = merged.value("stage_dir", std::string());
+            job.retention.keep_benign   = merged.value("keep_benign", 0.01);
+            job.retention.keep_baseline = merged.value("keep_baseline", 1);
+            job.retention.shard_size    = merged.value("shard_size", 0);
+            if (job.retention.keep_baseline < 1)
+                throw std::runtime_error("keep_baseline must be at least 1, injection_0 is the golden reference");
+            if (merged.contains("fingerprint_outputs")) {
+                const json &fo = merged["fingerprint_outputs"];
+                if (fo.is_string())
+                    job.fingerprint.outputs.push_back(fo.get<std::string>());
+                else
+                    job.fingerprint.outputs = fo.get<std::vector<std::string>>();
+            }
+            job.fingerprint.sink = merged.value("fingerprint_sink", false);
+            job.fingerprint.lib  = merged.value("fingerprint_lib", job.fingerprint.lib);
+            job.stopping.margin       = merged.value("stop_margin", 0.0);
+            job.stopping.confidence   = merged.value("stop_confidence", 0.95);
+            job.stopping.method       = merged.value("stop_method", std::string("wilson"));
+            job.stopping.min_runs     = merged.value("stop_min_runs", 100);
+            job.stopping.per_location = merged.value("stop_per_location", true);
+            if (job.stopping.method != "wilson" && job.stopping.method != "clopper-pearson")
+                throw std::runtime_error("stop_method must be \"wilson\" or \"clopper-pearson\"");
+            if (job.stopping.confidence <= 0.0 || job.stopping.confidence >= 1.0)
+                throw std::runtime_error("stop_confidence must be between 0 and 1");
+            job.strata.enabled      = merged.value("stratify", false);
+            job.strata.bit_bins     = merged.value("strata_bit_bins", job.strata.bit_bins);
+            job.strata.time_bins    = merged.value("strata_time_bins", job.strata.time_bins);
+            job.strata.per_register = merged.value("strata_per_register", false);
+            job.strata.mem_regions  = merged.value("strata_mem_regions", true);
+            job.strata.pilot        = merged.value("strata_pilot", job.strata.pilot);
+            job.strata.batch        = merged.value("strata_batch", job.strata.batch);
+            job.plan.enabled = merged.value("fault_plan", false);
+            job.plan.seed    = merged.value("fault_plan_seed", std::uint64_t{0});
+            job.plan.window_ms = merged.value("fault_plan_window_ms", 0);
+            if (job.plan.enabled && job.strata.enabled)
+                throw std::runtime_error("fault_plan and stratify cannot be combined");
+            if (job.plan.enabled && p.all_threads)
+                throw std::runtime_error("fault_plan describes one fault per run, not all_threads");
+            job.cache.path   = merged.value("outcome_cache", std::string());
+            job.cache.verify = merged.value("outcome_cache_verify", 0.0);
+            if (merged.contains("outcome_cache_inputs")) {
+                const json &ci = merged["outcome_cache_inputs"];
+                if (ci.is_string())
+                    job.cache.inputs.push_back(ci.get<std::string>());
+                else
+                    job.cache.inputs = ci.get<std::vector<std::string>>();
+            }
+            if (!job.cache.path.empty() && !job.plan.enabled)
+                throw std::runtime_error("outcome_cache keeps outcomes of planned faults, it needs fault_plan");
+            if (job.cache.verify < 0.0 || job.cache.verify > 1.0)
+                throw std::runtime_error("outcome_cache_verify must be between 0 and 1");
+            job.profile.enabled   = merged.value("profile_guided", false);
+            job.profile.period_us = merged.value("profile_period_us", job.profile.period_us);
+            job.profile.runs      = merged.value("profile_runs", job.profile.runs);
+            job.profile.sites     = merged.value("profile_sites", job.profile.sites);
+            if (job.profile.enabled) {
+                // the site and its execution replace the delay and the victim thread
+                if (job.plan.enabled || job.strata.enabled)
+                    throw std::runtime_error("profile_guided draws sites, not delays: "
+                                             "no fault_plan or stratify with it");
+                if (p.target_pc_present || p.all_threads)
+                    throw std::runtime_error("profile_guided flips in the thread at the site, "
+                                             "no pc or all_threads with it");
+                if (job.profile.period_us <= 0 || job.profile.runs <= 0 || job.profile.sites <= 0)
+                    throw std::runtime_error("profile_period_us, profile_runs and profile_sites must be positive");
+            }
+            job.telemetry_file        = telemetry_file;
+            job.telemetry_socket      = telemetry_socket;
+            job.telemetry_interval_ms = telemetry_interval_ms;
             jobs.push_back(job);
         }
     }
@@ -130,7 +247,7 @@ std::vector<FijJob> build_fij_jobs_from_config(const json &config) {
     return jobs;
 }
 
-std::vector<FijJob> load_fij_jobs_from_file(const std::string &config_path) {
+json load_config_file(const std::string &config_path) {
     std::ifstream ifs(config_path);
     if (!ifs) {
         throw std::runtime_error("Cannot open config file: " + config_path);
@@ -147,6 +264,9 @@ std::vector<FijJob> load_fij_jobs_from_file(const std::string &config_path) {
         text += "\n";
     }
 
-    json cfg = json::parse(text);
-    return build_fij_jobs_from_config(cfg);
+    return json::parse(text);
+}
+
+std::vector<FijJob> load_fij_jobs_from_file(const std::string &config_path) {
+    return build_fij_jobs_from_config(load_config_file(config_path));
 }
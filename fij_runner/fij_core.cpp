@@ -186,8 +186,20 @@ void fij_params_apply_defaults(struct fij_params &p) {
     p.all_threads     = norm_bool(p.all_threads);
     p.process_present = norm_bool(p.process_present);
     p.no_injection    = norm_bool(p.no_injection);
+    p.hang_detect     = norm_bool(p.hang_detect);
+    p.watch_masked    = norm_bool(p.watch_masked);
+    p.reg_prefilter   = norm_bool(p.reg_prefilter);
+    p.perf_counters   = norm_bool(p.perf_counters);
+    p.capture_output  = norm_bool(p.capture_output);
 
     if (p.weight_mem < 0) p.weight_mem = 0;
+    if (p.hang_window_ms < 0) p.hang_window_ms = 0;
+    if (p.hang_pc_span < 0) p.hang_pc_span = 0;
+    if (p.reg_prefilter_window < 0) p.reg_prefilter_window = 0;
+    if (p.capture_bytes < 0) p.capture_bytes = 0;
+    if (p.digest_mode < FIJ_DIGEST_OFF || p.digest_mode > FIJ_DIGEST_COMPARE)
+        p.digest_mode = FIJ_DIGEST_OFF;
+    if (p.delay_clock != FIJ_DELAY_CPU) p.delay_clock = FIJ_DELAY_WALL;
 
     if (p.target_reg == 0) p.target_reg = FIJ_REG_NONE;
 
@@ -275,17 +287,40 @@ fs::path create_dir_in_path(const fs::path &base_path, const std::string &final_
     }
 }
 
+// -----------------------------------------------------------------------------
+// expand_run_placeholders
+// -----------------------------------------------------------------------------
+
+std::string expand_run_placeholders(std::string s, const std::string &campaign, int run) {
+    const std::string campaign_placeholder = "{campaign}";
+    const std::string run_placeholder      = "{run}";
+    const std::string run_str              = std::to_string(run);
+
+    std::size_t pos = 0;
+    while ((pos = s.find(campaign_placeholder, pos)) != std::string::npos) {
+        s.replace(pos, campaign_placeholder.size(), campaign);
+        pos += campaign.size();
+    }
+    pos = 0;
+    while ((pos = s.find(run_placeholder, pos)) != std::string::npos) {
+        s.replace(pos, run_placeholder.size(), run_str);
+        pos += run_str.size();
+    }
+    return s;
+}
+
 // -----------------------------------------------------------------------------
 // log_injection_iteration
 // -----------------------------------------------------------------------------
 
 void log_injection_iteration(
-    const fs::path &base_path,
+    const fs::path &folder,
     int i,
     double dt_seconds,
-    const struct fij_result &res
+    const struct fij_result &res,
+    bool outputs_retained,
+    const json &extra
 ) {
-    fs::path folder = base_path / ("injection_" + std::to_string(i));
     fs::create_directories(folder);
 
     json raw_result;
@@ -299,6 +334,7 @@ void log_injection_iteration(
     raw_result["pid_idx"]           = res.pid_idx;
     raw_result["thread_idx"]        = res.thread_idx;
     raw_result["injection_time_ns"] = static_cast<std::uint64_t>(res.injection_time_ns);
+    raw_result["injection_cpu_ns"]  = static_cast<std::uint64_t>(res.injection_cpu_ns);
     raw_result["memory_flip"]       = res.memory_flip;
 
     auto to_hex64 = [](std::uint64_t v) {
@@ -314,10 +350,91 @@ void log_injection_iteration(
     raw_result["target_address"] = to_hex64(addr);
     raw_result["target_before"]  = to_hex64(before);
     raw_result["target_after"]   = to_hex64(after);
+    if (res.memory_flip) {
+        static const char *regions[FIJ_MEM_REGIONS] = {
+            "any", "text", "rodata", "data", "heap", "stack", "anon",
+        };
+        int r = res.mem_region;
+        raw_result["mem_region"] = r >= 0 && r < FIJ_MEM_REGIONS ? regions[r] : "any";
+    }
 
     raw_result["register_name"] =
         cstr_from_fixed(res.register_name, sizeof(res.register_name));
 
+    raw_result["hang_detected"] = res.hang_detected;
+    if (res.hang_detected) {
+        raw_result["hang_pc_lo"] = to_hex64(res.hang_pc_lo);
+        raw_result["hang_pc_hi"] = to_hex64(res.hang_pc_hi);
+    }
+
+    raw_result["watch_status"] = res.watch_status;
+    if (res.watch_status == FIJ_WATCH_READ || res.watch_status == FIJ_WATCH_MASKED)
+        raw_result["watch_pc"] = to_hex64(res.watch_pc);
+
+    if (res.ts_roi_start || res.roi_missed) {
+        json roi;
+        roi["start_ns"] = static_cast<std::uint64_t>(res.ts_roi_start);
+        roi["end_ns"]   = static_cast<std::uint64_t>(res.ts_roi_end);
+        std::uint64_t end = res.ts_roi_end ? res.ts_roi_end : res.ts_exit;
+        roi["wall_ns"]  = res.ts_roi_start && end > res.ts_roi_start
+            ? static_cast<std::uint64_t>(end - res.ts_roi_start) : 0;
+        roi["cpu_ns"]   = static_cast<std::uint64_t>(res.roi_cpu_ns);
+        roi["missed"]   = res.roi_missed;
+        raw_result["roi"] = roi;
+    }
+    // executions of the profiled site the run saw, the flip at one of them
+    if (res.trigger_hits)
+        raw_result["trigger_hits"] = static_cast<std::uint64_t>(res.trigger_hits);
+
+    raw_result["regs_dead"]    = res.regs_dead;
+    raw_result["regs_skipped"] = res.regs_skipped;
+
+    raw_result["converged"] = res.converged;
+    if (res.converged)
+        raw_result["converged_idx"] = res.converged_idx;
+
+    if (res.sigal == SIGSEGV || res.sigal == SIGBUS)
+        raw_result["fault_addr"] = to_hex64(res.fault_addr);
+
+    json ts;
+    ts["exec_start"]   = static_cast<std::uint64_t>(res.ts_exec_start);
+    ts["exec_done"]    = static_cast<std::uint64_t>(res.ts_exec_done);
+    ts["resume"]       = static_cast<std::uint64_t>(res.ts_resume);
+    ts["flip_start"]   = static_cast<std::uint64_t>(res.ts_flip_start);
+    ts["flip_stopped"] = static_cast<std::uint64_t>(res.ts_flip_stopped);
+    ts["flip_end"]     = static_cast<std::uint64_t>(res.ts_flip_end);
+    ts["exit"]         = static_cast<std::uint64_t>(res.ts_exit);
+    ts["monitor_done"] = static_cast<std::uint64_t>(res.ts_monitor_done);
+    ts["collect"]      = static_cast<std::uint64_t>(res.ts_collect);
+    raw_result["timestamps_ns"] = ts;
+
+    json ru;
+    ru["utime_ns"]  = static_cast<std::uint64_t>(res.utime_ns);
+    ru["stime_ns"]  = static_cast<std::uint64_t>(res.stime_ns);
+    ru["cpu_ns"]    = static_cast<std::uint64_t>(res.cpu_ns);
+    ru["maxrss_kb"] = static_cast<std::uint64_t>(res.maxrss_kb);
+    ru["min_flt"]   = static_cast<std::uint64_t>(res.min_flt);
+    ru["maj_flt"]   = static_cast<std::uint64_t>(res.maj_flt);
+    ru["nvcsw"]     = static_cast<std::uint64_t>(res.nvcsw);
+    ru["nivcsw"]    = static_cast<std::uint64_t>(res.nivcsw);
+    if (res.perf_source == FIJ_PERF_HW) {
+        ru["instructions"] = static_cast<std::uint64_t>(res.perf_instructions);
+        ru["cycles"]       = static_cast<std::uint64_t>(res.perf_cycles);
+    } else if (res.perf_source == FIJ_PERF_SW) {
+        ru["task_clock_ns"] = static_cast<std::uint64_t>(res.perf_task_clock_ns);
+    }
+    raw_result["rusage"] = ru;
+    raw_result["cpu_budget_exceeded"] = res.cpu_budget_exceeded;
+
+    if (res.capture_total || res.capture_hash) {
+        json cap;
+        cap["total"] = static_cast<std::uint64_t>(res.capture_total);
+        cap["hash"]  = to_hex64(res.capture_hash);
+        cap["head"]  = res.capture_head;
+        cap["tail"]  = res.capture_tail;
+        raw_result["capture"] = cap;
+    }
+
     json payload;
     payload["iteration"]   = i;
 
@@ -335,12 +452,34 @@ void log_injection_iteration(
 
     payload["duration_ms"] = dt_seconds * 1000.0;
     payload["result"]      = raw_result;
+    if (!outputs_retained) payload["outputs_retained"] = false;
+    for (const auto &[key, value] : extra.items()) payload[key] = value;
 
     fs::path out_file = folder / ("injection_" + std::to_string(i) + ".json");
     std::ofstream ofs(out_file);
     ofs << std::setw(2) << payload << std::endl;
 }
 
+// -----------------------------------------------------------------------------
+// write_captured_log
+// -----------------------------------------------------------------------------
+
+void write_captured_log(const fs::path &path, const std::string &output, const struct fij_result &res) {
+    std::ofstream out(path, std::ios::binary);
+    std::size_t head = std::min<std::size_t>(res.capture_head, output.size());
+    out.write(output.data(), static_cast<std::streamsize>(head));
+
+    // the hash covers the dropped middle too, so two logs are equal only if
+    // the whole outputs were
+    std::uint64_t dropped = res.capture_total - res.capture_head - res.capture_tail;
+    if (dropped > 0) {
+        out << "\n[fij: " << dropped << " of " << res.capture_total
+            << " bytes not kept, xxh64 0x" << std::hex << std::setw(16) << std::setfill('0')
+            << res.capture_hash << std::dec << "]\n";
+    }
+    out.write(output.data() + head, static_cast<std::streamsize>(output.size() - head));
+}
+
 // -----------------------------------------------------------------------------
 // label_from_params
 // -----------------------------------------------------------------------------
@@ -0,0 +1,192 @@
+#include "fij.hpp"
+
+#include <fij_fingerprint.h>
+
+#include <sys/mman.h>
+
+// -----------------------------------------------------------------------------
+// Output fingerprints
+// -----------------------------------------------------------------------------
+//
+// With fingerprint_outputs every run is started with libfij_preload.so in
+// LD_PRELOAD and a shared memory slot of its own. The library hashes what
+// the target writes to the matching outputs, so the runner and the analyzer
+// compare a run with golden from a few numbers instead of reading its files
+// back. The golden fingerprints are the baseline run's, kept only for the
+// outputs whose hash equals the file on disk; the others are compared by
+// reading them, as before.
+
+FingerprintSlot::FingerprintSlot(const std::string &slot_name) : name(slot_name) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+
+    if (ftruncate(fd, sizeof(struct fij_fp_slot)) < 0) {
+        int err = errno;
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::system_error(err, std::generic_category(), "ftruncate " + name);
+    }
+
+    void *m = mmap(nullptr, sizeof(struct fij_fp_slot), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        int err = errno;
+        shm_unlink(name.c_str());
+        throw std::system_error(err, std::generic_category(), "mmap " + name);
+    }
+
+    map = m;
+    static_cast<struct fij_fp_slot *>(map)->magic = FIJ_FP_MAGIC;
+}
+
+FingerprintSlot::~FingerprintSlot() {
+    if (map) munmap(map, sizeof(struct fij_fp_slot));
+    shm_unlink(name.c_str());
+}
+
+FingerprintMap FingerprintSlot::read() const {
+    const auto *slot = static_cast<const struct fij_fp_slot *>(map);
+    FingerprintMap fp;
+
+    std::uint32_t n = std::min<std::uint32_t>(slot->nfiles, FIJ_FP_MAX_FILES);
+    for (std::uint32_t k = 0; k < n; ++k) {
+        const struct fij_fp_file &f = slot->files[k];
+        OutputFingerprint o;
+        o.bytes   = f.bytes;
+        o.hash    = f.hash;
+        o.ordered = !(f.flags & FIJ_FP_UNORDERED);
+        o.sunk    = f.flags & FIJ_FP_SUNK;
+        o.stdio   = f.flags & FIJ_FP_STDIO;
+        fp[fs::path(cstr_from_array(f.name)).filename().string()] = o;
+    }
+    return fp;
+}
+
+std::uint32_t FingerprintSlot::overflow() const {
+    return static_cast<const struct fij_fp_slot *>(map)->overflow;
+}
+
+std::string fingerprint_env(const FingerprintOptions &opt, const std::string &slot_name,
+                            bool sink, const std::string &campaign, int run) {
+    std::string paths;
+    for (const auto &pattern : opt.outputs) {
+        if (!paths.empty()) paths += ":";
+        paths += expand_run_placeholders(pattern, campaign, run);
+    }
+
+    // the module splits env_extra on spaces
+    std::string env = "LD_PRELOAD=" + fs::absolute(opt.lib).lexically_normal().string() +
+                      " " FIJ_FP_ENV_SHM "=" + slot_name +
+                      " " FIJ_FP_ENV_PATHS "=" + paths;
+    if (sink) env += " " FIJ_FP_ENV_SINK "=1";
+    return env;
+}
+
+FingerprintMap fingerprint_files(const fs::path &dir) {
+    FingerprintMap fp;
+    std::vector<char> buf(1 << 16);
+
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(dir, ec)) {
+        if (!entry.is_regular_file() || entry.path().extension() == ".json") continue;
+
+        std::ifstream in(entry.path(), std::ios::binary);
+        OutputFingerprint o;
+        o.hash = FIJ_FP_FNV_OFFSET;
+        while (in) {
+            in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+            std::size_t n = static_cast<std::size_t>(in.gcount());
+            o.hash = fij_fp_fnv1a(o.hash, buf.data(), n);
+            o.bytes += n;
+        }
+        fp[entry.path().filename().string()] = o;
+    }
+    return fp;
+}
+
+json fingerprint_to_json(const FingerprintMap &fp) {
+    json j = json::object();
+    for (const auto &[name, o] : fp) {
+        std::ostringstream hash;
+        hash << "0x" << std::hex << std::setw(16) << std::setfill('0') << o.hash;
+
+        json e;
+        e["bytes"] = o.bytes;
+        e["hash"]  = hash.str();
+        if (!o.ordered) e["ordered"] = false;
+        if (o.sunk)     e["sunk"]    = true;
+        j[name] = e;
+    }
+    return j;
+}
+
+FingerprintMap fingerprint_from_json(const json &j) {
+    FingerprintMap fp;
+    if (!j.is_object()) return fp;
+
+    for (const auto &[name, e] : j.items()) {
+        OutputFingerprint o;
+        o.bytes   = e.value("bytes", std::uint64_t{0});
+        o.hash    = std::stoull(e.value("hash", std::string("0")), nullptr, 16);
+        o.ordered = e.value("ordered", true);
+        o.sunk    = e.value("sunk", false);
+        fp[name] = o;
+    }
+    return fp;
+}
+
+void write_golden_fingerprint(const fs::path &campaign, const FingerprintMap &fp,
+                              const std::vector<std::string> &fallback) {
+    json doc;
+    doc["files"]    = fingerprint_to_json(fp);
+    doc["fallback"] = fallback;     // outputs the library could not follow, compared by reading
+    std::ofstream(campaign / "no_inj" / "fingerprint.json") << doc.dump(2) << "\n";
+}
+
+FingerprintMap load_golden_fingerprint(const fs::path &campaign) {
+    std::ifstream in(campaign / "no_inj" / "fingerprint.json");
+    if (!in.good()) return {};
+    try {
+        json doc;
+        in >> doc;
+        return fingerprint_from_json(doc.value("files", json::object()));
+    } catch (const std::exception &) {
+        return {};
+    }
+}
+
+OutputCheck check_run_output(const fs::path &golden_file, const fs::path &run_dir,
+                             const FingerprintMap &golden_fp, const FingerprintMap &run_fp,
+                             std::uint64_t *bytes) {
+    std::string name = golden_file.filename().string();
+    auto g = golden_fp.find(name);
+    auto r = run_fp.find(name);
+
+    if (g != golden_fp.end() && r != run_fp.end()) {
+        const OutputFingerprint &run = r->second;
+        if (run.ordered) {
+            bool same = run.bytes == g->second.bytes && run.hash == g->second.hash;
+            return same ? OutputCheck::Same : OutputCheck::Differs;
+        }
+        // rewritten in place and sunk: nothing left to compare, golden never did that
+        if (run.sunk) return OutputCheck::Differs;
+    }
+
+    fs::path run_file = run_dir / golden_file.filename();
+    if (!fs::exists(run_file)) return OutputCheck::Missing;
+    return are_files_identical_binary(golden_file, run_file, bytes) ? OutputCheck::Same
+                                                                     : OutputCheck::Differs;
+}
+
+bool run_outputs_match_golden(const fs::path &run_dir, const fs::path &golden_dir,
+                              const FingerprintMap &golden_fp, const FingerprintMap &run_fp) {
+    // the same comparison the analyzer makes, while the outputs are still at hand
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(golden_dir, ec)) {
+        if (entry.path().extension() == ".json") continue;
+        if (check_run_output(entry.path(), run_dir, golden_fp, run_fp) != OutputCheck::Same)
+            return false;
+    }
+    return !ec;     // no golden outputs to compare with
+}
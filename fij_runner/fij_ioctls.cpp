@@ -1,4 +1,5 @@
 #include "fij_ioctls.hpp"
+#include "fij_telemetry.hpp"
 
 #include <chrono>
 #include <iostream>
@@ -71,7 +72,11 @@ std::pair<double, struct fij_result> run_send_and_poll(
     int pre_delay_ms,
     int max_retries,
     int retry_delay_ms,
-    int poll_interval_ms
+    int poll_interval_ms,
+    JobTelemetry *telemetry,
+    std::string *output,
+    int window_max_ms,
+    RunProfile *profile
 ) {
 
     if (pre_delay_ms > 0) {
@@ -79,13 +84,15 @@ std::pair<double, struct fij_result> run_send_and_poll(
     }
 
     base_params.no_injection = no_injection;
-    base_params.max_delay_ms = max_delay_ms;
+    // max_delay_ms still sets the kill deadline below
+    base_params.max_delay_ms = window_max_ms > 0 ? window_max_ms : max_delay_ms;
 
     auto start = std::chrono::steady_clock::now();
     int fd = ::open(device.c_str(), O_RDWR);
     if (fd == -1) {
         throw std::system_error(errno, std::generic_category(), "open");
     }
+    TelemetryGauge in_flight(telemetry ? &telemetry->in_flight : nullptr);
 
     try {
         int attempt = 0;
@@ -93,6 +100,7 @@ std::pair<double, struct fij_result> run_send_and_poll(
             if (::ioctl(fd, IOCTL_SEND_MSG, &base_params) == -1) {
                 if (errno == EBUSY && attempt < max_retries) {
                     ++attempt;
+                    if (telemetry) telemetry->ebusy_retries++;
                     std::this_thread::sleep_for(std::chrono::milliseconds(retry_delay_ms));
                     continue;
                 }
@@ -110,6 +118,7 @@ std::pair<double, struct fij_result> run_send_and_poll(
                 ioctl(fd, IOCTL_KILL_TARGET);
                 std::cout << "Iteration " << iteration_index << " : Process is being killed\n";
                 killed = 1;
+                if (telemetry) telemetry->kills++;
             }
 
             if (::ioctl(fd, IOCTL_RECEIVE_MSG, &result) == -1) {
@@ -119,6 +128,7 @@ std::pair<double, struct fij_result> run_send_and_poll(
                 }
                 if (errno == EBUSY && max_retries > 0) {
                     --max_retries;
+                    if (telemetry) telemetry->ebusy_retries++;
                     std::this_thread::sleep_for(std::chrono::milliseconds(retry_delay_ms));
                     continue;
                 }
@@ -127,6 +137,35 @@ std::pair<double, struct fij_result> run_send_and_poll(
             break;
         }
 
+        // head and tail of what the target printed, kept by the module
+        if (output && base_params.capture_output) {
+            output->assign(result.capture_head + result.capture_tail, '\0');
+            struct fij_output out{};
+            out.buf  = reinterpret_cast<__u64>(output->data());
+            out.size = static_cast<__u32>(output->size());
+            ioctl_checked(fd, IOCTL_GET_OUTPUT, &out);
+            output->resize(out.len);
+        }
+
+        // PC samples and the files they fall in
+        if (profile && base_params.profile_period_us > 0) {
+            std::vector<char> paths(static_cast<std::size_t>(FIJ_PROFILE_MAX_FILES) * FIJ_PROBE_PATH);
+            profile->samples.resize(result.profile_samples);
+            struct fij_profile prof{};
+            prof.samples     = reinterpret_cast<__u64>(profile->samples.data());
+            prof.files       = reinterpret_cast<__u64>(paths.data());
+            prof.max_samples = result.profile_samples;
+            prof.max_files   = FIJ_PROFILE_MAX_FILES;
+            ioctl_checked(fd, IOCTL_GET_PROFILE, &prof);
+            profile->samples.resize(prof.nsamples);
+            profile->files.clear();
+            for (__u32 k = 0; k < prof.nfiles; ++k) {
+                const char *path = paths.data() + static_cast<std::size_t>(k) * FIJ_PROBE_PATH;
+                profile->files.emplace_back(path, strnlen(path, FIJ_PROBE_PATH));
+            }
+            profile->dropped = result.profile_dropped;
+        }
+
         auto end = std::chrono::steady_clock::now();
         double dt = std::chrono::duration<double>(end - start).count();
         ::close(fd);
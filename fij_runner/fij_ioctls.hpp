@@ -28,7 +28,11 @@ std::pair<double, struct fij_result> run_send_and_poll(
     int pre_delay_ms     = 0,
     int max_retries      = 5,
     int retry_delay_ms   = 50,
-    int poll_interval_ms = 1
+    int poll_interval_ms = 1,
+    JobTelemetry *telemetry = nullptr,
+    std::string *output     = nullptr,  // captured stdout/stderr (capture_output)
+    int window_max_ms       = 0,        // top of the injection window if below max_delay_ms
+    RunProfile *profile     = nullptr   // PC samples (profile_period_us)
 );
 
 } // namespace fij_detail
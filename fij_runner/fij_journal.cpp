@@ -0,0 +1,210 @@
+#include "fij.hpp"
+
+// -----------------------------------------------------------------------------
+// Campaign journal
+// -----------------------------------------------------------------------------
+//
+// <campaign>/journal.jsonl is appended to as the campaign goes: a "campaign"
+// record with the configuration hash and the run count, one "baseline"
+// record with the golden runs once their outputs are persisted, and one
+// "run" record per injected run once its JSON is written. Each record is
+// synced before the next run can depend on it, so after a crash or a reboot
+// the journal lists exactly the work that does not have to be redone. A
+// torn last line is ignored.
+
+CampaignJournal::CampaignJournal(const fs::path &campaign) {
+    fs::path p = campaign / "journal.jsonl";
+    fd = ::open(p.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "open " + p.string());
+}
+
+CampaignJournal::~CampaignJournal() {
+    if (fd >= 0) ::close(fd);
+}
+
+void CampaignJournal::append(const json &record) {
+    std::string line = record.dump() + "\n";
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const char *p = line.data();
+        std::size_t left = line.size();
+        while (left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "journal write");
+            }
+            p += n;
+            left -= static_cast<std::size_t>(n);
+        }
+    }
+    // outside the lock: workers sync concurrently
+    if (::fdatasync(fd) < 0)
+        throw std::system_error(errno, std::generic_category(), "journal fdatasync");
+}
+
+std::string campaign_config_hash(const struct fij_params &p, int baseline_runs,
+                                 const RetentionPolicy &retention,
+                                 const FingerprintOptions &fingerprint,
+                                 const StrataOptions &strata,
+                                 const PlanOptions &plan,
+                                 const ProfileOptions &profile) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&h](const void *data, std::size_t n) {
+        const unsigned char *b = static_cast<const unsigned char *>(data);
+        for (std::size_t k = 0; k < n; ++k) {
+            h ^= b[k];
+            h *= 0x100000001b3ULL;
+        }
+    };
+
+    struct fij_params params = p;
+    params.iteration_number = 0;
+    mix(&params, sizeof(params));
+
+    // a journal from another build cannot be decoded
+    std::uint64_t result_size = sizeof(struct fij_result);
+    mix(&result_size, sizeof(result_size));
+
+    mix(&baseline_runs, sizeof(baseline_runs));
+    mix(&retention.shard_size, sizeof(retention.shard_size));
+    for (const auto &pattern : fingerprint.outputs) mix(pattern.data(), pattern.size() + 1);
+    mix(&fingerprint.sink, sizeof(fingerprint.sink));
+
+    // stratified runs draw their faults differently; unstratified hashes stay as they were
+    if (strata.enabled) {
+        int cells[4] = {strata.bit_bins, strata.time_bins, strata.per_register, strata.mem_regions};
+        mix(cells, sizeof(cells));
+    }
+    // and so do planned runs: a plan from another seed is another campaign
+    if (plan.enabled) mix(&plan.seed, sizeof(plan.seed));
+    if (plan.enabled && plan.window_ms > 0) mix(&plan.window_ms, sizeof(plan.window_ms));
+    // profile-guided runs pick sites, not delays
+    if (profile.enabled) {
+        int cells[3] = {profile.period_us, profile.runs, profile.sites};
+        mix(cells, sizeof(cells));
+    }
+
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << h;
+    return oss.str();
+}
+
+std::string journal_encode_result(const struct fij_result &res) {
+    static const char digits[] = "0123456789abcdef";
+    const unsigned char *b = reinterpret_cast<const unsigned char *>(&res);
+    std::string hex;
+    hex.reserve(2 * sizeof(res));
+    for (std::size_t k = 0; k < sizeof(res); ++k) {
+        hex += digits[b[k] >> 4];
+        hex += digits[b[k] & 0xf];
+    }
+    return hex;
+}
+
+bool journal_decode_result(const std::string &hex, struct fij_result &res) {
+    if (hex.size() != 2 * sizeof(res)) return false;
+
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    unsigned char *b = reinterpret_cast<unsigned char *>(&res);
+    for (std::size_t k = 0; k < sizeof(res); ++k) {
+        int hi = nibble(hex[2 * k]), lo = nibble(hex[2 * k + 1]);
+        if (hi < 0 || lo < 0) return false;
+        b[k] = static_cast<unsigned char>((hi << 4) | lo);
+    }
+    return true;
+}
+
+JournalState load_campaign_journal(const fs::path &campaign) {
+    JournalState st;
+    std::ifstream in(campaign / "journal.jsonl");
+    if (!in.good()) return st;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        json rec;
+        try {
+            rec = json::parse(line);
+        } catch (const std::exception &) {
+            break;  // torn write of the last record
+        }
+
+        std::string type = rec.value("type", std::string());
+        if (type == "campaign") {
+            if (!st.found) st.config_hash = rec.value("config_hash", std::string());
+            st.found = true;
+            st.runs  = rec.value("runs", st.runs);
+        } else if (type == "baseline") {
+            std::vector<double> times = rec.value("times", std::vector<double>());
+            std::vector<struct fij_result> results;
+            for (const auto &hex : rec.value("results", std::vector<std::string>())) {
+                struct fij_result res;
+                if (!journal_decode_result(hex, res)) break;
+                results.push_back(res);
+            }
+            if (results.size() != times.size()) continue;   // written by another build
+
+            st.baseline_done          = true;
+            st.baseline_times         = std::move(times);
+            st.baseline_results       = std::move(results);
+            st.golden_run_fingerprint = rec.value("fingerprint", json::object());
+            st.golden_overflow        = rec.value("overflow", 0u);
+        } else if (type == "run") {
+            struct fij_result res;
+            if (!journal_decode_result(rec.value("result", std::string()), res)) continue;
+            JournaledRun &run = st.completed[rec.value("i", -1)];
+            run.dt        = rec.value("dt", 0.0);
+            run.result    = res;
+            run.run_class = rec.value("class", std::string());
+            run.stratum   = rec.value("stratum", -1);
+        }
+    }
+    st.completed.erase(-1);
+    return st;
+}
+
+fs::path find_campaign_to_resume(const fs::path &base, const std::string &folder,
+                                 const std::string &config_hash) {
+    // create_dir_in_path numbers the folders of repeated campaigns: folder, folder(1), ...
+    fs::path best;
+    int best_k = -1;
+
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(base, ec)) {
+        if (!entry.is_directory()) continue;
+        std::string name = entry.path().filename().string();
+
+        int k;
+        if (name == folder) {
+            k = 0;
+        } else if (name.size() > folder.size() + 2 && name.compare(0, folder.size(), folder) == 0 &&
+                   name[folder.size()] == '(' && name.back() == ')') {
+            std::string num = name.substr(folder.size() + 1, name.size() - folder.size() - 2);
+            if (num.find_first_not_of("0123456789") != std::string::npos) continue;
+            k = std::stoi(num);
+        } else {
+            continue;
+        }
+
+        if (k <= best_k) continue;
+
+        // the first record carries the hash, no need to read the runs
+        std::ifstream in(entry.path() / "journal.jsonl");
+        std::string first;
+        if (!std::getline(in, first)) continue;
+        try {
+            json rec = json::parse(first);
+            if (rec.value("config_hash", std::string()) != config_hash) continue;
+        } catch (const std::exception &) {
+            continue;
+        }
+        best   = fs::absolute(entry.path());
+        best_k = k;
+    }
+    return best;
+}
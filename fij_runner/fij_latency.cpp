@@ -0,0 +1,184 @@
+#include "fij.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// -----------------------------------------------------------------------------
+// Per-phase latency histograms
+// -----------------------------------------------------------------------------
+//
+// The kernel stamps every run with CLOCK_MONOTONIC timestamps (ts_* in
+// fij_result). Differences between consecutive stamps give the time spent in
+// each phase of the run; they are recorded in log-linear histograms (HDR
+// style: 16 linear sub-buckets per power of two, ~6% relative precision) so
+// tail latencies survive aggregation over thousands of runs.
+
+namespace {
+
+constexpr int kSubBits    = 4;
+constexpr int kSubBuckets = 1 << kSubBits;            // per power of two
+constexpr int kBuckets    = (64 - kSubBits + 1) * kSubBuckets;
+
+int bucket_of(std::uint64_t v) {
+    if (v < 2 * kSubBuckets) return static_cast<int>(v);
+    int msb   = 63 - __builtin_clzll(v);
+    int shift = msb - kSubBits;
+    int sub   = static_cast<int>(v >> shift);        // in [16, 32)
+    return (shift + 1) * kSubBuckets + (sub - kSubBuckets);
+}
+
+std::uint64_t bucket_lo(int idx) {
+    if (idx < 2 * kSubBuckets) return static_cast<std::uint64_t>(idx);
+    int shift = idx / kSubBuckets - 1;
+    std::uint64_t sub = static_cast<std::uint64_t>(idx % kSubBuckets + kSubBuckets);
+    return sub << shift;
+}
+
+std::uint64_t bucket_hi(int idx) {
+    if (idx < 2 * kSubBuckets) return static_cast<std::uint64_t>(idx);
+    int shift = idx / kSubBuckets - 1;
+    return bucket_lo(idx) + ((std::uint64_t{1} << shift) - 1);
+}
+
+struct LatencyHistogram {
+    std::vector<std::uint64_t> counts = std::vector<std::uint64_t>(kBuckets, 0);
+    std::uint64_t n   = 0;
+    std::uint64_t min = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max = 0;
+    double sum        = 0.0;
+
+    void record(std::uint64_t v) {
+        counts[bucket_of(v)]++;
+        n++;
+        min = std::min(min, v);
+        max = std::max(max, v);
+        sum += static_cast<double>(v);
+    }
+
+    // Highest value equivalent to the q-quantile's bucket, clamped to max
+    std::uint64_t percentile(double q) const {
+        if (n == 0) return 0;
+        std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(q * n));
+        if (rank == 0) rank = 1;
+        std::uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(bucket_hi(i), max);
+        }
+        return max;
+    }
+};
+
+struct Phase {
+    const char *name;
+    __u64 fij_result::*from;
+    __u64 fij_result::*to;
+};
+
+// Consecutive stamps first, then the spans that cover several of them
+const Phase kPhases[] = {
+    {"exec",         &fij_result::ts_exec_start,   &fij_result::ts_exec_done},
+    {"arm",          &fij_result::ts_exec_done,    &fij_result::ts_resume},
+    {"until_flip",   &fij_result::ts_resume,       &fij_result::ts_flip_start},
+    {"stop_wait",    &fij_result::ts_flip_start,   &fij_result::ts_flip_stopped},
+    {"flip",         &fij_result::ts_flip_stopped, &fij_result::ts_flip_end},
+    {"after_flip",   &fij_result::ts_flip_end,     &fij_result::ts_exit},
+    {"collect",      &fij_result::ts_exit,         &fij_result::ts_collect},
+    {"target",       &fij_result::ts_resume,       &fij_result::ts_exit},
+    {"kernel_total", &fij_result::ts_exec_start,   &fij_result::ts_collect},
+};
+
+struct PhaseSet {
+    std::string name;
+    std::map<std::string, LatencyHistogram> hist;
+};
+
+PhaseSet collect_phases(const std::string &name,
+                        const std::vector<struct fij_result> &results,
+                        const std::vector<double> &times_s) {
+    PhaseSet set;
+    set.name = name;
+
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        // failed runs are marked with a negative wall time
+        if (i < times_s.size() && times_s[i] < 0.0) continue;
+
+        const struct fij_result &r = results[i];
+        for (const Phase &p : kPhases) {
+            std::uint64_t a = r.*(p.from);
+            std::uint64_t b = r.*(p.to);
+            if (a == 0 || b == 0 || b < a) continue;   // phase not reached
+            set.hist[p.name].record(b - a);
+        }
+        if (i < times_s.size())
+            set.hist["wall"].record(static_cast<std::uint64_t>(times_s[i] * 1e9));
+    }
+    return set;
+}
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// write_latency_report
+// -----------------------------------------------------------------------------
+
+void write_latency_report(
+    const fs::path &out_dir,
+    const std::vector<struct fij_result> &baseline_results,
+    const std::vector<double> &baseline_times_s,
+    const std::vector<struct fij_result> &inj_results,
+    const std::vector<double> &inj_times_s,
+    bool verbose
+) {
+    std::vector<PhaseSet> sets;
+    sets.push_back(collect_phases("baseline", baseline_results, baseline_times_s));
+    sets.push_back(collect_phases("injection", inj_results, inj_times_s));
+
+    fs::create_directories(out_dir);
+
+    std::ofstream summary(out_dir / "latency.csv");
+    std::ofstream buckets(out_dir / "latency_hist.csv");
+    if (!summary || !buckets) {
+        std::cerr << "[latency] cannot write report in " << out_dir << "\n";
+        return;
+    }
+
+    summary << "set,phase,count,min_ns,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n";
+    buckets << "set,phase,bucket_lo_ns,bucket_hi_ns,count\n";
+
+    for (const PhaseSet &set : sets) {
+        for (const auto &[phase, h] : set.hist) {
+            if (h.n == 0) continue;
+            summary << set.name << "," << phase << "," << h.n << ","
+                    << h.min << ","
+                    << static_cast<std::uint64_t>(h.sum / h.n) << ","
+                    << h.percentile(0.50) << ","
+                    << h.percentile(0.90) << ","
+                    << h.percentile(0.99) << ","
+                    << h.percentile(0.999) << ","
+                    << h.max << "\n";
+
+            for (int i = 0; i < kBuckets; ++i) {
+                if (!h.counts[i]) continue;
+                buckets << set.name << "," << phase << ","
+                        << bucket_lo(i) << "," << bucket_hi(i) << ","
+                        << h.counts[i] << "\n";
+            }
+        }
+    }
+
+    if (verbose) {
+        std::cout << "Latency per phase (injection runs, p50 / p99 in us):\n";
+        for (const auto &[phase, h] : sets.back().hist) {
+            if (h.n == 0) continue;
+            std::cout << "  " << std::left << std::setw(13) << phase << std::right
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(12) << h.percentile(0.50) / 1e3 << " / "
+                      << std::setw(12) << h.percentile(0.99) / 1e3 << "\n";
+        }
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << "  written to " << (out_dir / "latency.csv") << "\n";
+    }
+}
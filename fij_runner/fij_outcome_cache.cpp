@@ -0,0 +1,258 @@
+#include "fij.hpp"
+
+#include <fij_fingerprint.h>
+
+#include <algorithm>
+
+// -----------------------------------------------------------------------------
+// Fault outcome cache (outcome_cache)
+// -----------------------------------------------------------------------------
+//
+// A planned fault is fully specified, and a target that is deterministic
+// under ASLR off and a fixed AT_RANDOM does the same thing every time it
+// meets it. With outcome_cache the runner keeps what every planned run did
+// in a JSONL file shared by campaigns: class, fij_result and duration under
+// a key of target, inputs and fault. A campaign whose plan reaches a fault
+// already in the file records that outcome instead of running it. With
+// outcome_cache_verify a share of those hits is run anyway and compared
+// with the entry; an entry that disagrees is marked nondeterministic, kept
+// in the file for the record and never used again.
+
+namespace {
+
+std::uint64_t fnv_mix(std::uint64_t h, const void *data, std::size_t n) {
+    return fij_fp_fnv1a(h, data, n);
+}
+
+std::uint64_t fnv_mix_str(std::uint64_t h, const std::string &s) {
+    return fnv_mix(h, s.c_str(), s.size() + 1);
+}
+
+std::uint64_t mix_file(std::uint64_t h, const fs::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("outcome_cache: cannot read " + path.string());
+
+    std::vector<char> buf(1 << 16);
+    std::uint64_t bytes = 0;
+    while (in) {
+        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+        std::size_t n = static_cast<std::size_t>(in.gcount());
+        h = fnv_mix(h, buf.data(), n);
+        bytes += n;
+    }
+    return fnv_mix(h, &bytes, sizeof(bytes));
+}
+
+// a file, or every file of a folder in name order
+std::uint64_t mix_input(std::uint64_t h, const fs::path &path) {
+    if (!fs::is_directory(path)) return mix_file(fnv_mix_str(h, path.string()), path);
+
+    std::vector<fs::path> files;
+    for (const auto &entry : fs::recursive_directory_iterator(path))
+        if (entry.is_regular_file()) files.push_back(entry.path());
+    std::sort(files.begin(), files.end());
+
+    for (const auto &f : files)
+        h = mix_file(fnv_mix_str(h, f.lexically_relative(path).string()), f);
+    return h;
+}
+
+std::string to_hex16(std::uint64_t v) {
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << v;
+    return oss.str();
+}
+
+json entry_to_json(const std::string &key, const CachedOutcome &e) {
+    json j;
+    j["key"]       = key;
+    j["class"]     = run_class_name(e.run_class);
+    j["exit_code"] = e.result.exit_code;
+    j["dt"]        = e.dt;
+    j["seen"]      = e.seen;
+    j["campaign"]  = e.campaign;
+    j["run"]       = e.run;
+    j["result"]    = journal_encode_result(e.result);
+    if (e.nondeterministic) j["nondeterministic"] = true;
+    return j;
+}
+
+bool entry_from_json(const json &j, std::string &key, CachedOutcome &e) {
+    if (!j.is_object() || !j.contains("key")) return false;
+    key = j.value("key", std::string());
+    if (!run_class_from_name(j.value("class", std::string()), e.run_class)) return false;
+    // written by a build with another fij_result: useless here
+    if (!journal_decode_result(j.value("result", std::string()), e.result)) return false;
+    e.dt               = j.value("dt", 0.0);
+    e.seen             = j.value("seen", 1);
+    e.nondeterministic = j.value("nondeterministic", false);
+    e.campaign         = j.value("campaign", std::string());
+    e.run              = j.value("run", -1);
+    return true;
+}
+
+} // namespace
+
+OutcomeCache::OutcomeCache(const OutcomeCacheOptions &o, const struct fij_params &base,
+                           double cpu_deadline_factor, const std::string &campaign)
+    : opt(o) {
+    // what decides an outcome, without what only names this campaign or run
+    struct fij_params p = base;
+    std::memset(p.log_path, 0, sizeof(p.log_path));
+    std::memset(p.digest_golden, 0, sizeof(p.digest_golden));
+    std::memset(&p.fault, 0, sizeof(p.fault));
+    p.digest_golden_count = 0;
+    p.cpu_budget_ns       = 0;      // measured by each baseline, the factor is what is asked
+    p.seed                = 0;      // nothing is left to draw once the fault is described
+    p.iteration_number    = 0;
+
+    std::uint64_t h = FIJ_FP_FNV_OFFSET;
+    h = fnv_mix(h, &p, sizeof(p));
+    h = fnv_mix(h, &cpu_deadline_factor, sizeof(cpu_deadline_factor));
+    std::uint64_t result_size = sizeof(struct fij_result);
+    h = fnv_mix(h, &result_size, sizeof(result_size));
+
+    h = mix_file(h, cstr_from_array(base.process_path));
+    // a region of interest may sit in a library, which then decides as much
+    if (base.roi_start.present) h = mix_file(h, cstr_from_array(base.roi_start.path));
+    if (base.roi_end.present)   h = mix_file(h, cstr_from_array(base.roi_end.path));
+
+    // arguments naming an existing file, alone or after '=': the output
+    // paths carry {campaign} or {run} and are left out
+    std::istringstream args(cstr_from_array(base.process_args));
+    std::string tok;
+    while (args >> tok) {
+        if (tok.find('{') != std::string::npos) continue;
+        std::string name = tok.substr(tok.find('=') + 1);
+        std::error_code ec;
+        if (!name.empty() && fs::is_regular_file(name, ec)) h = mix_input(h, name);
+    }
+    for (const auto &in : opt.inputs) {
+        if (!fs::exists(in))
+            throw std::runtime_error("outcome_cache_inputs: " + in + " does not exist");
+        h = mix_input(h, in);
+    }
+    target_hash = h;
+    verify_salt = fnv_mix_str(FIJ_FP_FNV_OFFSET, campaign);
+    campaign_name = campaign;
+
+    // later lines of a key supersede earlier ones, a torn last line is skipped
+    std::ifstream in(opt.path);
+    std::string line;
+    while (std::getline(in, line)) {
+        json j = json::parse(line, nullptr, false);
+        std::string key;
+        CachedOutcome e;
+        if (!j.is_discarded() && entry_from_json(j, key, e)) entries[key] = e;
+    }
+
+    fs::path dir = fs::path(opt.path).parent_path();
+    if (!dir.empty()) fs::create_directories(dir);
+    fd = ::open(opt.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "open " + opt.path);
+}
+
+OutcomeCache::~OutcomeCache() {
+    if (fd >= 0) ::close(fd);
+}
+
+std::string OutcomeCache::key(const FaultPlanRecord &r) const {
+    return to_hex16(fnv_mix(target_hash, &r.fault, sizeof(r.fault)));
+}
+
+bool OutcomeCache::lookup(const std::string &key, CachedOutcome &out) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = entries.find(key);
+    if (it == entries.end() || it->second.nondeterministic) {
+        misses++;
+        return false;
+    }
+    hits++;
+    out = it->second;
+    return true;
+}
+
+bool OutcomeCache::sampled_for_verify(const std::string &key) const {
+    if (opt.verify <= 0.0) return false;
+    // fixed per campaign and key, so a resumed campaign verifies the same runs
+    std::uint64_t h = fnv_mix_str(verify_salt, key);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;   // FNV alone is too regular on short keys
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return static_cast<double>(h >> 11) * 0x1.0p-53 < opt.verify;
+}
+
+void OutcomeCache::append(const json &record) {
+    // one write per line: O_APPEND keeps concurrent runners from interleaving
+    std::string line = record.dump() + "\n";
+    const char *p = line.data();
+    std::size_t left = line.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::system_error(errno, std::generic_category(), "outcome_cache write");
+        }
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+}
+
+void OutcomeCache::store(const std::string &key, RunClass c, const struct fij_result &res,
+                         double dt, int run) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = entries.find(key);
+    if (it != entries.end() && it->second.nondeterministic) return;     // stays untrusted
+
+    CachedOutcome e;
+    e.run_class = c;
+    e.result    = res;
+    e.dt        = dt;
+    e.seen      = 1;
+    e.campaign  = campaign_name;
+    e.run       = run;
+    entries[key] = e;
+    stored++;
+    append(entry_to_json(key, e));
+}
+
+bool OutcomeCache::verify(const std::string &key, const CachedOutcome &cached, RunClass c,
+                          const struct fij_result &res, int run) {
+    bool same = c == cached.run_class && res.exit_code == cached.result.exit_code &&
+                res.process_hanged == cached.result.process_hanged;
+
+    std::lock_guard<std::mutex> guard(lock);
+    verified++;
+    CachedOutcome &e = entries[key];
+    if (same) {
+        e.seen++;
+    } else {
+        e.nondeterministic = true;
+        mismatches.push_back({
+            {"run", run}, {"key", key},
+            {"cached", run_class_name(cached.run_class)}, {"observed", run_class_name(c)},
+            {"cached_exit_code", cached.result.exit_code}, {"observed_exit_code", res.exit_code},
+            {"first_seen", cached.campaign + " run " + std::to_string(cached.run)},
+        });
+    }
+    json rec = entry_to_json(key, e);
+    if (!same) rec["observed"] = run_class_name(c);
+    append(rec);
+    return same;
+}
+
+json OutcomeCache::report() const {
+    std::lock_guard<std::mutex> guard(lock);
+    json doc;
+    doc["path"]       = opt.path;
+    doc["target"]     = to_hex16(target_hash);
+    doc["entries"]    = entries.size();
+    doc["hits"]       = hits;
+    doc["misses"]     = misses;
+    doc["verify"]     = opt.verify;
+    doc["verified"]   = verified;
+    doc["stored"]     = stored;
+    doc["mismatches"] = mismatches;
+    return doc;
+}
@@ -0,0 +1,306 @@
+#include "fij.hpp"
+#include "fij_ioctls.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <unordered_set>
+
+// -----------------------------------------------------------------------------
+// Precomputed fault lists (fault_plan)
+// -----------------------------------------------------------------------------
+//
+// Without a plan the module draws every part of a fault itself, so no run
+// can be repeated and two runs may well flip the same thing. With
+// fault_plan the runner draws the faults once the baseline has fixed the
+// injection window: <campaign>/plan.bin holds one fully specified fault per
+// run (delay, victim process and thread, register or byte, bit mask), no
+// two alike, plus a seed for what the module still draws. Run i hands
+// record i to the module as fij_params.fault, which makes the module run
+// the target with ASLR off and a fixed AT_RANDOM, so the same record flips
+// the same bit again: fij_app CONFIG.json --replay i.
+
+namespace {
+
+const char kPlanMagic[8] = {'F', 'I', 'J', 'P', 'L', 'A', 'N', '1'};
+
+std::string to_hex64(std::uint64_t v) {
+    std::ostringstream oss;
+    oss << "0x" << std::setw(16) << std::setfill('0') << std::hex << v;
+    return oss.str();
+}
+
+// delay, kind, register, bits and byte: the victim selectors only matter
+// for multi-process or multi-threaded targets and do not make a fault new
+std::string fault_key(const struct fij_fault &f) {
+    std::uint64_t k[5] = {f.delay_us, f.flags, f.reg, f.mask, f.location};
+    return std::string(reinterpret_cast<const char *>(k), sizeof(k));
+}
+
+bool plan_usable(const fs::path &path, const FaultPlanHeader &want) {
+    std::ifstream in(path, std::ios::binary);
+    FaultPlanHeader h{};
+    if (!in.read(reinterpret_cast<char *>(&h), sizeof(h))) return false;
+
+    return std::memcmp(h.magic, kPlanMagic, sizeof(h.magic)) == 0 &&
+           h.record_size == want.record_size && h.count >= want.count && h.seed == want.seed &&
+           h.min_delay_ms == want.min_delay_ms && h.max_delay_ms == want.max_delay_ms;
+}
+
+} // namespace
+
+void prepare_fault_plan(const fs::path &path, const struct fij_params &base, int max_delay_ms,
+                        int count, std::uint64_t seed) {
+    FaultPlanHeader header{};
+    std::memcpy(header.magic, kPlanMagic, sizeof(header.magic));
+    header.record_size  = sizeof(FaultPlanRecord);
+    header.count        = static_cast<std::uint32_t>(count);
+    header.seed         = seed;
+    header.min_delay_ms = std::max(base.min_delay_ms, 0);
+    header.max_delay_ms = std::max(max_delay_ms, header.min_delay_ms);
+
+    // a resumed campaign keeps its plan, and so its faults
+    if (plan_usable(path, header)) return;
+
+    if (base.reg_bit_present && (base.reg_bit < 0 || base.reg_bit > 63))
+        throw std::invalid_argument("bit must be between 0 and 63");
+
+    // register or memory split the way the module's weight_mem draw makes it
+    double p_reg = 1.0;
+    if (base.only_mem)                        p_reg = 0.0;
+    else if (base.target_reg != FIJ_REG_NONE) p_reg = 1.0;
+    else if (base.weight_mem > 0)             p_reg = 1.0 / (1.0 + base.weight_mem);
+
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    // a uprobe at pc decides when, not the delay
+    std::uniform_int_distribution<std::uint64_t> delay_us(
+        base.target_pc_present ? 0 : 1000ULL * header.min_delay_ms,
+        base.target_pc_present ? 0 : 1000ULL * header.max_delay_ms);
+    std::uniform_int_distribution<int> any_reg(FIJ_REG_NONE + 1, FIJ_REG_MAX - 1);
+    std::uniform_int_distribution<int> reg_bit(0, 63);
+    std::uniform_int_distribution<int> byte_bit(0, 7);
+
+    std::vector<FaultPlanRecord> records;
+    records.reserve(count);
+    std::unordered_set<std::string> seen;
+
+    long long draws = 0;
+    const long long max_draws = 64LL * count + 1024;
+    while (static_cast<int>(records.size()) < count) {
+        if (++draws > max_draws) {
+            throw std::runtime_error("fault_plan: only " + std::to_string(records.size()) +
+                                     " distinct faults found for " + std::to_string(count) +
+                                     " runs, widen reg/bit/pc or lower runs");
+        }
+
+        FaultPlanRecord r;
+        std::memset(&r, 0, sizeof(r));
+        struct fij_fault &f = r.fault;
+        f.flags    = FIJ_FAULT_SET;
+        f.delay_us = delay_us(rng);
+        // selectors are taken modulo what exists at the flip
+        f.process_sel = base.process_present ? static_cast<std::uint32_t>(std::max(base.nprocess, 0))
+                                             : static_cast<std::uint32_t>(rng());
+        f.thread_sel  = base.thread_present && base.thread > 0
+                            ? static_cast<std::uint32_t>(base.thread - 1)
+                            : static_cast<std::uint32_t>(rng());
+
+        if (unit(rng) < p_reg) {
+            f.reg  = base.target_reg != FIJ_REG_NONE ? base.target_reg : any_reg(rng);
+            f.mask = 1ULL << (base.reg_bit_present ? base.reg_bit : reg_bit(rng));
+        } else {
+            f.flags   |= FIJ_FAULT_MEM;
+            f.location = rng();
+            f.mask     = 1ULL << byte_bit(rng);
+        }
+
+        if (!seen.insert(fault_key(f)).second) continue;
+        r.seed = rng() | 1;     // 0 would mean kernel randomness
+        records.push_back(r);
+    }
+
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(records.data()),
+                  static_cast<std::streamsize>(records.size() * sizeof(FaultPlanRecord)));
+        if (!out)
+            throw std::system_error(errno, std::generic_category(), "write " + tmp.string());
+    }
+    fs::rename(tmp, path);
+}
+
+// -----------------------------------------------------------------------------
+// FaultPlan
+// -----------------------------------------------------------------------------
+
+FaultPlan::FaultPlan(const fs::path &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "open " + path.string());
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "fstat " + path.string());
+    }
+    bytes = static_cast<std::size_t>(st.st_size);
+    if (bytes < sizeof(FaultPlanHeader)) {
+        ::close(fd);
+        throw std::runtime_error(path.string() + " is not a fault plan");
+    }
+
+    void *m = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED)
+        throw std::system_error(errno, std::generic_category(), "mmap " + path.string());
+    map = m;
+
+    const FaultPlanHeader &h = header();
+    if (std::memcmp(h.magic, kPlanMagic, sizeof(h.magic)) != 0 ||
+        h.record_size != sizeof(FaultPlanRecord) ||
+        bytes < sizeof(FaultPlanHeader) + static_cast<std::size_t>(h.count) * h.record_size) {
+        munmap(map, bytes);
+        map = nullptr;
+        throw std::runtime_error(path.string() + " was written by another build or is truncated");
+    }
+}
+
+FaultPlan::~FaultPlan() {
+    if (map) munmap(map, bytes);
+}
+
+const FaultPlanHeader &FaultPlan::header() const {
+    return *static_cast<const FaultPlanHeader *>(map);
+}
+
+std::size_t FaultPlan::size() const {
+    return header().count;
+}
+
+const FaultPlanRecord &FaultPlan::operator[](std::size_t i) const {
+    const char *records = static_cast<const char *>(map) + sizeof(FaultPlanHeader);
+    return reinterpret_cast<const FaultPlanRecord *>(records)[i];
+}
+
+void apply_planned_fault(struct fij_params &p, const FaultPlanRecord &r) {
+    p.fault = r.fault;
+    p.seed  = r.seed;
+}
+
+json planned_fault_to_json(const FaultPlanRecord &r, int index) {
+    const struct fij_fault &f = r.fault;
+    json j;
+    j["plan_index"]  = index;
+    j["kind"]        = (f.flags & FIJ_FAULT_MEM) ? "memory" : "register";
+    j["delay_us"]    = static_cast<std::uint64_t>(f.delay_us);
+    j["process_sel"] = f.process_sel;
+    j["thread_sel"]  = f.thread_sel;
+    if (f.flags & FIJ_FAULT_MEM)
+        j["location"] = to_hex64(f.location);
+    else
+        j["reg"] = f.reg;
+    j["mask"] = to_hex64(f.mask);
+    j["seed"] = to_hex64(r.seed);
+    return j;
+}
+
+// -----------------------------------------------------------------------------
+// replay_planned_run – fij_app CONFIG.json --replay N
+// -----------------------------------------------------------------------------
+
+void replay_planned_run(const std::string &device, const FijJob &job, int run,
+                        int pre_delay_ms, int max_retries, int retry_delay_ms, bool verbose) {
+    if (!job.plan.enabled)
+        throw std::invalid_argument("--replay needs fault_plan in the configuration");
+
+    // the hash run_injection_campaign journaled, baseline_runs raised the same way
+    std::string config_hash = campaign_config_hash(job.params, std::max(job.baseline_runs, 3),
+                                                   job.retention, job.fingerprint, job.strata,
+                                                   job.plan);
+    std::string label = label_from_params(job.params);
+    fs::path campaign = find_campaign_to_resume("../fij_logs", campaign_folder_name(job.params),
+                                                config_hash);
+    if (campaign.empty())
+        throw std::runtime_error("No planned campaign of " + label + " to replay from");
+
+    FaultPlan plan(campaign / "plan.bin");
+    if (run < 0 || static_cast<std::size_t>(run) >= plan.size()) {
+        throw std::out_of_range("Run " + std::to_string(run) + " is not in the plan of " +
+                                campaign.string() + " (" + std::to_string(plan.size()) + " runs)");
+    }
+    int max_delay_ms = plan.header().max_delay_ms;
+
+    fs::path run_dir = campaign / "replay" / ("injection_" + std::to_string(run));
+    fs::remove_all(run_dir);
+    fs::create_directories(run_dir);
+
+    std::string campaign_str = run_dir.parent_path().string();
+    struct fij_params p = job.params;
+    set_cstring(p.process_args,
+                expand_run_placeholders(cstr_from_array(job.params.process_args), campaign_str, run));
+    fs::path run_log_path = run_dir / "log.txt";
+    set_cstring(p.log_path, run_log_path.string());
+    p.iteration_number = run;
+    if (p.hang_detect && p.hang_window_ms == 0) p.hang_window_ms = 2 * max_delay_ms;
+    // let the fault play out: nothing to compare digests with, no early kill
+    p.digest_mode  = FIJ_DIGEST_OFF;
+    p.watch_masked = 0;
+    apply_planned_fault(p, plan[run]);
+
+    if (verbose) {
+        std::cout << "[+] Replaying run " << run << " of " << campaign << "\n"
+                  << "    fault = " << planned_fault_to_json(plan[run], run).dump() << "\n";
+    }
+
+    std::string output;
+    auto [dt, res] = fij_detail::run_send_and_poll(device, p, run, max_delay_ms, 0, pre_delay_ms,
+                                                   max_retries, retry_delay_ms, 1, nullptr,
+                                                   &output);
+    if (p.capture_output) write_captured_log(run_log_path, output, res);
+
+    bool outputs_same = true;
+    if (res.exit_code == 0)
+        outputs_same = run_outputs_match_golden(run_dir, campaign / "no_inj" / "injection_0", {}, {});
+    RunClass run_class = classify_run(res, outputs_same);
+
+    json replay;
+    replay["campaign"] = campaign.string();
+    replay["class"]    = run_class_name(run_class);
+
+    JournalState journal = load_campaign_journal(campaign);
+    auto done = journal.completed.find(run);
+    bool same_fault = false;
+    if (done != journal.completed.end()) {
+        const struct fij_result &orig = done->second.result;
+        same_fault = res.fault_injected == orig.fault_injected &&
+                     res.memory_flip == orig.memory_flip &&
+                     res.pid_idx == orig.pid_idx && res.thread_idx == orig.thread_idx &&
+                     res.target_address == orig.target_address &&
+                     res.target_before == orig.target_before &&
+                     res.target_after == orig.target_after &&
+                     std::strncmp(res.register_name, orig.register_name,
+                                  sizeof(res.register_name)) == 0;
+        replay["same_fault"]         = same_fault;
+        replay["campaign_exit_code"] = orig.exit_code;
+        if (!done->second.run_class.empty()) replay["campaign_class"] = done->second.run_class;
+    }
+
+    json extra;
+    extra["fault"]  = planned_fault_to_json(plan[run], run);
+    extra["replay"] = replay;
+    log_injection_iteration(run_dir, run, dt, res, true, extra);
+
+    std::cout << "  Replay of run " << run << ": "
+              << (res.fault_injected ? "fault injected" : "no fault injected")
+              << ", exit code " << res.exit_code << ", " << run_class_name(run_class);
+    if (done == journal.completed.end())
+        std::cout << " (the campaign has no record of this run)\n";
+    else
+        std::cout << (same_fault ? ", same fault as the campaign run\n"
+                                 : ", the fault differs from the campaign run\n");
+}
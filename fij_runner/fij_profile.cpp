@@ -0,0 +1,248 @@
+#include "fij.hpp"
+#include "fij_ioctls.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+
+// -----------------------------------------------------------------------------
+// Profile-guided injection sites (profile_guided)
+// -----------------------------------------------------------------------------
+//
+// A random delay puts faults wherever the clock happens to be, and says
+// nothing about which code was running. With profile_guided the golden
+// runs are sampled first: the module reads the user PC of the running
+// threads every profile_period_us and reports it as an offset into the
+// executable or library mapped there. The most sampled offsets become the
+// injection sites, weighted by their samples, i.e. by the time spent there.
+// One more golden run per site counts how often the site is executed. An
+// injected run then draws a site by weight and one of its executions
+// uniformly, and the module flips in the thread that reaches it, right
+// before the instruction. Every fault is tied to an instruction and a
+// function, and hot code gets faults in proportion to its time.
+
+namespace {
+
+std::uint64_t splitmix64(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+std::string to_hex(std::uint64_t v) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << v;
+    return oss.str();
+}
+
+json site_to_json(const ProfileSite &s) {
+    json j;
+    j["path"]     = s.path;
+    j["offset"]   = to_hex(s.offset);
+    j["function"] = s.function;
+    j["function_offset"] = to_hex(s.function_offset);
+    j["samples"]  = s.samples;
+    j["hits"]     = s.hits;
+    return j;
+}
+
+ProfileSite site_from_json(const json &j) {
+    ProfileSite s;
+    s.path     = j.value("path", std::string());
+    s.offset   = std::stoull(j.value("offset", std::string("0")), nullptr, 0);
+    s.function = j.value("function", std::string());
+    s.function_offset = std::stoull(j.value("function_offset", std::string("0")), nullptr, 16);
+    s.samples  = j.value("samples", std::uint64_t{0});
+    s.hits     = j.value("hits", std::uint64_t{0});
+    return s;
+}
+
+// golden run with the module's extras set, outputs in scratch/run_<k>
+struct fij_result golden_run(const std::string &device, struct fij_params p,
+                             const fs::path &scratch, int k, int pre_delay_ms,
+                             int max_retries, int retry_delay_ms, RunProfile *profile) {
+    fs::path run_dir = scratch / ("run_" + std::to_string(k));
+    fs::create_directories(run_dir);
+
+    std::string args = expand_run_placeholders(cstr_from_array(p.process_args),
+                                               scratch.string(), k);
+    set_cstring(p.process_args, args);
+    set_cstring(p.log_path, (run_dir / "log.txt").string());
+    p.iteration_number = k;
+
+    auto [dt, res] = fij_detail::run_send_and_poll(
+        device, p, k,
+        0,              // max_delay_ms (unused, no injection)
+        1,              // no_injection = 1
+        pre_delay_ms, max_retries, retry_delay_ms,
+        1,              // poll_interval_ms
+        nullptr, nullptr, 0, profile);
+    (void)dt;
+
+    std::error_code ec;
+    fs::remove_all(run_dir, ec);
+    return res;
+}
+
+} // namespace
+
+std::pair<int, std::uint64_t> SiteProfile::draw(std::uint64_t seed, int run, int attempt) const {
+    std::uint64_t total = 0;
+    for (const auto &s : sites) total += s.samples;
+    if (sites.empty() || total == 0) return {-1, 0};
+
+    // fixed by campaign, run and attempt: a resumed campaign draws the same sites
+    std::uint64_t h = splitmix64(seed ^ splitmix64((static_cast<std::uint64_t>(run) << 20) ^
+                                                   static_cast<std::uint64_t>(attempt)));
+    std::uint64_t pick = h % total;
+    int site = 0;
+    for (; site < static_cast<int>(sites.size()) - 1; ++site) {
+        if (pick < sites[site].samples) break;
+        pick -= sites[site].samples;
+    }
+    std::uint64_t hit = 1 + splitmix64(h) % std::max<std::uint64_t>(sites[site].hits, 1);
+    return {site, hit};
+}
+
+json SiteProfile::to_json() const {
+    std::uint64_t kept = 0;
+    for (const auto &s : sites) kept += s.samples;
+
+    json j;
+    j["period_us"] = period_us;
+    j["runs"]      = runs;
+    j["samples"]   = samples;
+    j["dropped"]   = dropped;
+    // share of the sampled time the injection sites stand for
+    j["coverage"]  = samples ? static_cast<double>(kept) / static_cast<double>(samples) : 0.0;
+    j["sites"]     = json::array();
+    for (const auto &s : sites) {
+        json e = site_to_json(s);
+        e["weight"] = kept ? static_cast<double>(s.samples) / static_cast<double>(kept) : 0.0;
+        j["sites"].push_back(e);
+    }
+    j["unusable"] = json::array();
+    for (const auto &s : unusable) j["unusable"].push_back(site_to_json(s));
+    return j;
+}
+
+SiteProfile SiteProfile::from_json(const json &j) {
+    SiteProfile sp;
+    sp.period_us = j.value("period_us", 0);
+    sp.runs      = j.value("runs", 0);
+    sp.samples   = j.value("samples", std::uint64_t{0});
+    sp.dropped   = j.value("dropped", std::uint64_t{0});
+    for (const auto &e : j.value("sites", json::array())) sp.sites.push_back(site_from_json(e));
+    for (const auto &e : j.value("unusable", json::array())) sp.unusable.push_back(site_from_json(e));
+    return sp;
+}
+
+SiteProfile profile_injection_sites(const std::string &device, const struct fij_params &golden,
+                                    const fs::path &scratch, const ProfileOptions &opt,
+                                    int num_threads, int pre_delay_ms, int max_retries,
+                                    int retry_delay_ms, bool verbose) {
+    SiteProfile sp;
+    sp.period_us = opt.period_us;
+    sp.runs      = opt.runs;
+
+    struct ScratchCleanup {
+        fs::path dir;
+        ~ScratchCleanup() {
+            std::error_code ec;
+            fs::remove_all(dir, ec);
+        }
+    } scratch_cleanup{scratch};
+
+    // 1. sampled golden runs, merged into one histogram of (file, offset)
+    struct fij_params sampled = golden;
+    sampled.profile_period_us = opt.period_us;
+
+    std::map<std::pair<std::string, std::uint64_t>, std::uint64_t> histogram;
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+    for (int k = 0; k < opt.runs; ++k) {
+        RunProfile prof;
+        try {
+            golden_run(device, sampled, scratch, k, pre_delay_ms, max_retries, retry_delay_ms, &prof);
+        } catch (const std::system_error &e) {
+            #pragma omp critical(fij_io)
+            std::cerr << "  Profile run " << k << " failed: " << e.what() << "\n";
+            continue;
+        }
+        #pragma omp critical(profile_collect)
+        {
+            for (const auto &s : prof.samples) {
+                if (s.file >= prof.files.size()) continue;
+                histogram[{prof.files[s.file], s.offset}]++;
+                sp.samples++;
+            }
+            sp.dropped += prof.dropped;
+        }
+    }
+    if (histogram.empty())
+        throw std::runtime_error("Profile runs took no PC sample in a mapped file; "
+                                 "raise profile_runs or lower profile_period_us.");
+
+    // 2. the most sampled sites, the map order breaking ties
+    std::vector<ProfileSite> candidates;
+    for (const auto &[key, n] : histogram) {
+        ProfileSite s;
+        s.path    = key.first;
+        s.offset  = key.second;
+        s.samples = n;
+        candidates.push_back(s);
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const ProfileSite &a, const ProfileSite &b) { return a.samples > b.samples; });
+    if (static_cast<int>(candidates.size()) > opt.sites) candidates.resize(opt.sites);
+
+    // 3. executions of each site in one golden run
+    struct fij_params counted = golden;
+    counted.trigger_hit = 0;
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+    for (int k = 0; k < static_cast<int>(candidates.size()); ++k) {
+        ProfileSite &s = candidates[k];
+        symbolize_file_offset(s.path, s.offset, s.function, s.function_offset);
+
+        struct fij_params p = counted;
+        set_cstring(p.trigger.path, s.path);
+        p.trigger.offset  = s.offset;
+        p.trigger.present = 1;
+        try {
+            s.hits = golden_run(device, p, scratch, opt.runs + k, pre_delay_ms, max_retries,
+                                retry_delay_ms, nullptr).trigger_hits;
+        } catch (const std::system_error &) {
+            // an instruction the kernel will not probe
+            s.hits = 0;
+        }
+    }
+    for (const auto &s : candidates)
+        (s.hits > 0 ? sp.sites : sp.unusable).push_back(s);
+    if (sp.sites.empty())
+        throw std::runtime_error("No profiled site could be probed and counted.");
+
+    if (verbose) {
+        json j = sp.to_json();
+        std::cout << "  Profile: " << sp.samples << " samples, " << sp.sites.size()
+                  << " injection sites covering "
+                  << std::fixed << std::setprecision(1) << j["coverage"].get<double>() * 100.0
+                  << "% of them" << std::defaultfloat;
+        if (!sp.unusable.empty()) std::cout << ", " << sp.unusable.size() << " not probeable";
+        std::cout << "\n";
+        for (std::size_t k = 0; k < std::min<std::size_t>(sp.sites.size(), 5); ++k) {
+            const auto &s = sp.sites[k];
+            std::cout << "    " << (s.function.empty() ? to_hex(s.offset)
+                                                      : s.function + "+" + to_hex(s.function_offset))
+                      << " in " << fs::path(s.path).filename().string() << ": "
+                      << s.samples << " samples, " << s.hits << " executions\n";
+        }
+    }
+    return sp;
+}
+
+void apply_profile_site(struct fij_params &p, const ProfileSite &site, std::uint64_t hit) {
+    set_cstring(p.trigger.path, site.path);
+    p.trigger.offset  = site.offset;
+    p.trigger.present = 1;
+    p.trigger_hit     = hit;
+}
@@ -0,0 +1,72 @@
+#include "fij.hpp"
+
+// -----------------------------------------------------------------------------
+// Run output staging and retention
+// -----------------------------------------------------------------------------
+//
+// With a stage_dir, every run writes its outputs to a tmpfs area first. Once
+// the run is collected the runner decides what to persist under fij_logs:
+// the golden baseline runs, every injected run that did not finish cleanly
+// with golden outputs, and a deterministic sample of the benign ones. The
+// other benign runs only keep their JSON. shard_size spreads the persisted
+// injection_<i> folders over shard_<n>/ directories so none of them grows
+// to millions of entries.
+
+fs::path run_dir_path(const fs::path &campaign, int i, int shard_size) {
+    std::string name = "injection_" + std::to_string(i);
+    if (shard_size <= 0) return campaign / name;
+
+    std::ostringstream shard;
+    shard << "shard_" << std::setw(4) << std::setfill('0') << (i / shard_size);
+    return campaign / shard.str() / name;
+}
+
+void write_campaign_layout(const fs::path &campaign, const RetentionPolicy &policy) {
+    json layout;
+    layout["shard_size"]    = policy.shard_size;
+    layout["staged"]        = !policy.stage_dir.empty();
+    layout["keep_benign"]   = policy.keep_benign;
+    layout["keep_baseline"] = policy.keep_baseline;
+    std::ofstream(campaign / "layout.json") << layout.dump(2) << "\n";
+}
+
+int campaign_shard_size(const fs::path &campaign) {
+    std::ifstream in(campaign / "layout.json");
+    if (!in.good()) return 0;   // campaigns from before sharding are flat
+    try {
+        json layout;
+        in >> layout;
+        return layout.value("shard_size", 0);
+    } catch (const std::exception &) {
+        return 0;
+    }
+}
+
+bool retain_run_outputs(const struct fij_result &res, bool outputs_same, int i,
+                        const RetentionPolicy &policy, std::uint64_t slowdown_cpu_ns) {
+    // killed on purpose before writing anything worth comparing
+    if (res.watch_status == FIJ_WATCH_MASKED || res.converged) return false;
+
+    if (res.exit_code != 0 || res.process_hanged) return true;
+    if (slowdown_cpu_ns > 0 && res.cpu_ns > slowdown_cpu_ns) return true;
+    if (!outputs_same) return true;
+
+    if (policy.keep_benign >= 1.0) return true;
+    if (policy.keep_benign <= 0.0) return false;
+
+    // Fibonacci hash of the run index: the same runs are sampled on every rerun
+    std::uint64_t h = (static_cast<std::uint64_t>(i) * 0x9e3779b97f4a7c15ULL) >> 40;
+    return h < static_cast<std::uint64_t>(policy.keep_benign * (1ULL << 24));
+}
+
+void move_run_dir(const fs::path &from, const fs::path &to) {
+    fs::create_directories(to.parent_path());
+    std::error_code ec;
+    fs::remove_all(to, ec);
+    fs::rename(from, to, ec);
+    if (!ec) return;
+
+    // tmpfs to disk: rename() cannot cross filesystems
+    fs::copy(from, to, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+    fs::remove_all(from);
+}
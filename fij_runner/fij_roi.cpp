@@ -0,0 +1,250 @@
+#include "fij.hpp"
+
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// -----------------------------------------------------------------------------
+// Region of interest probes (roi_start, roi_end)
+// -----------------------------------------------------------------------------
+//
+// The module probes a file at a file offset, which can be in any library
+// the target maps, loaded at startup or with dlopen(). A probe is written
+// FILE:LOCATION, or LOCATION alone for the executable, where LOCATION is a
+// symbol, symbol+offset, or an address as nm and objdump print it. This
+// file turns that into the absolute path and file offset the module wants,
+// reading the symbol tables and program headers of the ELF file. The
+// profile-guided sites go the other way, from file offset to function.
+
+namespace {
+
+// A file mapped read-only for the lookups
+struct MappedFile {
+    explicit MappedFile(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        struct stat st{};
+        if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+            close(fd);
+            throw std::runtime_error(path + " is empty or unreadable");
+        }
+        size = static_cast<std::size_t>(st.st_size);
+        void *m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED)
+            throw std::system_error(errno, std::generic_category(), "mmap " + path);
+        data = static_cast<const unsigned char *>(m);
+    }
+    ~MappedFile() { munmap(const_cast<unsigned char *>(data), size); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // n objects of T at off, or nullptr if they do not fit
+    template <typename T>
+    const T *at(std::uint64_t off, std::uint64_t n = 1) const {
+        if (off > size || n > (size - off) / sizeof(T)) return nullptr;
+        return reinterpret_cast<const T *>(data + off);
+    }
+
+    const unsigned char *data = nullptr;
+    std::size_t size = 0;
+};
+
+const Elf64_Ehdr &elf_header(const MappedFile &f, const std::string &path) {
+    const Elf64_Ehdr *eh = f.at<Elf64_Ehdr>(0);
+    if (!eh || std::memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0)
+        throw std::runtime_error(path + " is not an ELF file");
+    if (eh->e_ident[EI_CLASS] != ELFCLASS64)
+        throw std::runtime_error(path + " is not a 64-bit ELF file");
+    return *eh;
+}
+
+// value of a defined symbol, .symtab first since stripped files only keep .dynsym
+bool find_symbol(const MappedFile &f, const Elf64_Ehdr &eh, const std::string &name,
+                 std::uint64_t &value) {
+    const Elf64_Shdr *sh = f.at<Elf64_Shdr>(eh.e_shoff, eh.e_shnum);
+    if (!sh) return false;
+
+    for (std::uint32_t type : {SHT_SYMTAB, SHT_DYNSYM}) {
+        for (int k = 0; k < eh.e_shnum; ++k) {
+            if (sh[k].sh_type != type || sh[k].sh_link >= eh.e_shnum) continue;
+
+            const Elf64_Shdr &strtab = sh[sh[k].sh_link];
+            std::uint64_t count = sh[k].sh_size / sizeof(Elf64_Sym);
+            const Elf64_Sym *syms = f.at<Elf64_Sym>(sh[k].sh_offset, count);
+            const char *strs = f.at<char>(strtab.sh_offset, strtab.sh_size);
+            if (!syms || !strs) continue;
+
+            for (std::uint64_t s = 0; s < count; ++s) {
+                if (syms[s].st_shndx == SHN_UNDEF || syms[s].st_value == 0) continue;
+                if (syms[s].st_name >= strtab.sh_size) continue;
+                const char *sym = strs + syms[s].st_name;
+                std::size_t len = strnlen(sym, strtab.sh_size - syms[s].st_name);
+                // versioned .symtab names carry @VERSION or @@VERSION
+                std::string_view bare(sym, len);
+                bare = bare.substr(0, bare.find('@'));
+                if (bare == name) {
+                    value = syms[s].st_value;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// file offset of a virtual address in an executable PT_LOAD segment
+bool vaddr_to_offset(const MappedFile &f, const Elf64_Ehdr &eh, std::uint64_t va,
+                     std::uint64_t &off) {
+    const Elf64_Phdr *ph = f.at<Elf64_Phdr>(eh.e_phoff, eh.e_phnum);
+    if (!ph) return false;
+
+    for (int k = 0; k < eh.e_phnum; ++k) {
+        if (ph[k].p_type != PT_LOAD || !(ph[k].p_flags & PF_X)) continue;
+        if (va >= ph[k].p_vaddr && va < ph[k].p_vaddr + ph[k].p_filesz) {
+            off = va - ph[k].p_vaddr + ph[k].p_offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+// virtual address of a file offset in an executable PT_LOAD segment
+bool offset_to_vaddr(const MappedFile &f, const Elf64_Ehdr &eh, std::uint64_t off,
+                     std::uint64_t &va) {
+    const Elf64_Phdr *ph = f.at<Elf64_Phdr>(eh.e_phoff, eh.e_phnum);
+    if (!ph) return false;
+
+    for (int k = 0; k < eh.e_phnum; ++k) {
+        if (ph[k].p_type != PT_LOAD || !(ph[k].p_flags & PF_X)) continue;
+        if (off >= ph[k].p_offset && off < ph[k].p_offset + ph[k].p_filesz) {
+            va = off - ph[k].p_offset + ph[k].p_vaddr;
+            return true;
+        }
+    }
+    return false;
+}
+
+// the function covering va, the nearest one below it if none has a size that does
+bool find_function(const MappedFile &f, const Elf64_Ehdr &eh, std::uint64_t va,
+                   std::string &name, std::uint64_t &start) {
+    const Elf64_Shdr *sh = f.at<Elf64_Shdr>(eh.e_shoff, eh.e_shnum);
+    if (!sh) return false;
+
+    for (std::uint32_t type : {SHT_SYMTAB, SHT_DYNSYM}) {
+        bool found = false, covers = false;
+        for (int k = 0; k < eh.e_shnum; ++k) {
+            if (sh[k].sh_type != type || sh[k].sh_link >= eh.e_shnum) continue;
+
+            const Elf64_Shdr &strtab = sh[sh[k].sh_link];
+            std::uint64_t count = sh[k].sh_size / sizeof(Elf64_Sym);
+            const Elf64_Sym *syms = f.at<Elf64_Sym>(sh[k].sh_offset, count);
+            const char *strs = f.at<char>(strtab.sh_offset, strtab.sh_size);
+            if (!syms || !strs) continue;
+
+            for (std::uint64_t s = 0; s < count; ++s) {
+                const Elf64_Sym &sym = syms[s];
+                if (ELF64_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_shndx == SHN_UNDEF) continue;
+                if (sym.st_value > va || sym.st_name >= strtab.sh_size) continue;
+                bool in = va < sym.st_value + sym.st_size;
+                if (found && (covers && !in)) continue;
+                if (found && covers == in && sym.st_value <= start) continue;
+                const char *str = strs + sym.st_name;
+                name.assign(str, strnlen(str, strtab.sh_size - sym.st_name));
+                start  = sym.st_value;
+                covers = in;
+                found  = true;
+            }
+        }
+        if (found) return true;
+    }
+    return false;
+}
+
+// Hex as nm and objdump print it, with or without 0x, and nothing else
+bool parse_hex(const std::string &text, std::uint64_t &value) {
+    std::size_t start = text.compare(0, 2, "0x") == 0 || text.compare(0, 2, "0X") == 0 ? 2 : 0;
+    if (start == text.size() ||
+        text.find_first_not_of("0123456789abcdefABCDEF", start) != std::string::npos)
+        return false;
+    try {
+        std::size_t used = 0;
+        value = std::stoull(text.substr(start), &used, 16);
+        return used == text.size() - start;
+    } catch (const std::exception &) {
+        return false;   // out of range
+    }
+}
+
+} // namespace
+
+bool symbolize_file_offset(const std::string &path, std::uint64_t offset,
+                           std::string &function, std::uint64_t &function_offset) {
+    try {
+        MappedFile f(path);
+        const Elf64_Ehdr &eh = elf_header(f, path);
+        std::uint64_t va = 0, start = 0;
+        std::string name;
+        if (!offset_to_vaddr(f, eh, offset, va) || !find_function(f, eh, va, name, start))
+            return false;
+        function        = name;
+        function_offset = va - start;
+        return true;
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+struct fij_probe resolve_roi_probe(const std::string &spec, const std::string &exe_path) {
+    std::string file = exe_path, location = spec;
+    auto colon = spec.rfind(':');
+    if (colon != std::string::npos) {
+        file     = spec.substr(0, colon);
+        location = spec.substr(colon + 1);
+    }
+    if (file.empty() || location.empty())
+        throw std::runtime_error("ROI probe \"" + spec + "\": expected [FILE:]SYMBOL[+OFFSET] or [FILE:]ADDRESS");
+
+    std::string path = fs::canonical(file).string();
+    MappedFile f(path);
+    const Elf64_Ehdr &eh = elf_header(f, path);
+
+    // An all-hex location is an address, unless it starts with a letter and
+    // the file has a symbol of that name (add, cafe)
+    std::uint64_t va = 0;
+    bool address = parse_hex(location, va);
+    if (address && std::isalpha(static_cast<unsigned char>(location[0]))) {
+        std::uint64_t sym = 0;
+        if (find_symbol(f, eh, location, sym)) va = sym;
+    } else if (!address) {
+        std::string name = location;
+        std::uint64_t extra = 0;
+        auto plus = location.find('+');
+        if (plus != std::string::npos) {
+            name = location.substr(0, plus);
+            if (!parse_hex(location.substr(plus + 1), extra))
+                throw std::runtime_error("ROI probe \"" + spec + "\": offset \"" +
+                                         location.substr(plus + 1) + "\" is not a hex number");
+        }
+        if (!find_symbol(f, eh, name, va))
+            throw std::runtime_error("ROI probe \"" + spec + "\": no symbol " + name + " in " + path);
+        va += extra;
+    }
+
+    struct fij_probe probe{};
+    std::uint64_t off = 0;
+    if (!vaddr_to_offset(f, eh, va, off)) {
+        std::ostringstream oss;
+        oss << "ROI probe \"" << spec << "\": 0x" << std::hex << va
+            << " is not in an executable segment of " << path;
+        throw std::runtime_error(oss.str());
+    }
+    if (path.size() >= sizeof(probe.path))
+        throw std::runtime_error("ROI probe \"" + spec + "\": path longer than " +
+                                 std::to_string(sizeof(probe.path) - 1) + " bytes");
+    set_cstring(probe.path, path);
+    probe.offset  = off;
+    probe.present = 1;
+    return probe;
+}
@@ -1,6 +1,9 @@
 #include "fij.hpp"
 #include "fij_ioctls.hpp"
+#include "fij_telemetry.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <iostream>
@@ -14,22 +17,158 @@
 
 namespace fs = std::filesystem;
 
+// -----------------------------------------------------------------------------
+// golden_digests – checkpoint digests seen in every baseline run
+// -----------------------------------------------------------------------------
+
+// A digest only one baseline run produced comes from non-deterministic
+// state and could never be matched reliably, so only the common ones count.
+static std::vector<std::uint64_t> golden_digests(const std::vector<struct fij_result> &baseline) {
+    std::vector<std::uint64_t> common;
+    if (baseline.empty()) return common;
+
+    const struct fij_result &first = baseline.front();
+    int n0 = std::min(first.digest_count, FIJ_MAX_DIGESTS);
+    for (int k = 0; k < n0; ++k) {
+        std::uint64_t d = first.digests[k];
+        if (std::find(common.begin(), common.end(), d) != common.end()) continue;
+
+        bool everywhere = true;
+        for (const auto &res : baseline) {
+            int n = std::min(res.digest_count, FIJ_MAX_DIGESTS);
+            if (std::find(res.digests, res.digests + n, d) == res.digests + n) {
+                everywhere = false;
+                break;
+            }
+        }
+        if (everywhere) common.push_back(d);
+    }
+    return common;
+}
+
+// -----------------------------------------------------------------------------
+// baseline_rusage – CPU time and memory of the golden runs
+// -----------------------------------------------------------------------------
+
+struct BaselineRusage {
+    int runs = 0;
+    double cpu_ns_mean = 0.0;
+    std::uint64_t cpu_ns_max = 0;
+    std::uint64_t maxrss_kb_max = 0;
+};
+
+static BaselineRusage baseline_rusage(const std::vector<struct fij_result> &baseline) {
+    BaselineRusage br;
+    double sum = 0.0;
+    for (const auto &res : baseline) {
+        if (res.cpu_ns == 0) continue;  // older module or run without accounting
+        br.runs++;
+        sum += static_cast<double>(res.cpu_ns);
+        br.cpu_ns_max    = std::max<std::uint64_t>(br.cpu_ns_max, res.cpu_ns);
+        br.maxrss_kb_max = std::max<std::uint64_t>(br.maxrss_kb_max, res.maxrss_kb);
+    }
+    if (br.runs > 0) br.cpu_ns_mean = sum / br.runs;
+    return br;
+}
+
+// -----------------------------------------------------------------------------
+// baseline_roi – length of the region of interest in the golden runs
+// -----------------------------------------------------------------------------
+
+struct BaselineRoi {
+    int runs = 0;           // golden runs that reached roi_start
+    int unclosed = 0;       // of those, runs that exited before roi_end
+    double wall_ns_mean = 0.0;
+    double cpu_ns_mean = 0.0;
+};
+
+static BaselineRoi baseline_roi(const std::vector<struct fij_result> &baseline) {
+    BaselineRoi br;
+    double wall = 0.0, cpu = 0.0;
+    for (const auto &res : baseline) {
+        if (res.ts_roi_start == 0) continue;
+        std::uint64_t end = res.ts_roi_end ? res.ts_roi_end : res.ts_exit;
+        if (end < res.ts_roi_start) continue;
+        br.runs++;
+        if (res.ts_roi_end == 0) br.unclosed++;
+        wall += static_cast<double>(end - res.ts_roi_start);
+        cpu  += static_cast<double>(res.roi_cpu_ns);
+    }
+    if (br.runs > 0) {
+        br.wall_ns_mean = wall / br.runs;
+        br.cpu_ns_mean  = cpu / br.runs;
+    }
+    return br;
+}
+
+// -----------------------------------------------------------------------------
+// campaign_folder_name – where a target's campaigns go under fij_logs
+// -----------------------------------------------------------------------------
+
+std::string campaign_folder_name(const struct fij_params &p) {
+    std::regex slug_re("[^A-Za-z0-9._-]+");
+    auto slug = [&](const std::string &s) {
+        std::string trimmed = s;
+        std::string out = std::regex_replace(trimmed, slug_re, "_");
+        while (!out.empty() && out.front() == '_') out.erase(out.begin());
+        while (!out.empty() && out.back() == '_') out.pop_back();
+        for (auto &c : out) c = std::tolower(c);
+        return out;
+    };
+
+    std::string filename = fs::path(cstr_from_array(p.process_path)).filename().string();
+    std::string args_str = cstr_from_array(p.process_args);
+
+    std::string logs_folder;
+    std::vector<std::string> parts;
+    parts.push_back(slug(filename));
+    if (!args_str.empty()) {
+        parts.push_back("+");
+        parts.push_back(slug(args_str));
+    }
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        if (i > 0) logs_folder += "_";
+        logs_folder += parts[i];
+    }
+
+    // Fix long filenames
+    if (logs_folder.length() > 100) {
+        std::hash<std::string> hasher;
+        std::size_t h = hasher(logs_folder);
+        std::stringstream ss;
+        ss << std::hex << h;
+        // truncate original string but keep hash for uniqueness
+        logs_folder = logs_folder.substr(0, 100) + "_" + ss.str();
+    }
+    return logs_folder;
+}
+
 // -----------------------------------------------------------------------------
 // run_injection_campaign – single campaign
 // -----------------------------------------------------------------------------
 
 CampaignResult run_injection_campaign(
     const std::string &device,
-    struct fij_params base_params,
-    int runs,
-    int baseline_runs,
+    const FijJob &job,
     int pre_delay_ms,
     int max_retries,
     int retry_delay_ms,
     bool verbose,
-    int max_workers
+    const ResumeOptions &resume,
+    JobTelemetry *telemetry
 ) {
-    (void)max_workers; // currently unused, sequential execution
+    struct fij_params base_params = job.params;
+    int runs          = job.runs;
+    int baseline_runs = job.baseline_runs;
+    double cpu_deadline_factor = job.cpu_deadline_factor;
+    double slowdown_factor     = job.slowdown_factor;
+    const RetentionPolicy &retention          = job.retention;
+    const FingerprintOptions &fingerprint     = job.fingerprint;
+    const StoppingRule &stopping              = job.stopping;
+    const StrataOptions &strata               = job.strata;
+    const PlanOptions &fault_plan             = job.plan;
+    const OutcomeCacheOptions &outcome_cache  = job.cache;
+    const ProfileOptions &profile             = job.profile;
 
     if (!fs::exists(device)) {
         throw std::system_error(ENOENT, std::generic_category(),
@@ -65,105 +204,158 @@ CampaignResult run_injection_campaign(
         return cstr_from_array(arr);
     };
 
-    std::regex slug_re("[^A-Za-z0-9._-]+");
-    auto slug = [&](const std::string &s) {
-        std::string trimmed = s;
-        std::string out = std::regex_replace(trimmed, slug_re, "_");
-        while (!out.empty() && out.front() == '_') out.erase(out.begin());
-        while (!out.empty() && out.back() == '_') out.pop_back();
-        for (auto &c : out) c = std::tolower(c);
-        return out;
-    };
+    std::string logs_folder = campaign_folder_name(base_params);
 
-    std::string filename = fs::path(cstr(base_params.process_path)).filename().string();
-    std::string args_str = cstr(base_params.process_args);
+    // --resume / --top-up continue the latest campaign journaled with this configuration
+    std::string config_hash = campaign_config_hash(base_params, baseline_runs, retention, fingerprint,
+                                                   strata, fault_plan, profile);
+    fs::path campaign_path;
+    JournalState journal_state;
+    if (resume.resume || resume.top_up > 0)
+        campaign_path = find_campaign_to_resume("../fij_logs", logs_folder, config_hash);
 
-    std::string logs_folder;
-    {
-        std::vector<std::string> parts;
-        parts.push_back(slug(filename));
-        if (!args_str.empty()) {
-            parts.push_back("+");
-            parts.push_back(slug(args_str));
-        }
-        for (std::size_t i = 0; i < parts.size(); ++i) {
-            if (i > 0) logs_folder += "_";
-            logs_folder += parts[i];
-        }
+    if (!campaign_path.empty()) {
+        journal_state = load_campaign_journal(campaign_path);
+        runs = journal_state.runs + std::max(resume.top_up, 0);
+        std::cout << "  Resuming " << campaign_path << ": "
+                  << journal_state.completed.size() << "/" << runs << " runs done"
+                  << (journal_state.baseline_done ? ", baseline reused" : "") << "\n";
+    } else {
+        if (resume.top_up > 0)
+            throw std::runtime_error("No journaled campaign of " + label + " to top up");
+        if (resume.resume)
+            std::cout << "  No journaled campaign of " << label << ", starting a new one\n";
+        campaign_path = create_dir_in_path("../fij_logs", logs_folder);
+    }
 
-        // Fix long filenames
-        if (logs_folder.length() > 100) {
-            std::hash<std::string> hasher;
-            std::size_t h = hasher(logs_folder);
-            std::stringstream ss;
-            ss << std::hex << h;
-            // truncate original string but keep hash for uniqueness
-            logs_folder = logs_folder.substr(0, 100) + "_" + ss.str();
-        }
+    CampaignJournal journal(campaign_path);
+    if (!journal_state.found || runs != journal_state.runs) {
+        json rec;
+        rec["type"]          = "campaign";
+        rec["config_hash"]   = config_hash;
+        rec["label"]         = label;
+        rec["runs"]          = runs;
+        rec["baseline_runs"] = baseline_runs;
+        journal.append(rec);
     }
 
-    fs::path campaign_path = create_dir_in_path("../fij_logs", logs_folder);
+    // Runs write to stage_path; with no stage_dir that is the campaign itself
+    bool staging = !retention.stage_dir.empty();
+    fs::path stage_path = campaign_path;
+    if (staging) {
+        stage_path = fs::path(retention.stage_dir) /
+                     ("fij_" + std::to_string(getpid()) + "_" + campaign_path.filename().string());
+        fs::create_directories(stage_path);
+    }
+    if (staging || retention.shard_size > 0) write_campaign_layout(campaign_path, retention);
+
+    // whatever happens, the staging area does not outlive the campaign
+    struct StageCleanup {
+        fs::path dir;
+        ~StageCleanup() {
+            std::error_code ec;
+            if (!dir.empty()) fs::remove_all(dir, ec);
+        }
+    } stage_cleanup{staging ? stage_path : fs::path()};
 
     std::string args_template = cstr(base_params.process_args);
 
+    // Outputs hashed inside the target by libfij_preload.so (fingerprint_outputs)
+    bool fingerprinting = !fingerprint.outputs.empty();
+    bool fingerprint_sink = fingerprinting && fingerprint.sink;
+    if (fingerprinting && !fs::exists(fingerprint.lib)) {
+        throw std::system_error(ENOENT, std::generic_category(),
+                                "Fingerprint library " + fingerprint.lib +
+                                " does not exist (make -C fij_preload)");
+    }
+    std::string slot_prefix = "/fij_fp_" + std::to_string(getpid()) + "_";
+    auto set_fingerprint_env = [&](struct fij_params &p, const FingerprintSlot &slot, bool sink,
+                                   const std::string &campaign_str, int i) {
+        std::string env = fingerprint_env(fingerprint, slot.name, sink, campaign_str, i);
+        if (env.size() >= sizeof(p.env_extra))
+            throw std::invalid_argument("fingerprint_outputs patterns do not fit in env_extra");
+        set_cstring(p.env_extra, env);
+    };
+    FingerprintMap golden_run_fp;       // what the library saw in baseline run 0
+    std::uint32_t golden_overflow = 0;
+
     // ---------------- Phase 1: baseline ----------------
 
+    auto baseline_start = std::chrono::steady_clock::now();
+
     fs::path no_inj_path = campaign_path / "no_inj";
     fs::create_directories(no_inj_path);
 
+    if (telemetry) telemetry->set_phase(TELEMETRY_BASELINE);
+
+    // a resumed campaign keeps its golden runs; the statistics below are
+    // recomputed from them exactly as the first time
+    bool baseline_restored = journal_state.baseline_done;
+    int baseline_todo = baseline_restored ? 0 : baseline_runs;
+
     if (verbose) {
-        std::cout << "Phase 1: running " << baseline_runs
-                  << " baseline IOCTL calls (no_injection=1)\n";
+        if (baseline_restored)
+            std::cout << "Phase 1: reusing " << journal_state.baseline_times.size()
+                      << " journaled baseline runs\n";
+        else
+            std::cout << "Phase 1: running " << baseline_runs
+                      << " baseline IOCTL calls (no_injection=1)\n";
     }
 
     std::vector<double> baseline_times;
     std::vector<struct fij_result> baseline_results;
+    std::vector<TimelineRun> timeline_runs;
+    std::vector<TimelineSpan> timeline_spans;
     baseline_times.reserve(baseline_runs);
     baseline_results.reserve(baseline_runs);
+    if (baseline_restored) {
+        baseline_times   = journal_state.baseline_times;
+        baseline_results = journal_state.baseline_results;
+        golden_run_fp    = fingerprint_from_json(journal_state.golden_run_fingerprint);
+        golden_overflow  = journal_state.golden_overflow;
+    }
 
     // decide how many threads to use
-    int num_threads = max_workers;
+    int num_threads = job.workers;
     if (num_threads <= 0) {
-        // fallback to OpenMP default if max_workers is not set/negative
+        // fallback to OpenMP default if workers is not set/negative
         num_threads = std::max(1, omp_get_max_threads());
     }
 
     #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
-    for (int i = 0; i < baseline_runs; ++i) {
+    for (int i = 0; i < baseline_todo; ++i) {
+        TelemetryGauge busy(telemetry ? &telemetry->busy_workers : nullptr);
+        std::uint64_t run_start = timeline_now_ns();
         try {
-            // Per-run directory: ../fij_logs/<campaign>/no_inj/injection_i
-            fs::path run_dir = no_inj_path / ("injection_" + std::to_string(i));
+            // Per-run directory: ../fij_logs/<campaign>/no_inj/injection_i (or staged)
+            fs::path run_dir = stage_path / "no_inj" / ("injection_" + std::to_string(i));
             fs::create_directories(run_dir);
 
             // Expand arguments with {campaign} and {run} placeholders
-            std::string expanded_args = args_template;
-            {
-                std::string campaign_placeholder = "{campaign}";
-                std::string run_placeholder      = "{run}";
-                std::string campaign_str         = no_inj_path.string();
-                std::string run_str              = std::to_string(i);
-
-                std::size_t pos = 0;
-                while ((pos = expanded_args.find(campaign_placeholder, pos)) != std::string::npos) {
-                    expanded_args.replace(pos, campaign_placeholder.size(), campaign_str);
-                    pos += campaign_str.size();
-                }
-                pos = 0;
-                while ((pos = expanded_args.find(run_placeholder, pos)) != std::string::npos) {
-                    expanded_args.replace(pos, run_placeholder.size(), run_str);
-                    pos += run_str.size();
-                }
-            }
+            std::string campaign_str  = run_dir.parent_path().string();
+            std::string expanded_args = expand_run_placeholders(args_template, campaign_str, i);
 
             // Per-run copy of params to avoid races
             struct fij_params per_run_params = base_params;
             set_cstring(per_run_params.process_args, expanded_args);
+            // golden runs define the program's behaviour, never cut them short
+            per_run_params.hang_detect = 0;
+            per_run_params.watch_masked = 0;
+            per_run_params.cpu_budget_ns = 0;
 
             fs::path run_log_path = run_dir / "log.txt";
             set_cstring(per_run_params.log_path, run_log_path.string());
             per_run_params.iteration_number = i;
 
+            // baseline outputs always reach the disk: they are the golden files
+            std::unique_ptr<FingerprintSlot> fp_slot;
+            if (fingerprinting) {
+                fp_slot = std::make_unique<FingerprintSlot>(slot_prefix + "b" + std::to_string(i));
+                set_fingerprint_env(per_run_params, *fp_slot, false, campaign_str, i);
+            }
+
             // max_delay_ms = 0 here: baseline, no injection window needed.
+            std::string output;
             auto [dt, res] = fij_detail::run_send_and_poll(
                 device,
                 per_run_params,
@@ -172,14 +364,33 @@ CampaignResult run_injection_campaign(
                 1,          // no_injection = 1  so the kernel does not inject
                 pre_delay_ms,
                 max_retries,
-                retry_delay_ms
+                retry_delay_ms,
+                1,              // poll_interval_ms
+                telemetry,
+                &output
             );
+            if (telemetry) telemetry->baseline_done++;
+            if (per_run_params.capture_output) write_captured_log(run_log_path, output, res);
+            if (fp_slot && i == 0) {
+                golden_run_fp   = fp_slot->read();
+                golden_overflow = fp_slot->overflow();
+            }
+
+            // only the first keep_baseline golden runs are worth persisting
+            if (staging) {
+                if (i < retention.keep_baseline)
+                    move_run_dir(run_dir, no_inj_path / run_dir.filename());
+                else
+                    fs::remove_all(run_dir);
+            }
 
             // Collect results (protect vector push_back)
             #pragma omp critical(baseline_collect)
             {
                 baseline_times.push_back(dt);
                 baseline_results.push_back(res);
+                timeline_runs.push_back(timeline_run(omp_get_thread_num(), i, "baseline",
+                                                     run_start, timeline_now_ns(), &res));
             }
 
             // Logging (I/O needs its own critical section to avoid garbling)
@@ -192,6 +403,9 @@ CampaignResult run_injection_campaign(
             }
 
         } catch (const std::system_error &e) {
+            #pragma omp critical(baseline_collect)
+            timeline_runs.push_back(timeline_run(omp_get_thread_num(), i, "error",
+                                                 run_start, timeline_now_ns(), nullptr));
             if (verbose) {
                 #pragma omp critical(fij_io)
                 {
@@ -202,6 +416,20 @@ CampaignResult run_injection_campaign(
         }
     }
 
+    if (!baseline_restored && !baseline_times.empty()) {
+        json rec;
+        rec["type"]        = "baseline";
+        rec["times"]       = baseline_times;
+        rec["results"]     = json::array();
+        for (const auto &res : baseline_results)
+            rec["results"].push_back(journal_encode_result(res));
+        rec["fingerprint"] = fingerprint_to_json(golden_run_fp);
+        rec["overflow"]    = golden_overflow;
+        journal.append(rec);
+    }
+
+    std::uint64_t stats_start = timeline_now_ns();
+
     if (baseline_times.empty()) {
         throw std::runtime_error("All baseline runs failed for target " + label +
                                  "; cannot determine max_delay_ms.");
@@ -224,57 +452,343 @@ CampaignResult run_injection_campaign(
         std::cout << "  Average baseline time: " << (max_delay_ms) << " ms\n";
     }
 
-    // ---------------- Phase 2: injection ----------------
+    // CPU time is what the target consumed, free of ioctl and poll latency
+    std::uint64_t slowdown_cpu_ns = 0;
+    // injection delays are drawn up to this, on the run's delay_clock
+    int delay_window_ms = max_delay_ms;
+    {
+        BaselineRusage br = baseline_rusage(baseline_results);
 
-    auto campaign_start = std::chrono::steady_clock::now();
+        json ru;
+        ru["runs"]          = br.runs;
+        ru["cpu_ns_mean"]   = static_cast<std::uint64_t>(br.cpu_ns_mean);
+        ru["cpu_ns_max"]    = br.cpu_ns_max;
+        ru["maxrss_kb_max"] = br.maxrss_kb_max;
+        slowdown_cpu_ns = slowdown_factor > 0.0
+            ? static_cast<std::uint64_t>(slowdown_factor * br.cpu_ns_mean) : 0;
+        ru["slowdown_cpu_ns"] = slowdown_cpu_ns;
+        std::ofstream(no_inj_path / "rusage.json") << ru.dump(2) << "\n";
 
-    if (verbose) {
-        std::cout << "\nPhase 2: running " << runs
-                  << " IOCTL calls with injection (no_injection=0, max_delay_ms="
-                  << max_delay_ms << ")\n";
+        if (cpu_deadline_factor > 0.0 && br.cpu_ns_max > 0) {
+            base_params.cpu_budget_ns =
+                static_cast<std::uint64_t>(cpu_deadline_factor * br.cpu_ns_max);
+        }
+
+        if (verbose && br.runs > 0) {
+            std::cout << "  Baseline CPU time: mean " << (br.cpu_ns_mean / 1e6)
+                      << " ms, max " << (br.cpu_ns_max / 1e6) << " ms, peak RSS "
+                      << br.maxrss_kb_max << " kB\n";
+            if (base_params.cpu_budget_ns)
+                std::cout << "  CPU deadline: " << (base_params.cpu_budget_ns / 1e6) << " ms\n";
+        }
+
+        // delays counted in target CPU time cover the golden CPU time, not its wall time
+        if (base_params.delay_clock == FIJ_DELAY_CPU && br.cpu_ns_mean > 0) {
+            delay_window_ms = std::max(1, static_cast<int>(std::lround(br.cpu_ns_mean / 1e6)));
+            if (verbose)
+                std::cout << "  Injection window: " << delay_window_ms << " ms of target CPU time\n";
+        }
+    }
+
+    // with a region of interest the delay counts from roi_start: the window is the region
+    if (base_params.roi_start.present) {
+        BaselineRoi br = baseline_roi(baseline_results);
+        if (br.runs == 0) {
+            std::ostringstream oss;
+            oss << "No baseline run of " << label << " reached roi_start "
+                << cstr_from_array(base_params.roi_start.path) << "+0x" << std::hex
+                << base_params.roi_start.offset << "; nothing to inject into.";
+            throw std::runtime_error(oss.str());
+        }
+
+        json roi;
+        roi["start"]        = {{"path", cstr_from_array(base_params.roi_start.path)},
+                               {"offset", base_params.roi_start.offset}};
+        if (base_params.roi_end.present)
+            roi["end"]      = {{"path", cstr_from_array(base_params.roi_end.path)},
+                               {"offset", base_params.roi_end.offset}};
+        roi["runs"]         = br.runs;
+        roi["unclosed"]     = br.unclosed;
+        roi["wall_ns_mean"] = static_cast<std::uint64_t>(br.wall_ns_mean);
+        roi["cpu_ns_mean"]  = static_cast<std::uint64_t>(br.cpu_ns_mean);
+        std::ofstream(no_inj_path / "roi.json") << roi.dump(2) << "\n";
+
+        double window_ns = base_params.delay_clock == FIJ_DELAY_CPU && br.cpu_ns_mean > 0
+            ? br.cpu_ns_mean : br.wall_ns_mean;
+        delay_window_ms = std::max(1, static_cast<int>(std::lround(window_ns / 1e6)));
+        if (verbose) {
+            std::cout << "  Region of interest: " << br.runs << " runs, mean "
+                      << (br.wall_ns_mean / 1e6) << " ms wall, " << (br.cpu_ns_mean / 1e6)
+                      << " ms CPU";
+            if (br.unclosed) std::cout << " (" << br.unclosed << " exited inside it)";
+            std::cout << "\n  Injection window: " << delay_window_ms << " ms from roi_start\n";
+        }
     }
 
+    // Golden checkpoint digests: injected runs stop once they match one
+    if (base_params.digest_mode != FIJ_DIGEST_OFF) {
+        std::vector<std::uint64_t> golden = golden_digests(baseline_results);
+
+        json digests_json = json::array();
+        for (std::uint64_t d : golden) {
+            std::ostringstream oss;
+            oss << "0x" << std::hex << std::setw(16) << std::setfill('0') << d;
+            digests_json.push_back(oss.str());
+        }
+        std::ofstream(no_inj_path / "digests.json") << digests_json.dump(2) << "\n";
+
+        base_params.digest_golden_count = static_cast<int>(golden.size());
+        for (std::size_t k = 0; k < golden.size(); ++k)
+            base_params.digest_golden[k] = golden[k];
+        base_params.digest_mode = golden.empty() ? FIJ_DIGEST_OFF : FIJ_DIGEST_COMPARE;
+
+        if (verbose || golden.empty()) {
+            std::cout << "  Golden digests: " << golden.size()
+                      << (golden.empty() ? " (target not reproducible at digest_pc, convergence check disabled)" : "")
+                      << "\n";
+        }
+    }
+
+    // Golden fingerprints: only the outputs whose hash matches the file on disk.
+    // A stream that saw no writes proves nothing: C stdio flushes inside libc,
+    // so an empty golden would also match a run that did write the file.
+    fs::path golden_dir = no_inj_path / "injection_0";
+    FingerprintMap golden_fp;
+    if (fingerprinting) {
+        std::vector<std::string> fallback;
+        for (const auto &[name, disk] : fingerprint_files(golden_dir)) {
+            auto seen = golden_run_fp.find(name);
+            if (seen == golden_run_fp.end()) continue;  // not matched by the patterns
+            const OutputFingerprint &run = seen->second;
+            bool empty = run.bytes == 0 && (disk.bytes > 0 || run.stdio);
+            if (!empty && run.ordered && run.bytes == disk.bytes && run.hash == disk.hash)
+                golden_fp[name] = disk;
+            else
+                fallback.push_back(name);
+        }
+        write_golden_fingerprint(campaign_path, golden_fp, fallback);
+
+        // an output compared by reading it has to be on disk
+        if (fingerprint_sink && (golden_fp.empty() || !fallback.empty() || golden_overflow > 0)) {
+            fingerprint_sink = false;
+            std::cout << "  Fingerprints: not every output could be followed, "
+                         "fingerprint_sink disabled\n";
+        }
+        if (verbose || !fallback.empty()) {
+            std::cout << "  Fingerprinted outputs: " << golden_fp.size();
+            for (const auto &name : fallback) std::cout << ", " << name << " compared by reading";
+            std::cout << "\n";
+        }
+    }
+
+    // ---------------- Phase 2: injection ----------------
+
+    timeline_spans.push_back({"baseline statistics", stats_start, timeline_now_ns()});
+
+    auto campaign_start = std::chrono::steady_clock::now();
+    double baseline_total = std::chrono::duration<double>(campaign_start - baseline_start).count();
+    if (telemetry) telemetry->set_phase(TELEMETRY_INJECTION);
+
     std::vector<double> inj_times(runs, -1.0);
     std::vector<struct fij_result> inj_results(runs);
+    std::atomic<int> outputs_kept{0};
+
+    // with stop_margin, no run is started once the outcome rates are known well enough
+    bool tracking = stopping.margin > 0.0;
+    StoppingTracker tracker(stopping);
+    std::atomic<bool> stop_early{false};
+
+    // with stratify, every run is pinned to a stratum of the fault space
+    std::unique_ptr<StrataPlanner> planner;
+    if (strata.enabled) {
+        planner = std::make_unique<StrataPlanner>(strata, base_params, delay_window_ms,
+                                                  std::stoull(config_hash, nullptr, 16));
+        if (verbose) {
+            std::cout << "  Strata: " << planner->strata.size() << " ("
+                      << planner->time_bins << " time bins)\n";
+        }
+    }
+    // with fault_plan, run i flips the fault of record i of <campaign>/plan.bin
+    std::unique_ptr<FaultPlan> plan;
+    if (fault_plan.enabled) {
+        std::uint64_t plan_seed = fault_plan.seed ? fault_plan.seed
+                                                  : std::stoull(config_hash, nullptr, 16);
+        int plan_window_ms = fault_plan.window_ms > 0 ? fault_plan.window_ms : delay_window_ms;
+        prepare_fault_plan(campaign_path / "plan.bin", base_params, plan_window_ms, runs, plan_seed);
+        plan = std::make_unique<FaultPlan>(campaign_path / "plan.bin");
+        if (verbose) std::cout << "  Fault plan: " << plan->size() << " distinct faults\n";
+    }
+    // with outcome_cache, a planned fault already seen on this target is not run again
+    std::unique_ptr<OutcomeCache> cache;
+    if (plan && !outcome_cache.path.empty()) {
+        cache = std::make_unique<OutcomeCache>(outcome_cache, base_params, cpu_deadline_factor,
+                                               campaign_path.string());
+        if (verbose) {
+            std::cout << "  Outcome cache: " << cache->entries.size() << " entries in "
+                      << outcome_cache.path << "\n";
+        }
+    }
+    // with profile_guided, every run flips at a site drawn from the golden-run profile
+    std::unique_ptr<SiteProfile> sites;
+    if (profile.enabled) {
+        fs::path profile_path = no_inj_path / "profile.json";
+        if (baseline_restored && fs::exists(profile_path)) {
+            sites = std::make_unique<SiteProfile>(
+                SiteProfile::from_json(json::parse(std::ifstream(profile_path))));
+            if (verbose) std::cout << "  Profile: reusing " << sites->sites.size() << " injection sites\n";
+        } else {
+            // sampled like the golden runs are run, and never cut short
+            struct fij_params golden = base_params;
+            golden.hang_detect   = 0;
+            golden.watch_masked  = 0;
+            golden.cpu_budget_ns = 0;
+            golden.digest_mode   = FIJ_DIGEST_OFF;
+            sites = std::make_unique<SiteProfile>(profile_injection_sites(
+                device, golden, stage_path / "no_inj" / "profile", profile, num_threads,
+                pre_delay_ms, max_retries, retry_delay_ms, verbose));
+            std::ofstream(profile_path) << sites->to_json().dump(2) << "\n";
+        }
+    }
+    // a planned fault the target does not live long enough for is given up after this
+    const int plan_attempts = 3;
+
+    // the weighted estimates decide when a stratified campaign has enough runs
+    auto enough_runs = [&]() {
+        return planner ? planner->within_margin(stopping) : tracker.satisfied();
+    };
+
+    // runs journaled by an earlier invocation are not redone
+    int runs_todo = runs;
+    for (const auto &[i, done] : journal_state.completed) {
+        if (i < 0 || i >= runs) continue;
+        inj_times[i]   = done.dt;
+        inj_results[i] = done.result;
+        runs_todo--;
+        if (telemetry) {
+            telemetry->record_outcome(done.result);
+            telemetry->runs_done++;
+        }
+        // runs journaled without a class (stop_margin was off) are left out
+        RunClass c;
+        if (tracking && run_class_from_name(done.run_class, c))
+            tracker.add(c, done.result.memory_flip == 1);
+        if (planner) planner->restore(done.stratum, done.result, done.run_class);
+    }
+    if (tracking && enough_runs()) stop_early = true;
+
+    if (verbose) {
+        std::cout << "\nPhase 2: running " << runs_todo
+                  << " IOCTL calls with injection (no_injection=0, ";
+        if (sites)
+            std::cout << "at " << sites->sites.size() << " profiled sites)\n";
+        else
+            std::cout << "max_delay_ms=" << delay_window_ms
+                      << (base_params.delay_clock == FIJ_DELAY_CPU ? " of CPU time" : "") << ")\n";
+    }
 
     #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
     for (int i = 0; i < runs; ++i) {
+        if (inj_times[i] >= 0.0 || stop_early.load(std::memory_order_relaxed)) continue;
 
         bool successful_injection = false;
+        TelemetryGauge busy(telemetry ? &telemetry->busy_workers : nullptr);
+
+        int stratum = planner ? planner->next() : -1;
+        if (planner && stratum < 0) continue;   // nothing left that can be sampled
+        int attempts = 0;
+        // a drawn execution the run did not reach is replaced by another draw
+        int draws = 0;
+        int site = -1;
+        std::uint64_t site_hit = 0;
+
+        std::string cache_key;
+        CachedOutcome cached;
+        bool cache_hit = false, cache_verify = false;
+        if (cache) {
+            cache_key    = cache->key((*plan)[i]);
+            cache_hit    = cache->lookup(cache_key, cached);
+            cache_verify = cache_hit && cache->sampled_for_verify(cache_key);
+        }
+        // the recorded outcome stands in for the run: no outputs, the analyzer takes its class
+        if (cache_hit && !cache_verify) {
+            struct fij_result res = cached.result;
+            res.iteration_number = i;
+            inj_times[i]   = cached.dt;
+            inj_results[i] = res;
+            if (telemetry) {
+                telemetry->record_outcome(res);
+                telemetry->runs_done++;
+            }
+
+            json extra = json::object();
+            extra["fault"]  = planned_fault_to_json((*plan)[i], i);
+            extra["cached"] = {
+                {"key", cache_key}, {"class", run_class_name(cached.run_class)},
+                {"seen", cached.seen}, {"campaign", cached.campaign}, {"run", cached.run},
+            };
+            log_injection_iteration(run_dir_path(campaign_path, i, retention.shard_size), i,
+                                    cached.dt, res, false, extra);
+
+            json rec;
+            rec["type"]    = "run";
+            rec["i"]       = i;
+            rec["dt"]      = cached.dt;
+            rec["outcome"] = outcome_name(classify_outcome(res));
+            rec["result"]  = journal_encode_result(res);
+            rec["class"]   = run_class_name(cached.run_class);
+            rec["cached"]  = true;
+            journal.append(rec);
+
+            if (tracking) {
+                tracker.add(cached.run_class, res.memory_flip == 1);
+                if (!stop_early && enough_runs() && !stop_early.exchange(true)) {
+                    #pragma omp critical(fij_io)
+                    std::cout << "  Outcome rates within +/-" << stopping.margin
+                              << " at " << stopping.confidence * 100.0 << "% confidence after "
+                              << tracker.runs() << " classified runs, stopping early\n";
+                }
+            }
+            continue;
+        }
 
         while (!successful_injection) {
 
+            std::uint64_t run_start = timeline_now_ns();
             try {
-                fs::path run_dir = campaign_path / ("injection_" + std::to_string(i));
+                fs::path keep_dir = run_dir_path(campaign_path, i, retention.shard_size);
+                fs::path run_dir  = staging ? stage_path / keep_dir.filename() : keep_dir;
     
                 fs::create_directories(run_dir);
     
-                std::string expanded_args = args_template;
-                {
-                    std::string campaign_placeholder = "{campaign}";
-                    std::string run_placeholder      = "{run}";
-                    std::string campaign_str         = campaign_path.string();
-                    std::string run_str              = std::to_string(i);
-    
-                    std::size_t pos = 0;
-                    while ((pos = expanded_args.find(campaign_placeholder, pos)) != std::string::npos) {
-                        expanded_args.replace(pos, campaign_placeholder.size(), campaign_str);
-                        pos += campaign_str.size();
-                    }
-                    pos = 0;
-                    while ((pos = expanded_args.find(run_placeholder, pos)) != std::string::npos) {
-                        expanded_args.replace(pos, run_placeholder.size(), run_str);
-                        pos += run_str.size();
-                    }
-                }
+                // the folder holding injection_<run>: staging area or shard
+                std::string campaign_str  = run_dir.parent_path().string();
+                std::string expanded_args = expand_run_placeholders(args_template, campaign_str, i);
     
                 struct fij_params per_run_params = base_params;  // per-iteration copy
                 set_cstring(per_run_params.process_args, expanded_args);
+                // A loop that outlives twice the whole golden run is not golden behaviour
+                if (per_run_params.hang_detect && per_run_params.hang_window_ms == 0)
+                    per_run_params.hang_window_ms = 2 * max_delay_ms;
     
                 fs::path run_log_path = run_dir / "log.txt";
                 set_cstring(per_run_params.log_path, run_log_path.string());
                 per_run_params.iteration_number = i;
+
+                int window_max_ms = delay_window_ms;
+                if (stratum >= 0) planner->apply(stratum, per_run_params, window_max_ms);
+                if (plan) apply_planned_fault(per_run_params, (*plan)[i]);
+                if (sites) {
+                    std::tie(site, site_hit) = sites->draw(std::stoull(config_hash, nullptr, 16), i, draws++);
+                    apply_profile_site(per_run_params, sites->sites[site], site_hit);
+                }
+
+                std::unique_ptr<FingerprintSlot> fp_slot;
+                if (fingerprinting) {
+                    fp_slot = std::make_unique<FingerprintSlot>(slot_prefix + std::to_string(i));
+                    set_fingerprint_env(per_run_params, *fp_slot, fingerprint_sink, campaign_str, i);
+                }
     
+                std::string output;
                 auto [dt, res] = fij_detail::run_send_and_poll(
                     device,
                     per_run_params,
@@ -283,15 +797,64 @@ CampaignResult run_injection_campaign(
                     0,              // no_injection = 0, the function has to inject a fault
                     pre_delay_ms,
                     max_retries,
-                    retry_delay_ms
+                    retry_delay_ms,
+                    1,              // poll_interval_ms
+                    telemetry,
+                    &output,
+                    window_max_ms
                 );
+                if (telemetry) telemetry->attempts++;
+                if (stratum >= 0) planner->observe_layout(stratum, res);
+
+                #pragma omp critical(timeline_collect)
+                timeline_runs.push_back(timeline_run(omp_get_thread_num(), i,
+                                                     res.fault_injected ? "injection" : "retry",
+                                                     run_start, timeline_now_ns(), &res));
+
+                // a memory region the target does not have: try another stratum
+                if (!res.fault_injected && stratum >= 0 && !planner->usable(stratum)) {
+                    stratum = planner->next();
+                    if (stratum < 0) break;
+                }
+                // the plan is fixed: a fault that keeps missing the target is left out
+                if (!res.fault_injected && plan && ++attempts >= plan_attempts) {
+                    #pragma omp critical(fij_io)
+                    std::cout << "  Planned fault " << i << " not injected after " << attempts
+                              << " attempts, run left out\n";
+                    break;
+                }
 
                 if( res.fault_injected ) {
 
                     successful_injection = true;
+                    if (telemetry) {
+                        telemetry->record_outcome(res);
+                        telemetry->runs_done++;
+                    }
 
                     inj_times[i]   = dt;
                     inj_results[i] = res;
+
+                    FingerprintMap run_fp;
+                    json extra = json::object();
+                    if (plan) extra["fault"] = planned_fault_to_json((*plan)[i], i);
+                    if (sites) {
+                        const ProfileSite &s = sites->sites[site];
+                        std::ostringstream off, fn_off;
+                        off << "0x" << std::hex << s.offset;
+                        fn_off << "0x" << std::hex << s.function_offset;
+                        extra["site"] = {
+                            {"path", s.path}, {"offset", off.str()}, {"function", s.function},
+                            {"function_offset", fn_off.str()},
+                            {"hit", site_hit}, {"hits", s.hits},
+                        };
+                    }
+                    if (fp_slot) {
+                        run_fp = fp_slot->read();
+                        extra["fingerprint"] = fingerprint_to_json(run_fp);
+                    }
+                    // before retention, which compares it with golden like any output
+                    if (per_run_params.capture_output) write_captured_log(run_log_path, output, res);
         
                     if ( (i + 1) % 100 == 0 || i == runs - 1 ) {
                         std::cout << "dt=" << dt
@@ -308,11 +871,82 @@ CampaignResult run_injection_campaign(
                         }
                     }
         
-                    log_injection_iteration(campaign_path, i, dt, res);
+                    // compared with golden only when something needs it before the analyzer
+                    bool outputs_same = true;
+                    bool clean_exit = res.exit_code == 0 && res.watch_status != FIJ_WATCH_MASKED &&
+                                      !res.converged;
+                    if ((staging || tracking || planner || cache) && clean_exit)
+                        outputs_same = run_outputs_match_golden(run_dir, golden_dir, golden_fp, run_fp);
+                    RunClass run_class = classify_run(res, outputs_same);
+                    if (cache_verify) {
+                        bool same = cache->verify(cache_key, cached, run_class, res, i);
+                        extra["cache_verify"] = {
+                            {"key", cache_key}, {"cached", run_class_name(cached.run_class)},
+                            {"match", same},
+                        };
+                        if (!same) {
+                            #pragma omp critical(fij_io)
+                            std::cout << "  Run " << i << ": " << run_class_name(run_class)
+                                      << ", cached " << run_class_name(cached.run_class)
+                                      << " from " << cached.campaign << " run " << cached.run
+                                      << ", target is not deterministic under this fault\n";
+                        }
+                    } else if (cache) {
+                        cache->store(cache_key, run_class, res, dt, i);
+                    }
+                    if (stratum >= 0 && !planner->in_bin(stratum, res)) {
+                        planner->out_of_bin(stratum);
+                        extra["stratum"] = planner->name(stratum);
+                        #pragma omp critical(fij_io)
+                        std::cout << "  Run " << i << ": injected after " << res.injection_time_ns
+                                  << " ns, outside the delay bin of " << planner->name(stratum)
+                                  << ", not counted in the stratum\n";
+                    } else if (stratum >= 0) {
+                        planner->add(stratum, run_class);
+                        extra["stratum"] = planner->name(stratum);
+                    }
+
+                    if (staging) {
+                        bool keep = retain_run_outputs(res, outputs_same, i, retention,
+                                                       slowdown_cpu_ns);
+                        if (keep) {
+                            move_run_dir(run_dir, keep_dir);
+                            outputs_kept++;
+                        } else {
+                            fs::remove_all(run_dir);
+                        }
+                        log_injection_iteration(keep_dir, i, dt, res, keep, extra);
+                    } else {
+                        log_injection_iteration(run_dir, i, dt, res, true, extra);
+                    }
+
+                    // only now is the run complete on disk
+                    json rec;
+                    rec["type"]    = "run";
+                    rec["i"]       = i;
+                    rec["dt"]      = dt;
+                    rec["outcome"] = outcome_name(classify_outcome(res));
+                    rec["result"]  = journal_encode_result(res);
+                    if (staging || tracking || planner || cache) rec["class"] = run_class_name(run_class);
+                    if (stratum >= 0) rec["stratum"] = stratum;
+                    journal.append(rec);
+
+                    if (tracking) {
+                        tracker.add(run_class, res.memory_flip == 1);
+                        if (!stop_early && enough_runs() && !stop_early.exchange(true)) {
+                            #pragma omp critical(fij_io)
+                            std::cout << "  Outcome rates within +/-" << stopping.margin
+                                      << " at " << stopping.confidence * 100.0 << "% confidence after "
+                                      << tracker.runs() << " classified runs, stopping early\n";
+                        }
+                    }
                 }
     
                 
             } catch (const std::system_error &e) {
+                #pragma omp critical(timeline_collect)
+                timeline_runs.push_back(timeline_run(omp_get_thread_num(), i, "error",
+                                                     run_start, timeline_now_ns(), nullptr));
                 if (verbose) {
                     #pragma omp critical(fij_io)
                     {
@@ -357,6 +991,10 @@ CampaignResult run_injection_campaign(
         std::cout << "  Average: " << (avg * 1000.0) << " ms\n";
         std::cout << "  Std dev: " << (stddev * 1000.0) << " ms\n";
         std::cout << "  Campaign time: " << campaign_total << "\n";
+        if (staging) {
+            std::cout << "  Outputs kept: " << outputs_kept.load() << "/" << successful_times.size()
+                      << " runs (the others only kept their JSON)\n";
+        }
         std::cout << "=== Campaign end ===\n\n";
     }
 
@@ -367,13 +1005,51 @@ CampaignResult run_injection_campaign(
     cr.injection_requested = runs;
     cr.injection_success   = static_cast<int>(successful_times.size());
     cr.avg_ms              = avg * 1000.0;
+    cr.campaign_path       = campaign_path;
     cr.std_ms              = stddev * 1000.0;
+    cr.workers             = num_threads;
+    cr.baseline_s          = baseline_total;
+    cr.injection_s         = campaign_total;
 
     for (double t : successful_times) {
         cr.inj_times_ms.push_back(t * 1000.0);
     }
 
-    analyze_injection_campaign(campaign_path, runs);
+    if (telemetry) telemetry->set_phase(TELEMETRY_ANALYSIS);
+    std::uint64_t analysis_start = timeline_now_ns();
+    cr.outcomes = analyze_injection_campaign(campaign_path, runs);
+    timeline_spans.push_back({"analysis", analysis_start, timeline_now_ns()});
+    cr.analysis_s = (timeline_now_ns() - analysis_start) / 1e9;
+
+    // the analyzer recreates diff/, so the reports go in afterwards
+    std::uint64_t report_start = timeline_now_ns();
+    write_latency_report(campaign_path / "diff", baseline_results, baseline_times,
+                         inj_results, inj_times, verbose);
+    if (tracking) {
+        json doc = tracker.report();
+        doc["runs_planned"]  = runs;
+        doc["runs_done"]     = static_cast<int>(successful_times.size());
+        doc["stopped_early"] = stop_early.load();
+        std::ofstream(campaign_path / "diff" / "stopping.json") << doc.dump(2) << "\n";
+    }
+    if (planner) {
+        std::ofstream(campaign_path / "diff" / "strata.json")
+            << planner->report(stopping.confidence).dump(2) << "\n";
+    }
+    if (cache) {
+        json doc = cache->report();
+        std::ofstream(campaign_path / "diff" / "cache.json") << doc.dump(2) << "\n";
+        if (verbose) {
+            std::cout << "  Outcome cache: " << doc["hits"] << " hits, " << doc["misses"]
+                      << " misses, " << doc["verified"] << " verified, "
+                      << doc["mismatches"].size() << " nondeterministic\n";
+        }
+    }
+    timeline_spans.push_back({"latency report", report_start, timeline_now_ns()});
+
+    cr.timeline_runs  = std::move(timeline_runs);
+    cr.timeline_spans = std::move(timeline_spans);
 
+    if (telemetry) telemetry->set_phase(TELEMETRY_DONE);
     return cr;
 }
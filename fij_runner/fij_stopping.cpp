@@ -0,0 +1,211 @@
+#include "fij.hpp"
+
+#include <cmath>
+
+// -----------------------------------------------------------------------------
+// Statistical early stopping (stop_margin)
+// -----------------------------------------------------------------------------
+//
+// Statistical fault injection sizes a campaign by the precision wanted on
+// the outcome rates rather than by a fixed run count. Every injected run is
+// classified as it completes, the way the analyzer will (masked runs count
+// as benign), and the runner keeps a binomial confidence interval for the
+// CRASH, HANG, SDC and BENIGN rates, over all runs and over the register
+// and memory runs separately. Once every interval is within stop_margin of
+// its estimate no new run is started.
+
+namespace {
+
+const char *kGroupNames[3] = {"all", "register", "memory"};
+
+double normal_cdf(double x) {
+    return 0.5 * std::erfc(-x / std::sqrt(2.0));
+}
+
+// two-sided critical value of the standard normal, by bisection
+double normal_quantile(double p) {
+    double lo = -40.0, hi = 40.0;
+    for (int k = 0; k < 200; ++k) {
+        double mid = 0.5 * (lo + hi);
+        if (normal_cdf(mid) < p) lo = mid; else hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+// continued fraction of the incomplete beta function (modified Lentz)
+double beta_cf(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1.0;
+    double d = 1.0 - (a + b) * x / (a + 1.0);
+    if (std::fabs(d) < tiny) d = tiny;
+    d = 1.0 / d;
+    double h = d;
+
+    for (int m = 1; m <= 500; ++m) {
+        double m2 = 2.0 * m;
+        double num = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+        d = 1.0 + num * d;
+        if (std::fabs(d) < tiny) d = tiny;
+        c = 1.0 + num / c;
+        if (std::fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        h *= d * c;
+
+        num = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+        d = 1.0 + num * d;
+        if (std::fabs(d) < tiny) d = tiny;
+        c = 1.0 + num / c;
+        if (std::fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        double step = d * c;
+        h *= step;
+        if (std::fabs(step - 1.0) < 1e-14) break;
+    }
+    return h;
+}
+
+// regularized incomplete beta I_x(a, b)
+double beta_inc(double a, double b, double x) {
+    if (x <= 0.0) return 0.0;
+    if (x >= 1.0) return 1.0;
+
+    double ln_front = std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+                      a * std::log(x) + b * std::log1p(-x);
+    double front = std::exp(ln_front);
+    if (x < (a + 1.0) / (a + b + 2.0)) return front * beta_cf(a, b, x) / a;
+    return 1.0 - front * beta_cf(b, a, 1.0 - x) / b;
+}
+
+// x with I_x(a, b) = p
+double beta_quantile(double p, double a, double b) {
+    double lo = 0.0, hi = 1.0;
+    for (int k = 0; k < 100; ++k) {
+        double mid = 0.5 * (lo + hi);
+        if (beta_inc(a, b, mid) < p) lo = mid; else hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+} // namespace
+
+const char *run_class_name(RunClass c) {
+    switch (c) {
+    case RunClass::Benign: return "BENIGN";
+    case RunClass::Sdc:    return "SDC";
+    case RunClass::Crash:  return "CRASH";
+    case RunClass::Hang:   return "HANG";
+    }
+    return "BENIGN";
+}
+
+bool run_class_from_name(const std::string &name, RunClass &c) {
+    for (int k = 0; k < kRunClasses; ++k) {
+        if (name == run_class_name(static_cast<RunClass>(k))) {
+            c = static_cast<RunClass>(k);
+            return true;
+        }
+    }
+    return false;
+}
+
+RunClass classify_run(const struct fij_result &res, bool outputs_same) {
+    // killed on purpose by the module: the fault had no effect on the outputs
+    if (res.watch_status == FIJ_WATCH_MASKED || res.converged) return RunClass::Benign;
+    if (res.exit_code != 0) return res.process_hanged ? RunClass::Hang : RunClass::Crash;
+    return outputs_same ? RunClass::Benign : RunClass::Sdc;
+}
+
+double normal_critical_value(double confidence) {
+    return normal_quantile(0.5 + confidence / 2.0);
+}
+
+RateInterval wilson_interval(int k, int n, double confidence) {
+    if (n <= 0) return {0.0, 0.0, 1.0};
+    double z  = normal_critical_value(confidence);
+    double z2 = z * z;
+    double p  = static_cast<double>(k) / n;
+
+    double centre = (p + z2 / (2.0 * n)) / (1.0 + z2 / n);
+    double half   = z * std::sqrt(p * (1.0 - p) / n + z2 / (4.0 * n * n)) / (1.0 + z2 / n);
+    return {p, std::max(0.0, centre - half), std::min(1.0, centre + half)};
+}
+
+RateInterval clopper_pearson_interval(int k, int n, double confidence) {
+    if (n <= 0) return {0.0, 0.0, 1.0};
+    double alpha = 1.0 - confidence;
+    double p  = static_cast<double>(k) / n;
+    double lo = k == 0 ? 0.0 : beta_quantile(alpha / 2.0, k, n - k + 1);
+    double hi = k == n ? 1.0 : beta_quantile(1.0 - alpha / 2.0, k + 1, n - k);
+    return {p, lo, hi};
+}
+
+// -----------------------------------------------------------------------------
+// StoppingTracker
+// -----------------------------------------------------------------------------
+
+StoppingTracker::StoppingTracker(const StoppingRule &r) : rule(r) {}
+
+void StoppingTracker::add(RunClass c, bool memory) {
+    std::lock_guard<std::mutex> guard(lock);
+    counts[0][static_cast<int>(c)]++;
+    counts[memory ? 2 : 1][static_cast<int>(c)]++;
+}
+
+int StoppingTracker::runs() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return group_runs(0);
+}
+
+int StoppingTracker::group_runs(int g) const {
+    int n = 0;
+    for (int k = 0; k < kRunClasses; ++k) n += counts[g][k];
+    return n;
+}
+
+RateInterval StoppingTracker::interval(int k, int n) const {
+    if (rule.method == "clopper-pearson") return clopper_pearson_interval(k, n, rule.confidence);
+    return wilson_interval(k, n, rule.confidence);
+}
+
+bool StoppingTracker::satisfied() const {
+    if (rule.margin <= 0.0) return false;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (group_runs(0) < std::max(rule.min_runs, 1)) return false;
+
+    for (int g = 0; g < (rule.per_location ? 3 : 1); ++g) {
+        int n = group_runs(g);
+        if (n == 0) continue;   // no fault of this kind in the campaign
+        for (int k = 0; k < kRunClasses; ++k) {
+            RateInterval ci = interval(counts[g][k], n);
+            if (std::max(ci.p - ci.lo, ci.hi - ci.p) > rule.margin) return false;
+        }
+    }
+    return true;
+}
+
+json StoppingTracker::report() const {
+    std::lock_guard<std::mutex> guard(lock);
+
+    json doc;
+    doc["margin"]       = rule.margin;
+    doc["confidence"]   = rule.confidence;
+    doc["method"]       = rule.method;
+    doc["min_runs"]     = rule.min_runs;
+    doc["per_location"] = rule.per_location;
+
+    json groups = json::object();
+    for (int g = 0; g < 3; ++g) {
+        int n = group_runs(g);
+        json rates = json::object();
+        for (int k = 0; k < kRunClasses; ++k) {
+            RateInterval ci = interval(counts[g][k], n);
+            rates[run_class_name(static_cast<RunClass>(k))] = {
+                {"count", counts[g][k]}, {"rate", ci.p}, {"lo", ci.lo}, {"hi", ci.hi},
+            };
+        }
+        groups[kGroupNames[g]] = {{"runs", n}, {"rates", rates}};
+    }
+    doc["groups"] = groups;
+    return doc;
+}
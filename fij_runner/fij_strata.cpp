@@ -0,0 +1,377 @@
+#include "fij.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// -----------------------------------------------------------------------------
+// Stratified allocation of runs (stratify)
+// -----------------------------------------------------------------------------
+//
+// Without a planner every run draws its fault at random: register or memory
+// by weight_mem, then register, bit and time, so each part of the fault space
+// gets runs in proportion to its size. The planner cuts the space into
+// strata (register bit range x time bin, memory region class x time bin),
+// pins every run to one of them through target_reg/reg_bit, only_mem,
+// mem_region and the delay window, and allocates each batch of runs by
+// Neyman allocation: more runs where the outcome varies more. Estimates are
+// the stratum rates weighted by each stratum's share of the unstratified
+// fault space, so they stay unbiased while their error bars shrink faster.
+
+namespace {
+
+const char *kRegionNames[FIJ_MEM_REGIONS] = {
+    "any", "text", "rodata", "data", "heap", "stack", "anon",
+};
+
+// classes that stopping and the estimates report, in RunClass order
+constexpr int kClasses = kRunClasses;
+
+} // namespace
+
+StrataPlanner::StrataPlanner(const StrataOptions &o, const struct fij_params &base,
+                             int max_delay_ms, std::uint64_t seed)
+    : opt(o), rng(seed) {
+    // how the unstratified draw splits register and memory flips
+    double p_reg = 1.0;
+    if (base.only_mem)                      p_reg = 0.0;
+    else if (base.target_reg != FIJ_REG_NONE) p_reg = 1.0;
+    else if (base.weight_mem > 0)           p_reg = 1.0 / (1.0 + base.weight_mem);
+
+    // The module draws the delay uniformly over [lo, hi] ms to the
+    // microsecond, so the bins split that interval at whole ms and share
+    // their edges; a bin's share of time is its length.
+    std::vector<std::pair<int, int>> bins;
+    std::vector<double> bin_share;
+    if (base.target_pc_present) {
+        bins.push_back({0, 0});     // the uprobe decides when, not the delay
+        bin_share.push_back(1.0);
+    } else {
+        int lo = std::max(base.min_delay_ms, 0);
+        int hi = std::max({max_delay_ms, lo, 1});   // 0 would be the module's default window
+        int span = hi - lo;
+        int t_bins = std::clamp(opt.time_bins, 1, std::max(span, 1));
+        for (int t = 0; t < t_bins; ++t) {
+            int a = lo + static_cast<int>(static_cast<long long>(span) * t / t_bins);
+            int b = lo + static_cast<int>(static_cast<long long>(span) * (t + 1) / t_bins);
+            bins.push_back({a, b});
+            bin_share.push_back(span > 0 ? static_cast<double>(b - a) / span : 1.0);
+        }
+    }
+    time_bins = static_cast<int>(bins.size());
+
+    auto add = [&](bool memory, int reg, int bit_lo, int bit_hi, int region, int t,
+                   double weight) {
+        Stratum s;
+        s.memory   = memory;
+        s.reg      = reg;
+        s.bit_lo   = bit_lo;
+        s.bit_hi   = bit_hi;
+        s.region   = region;
+        s.time_bin = t;
+        s.delay_lo = bins[t].first;
+        s.delay_hi = bins[t].second;
+        s.base_weight = weight;
+
+        std::ostringstream name;
+        if (memory) {
+            name << "mem:" << kRegionNames[region];
+        } else {
+            name << "reg";
+            if (reg != FIJ_REG_NONE) name << reg;
+            name << ":" << bit_lo << "-" << bit_hi;
+        }
+        if (time_bins > 1) name << "@t" << t;
+        s.name = name.str();
+        strata.push_back(s);
+    };
+
+    if (p_reg > 0.0) {
+        std::vector<int> regs;
+        if (base.target_reg != FIJ_REG_NONE) regs.push_back(base.target_reg);
+        else if (opt.per_register)
+            for (int r = FIJ_REG_NONE + 1; r < FIJ_REG_MAX; ++r) regs.push_back(r);
+        else regs.push_back(FIJ_REG_NONE);     // the module picks, as without a planner
+
+        std::vector<std::pair<int, int>> bit_ranges;
+        if (base.reg_bit_present) {
+            bit_ranges.push_back({base.reg_bit, base.reg_bit});
+        } else {
+            int b_bins = std::clamp(opt.bit_bins, 1, 64);
+            for (int b = 0; b < b_bins; ++b)
+                bit_ranges.push_back({64 * b / b_bins, 64 * (b + 1) / b_bins - 1});
+        }
+
+        for (int reg : regs)
+            for (const auto &[blo, bhi] : bit_ranges)
+                for (int t = 0; t < time_bins; ++t)
+                    add(false, reg, blo, bhi, FIJ_MEM_ANY, t,
+                        p_reg / regs.size() * (bhi - blo + 1) / 64.0 * bin_share[t]);
+    }
+
+    if (p_reg < 1.0) {
+        for (int t = 0; t < time_bins; ++t) {
+            if (!opt.mem_regions) {
+                add(true, FIJ_REG_NONE, 0, 7, FIJ_MEM_ANY, t, (1.0 - p_reg) * bin_share[t]);
+                continue;
+            }
+            // times the region's share of the mappings, learnt from the runs
+            for (int r = FIJ_MEM_ANY + 1; r < FIJ_MEM_REGIONS; ++r)
+                add(true, FIJ_REG_NONE, 0, 7, r, t, (1.0 - p_reg) * bin_share[t]);
+        }
+    }
+
+    layout_sum.assign(time_bins + 1, std::vector<double>(FIJ_MEM_REGIONS, 0.0));
+    layout_runs.assign(time_bins + 1, 0);
+}
+
+double StrataPlanner::weight(int h) const {
+    const Stratum &s = strata[h];
+    if (!s.memory || s.region == FIJ_MEM_ANY) return s.base_weight;
+
+    // mean share of the region's mappings in this time bin, else over all bins
+    int row = layout_runs[s.time_bin] > 0 ? s.time_bin : time_bins;
+    if (layout_runs[row] == 0) return s.base_weight / (FIJ_MEM_REGIONS - 1);
+    return s.base_weight * layout_sum[row][s.region] / layout_runs[row];
+}
+
+void StrataPlanner::observe_layout(int h, const struct fij_result &res) {
+    // the unstratified draw picks a mapping, then a byte in it
+    const __u32 *vmas = res.mem_region_vmas;
+    if (h < 0 || h >= static_cast<int>(strata.size()) || vmas[FIJ_MEM_ANY] == 0) return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    for (int row : {strata[h].time_bin, time_bins}) {
+        for (int r = FIJ_MEM_ANY + 1; r < FIJ_MEM_REGIONS; ++r)
+            layout_sum[row][r] += static_cast<double>(vmas[r]) / vmas[FIJ_MEM_ANY];
+        layout_runs[row]++;
+    }
+}
+
+void StrataPlanner::plan_batch() {
+    int n = static_cast<int>(strata.size());
+    std::vector<int> batch;
+
+    // every stratum that can be sampled gets its pilot runs first
+    for (int h = 0; h < n; ++h) {
+        if (weight(h) <= 0.0) continue;
+        for (int k = strata[h].assigned; k < opt.pilot; ++k) batch.push_back(h);
+    }
+
+    if (batch.empty()) {
+        // Neyman: n_h proportional to W_h S_h, S_h from the worst tracked rate
+        std::vector<double> ws(n, 0.0);
+        int assigned = 0;
+        for (int h = 0; h < n; ++h) {
+            assigned += strata[h].assigned;
+            double w = weight(h);
+            if (w <= 0.0) continue;
+            double s2 = 0.0;
+            for (int c = 0; c < kClasses; ++c) {
+                // smoothed so a stratum that looked uniform so far is not starved
+                double p = (strata[h].counts[c] + 0.5) / (strata[h].done + 1.0);
+                s2 = std::max(s2, p * (1.0 - p));
+            }
+            ws[h] = w * std::sqrt(s2);
+        }
+        double total = std::accumulate(ws.begin(), ws.end(), 0.0);
+        if (total <= 0.0) return;
+
+        int size = std::max(opt.batch, 1);
+        std::vector<double> deficit(n, 0.0);
+        double deficit_sum = 0.0;
+        for (int h = 0; h < n; ++h) {
+            double target = (assigned + size) * ws[h] / total;
+            deficit[h] = std::max(0.0, target - strata[h].assigned);
+            deficit_sum += deficit[h];
+        }
+
+        // largest remainder over the deficits
+        std::vector<std::pair<double, int>> rest;
+        int given = 0;
+        for (int h = 0; h < n; ++h) {
+            if (deficit[h] <= 0.0) continue;
+            double share = size * deficit[h] / deficit_sum;
+            int k = static_cast<int>(share);
+            for (int j = 0; j < k; ++j) batch.push_back(h);
+            given += k;
+            rest.push_back({share - k, h});
+        }
+        std::sort(rest.rbegin(), rest.rend());
+        for (std::size_t j = 0; given < size && j < rest.size(); ++j, ++given)
+            batch.push_back(rest[j].second);
+    }
+
+    std::shuffle(batch.begin(), batch.end(), rng);
+    for (int h : batch) strata[h].assigned++;
+    queue.insert(queue.end(), batch.begin(), batch.end());
+}
+
+int StrataPlanner::next() {
+    std::lock_guard<std::mutex> guard(lock);
+    // strata found empty since they were queued are skipped
+    while (true) {
+        if (queue.empty()) plan_batch();
+        if (queue.empty()) return -1;
+        int h = queue.front();
+        queue.pop_front();
+        if (weight(h) > 0.0) return h;
+        strata[h].assigned--;
+    }
+}
+
+void StrataPlanner::restore(int h, const struct fij_result &res, const std::string &run_class) {
+    if (h < 0 || h >= static_cast<int>(strata.size())) return;
+    observe_layout(h, res);
+
+    std::lock_guard<std::mutex> guard(lock);
+    strata[h].assigned++;
+    RunClass c;
+    if (res.fault_injected && !in_bin(h, res)) {
+        strata[h].outside++;
+    } else if (run_class_from_name(run_class, c)) {
+        strata[h].done++;
+        strata[h].counts[static_cast<int>(c)]++;
+    }
+}
+
+bool StrataPlanner::usable(int h) const {
+    std::lock_guard<std::mutex> guard(lock);
+    return weight(h) > 0.0;
+}
+
+void StrataPlanner::apply(int h, struct fij_params &p, int &window_max_ms) {
+    const Stratum &s = strata[h];
+
+    if (s.memory) {
+        p.only_mem   = 1;
+        p.target_reg = FIJ_REG_NONE;
+        p.mem_region = s.region;
+    } else {
+        p.only_mem   = 0;
+        p.weight_mem = 0;       // registers only
+        p.target_reg = s.reg;
+        std::lock_guard<std::mutex> guard(lock);
+        p.reg_bit_present = 1;
+        p.reg_bit = std::uniform_int_distribution<int>(s.bit_lo, s.bit_hi)(rng);
+    }
+
+    if (!p.target_pc_present) {
+        p.min_delay_ms = s.delay_lo;
+        window_max_ms  = std::max(s.delay_hi, 1);
+    }
+}
+
+bool StrataPlanner::in_bin(int h, const struct fij_result &res) const {
+    const Stratum &s = strata[h];
+    if (time_bins == 1 && s.delay_lo == 0 && s.delay_hi == 0) return true;   // target_pc
+    return res.injection_time_ns >= static_cast<__u64>(s.delay_lo) * 1000000ULL &&
+           res.injection_time_ns <= static_cast<__u64>(s.delay_hi) * 1000000ULL;
+}
+
+void StrataPlanner::out_of_bin(int h) {
+    std::lock_guard<std::mutex> guard(lock);
+    strata[h].outside++;
+}
+
+void StrataPlanner::add(int h, RunClass c) {
+    std::lock_guard<std::mutex> guard(lock);
+    strata[h].done++;
+    strata[h].counts[static_cast<int>(c)]++;
+}
+
+const std::string &StrataPlanner::name(int h) const {
+    return strata[h].name;
+}
+
+// weighted rate and its standard error over the strata of a group
+StrataPlanner::Estimate StrataPlanner::estimate(int group, int c) const {
+    Estimate e;
+    double w_all = 0.0, w_seen = 0.0;
+    for (std::size_t h = 0; h < strata.size(); ++h) {
+        const Stratum &s = strata[h];
+        if ((group == 1 && s.memory) || (group == 2 && !s.memory)) continue;
+        double w = weight(static_cast<int>(h));
+        w_all += w;
+        if (s.done == 0) continue;
+        w_seen += w;
+    }
+    if (w_seen <= 0.0) return e;
+
+    for (std::size_t h = 0; h < strata.size(); ++h) {
+        const Stratum &s = strata[h];
+        if ((group == 1 && s.memory) || (group == 2 && !s.memory) || s.done == 0) continue;
+        double w = weight(static_cast<int>(h)) / w_seen;
+        double p = static_cast<double>(s.counts[c]) / s.done;
+        double p_var = (s.counts[c] + 0.5) / (s.done + 1.0);    // no zero variance at small n
+        e.rate += w * p;
+        e.var  += w * w * p_var * (1.0 - p_var) / s.done;
+    }
+    e.runs = 0;
+    for (const auto &s : strata)
+        if (!((group == 1 && s.memory) || (group == 2 && !s.memory))) e.runs += s.done;
+    e.unsampled = w_all > 0.0 ? (w_all - w_seen) / w_all : 0.0;
+    return e;
+}
+
+bool StrataPlanner::within_margin(const StoppingRule &rule) const {
+    if (rule.margin <= 0.0) return false;
+    double z = normal_critical_value(rule.confidence);
+
+    std::lock_guard<std::mutex> guard(lock);
+    int runs = 0;
+    for (const auto &s : strata) runs += s.done;
+    if (runs < std::max(rule.min_runs, 1)) return false;
+
+    for (int g = 0; g < (rule.per_location ? 3 : 1); ++g) {
+        for (int c = 0; c < kClasses; ++c) {
+            Estimate e = estimate(g, c);
+            if (g > 0 && e.runs == 0) continue;     // no fault of this kind
+            if (e.unsampled > 0.0 || z * std::sqrt(e.var) > rule.margin) return false;
+        }
+    }
+    return true;
+}
+
+json StrataPlanner::report(double confidence) const {
+    double z = normal_critical_value(confidence);
+
+    std::lock_guard<std::mutex> guard(lock);
+    json doc;
+    doc["confidence"] = confidence;
+
+    json rows = json::array();
+    for (std::size_t h = 0; h < strata.size(); ++h) {
+        const Stratum &s = strata[h];
+        json counts = json::object();
+        for (int c = 0; c < kClasses; ++c)
+            counts[run_class_name(static_cast<RunClass>(c))] = s.counts[c];
+        rows.push_back({
+            {"name", s.name}, {"weight", weight(static_cast<int>(h))},
+            {"runs", s.done}, {"counts", counts}, {"outside_bin", s.outside},
+            {"delay_ms", {s.delay_lo, s.delay_hi}},
+        });
+    }
+    doc["strata"] = rows;
+
+    const char *groups[3] = {"all", "register", "memory"};
+    json est = json::object();
+    for (int g = 0; g < 3; ++g) {
+        json rates = json::object();
+        int runs = 0;
+        double unsampled = 0.0;
+        for (int c = 0; c < kClasses; ++c) {
+            Estimate e = estimate(g, c);
+            double se = std::sqrt(e.var);
+            rates[run_class_name(static_cast<RunClass>(c))] = {
+                {"rate", e.rate}, {"stderr", se},
+                {"lo", std::max(0.0, e.rate - z * se)}, {"hi", std::min(1.0, e.rate + z * se)},
+            };
+            runs = e.runs;
+            unsampled = e.unsampled;
+        }
+        est[groups[g]] = {{"runs", runs}, {"unsampled_weight", unsampled}, {"rates", rates}};
+    }
+    doc["estimates"] = est;
+    return doc;
+}
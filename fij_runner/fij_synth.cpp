@@ -0,0 +1,249 @@
+#include "fij.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <omp.h>
+
+#include <random>
+
+// -----------------------------------------------------------------------------
+// Synthetic campaigns and the analyzer benchmark
+// -----------------------------------------------------------------------------
+//
+// generate_synthetic_campaign writes a campaign folder the way a real one
+// looks after run_injection_campaign: golden outputs in no_inj/injection_0,
+// and injection_<i>/ with the run JSON (written by log_injection_iteration)
+// plus a text log, a PNG and a binary output. Runs are drawn as SDC, crash,
+// hang or benign in the requested mix, so analyze_injection_campaign can be
+// timed at any scale without a module or a target.
+
+namespace {
+
+const char *kLogName   = "log.txt";
+const char *kImageName = "output.png";
+const char *kBinName   = "output.bin";
+
+enum class SynthOutcome { Benign, Sdc, Crash, Hang };
+
+std::string golden_log(int px, std::size_t bin_bytes) {
+    std::ostringstream oss;
+    oss << "synthetic target\n"
+        << "image " << px << "x" << px << "\n"
+        << "binary " << bin_bytes << " bytes\n"
+        << "checksum 0x5eed\n"
+        << "done\n";
+    return oss.str();
+}
+
+cv::Mat golden_image(int px) {
+    cv::Mat img(px, px, CV_8UC3);
+    for (int y = 0; y < px; ++y) {
+        unsigned char *row = img.ptr(y);
+        for (int x = 0; x < px; ++x) {
+            row[3 * x + 0] = static_cast<unsigned char>(x * 255 / std::max(px - 1, 1));
+            row[3 * x + 1] = static_cast<unsigned char>(y * 255 / std::max(px - 1, 1));
+            row[3 * x + 2] = static_cast<unsigned char>((x ^ y) & 0xff);
+        }
+    }
+    return img;
+}
+
+std::vector<char> golden_binary(std::size_t bytes, std::uint64_t seed) {
+    std::vector<char> data(bytes);
+    std::mt19937_64 rng(seed);
+    for (auto &c : data) c = static_cast<char>(rng() & 0xff);
+    return data;
+}
+
+void write_bytes(const fs::path &p, const char *data, std::size_t n) {
+    std::ofstream f(p, std::ios::binary);
+    f.write(data, static_cast<std::streamsize>(n));
+}
+
+// the fields the analyzer reads, with plausible values for the rest
+struct fij_result synthetic_result(int i, SynthOutcome kind, std::mt19937_64 &rng) {
+    struct fij_result r;
+    std::memset(&r, 0, sizeof(r));
+    r.iteration_number = i;
+    r.fault_injected   = 1;
+    r.memory_flip      = static_cast<int>(rng() & 1);
+    r.target_address   = 0x400000 + (rng() & 0xfffff);
+    r.target_before    = rng();
+    r.target_after     = r.target_before ^ (1ULL << (rng() & 63));
+    if (!r.memory_flip) set_cstring(r.register_name, "rax");
+
+    switch (kind) {
+    case SynthOutcome::Crash:
+        r.sigal      = SIGSEGV;
+        r.exit_code  = SIGSEGV;
+        r.fault_addr = rng();
+        break;
+    case SynthOutcome::Hang:
+        r.exit_code      = SIGKILL;
+        r.process_hanged = 1;
+        break;
+    default:
+        break;
+    }
+
+    std::uint64_t t = 1000000000ULL + static_cast<std::uint64_t>(i) * 1000000ULL;
+    __u64 *stamps[9] = {
+        &r.ts_exec_start, &r.ts_exec_done, &r.ts_resume, &r.ts_flip_start,
+        &r.ts_flip_stopped, &r.ts_flip_end, &r.ts_exit, &r.ts_monitor_done, &r.ts_collect,
+    };
+    for (auto *s : stamps) *s = (t += 1000 + (rng() & 0xffff));
+    r.injection_time_ns = r.ts_flip_end - r.ts_flip_start;
+    r.cpu_ns    = r.ts_exit - r.ts_resume;
+    r.utime_ns  = r.cpu_ns;
+    r.maxrss_kb = 2048 + (rng() & 0x3ff);
+    return r;
+}
+
+double rate(std::uint64_t count, std::uint64_t ns) {
+    return ns ? static_cast<double>(count) * 1e9 / static_cast<double>(ns) : 0.0;
+}
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// generate_synthetic_campaign
+// -----------------------------------------------------------------------------
+
+void generate_synthetic_campaign(const fs::path &dir, const SynthCampaignOptions &opt) {
+    if (opt.sdc + opt.crash + opt.hang > 1.0)
+        throw std::runtime_error("SDC, crash and hang fractions add up to more than 1");
+
+    fs::remove_all(dir);
+    fs::path golden_dir = dir / "no_inj" / "injection_0";
+    fs::create_directories(golden_dir);
+
+    const std::string log = golden_log(opt.image_px, opt.binary_bytes);
+    const cv::Mat image = golden_image(opt.image_px);
+    const std::vector<char> bin = golden_binary(opt.binary_bytes, opt.seed);
+
+    write_bytes(golden_dir / kLogName, log.data(), log.size());
+    cv::imwrite((golden_dir / kImageName).string(), image);
+    write_bytes(golden_dir / kBinName, bin.data(), bin.size());
+    {
+        std::mt19937_64 rng(opt.seed);
+        struct fij_result golden = synthetic_result(0, SynthOutcome::Benign, rng);
+        golden.fault_injected = 0;
+        log_injection_iteration(golden_dir, 0, 0.1, golden);
+    }
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < opt.runs; ++i) {
+        std::mt19937_64 rng(opt.seed * 0x9e3779b97f4a7c15ULL + static_cast<std::uint64_t>(i));
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+
+        SynthOutcome kind = SynthOutcome::Benign;
+        if (u < opt.sdc)                            kind = SynthOutcome::Sdc;
+        else if (u < opt.sdc + opt.crash)           kind = SynthOutcome::Crash;
+        else if (u < opt.sdc + opt.crash + opt.hang) kind = SynthOutcome::Hang;
+
+        struct fij_result r = synthetic_result(i, kind, rng);
+        fs::path run_dir = dir / ("injection_" + std::to_string(i));
+        log_injection_iteration(run_dir, i, 0.1, r);
+
+        // crashed and hung targets leave a truncated log and nothing else
+        if (kind == SynthOutcome::Crash || kind == SynthOutcome::Hang) {
+            write_bytes(run_dir / kLogName, log.data(), log.size() / 2);
+            continue;
+        }
+
+        // SDC runs corrupt one of the three outputs
+        int corrupt = kind == SynthOutcome::Sdc ? static_cast<int>(rng() % 3) : -1;
+
+        std::string run_log = log;
+        if (corrupt == 0) run_log.replace(run_log.find("0x5eed"), 6, "0x5eef");
+        write_bytes(run_dir / kLogName, run_log.data(), run_log.size());
+
+        if (corrupt == 1) {
+            cv::Mat img = image.clone();
+            int px = opt.image_px;
+            for (int k = 0; k < 4; ++k)
+                img.ptr(static_cast<int>(rng() % px))[3 * (rng() % px)] ^= 0x80;
+            cv::imwrite((run_dir / kImageName).string(), img);
+        } else {
+            fs::copy_file(golden_dir / kImageName, run_dir / kImageName,
+                          fs::copy_options::overwrite_existing);
+        }
+
+        if (corrupt == 2 && !bin.empty()) {
+            std::vector<char> run_bin = bin;
+            run_bin[rng() % run_bin.size()] ^= static_cast<char>(1 << (rng() & 7));
+            write_bytes(run_dir / kBinName, run_bin.data(), run_bin.size());
+        } else {
+            write_bytes(run_dir / kBinName, bin.data(), bin.size());
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// run_analyzer_benchmark
+// -----------------------------------------------------------------------------
+
+void run_analyzer_benchmark(const AnalyzerBenchOptions &opt) {
+    json results = json::array();
+
+    std::cout << std::right << std::setw(10) << "runs" << std::setw(10) << "gen s"
+              << std::setw(10) << "total s" << std::setw(12) << "files/s" << std::setw(12)
+              << "MB/s" << std::setw(10) << "json s" << std::setw(10) << "cmp s"
+              << std::setw(10) << "image s" << std::setw(10) << "copy s" << "\n";
+
+    for (int runs : opt.runs) {
+        SynthCampaignOptions synth = opt.synth;
+        synth.runs = runs;
+        fs::path dir = fs::path(opt.dir) / ("synth_" + std::to_string(runs));
+
+        std::uint64_t g0 = timeline_now_ns();
+        generate_synthetic_campaign(dir, synth);
+        double gen_s = (timeline_now_ns() - g0) / 1e9;
+
+        AnalyzerProfile prof;
+        CampaignOutcomes o = analyze_injection_campaign(dir, runs, &prof);
+
+        json r;
+        r["runs"]           = runs;
+        r["threads"]        = omp_get_max_threads();
+        r["generate_s"]     = gen_s;
+        r["total_s"]        = prof.total_ns / 1e9;
+        r["files"]          = prof.files;
+        r["bytes"]          = prof.bytes;
+        r["files_per_sec"]  = rate(prof.files, prof.total_ns);
+        r["bytes_per_sec"]  = rate(prof.bytes, prof.total_ns);
+        r["stage_thread_s"] = {
+            {"json_parse", prof.json_parse_ns / 1e9},
+            {"compare",    prof.compare_ns / 1e9},
+            {"image_diff", prof.image_diff_ns / 1e9},
+            {"copy",       prof.copy_ns / 1e9},
+        };
+        r["outcomes"] = {
+            {"total", o.total}, {"crashed", o.crashed}, {"hanged", o.hanged},
+            {"sdc", o.sdc}, {"benign", o.benign}, {"masked", o.masked},
+        };
+        results.push_back(r);
+
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10) << runs
+                  << std::setw(10) << gen_s << std::setw(10) << prof.total_ns / 1e9
+                  << std::setprecision(0) << std::setw(12) << rate(prof.files, prof.total_ns)
+                  << std::setprecision(1) << std::setw(12) << rate(prof.bytes, prof.total_ns) / 1e6
+                  << std::setprecision(2) << std::setw(10) << prof.json_parse_ns / 1e9
+                  << std::setw(10) << prof.compare_ns / 1e9 << std::setw(10)
+                  << prof.image_diff_ns / 1e9 << std::setw(10) << prof.copy_ns / 1e9 << "\n";
+
+        if (!opt.keep) fs::remove_all(dir);
+    }
+
+    json doc;
+    doc["mix"] = {
+        {"sdc", opt.synth.sdc}, {"crash", opt.synth.crash}, {"hang", opt.synth.hang},
+        {"image_px", opt.synth.image_px}, {"binary_bytes", opt.synth.binary_bytes},
+        {"seed", opt.synth.seed},
+    };
+    doc["results"] = results;
+
+    std::ofstream out(opt.out);
+    if (!out) throw std::runtime_error("Cannot write " + opt.out);
+    out << doc.dump(2) << "\n";
+    std::cout << "\nResults written to " << opt.out << "\n";
+}
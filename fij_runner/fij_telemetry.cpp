@@ -0,0 +1,303 @@
+#include "fij_telemetry.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// -----------------------------------------------------------------------------
+// Kernel-side outcome of a run
+// -----------------------------------------------------------------------------
+
+TelemetryOutcome classify_outcome(const struct fij_result &res) {
+    int sig    = res.exit_code & 0x7f;
+    int status = (res.exit_code >> 8) & 0xff;
+
+    // the module kills masked and converged runs itself: check them first
+    if (res.watch_status == FIJ_WATCH_MASKED)  return OUTCOME_MASKED;
+    if (res.converged)                         return OUTCOME_CONVERGED;
+    if (res.process_hanged)                    return OUTCOME_HANG;
+    if (sig)                                   return OUTCOME_SIGNALED;
+    if (status)                                return OUTCOME_EXIT_ERROR;
+    return OUTCOME_EXIT_OK;
+}
+
+const char *outcome_name(TelemetryOutcome o) {
+    static const char *names[OUTCOME_NR] = {
+        "exit_ok", "exit_error", "signaled", "hang", "masked", "converged",
+    };
+    return o >= 0 && o < OUTCOME_NR ? names[o] : "unknown";
+}
+
+// -----------------------------------------------------------------------------
+// JobTelemetry
+// -----------------------------------------------------------------------------
+
+void JobTelemetry::set_phase(TelemetryPhase p) {
+    phase_start.store(std::chrono::steady_clock::now().time_since_epoch().count());
+    phase.store(p);
+}
+
+void JobTelemetry::record_outcome(const struct fij_result &res) {
+    outcomes[classify_outcome(res)]++;
+}
+
+// -----------------------------------------------------------------------------
+// CampaignTelemetry
+// -----------------------------------------------------------------------------
+
+namespace {
+
+const char *kPhaseNames[] = {"pending", "baseline", "injection", "analysis", "done"};
+
+std::string escape_label(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') { out += "\\n"; continue; }
+        out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+CampaignTelemetry::CampaignTelemetry(std::string file, std::string socket_path, int interval_ms)
+    : file_(std::move(file)), socket_path_(std::move(socket_path)),
+      interval_ms_(interval_ms > 0 ? interval_ms : 1000) {}
+
+CampaignTelemetry::~CampaignTelemetry() {
+    stop();
+}
+
+bool CampaignTelemetry::start() {
+    started_ = prev_time_ = std::chrono::steady_clock::now();
+
+    if (!socket_path_.empty()) {
+        struct sockaddr_un addr{};
+        if (socket_path_.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "[telemetry] socket path too long: " << socket_path_ << "\n";
+            return false;
+        }
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, socket_path_.c_str());
+
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        ::unlink(socket_path_.c_str());
+        if (listen_fd_ < 0 ||
+            ::bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listen_fd_, 8) != 0) {
+            std::cerr << "[telemetry] cannot listen on " << socket_path_ << ": "
+                      << std::strerror(errno) << "\n";
+            if (listen_fd_ >= 0) ::close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+    }
+
+    thread_ = std::thread([this] { loop(); });
+    return true;
+}
+
+void CampaignTelemetry::stop() {
+    if (!thread_.joinable()) return;
+
+    stop_.store(true);
+    thread_.join();
+
+    // leave the final numbers in the file, drop the socket
+    publish(render());
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        ::unlink(socket_path_.c_str());
+        listen_fd_ = -1;
+    }
+}
+
+JobTelemetry *CampaignTelemetry::add_job(const std::string &label, int baseline_runs,
+                                         int runs, int workers) {
+    auto job = std::make_unique<JobTelemetry>();
+    job->label            = label;
+    job->baseline_planned = baseline_runs;
+    job->runs_planned     = runs;
+    job->workers          = workers > 0 ? workers : 1;
+    job->phase_start      = std::chrono::steady_clock::now().time_since_epoch().count();
+
+    std::lock_guard<std::mutex> lock(jobs_mu_);
+    job->index = static_cast<int>(jobs_.size());
+    jobs_.push_back(std::move(job));
+    return jobs_.back().get();
+}
+
+std::string CampaignTelemetry::render() {
+    auto now = std::chrono::steady_clock::now();
+    std::ostringstream out;
+
+    std::lock_guard<std::mutex> lock(jobs_mu_);
+
+    long done = 0;
+    for (const auto &j : jobs_) done += j->baseline_done.load() + j->runs_done.load();
+
+    double window = std::chrono::duration<double>(now - prev_time_).count();
+    double rate   = window > 0.0 ? (done - prev_done_) / window : 0.0;
+    prev_done_ = done;
+    prev_time_ = now;
+
+    out << "# HELP fij_uptime_seconds Time since the runner started publishing.\n"
+        << "# TYPE fij_uptime_seconds gauge\n"
+        << "fij_uptime_seconds " << std::chrono::duration<double>(now - started_).count() << "\n"
+        << "# HELP fij_runs_per_second Completed runs per second over the last interval, all jobs.\n"
+        << "# TYPE fij_runs_per_second gauge\n"
+        << "fij_runs_per_second " << rate << "\n";
+
+    auto metric = [&](const char *name, const char *type, const char *help) {
+        out << "# HELP " << name << " " << help << "\n"
+            << "# TYPE " << name << " " << type << "\n";
+    };
+
+    auto labels = [&](const JobTelemetry &j) {
+        return "job=\"" + std::to_string(j.index) + "\",target=\"" + escape_label(j.label) + "\"";
+    };
+
+    metric("fij_job_phase", "gauge", "Current phase: 1 when the job is in that phase.");
+    for (const auto &j : jobs_) {
+        for (int p = TELEMETRY_PENDING; p <= TELEMETRY_DONE; ++p) {
+            out << "fij_job_phase{" << labels(*j) << ",phase=\"" << kPhaseNames[p] << "\"} "
+                << (j->phase.load() == p ? 1 : 0) << "\n";
+        }
+    }
+
+    metric("fij_job_runs_planned", "gauge", "Runs requested per kind.");
+    for (const auto &j : jobs_) {
+        out << "fij_job_runs_planned{" << labels(*j) << ",kind=\"baseline\"} " << j->baseline_planned << "\n"
+            << "fij_job_runs_planned{" << labels(*j) << ",kind=\"injection\"} " << j->runs_planned << "\n";
+    }
+
+    metric("fij_job_runs_completed_total", "counter", "Finished runs per kind (injection: fault injected).");
+    for (const auto &j : jobs_) {
+        out << "fij_job_runs_completed_total{" << labels(*j) << ",kind=\"baseline\"} " << j->baseline_done.load() << "\n"
+            << "fij_job_runs_completed_total{" << labels(*j) << ",kind=\"injection\"} " << j->runs_done.load() << "\n";
+    }
+
+    metric("fij_job_injection_attempts_total", "counter", "Injection runs started, including retries without a fault.");
+    for (const auto &j : jobs_)
+        out << "fij_job_injection_attempts_total{" << labels(*j) << "} " << j->attempts.load() << "\n";
+
+    metric("fij_job_in_flight", "gauge", "Runs currently holding the device open.");
+    for (const auto &j : jobs_)
+        out << "fij_job_in_flight{" << labels(*j) << "} " << j->in_flight.load() << "\n";
+
+    metric("fij_job_busy_workers", "gauge", "Workers currently running an iteration.");
+    for (const auto &j : jobs_)
+        out << "fij_job_busy_workers{" << labels(*j) << "} " << j->busy_workers.load() << "\n";
+
+    metric("fij_job_worker_utilization", "gauge", "Busy workers over configured workers.");
+    for (const auto &j : jobs_)
+        out << "fij_job_worker_utilization{" << labels(*j) << "} "
+            << static_cast<double>(j->busy_workers.load()) / j->workers << "\n";
+
+    metric("fij_job_ebusy_retries_total", "counter", "IOCTL_SEND_MSG retried because the device was busy.");
+    for (const auto &j : jobs_)
+        out << "fij_job_ebusy_retries_total{" << labels(*j) << "} " << j->ebusy_retries.load() << "\n";
+
+    metric("fij_job_kills_total", "counter", "Targets killed by the runner deadline.");
+    for (const auto &j : jobs_)
+        out << "fij_job_kills_total{" << labels(*j) << "} " << j->kills.load() << "\n";
+
+    metric("fij_job_outcomes_total", "counter", "Injected runs by kernel-reported outcome, before output comparison.");
+    for (const auto &j : jobs_) {
+        for (int o = 0; o < OUTCOME_NR; ++o) {
+            out << "fij_job_outcomes_total{" << labels(*j) << ",outcome=\"" << outcome_name(static_cast<TelemetryOutcome>(o)) << "\"} "
+                << j->outcomes[o].load() << "\n";
+        }
+    }
+
+    metric("fij_job_eta_seconds", "gauge", "Estimated time to the end of the job, -1 if unknown.");
+    for (const auto &j : jobs_) {
+        double eta = -1.0;
+        std::chrono::steady_clock::time_point since{
+            std::chrono::steady_clock::duration(j->phase_start.load())};
+        double elapsed = std::chrono::duration<double>(now - since).count();
+        int phase = j->phase.load();
+
+        if (phase == TELEMETRY_BASELINE) {
+            // injected runs take about as long as golden ones
+            long b = j->baseline_done.load();
+            if (b > 0 && elapsed > 0.0) {
+                double left = (j->baseline_planned - b) + j->runs_planned;
+                eta = left / (b / elapsed);
+            }
+        } else if (phase == TELEMETRY_INJECTION) {
+            long r = j->runs_done.load();
+            if (r > 0 && elapsed > 0.0) eta = (j->runs_planned - r) / (r / elapsed);
+        } else if (phase == TELEMETRY_ANALYSIS || phase == TELEMETRY_DONE) {
+            eta = 0.0;
+        }
+        out << "fij_job_eta_seconds{" << labels(*j) << "} " << eta << "\n";
+    }
+
+    return out.str();
+}
+
+void CampaignTelemetry::publish(const std::string &text) {
+    if (file_.empty()) return;
+
+    // scrapers must never see a half-written file
+    std::string tmp = file_ + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::trunc);
+        if (!f) return;
+        f << text;
+    }
+    std::rename(tmp.c_str(), file_.c_str());
+}
+
+void CampaignTelemetry::serve_socket(const std::string &text) {
+    int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) return;
+
+    const char *p = text.data();
+    std::size_t left = text.size();
+    while (left > 0) {
+        ssize_t n = ::send(fd, p, left, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+}
+
+void CampaignTelemetry::loop() {
+    auto next = std::chrono::steady_clock::now();
+    std::string text;
+
+    while (!stop_.load()) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next) {
+            // socket clients get the last sample so they don't skew the rate window
+            text = render();
+            publish(text);
+            next = now + std::chrono::milliseconds(interval_ms_);
+        }
+
+        // wake up often enough to notice stop() quickly
+        int wait_ms = static_cast<int>(std::min<long long>(
+            100, std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count()));
+        if (wait_ms < 1) wait_ms = 1;
+
+        if (listen_fd_ >= 0) {
+            struct pollfd pfd{listen_fd_, POLLIN, 0};
+            if (::poll(&pfd, 1, wait_ms) > 0) serve_socket(text);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+        }
+    }
+}
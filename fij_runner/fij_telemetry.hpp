@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <linux/fij.h>
+
+// -----------------------------------------------------------------------------
+// Live campaign telemetry
+// -----------------------------------------------------------------------------
+//
+// Workers bump the atomics of their JobTelemetry; a publisher thread renders
+// all jobs in Prometheus text format every interval, rewrites the metrics
+// file and answers connections on the optional Unix socket.
+
+enum TelemetryPhase {
+    TELEMETRY_PENDING = 0,
+    TELEMETRY_BASELINE,
+    TELEMETRY_INJECTION,
+    TELEMETRY_ANALYSIS,
+    TELEMETRY_DONE,
+};
+
+// Outcome as seen by the kernel, before any output comparison
+enum TelemetryOutcome {
+    OUTCOME_EXIT_OK = 0,
+    OUTCOME_EXIT_ERROR,
+    OUTCOME_SIGNALED,
+    OUTCOME_HANG,
+    OUTCOME_MASKED,
+    OUTCOME_CONVERGED,
+    OUTCOME_NR,
+};
+
+TelemetryOutcome classify_outcome(const struct fij_result &res);
+const char *outcome_name(TelemetryOutcome o);
+
+struct JobTelemetry {
+    int index = 0;
+    std::string label;
+    int baseline_planned = 0;
+    int runs_planned     = 0;
+    int workers          = 1;
+
+    std::atomic<int>  phase{TELEMETRY_PENDING};
+    std::atomic<long> baseline_done{0};
+    std::atomic<long> runs_done{0};         // injected runs with fault_injected
+    std::atomic<long> attempts{0};          // injection attempts, retries included
+    std::atomic<long> in_flight{0};         // runs between open() and close() of the device
+    std::atomic<long> busy_workers{0};
+    std::atomic<long> ebusy_retries{0};
+    std::atomic<long> kills{0};
+    std::atomic<long> outcomes[OUTCOME_NR]{};
+
+    std::atomic<std::chrono::steady_clock::rep> phase_start{0};   // steady_clock ticks
+
+    void set_phase(TelemetryPhase p);
+    void record_outcome(const struct fij_result &res);
+};
+
+// Keeps busy_workers / in_flight right when a run throws
+class TelemetryGauge {
+public:
+    TelemetryGauge(std::atomic<long> *g) : g_(g) { if (g_) ++*g_; }
+    ~TelemetryGauge() { if (g_) --*g_; }
+    TelemetryGauge(const TelemetryGauge &) = delete;
+    TelemetryGauge &operator=(const TelemetryGauge &) = delete;
+private:
+    std::atomic<long> *g_;
+};
+
+class CampaignTelemetry {
+public:
+    CampaignTelemetry(std::string file, std::string socket_path, int interval_ms);
+    ~CampaignTelemetry();
+
+    bool start();
+    void stop();
+
+    JobTelemetry *add_job(const std::string &label, int baseline_runs, int runs, int workers);
+
+private:
+    std::string render();
+    void publish(const std::string &text);
+    void serve_socket(const std::string &text);
+    void loop();
+
+    std::string file_;
+    std::string socket_path_;
+    int interval_ms_;
+    int listen_fd_ = -1;
+
+    std::mutex jobs_mu_;
+    std::vector<std::unique_ptr<JobTelemetry>> jobs_;
+
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+    std::chrono::steady_clock::time_point started_;
+
+    // previous sample for the windowed rate
+    long prev_done_ = 0;
+    std::chrono::steady_clock::time_point prev_time_;
+};
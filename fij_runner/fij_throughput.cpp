@@ -0,0 +1,162 @@
+#include "fij.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+// -----------------------------------------------------------------------------
+// End-to-end campaign benchmark
+// -----------------------------------------------------------------------------
+//
+// Runs every job of a config once per worker count, with a fixed number of
+// injections, and reports what a machine sustains on that workload: campaign
+// runs/sec, the cost of the baseline and analysis phases, disk bytes written
+// per run and the outcome mix, plus how the target was selected and what the
+// kernel spent stopping and flipping it, so thread/process scaling shows up
+// next to throughput. Campaign folders are removed after measuring unless
+// asked to keep them.
+
+namespace {
+
+std::uintmax_t dir_bytes(const fs::path &dir) {
+    std::uintmax_t total = 0;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(dir, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_regular_file(ec)) total += it->file_size(ec);
+    }
+    return total;
+}
+
+json outcomes_json(const CampaignOutcomes &o) {
+    return {
+        {"total",   o.total},
+        {"crashed", o.crashed},
+        {"hanged",  o.hanged},
+        {"sdc",     o.sdc},
+        {"benign",  o.benign},
+        {"masked",  o.masked},
+    };
+}
+
+std::string selection_label(const struct fij_params &p) {
+    std::string sel = p.process_present ? "proc " + std::to_string(p.nprocess) : "";
+    if (p.all_threads)         sel += (sel.empty() ? "" : ", ") + std::string("all threads");
+    else if (p.thread_present) sel += (sel.empty() ? "" : ", ") + ("thread " + std::to_string(p.thread));
+    return sel.empty() ? "random" : sel;
+}
+
+// injection-set p50/p99 per kernel phase, from the campaign's latency.csv
+json injection_latency(const fs::path &csv) {
+    json out = json::object();
+    std::ifstream in(csv);
+    std::string line;
+    std::getline(in, line); // header
+    while (std::getline(in, line)) {
+        std::vector<std::string> f;
+        std::stringstream ss(line);
+        for (std::string cell; std::getline(ss, cell, ',');) f.push_back(cell);
+        // set,phase,count,min_ns,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns
+        if (f.size() < 10 || f[0] != "injection") continue;
+        out[f[1]] = {{"p50", std::stoull(f[5])}, {"p99", std::stoull(f[7])}};
+    }
+    return out;
+}
+
+double latency_us(const json &lat, const char *phase) {
+    if (!lat.contains(phase)) return 0.0;
+    return lat[phase]["p50"].get<std::uint64_t>() / 1e3;
+}
+
+} // namespace
+
+void run_campaign_benchmark(const std::string &config_path, const CampaignBenchOptions &opt) {
+    json cfg = load_config_file(config_path);
+    if (!opt.base_path.empty()) cfg["base_path"] = opt.base_path;
+    std::vector<FijJob> jobs = build_fij_jobs_from_config(cfg);
+
+    if (jobs.empty()) throw std::runtime_error("No jobs in " + config_path);
+
+    json results = json::array();
+
+    std::cout << std::left << std::setw(40) << "target" << std::right << std::setw(8) << "workers"
+              << std::setw(10) << "runs/s" << std::setw(12) << "baseline s" << std::setw(12)
+              << "analysis s" << std::setw(14) << "bytes/run" << std::setw(14) << "selection"
+              << std::setw(12) << "stop us" << std::setw(10) << "flip us"
+              << "  crash/hang/sdc/benign/masked\n";
+
+    for (int workers : opt.workers) {
+        for (const auto &job : jobs) {
+            int runs = opt.runs > 0 ? opt.runs : job.runs;
+
+            // every run is done and drawn at random: no early stop, strata, plan, cache or profile
+            FijJob bench_job = job;
+            bench_job.runs     = runs;
+            bench_job.workers  = workers;
+            bench_job.stopping = StoppingRule{};
+            bench_job.strata   = StrataOptions{};
+            bench_job.plan     = PlanOptions{};
+            bench_job.cache    = OutcomeCacheOptions{};
+            bench_job.profile  = ProfileOptions{};
+
+            auto t0 = std::chrono::steady_clock::now();
+            CampaignResult cr = run_injection_campaign(
+                opt.device,
+                bench_job,
+                0,      // pre_delay_ms
+                5,      // max_retries
+                50,     // retry_delay_ms
+                false   // verbose
+            );
+            double total_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            std::uintmax_t bytes = dir_bytes(cr.campaign_path);
+            int finished = cr.baseline_success + cr.injection_success;
+            double runs_per_sec = cr.injection_s > 0 ? cr.injection_success / cr.injection_s : 0.0;
+            double bytes_per_run = finished > 0 ? static_cast<double>(bytes) / finished : 0.0;
+
+            std::string label = job.path + (job.args.empty() ? "" : " " + job.args);
+            std::string selection = selection_label(job.params);
+            json latency = injection_latency(cr.campaign_path / "diff" / "latency.csv");
+
+            json r;
+            r["target"]          = label;
+            r["workers"]         = workers;
+            r["runs"]            = runs;
+            r["injected"]        = cr.injection_success;
+            r["baseline_runs"]   = cr.baseline_success;
+            r["runs_per_sec"]    = runs_per_sec;
+            r["baseline_s"]      = cr.baseline_s;
+            r["injection_s"]     = cr.injection_s;
+            r["analysis_s"]      = cr.analysis_s;
+            r["total_s"]         = total_s;
+            r["bytes_written"]   = bytes;
+            r["bytes_per_run"]   = bytes_per_run;
+            r["outcomes"]        = outcomes_json(cr.outcomes);
+            r["selection"]       = selection;
+            r["latency_ns"]      = latency;
+            results.push_back(r);
+
+            const CampaignOutcomes &o = cr.outcomes;
+            std::string shown = label.size() > 38 ? "..." + label.substr(label.size() - 35) : label;
+            std::cout << std::left << std::setw(40) << shown << std::right << std::setw(8) << workers
+                      << std::fixed << std::setprecision(2) << std::setw(10) << runs_per_sec
+                      << std::setw(12) << cr.baseline_s << std::setw(12) << cr.analysis_s
+                      << std::setprecision(0) << std::setw(14) << bytes_per_run
+                      << std::setw(14) << selection << std::setprecision(1)
+                      << std::setw(12) << latency_us(latency, "stop_wait")
+                      << std::setw(10) << latency_us(latency, "flip") << "  " << o.crashed
+                      << "/" << o.hanged << "/" << o.sdc << "/" << o.benign << "/" << o.masked << "\n";
+
+            if (!opt.keep) fs::remove_all(cr.campaign_path);
+        }
+    }
+
+    json doc;
+    doc["config"]  = config_path;
+    doc["results"] = results;
+
+    std::ofstream out(opt.out);
+    if (!out) throw std::runtime_error("Cannot write " + opt.out);
+    out << doc.dump(2) << "\n";
+    std::cout << "\nResults written to " << opt.out << "\n";
+}
@@ -0,0 +1,223 @@
+#include "fij.hpp"
+
+#include <algorithm>
+#include <limits>
+
+// -----------------------------------------------------------------------------
+// Campaign timeline (Chrome trace format)
+// -----------------------------------------------------------------------------
+//
+// Every baseline and injection run becomes a slice on the track of the worker
+// that ran it; the kernel ts_* stamps of the run are nested inside as phase
+// slices. Runner work outside the workers goes on a separate "runner" track,
+// counters follow in-flight targets and their peak RSS, and the module
+// tracepoints, when recorded, are instant events on a "kernel" process.
+// steady_clock and the kernel stamps are both CLOCK_MONOTONIC, so everything
+// shares one time axis.
+
+namespace {
+
+constexpr int kRunnerPid = 1;
+constexpr int kKernelPid = 2;
+
+// nested phases: name, index of the first and last stamp in TimelineRun::ts
+struct TimelinePhase {
+    const char *name;
+    int from;
+    int to;
+};
+
+const std::vector<TimelinePhase> kInjectedPhases = {
+    {"exec",       0, 1},
+    {"arm",        1, 2},
+    {"until_flip", 2, 3},
+    {"stop_wait",  3, 4},
+    {"flip",       4, 5},
+    {"after_flip", 5, 6},
+    {"collect",    6, 7},
+};
+
+// baseline runs and injections that never fired
+const std::vector<TimelinePhase> kPlainPhases = {
+    {"exec",    0, 1},
+    {"arm",     1, 2},
+    {"target",  2, 6},
+    {"collect", 6, 7},
+};
+
+double to_us(std::uint64_t ns, std::uint64_t origin) {
+    return static_cast<double>(ns - origin) / 1000.0;
+}
+
+json slice(const std::string &name, const std::string &cat, int pid, int tid,
+           std::uint64_t start_ns, std::uint64_t end_ns, std::uint64_t origin) {
+    json e;
+    e["name"] = name;
+    e["cat"]  = cat;
+    e["ph"]   = "X";
+    e["pid"]  = pid;
+    e["tid"]  = tid;
+    e["ts"]   = to_us(start_ns, origin);
+    e["dur"]  = to_us(end_ns, start_ns);
+    return e;
+}
+
+json metadata(const char *what, int pid, int tid, const std::string &name) {
+    json e;
+    e["name"] = what;
+    e["ph"]   = "M";
+    e["pid"]  = pid;
+    e["tid"]  = tid;
+    e["args"] = {{"name", name}};
+    return e;
+}
+
+} // namespace
+
+std::uint64_t timeline_now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+TimelineRun timeline_run(int worker, int run, const std::string &kind,
+                         std::uint64_t start_ns, std::uint64_t end_ns,
+                         const struct fij_result *res) {
+    TimelineRun r{};
+    r.worker   = worker;
+    r.run      = run;
+    r.kind     = kind;
+    r.start_ns = start_ns;
+    r.end_ns   = end_ns;
+    if (!res) return r;
+
+    r.exit_code = res->exit_code;
+    r.maxrss_kb = res->maxrss_kb;
+
+    if ((res->exit_code & 0x7f) == SIGKILL || res->process_hanged) {
+        if (res->hang_detected)                        r.kill_reason = "livelock";
+        else if (res->cpu_budget_exceeded)             r.kill_reason = "cpu_budget";
+        else if (res->converged)                       r.kill_reason = "converged";
+        else if (res->watch_status == FIJ_WATCH_MASKED) r.kill_reason = "masked";
+        else                                           r.kill_reason = "deadline";
+    }
+
+    const __u64 *stamps[8] = {
+        &res->ts_exec_start, &res->ts_exec_done, &res->ts_resume, &res->ts_flip_start,
+        &res->ts_flip_stopped, &res->ts_flip_end, &res->ts_exit, &res->ts_collect,
+    };
+    for (int k = 0; k < 8; ++k) r.ts[k] = *stamps[k];
+    return r;
+}
+
+// -----------------------------------------------------------------------------
+// write_timeline_trace
+// -----------------------------------------------------------------------------
+
+void write_timeline_trace(
+    const fs::path &path,
+    const CampaignResult &cr,
+    const std::vector<KernelTraceEvent> &kernel_events
+) {
+    std::uint64_t origin = std::numeric_limits<std::uint64_t>::max();
+    for (const auto &r : cr.timeline_runs)  origin = std::min(origin, r.start_ns);
+    for (const auto &s : cr.timeline_spans) origin = std::min(origin, s.start_ns);
+    for (const auto &e : kernel_events)     origin = std::min(origin, e.ts_ns);
+    if (origin == std::numeric_limits<std::uint64_t>::max()) origin = 0;
+
+    int runner_tid = std::max(cr.workers, 1);
+    json events = json::array();
+
+    events.push_back(metadata("process_name", kRunnerPid, 0, "fij runner"));
+    for (int w = 0; w < runner_tid; ++w)
+        events.push_back(metadata("thread_name", kRunnerPid, w, "worker " + std::to_string(w)));
+    events.push_back(metadata("thread_name", kRunnerPid, runner_tid, "runner"));
+
+    // runs, with the kernel phases nested inside
+    for (const auto &r : cr.timeline_runs) {
+        json e = slice(r.kind + " #" + std::to_string(r.run), r.kind, kRunnerPid, r.worker,
+                       r.start_ns, r.end_ns, origin);
+        e["args"] = {{"run", r.run}, {"exit_code", r.exit_code}};
+        if (!r.kill_reason.empty()) e["args"]["kill"] = r.kill_reason;
+        events.push_back(std::move(e));
+
+        // failed runs have no stamps, unreached phases are 0
+        const auto &phases = r.ts[3] ? kInjectedPhases : kPlainPhases;
+        for (const auto &ph : phases) {
+            std::uint64_t from = r.ts[ph.from], to = r.ts[ph.to];
+            if (!from || to < from) continue;
+            events.push_back(slice(ph.name, "kernel", kRunnerPid, r.worker, from, to, origin));
+        }
+
+        if (!r.kill_reason.empty()) {
+            json k;
+            k["name"] = "kill";
+            k["cat"]  = "kill";
+            k["ph"]   = "i";
+            k["s"]    = "t";
+            k["pid"]  = kRunnerPid;
+            k["tid"]  = r.worker;
+            k["ts"]   = to_us(r.ts[6] ? r.ts[6] : r.end_ns, origin);
+            k["args"] = {{"reason", r.kill_reason}, {"run", r.run}};
+            events.push_back(std::move(k));
+        }
+    }
+
+    for (const auto &s : cr.timeline_spans)
+        events.push_back(slice(s.name, "runner", kRunnerPid, runner_tid, s.start_ns, s.end_ns, origin));
+
+    // counters: targets in flight, peak RSS of the target that just finished
+    std::vector<std::pair<std::uint64_t, int>> edges;
+    for (const auto &r : cr.timeline_runs) {
+        edges.emplace_back(r.start_ns, +1);
+        edges.emplace_back(r.end_ns, -1);
+    }
+    std::sort(edges.begin(), edges.end());
+    int in_flight = 0;
+    for (const auto &[t, d] : edges) {
+        in_flight += d;
+        json c;
+        c["name"] = "in_flight";
+        c["ph"]   = "C";
+        c["pid"]  = kRunnerPid;
+        c["ts"]   = to_us(t, origin);
+        c["args"] = {{"targets", in_flight}};
+        events.push_back(std::move(c));
+    }
+    for (const auto &r : cr.timeline_runs) {
+        if (!r.maxrss_kb) continue;
+        json c;
+        c["name"] = "target_maxrss_kb";
+        c["ph"]   = "C";
+        c["pid"]  = kRunnerPid;
+        c["ts"]   = to_us(r.end_ns, origin);
+        c["args"] = {{"kB", r.maxrss_kb}};
+        events.push_back(std::move(c));
+    }
+
+    // module tracepoints, one track per emitting task
+    if (!kernel_events.empty()) {
+        events.push_back(metadata("process_name", kKernelPid, 0, "fij module"));
+        for (const auto &ev : kernel_events) {
+            json k;
+            k["name"] = ev.event;
+            k["cat"]  = "tracepoint";
+            k["ph"]   = "i";
+            k["s"]    = "t";
+            k["pid"]  = kKernelPid;
+            k["tid"]  = ev.pid;
+            k["ts"]   = to_us(ev.ts_ns, origin);
+            k["args"] = {{"cpu", ev.cpu}, {"task", ev.task}, {"fields", ev.fields}};
+            events.push_back(std::move(k));
+        }
+    }
+
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "[timeline] cannot write " << path << "\n";
+        return;
+    }
+    json doc;
+    doc["traceEvents"]     = std::move(events);
+    doc["displayTimeUnit"] = "ns";
+    out << doc.dump() << "\n";
+}
@@ -0,0 +1,172 @@
+#include "fij.hpp"
+
+#include <atomic>
+#include <regex>
+
+#include <poll.h>
+#include <sys/stat.h>
+
+// -----------------------------------------------------------------------------
+// Kernel tracepoint stream
+// -----------------------------------------------------------------------------
+//
+// The module emits events/fij tracepoints (exec, stop, flip, resume, exit,
+// kill). A private tracefs instance keeps them out of the global buffer; its
+// clock is set to "mono" so event times line up with the ts_* stamps of
+// fij_result. A background thread drains trace_pipe while the campaign runs.
+
+namespace {
+
+const char *kTracefsRoots[] = {"/sys/kernel/tracing", "/sys/kernel/debug/tracing"};
+const char *kInstanceName   = "fij_runner";
+
+bool write_tracefs(const fs::path &p, const std::string &value) {
+    std::ofstream f(p);
+    if (!f) return false;
+    f << value;
+    f.flush();
+    return static_cast<bool>(f);
+}
+
+// "  fij_monitor-1234    [003] d..1.  5012.123456: fij_exit: tgid=..."
+bool parse_trace_line(const std::string &line, KernelTraceEvent &ev) {
+    static const std::regex re(
+        R"(^\s*(.+)-(\d+)\s+(?:\(\s*[-\d]+\)\s+)?\[(\d+)\]\s+(?:\S+\s+)?(\d+)\.(\d+):\s+(\w+):\s?(.*)$)");
+    std::smatch m;
+    if (!std::regex_match(line, m, re)) return false;
+
+    std::string frac = m[5].str();
+    std::uint64_t frac_ns = std::stoull(frac);
+    for (std::size_t k = frac.size(); k < 9; ++k) frac_ns *= 10;
+
+    ev.task   = m[1].str();
+    ev.pid    = std::stoi(m[2].str());
+    ev.cpu    = std::stoi(m[3].str());
+    ev.ts_ns  = std::stoull(m[4].str()) * 1000000000ULL + frac_ns;
+    ev.event  = m[6].str();
+    ev.fields = m[7].str();
+    return true;
+}
+
+} // namespace
+
+struct KernelTraceSession {
+    fs::path instance;
+    int fd = -1;
+    std::atomic<bool> stop{false};
+    std::thread reader;
+    std::vector<KernelTraceEvent> events;
+    std::string partial;
+
+    void drain() {
+        char buf[65536];
+        for (;;) {
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            if (n <= 0) return;
+            partial.append(buf, static_cast<std::size_t>(n));
+
+            std::size_t start = 0, nl;
+            while ((nl = partial.find('\n', start)) != std::string::npos) {
+                KernelTraceEvent ev;
+                if (parse_trace_line(partial.substr(start, nl - start), ev))
+                    events.push_back(std::move(ev));
+                start = nl + 1;
+            }
+            partial.erase(0, start);
+        }
+    }
+
+    void run() {
+        struct pollfd pfd{fd, POLLIN, 0};
+        while (!stop.load()) {
+            if (::poll(&pfd, 1, 100) > 0) drain();
+        }
+        drain();
+    }
+
+    // also runs when a campaign throws with the session still open
+    void shutdown() {
+        if (fd < 0) return;
+        stop.store(true);
+        if (reader.joinable()) reader.join();
+
+        write_tracefs(instance / "events/fij/enable", "0");
+        ::close(fd);
+        fd = -1;
+        ::rmdir(instance.c_str());
+    }
+
+    ~KernelTraceSession() { shutdown(); }
+};
+
+// -----------------------------------------------------------------------------
+// kernel_trace_start / kernel_trace_stop
+// -----------------------------------------------------------------------------
+
+std::shared_ptr<KernelTraceSession> kernel_trace_start() {
+    fs::path root;
+    for (const char *r : kTracefsRoots) {
+        if (fs::exists(fs::path(r) / "instances")) {
+            root = r;
+            break;
+        }
+    }
+    if (root.empty()) {
+        std::cerr << "[trace] tracefs not mounted, kernel trace disabled\n";
+        return nullptr;
+    }
+
+    auto s = std::make_shared<KernelTraceSession>();
+    s->instance = root / "instances" / kInstanceName;
+
+    // an instance left over by a crashed runner is reused as is
+    if (!fs::exists(s->instance) && ::mkdir(s->instance.c_str(), 0755) != 0) {
+        std::cerr << "[trace] cannot create " << s->instance << ": "
+                  << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+
+    write_tracefs(s->instance / "trace_clock", "mono");
+    if (!write_tracefs(s->instance / "events/fij/enable", "1")) {
+        std::cerr << "[trace] fij tracepoints not available (module loaded?)\n";
+        ::rmdir(s->instance.c_str());
+        return nullptr;
+    }
+
+    s->fd = ::open((s->instance / "trace_pipe").c_str(), O_RDONLY | O_NONBLOCK);
+    if (s->fd < 0) {
+        std::cerr << "[trace] cannot open trace_pipe: " << std::strerror(errno) << "\n";
+        write_tracefs(s->instance / "events/fij/enable", "0");
+        ::rmdir(s->instance.c_str());
+        return nullptr;
+    }
+
+    KernelTraceSession *raw = s.get();
+    s->reader = std::thread([raw] { raw->run(); });
+    return s;
+}
+
+std::vector<KernelTraceEvent> kernel_trace_stop(const std::shared_ptr<KernelTraceSession> &s) {
+    if (!s) return {};
+
+    s->shutdown();
+    return std::move(s->events);
+}
+
+// -----------------------------------------------------------------------------
+// write_kernel_timeline
+// -----------------------------------------------------------------------------
+
+void write_kernel_timeline(const fs::path &path, const std::vector<KernelTraceEvent> &events) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "[trace] cannot write " << path << "\n";
+        return;
+    }
+
+    out << "ts_ns,cpu,task,pid,event,fields\n";
+    for (const auto &ev : events) {
+        out << ev.ts_ns << "," << ev.cpu << "," << ev.task << "," << ev.pid << ","
+            << ev.event << ",\"" << ev.fields << "\"\n";
+    }
+}
@@ -1,15 +1,122 @@
 #include "fij.hpp"
 
+namespace {
+
+void usage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " CONFIG.json [--resume | --top-up N | --replay RUN]\n"
+              << "       " << argv0 << " --bench CONFIG.json [--workers 1,2,4] [--runs N]\n"
+              << "           [--base-path DIR] [--out FILE] [--keep]\n"
+              << "       " << argv0 << " --bench-analyzer [--runs 1000,100000,1000000] [--dir DIR]\n"
+              << "           [--sdc F] [--crash F] [--hang F] [--image-px N] [--binary-bytes N]\n"
+              << "           [--seed N] [--out FILE] [--keep]\n";
+}
+
+std::vector<int> parse_int_list(std::string list) {
+    std::vector<int> out;
+    std::size_t pos;
+    while ((pos = list.find(',')) != std::string::npos) {
+        out.push_back(std::stoi(list.substr(0, pos)));
+        list.erase(0, pos + 1);
+    }
+    if (!list.empty()) out.push_back(std::stoi(list));
+    return out;
+}
+
+int bench_analyzer_main(int argc, char **argv) {
+    AnalyzerBenchOptions opt;
+
+    try {
+        for (int i = 2; i < argc; ++i) {
+            std::string a = argv[i];
+            bool has_value = i + 1 < argc;
+            if (a == "--runs" && has_value)              opt.runs = parse_int_list(argv[++i]);
+            else if (a == "--dir" && has_value)          opt.dir = argv[++i];
+            else if (a == "--sdc" && has_value)          opt.synth.sdc = std::stod(argv[++i]);
+            else if (a == "--crash" && has_value)        opt.synth.crash = std::stod(argv[++i]);
+            else if (a == "--hang" && has_value)         opt.synth.hang = std::stod(argv[++i]);
+            else if (a == "--image-px" && has_value)     opt.synth.image_px = std::stoi(argv[++i]);
+            else if (a == "--binary-bytes" && has_value) opt.synth.binary_bytes = std::stoul(argv[++i]);
+            else if (a == "--seed" && has_value)         opt.synth.seed = std::stoull(argv[++i]);
+            else if (a == "--out" && has_value)          opt.out = argv[++i];
+            else if (a == "--keep")                      opt.keep = true;
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+
+        run_analyzer_benchmark(opt);
+    } catch (const std::exception &e) {
+        std::cerr << "Fatal error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+} // namespace
+
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " CONFIG.json\n";
+    if (argc >= 2 && std::string(argv[1]) == "--bench-analyzer")
+        return bench_analyzer_main(argc, argv);
+
+    if (argc >= 2 && std::string(argv[1]).rfind("--", 0) != 0) {
+        ResumeOptions resume;
+        bool replay = false;
+        try {
+            for (int i = 2; i < argc; ++i) {
+                std::string a = argv[i];
+                bool has_value = i + 1 < argc;
+                if (a == "--resume")                   resume.resume = true;
+                else if (a == "--top-up" && has_value) resume.top_up = std::stoi(argv[++i]);
+                else if (a == "--replay" && has_value) {
+                    resume.replay = std::stoi(argv[++i]);
+                    replay = true;
+                }
+                else {
+                    usage(argv[0]);
+                    return 1;
+                }
+            }
+            // a replay reruns one journaled run, it does not extend the campaign
+            if (resume.top_up < 0 ||
+                (replay && (resume.replay < 0 || resume.resume || resume.top_up > 0))) {
+                usage(argv[0]);
+                return 1;
+            }
+
+            run_campaigns_from_config(argv[1], "/dev/fij", 0, 5, 50, true, resume);
+        } catch (const std::exception &e) {
+            std::cerr << "Fatal error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc < 3 || std::string(argv[1]) != "--bench") {
+        usage(argv[0]);
         return 1;
     }
 
-    std::string config_path = argv[1];
+    std::string config_path = argv[2];
+    CampaignBenchOptions opt;
 
     try {
-        run_campaigns_from_config(config_path);
+        for (int i = 3; i < argc; ++i) {
+            std::string a = argv[i];
+            bool has_value = i + 1 < argc;
+            if (a == "--workers" && has_value)        opt.workers = parse_int_list(argv[++i]);
+            else if (a == "--runs" && has_value)      opt.runs = std::stoi(argv[++i]);
+            else if (a == "--base-path" && has_value) opt.base_path = argv[++i];
+            else if (a == "--out" && has_value)       opt.out = argv[++i];
+            else if (a == "--keep")                   opt.keep = true;
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+
+        run_campaign_benchmark(config_path, opt);
     } catch (const std::exception &e) {
         std::cerr << "Fatal error: " << e.what() << "\n";
         return 1;